@@ -33,6 +33,7 @@
 #include <atomic>
 #include <functional>
 #include <map>
+#include <set>
 #include <vector>
 #include <utility>
 #include <memory>
@@ -46,6 +47,27 @@
 #include <thread>
 #include <condition_variable>
 #include <regex>
+#include <algorithm>
+#include <tuple>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <fstream>
+#include <new>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 35))) && (defined(__x86_64__) || defined(__aarch64__))
+#include <sys/rseq.h>
+#define MEASURO_RSEQ_CPU_ID 1
+#endif
+#endif
 
 namespace measuro
 {
@@ -158,6 +180,67 @@ namespace measuro
         }
     };
 
+    /*!
+     * @class ExpressionError
+     *
+     * @brief Describes an error in the expression of a derived metric.
+     *
+     * @remarks thread-safe
+     */
+    class ExpressionError : public MeasuroError
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    description    Description of the error
+         */
+        ExpressionError(const std::string description) : MeasuroError(description)
+        {
+        }
+    };
+
+    /*!
+     * @class MetricConfigError
+     *
+     * @brief Describes an error due to an invalid metric configuration.
+     *
+     * @remarks thread-safe
+     */
+    class MetricConfigError : public MeasuroError
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    description    Description of the error
+         */
+        MetricConfigError(const std::string description) : MeasuroError(description)
+        {
+        }
+    };
+
+    /*!
+     * @class CategoryError
+     *
+     * @brief Describes an error due to an unknown or out-of-range category
+     * or state of a metric with a fixed set of categories or states.
+     *
+     * @remarks thread-safe
+     */
+    class CategoryError : public MeasuroError
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    description    Description of the error
+         */
+        CategoryError(const std::string description) : MeasuroError(description)
+        {
+        }
+    };
+
     /*!
     * Retrieves the current Measuro version as integers.
     *
@@ -253,6 +336,72 @@ namespace measuro
      */
     enum class SUM { KIND };
 
+    /*!
+     * @enum MEAN
+     *
+     * Enum used to uniquely identify mean metric types in code. The actual
+     * value is MEAN::KIND
+     */
+    enum class MEAN { KIND };
+
+    /*!
+     * @enum DERIVED
+     *
+     * Enum used to uniquely identify derived metric types in code. The actual
+     * value is DERIVED::KIND
+     */
+    enum class DERIVED { KIND };
+
+    /*!
+     * @enum WINDOWED
+     *
+     * Enum used to uniquely identify windowed counter metric types in code.
+     * The actual value is WINDOWED::KIND
+     */
+    enum class WINDOWED { KIND };
+
+    /*!
+     * @enum EWMA
+     *
+     * Enum used to uniquely identify exponentially weighted moving average
+     * metric types in code. The actual value is EWMA::KIND
+     */
+    enum class EWMA { KIND };
+
+    /*!
+     * @enum CATEGORY
+     *
+     * Enum used to uniquely identify category counter metric types in code.
+     * The actual value is CATEGORY::KIND
+     */
+    enum class CATEGORY { KIND };
+
+    /*!
+     * @enum STATE
+     *
+     * Enum used to uniquely identify state machine metric types in code.
+     * The actual value is STATE::KIND
+     */
+    enum class STATE { KIND };
+
+    /*!
+     * @enum CALLBACK
+     *
+     * Enum used to uniquely identify callback gauge metric types in code.
+     * The actual value is CALLBACK::KIND
+     */
+    enum class CALLBACK { KIND };
+
+    /*!
+     * @enum BLOCK
+     *
+     * Enum used to uniquely identify block counter metric types in code.
+     * The actual value is BLOCK::KIND
+     */
+    enum class BLOCK { KIND };
+
+    class Registry;
+
     /*!
      * @class Metric
      *
@@ -272,7 +421,7 @@ namespace measuro
          *
          * The kind of metric as determined by the inheriting class.
          */
-        enum class Kind { UINT = 0, INT = 1, FLOAT = 2, RATE = 3, STR = 4, BOOL = 5, SUM = 6 };
+        enum class Kind { UINT = 0, INT = 1, FLOAT = 2, RATE = 3, STR = 4, BOOL = 5, SUM = 6, MEAN = 7, DERIVED = 8, WINDOWED = 9, EWMA = 10, CATEGORY = 11, STATE = 12, CALLBACK = 13, BLOCK = 14 };
 
         /*!
          * Constructor.
@@ -288,7 +437,8 @@ namespace measuro
                 std::function<std::chrono::steady_clock::time_point ()> time_function,
                 const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
         : m_time_function(time_function), m_kind(kind), m_name(name), m_unit(unit), m_description(description),
-          m_last_hook_update(m_time_function()), m_hook_rate_limit(hook_rate_limit), m_has_hooks(false)
+          m_last_hook_update(m_time_function()), m_hook_rate_limit(hook_rate_limit), m_has_hooks(false), m_claimed_pass(0), m_completed_pass(0),
+          m_render_delta(false), m_id(std::numeric_limits<std::uint64_t>::max())
         {
         }
 
@@ -301,7 +451,8 @@ namespace measuro
                 std::function<std::chrono::steady_clock::time_point ()> time_function,
                 const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
         : m_time_function(time_function), m_kind(kind), m_name(name), m_unit(unit), m_description(description),
-          m_last_hook_update(m_time_function()), m_hook_rate_limit(hook_rate_limit), m_has_hooks(false)
+          m_last_hook_update(m_time_function()), m_hook_rate_limit(hook_rate_limit), m_has_hooks(false), m_claimed_pass(0), m_completed_pass(0),
+          m_render_delta(false), m_id(std::numeric_limits<std::uint64_t>::max())
         {
         }
 
@@ -314,7 +465,8 @@ namespace measuro
                 std::function<std::chrono::steady_clock::time_point ()> time_function,
                 const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
         : m_time_function(time_function), m_kind(kind), m_name(name), m_description(description),
-          m_last_hook_update(m_time_function()), m_hook_rate_limit(hook_rate_limit), m_has_hooks(false)
+          m_last_hook_update(m_time_function()), m_hook_rate_limit(hook_rate_limit), m_has_hooks(false), m_claimed_pass(0), m_completed_pass(0),
+          m_render_delta(false), m_id(std::numeric_limits<std::uint64_t>::max())
         {
         }
 
@@ -327,7 +479,8 @@ namespace measuro
                 std::function<std::chrono::steady_clock::time_point ()> time_function,
                 const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
         : m_time_function(time_function), m_kind(kind), m_name(name), m_description(description), m_last_hook_update(m_time_function()),
-          m_hook_rate_limit(hook_rate_limit), m_has_hooks(false)
+          m_hook_rate_limit(hook_rate_limit), m_has_hooks(false), m_claimed_pass(0), m_completed_pass(0),
+          m_render_delta(false), m_id(std::numeric_limits<std::uint64_t>::max())
         {
         }
 
@@ -386,6 +539,24 @@ namespace measuro
             return m_kind;
         }
 
+        /*!
+         * Get the metric's ID. The low 32 bits of an ID are a dense index,
+         * starting from 0, assigned by the registry in the order in which
+         * metrics are created. A metric keeps its ID until it's removed from
+         * the registry, after which its index may be given to a new metric.
+         * The high 32 bits count the times the index has been reused, so a
+         * removed metric's ID is never given to another metric. A
+         * registry's first 2^32 metrics have IDs equal to their indexes.
+         *
+         * @return the metric's ID, or the maximum std::uint64_t value if the metric isn't in a registry
+         *
+         * @remarks thread-safe
+         */
+        std::uint64_t id() const noexcept
+        {
+            return m_id;
+        }
+
         /*!
          * Get a string representation of the kind of the metric.
          *
@@ -426,6 +597,22 @@ namespace measuro
                 return "BOOL";
             case Kind::SUM:
                 return "SUM";
+            case Kind::MEAN:
+                return "MEAN";
+            case Kind::DERIVED:
+                return "DERIVED";
+            case Kind::WINDOWED:
+                return "WINDOWED";
+            case Kind::EWMA:
+                return "EWMA";
+            case Kind::CATEGORY:
+                return "CATEGORY";
+            case Kind::STATE:
+                return "STATE";
+            case Kind::CALLBACK:
+                return "CALLBACK";
+            case Kind::BLOCK:
+                return "BLOCK";
             }
 
             return "";
@@ -491,6 +678,20 @@ namespace measuro
             return false;
         }
 
+        /*!
+         * Get the metric's value as a double, whatever its native numeric
+         * type. Only call this method if the metric kind is numeric, i.e. not
+         * @c Metric::Kind::STR or @c Metric::Kind::BOOL.
+         *
+         * @throws MetricCastError
+         */
+        virtual double numeric_value() const
+        {
+            throw MetricCastError("Metric " + m_name + " of kind " + kind_name() + " has no numeric value");
+
+            return 0.0;
+        }
+
         /*!
          * Used by inheriting metric classes to separate the evaluation of the
          * metric value (performed by @c calculate()) from the representation
@@ -502,6 +703,118 @@ namespace measuro
             return;
         }
 
+        /*!
+         * Get any labelled values the metric tracks in addition to its main
+         * value, for inclusion in rendered output. Values are always numeric.
+         * Most metric kinds have none.
+         *
+         * @return list of (label, value) pairs, in the order they should be rendered
+         *
+         * @remarks thread-safe
+         */
+        virtual std::vector<std::pair<std::string, std::string> > series() const noexcept(false)
+        {
+            return std::vector<std::pair<std::string, std::string> >();
+        }
+
+        /*!
+         * Get the metrics whose values are read by ::calculate. The registry
+         * uses these to calculate metrics in dependency order, so that a
+         * metric is always calculated after the metrics it depends on.
+         *
+         * @return list of metrics on which this metric depends
+         *
+         * @remarks thread-safe
+         */
+        virtual std::vector<std::shared_ptr<Metric> > dependencies() const noexcept(false)
+        {
+            return std::vector<std::shared_ptr<Metric> >();
+        }
+
+        /*!
+         * Stops the metric depending on a metric that's being removed from
+         * the registry. By default a metric can't do without its
+         * dependencies, and is removed along with them.
+         *
+         * @param[in]    dependency    The metric being removed
+         *
+         * @return true if the metric no longer depends on the removed metric, false if it must be removed too
+         *
+         * @remarks thread-safe
+         */
+        virtual bool drop_dependency(const Metric & dependency) noexcept(false)
+        {
+            (void)(dependency);
+
+            return false;
+        }
+
+        /*!
+         * Get the change in the metric's value since a checkpoint, for
+         * rendering metrics as per-interval deltas rather than running
+         * totals. Only counter-like kinds (unsigned, signed and float
+         * metrics, and sums of them) support deltas.
+         *
+         * @param[in,out]    checkpoint    The value at the previous checkpoint, as stored by the previous call. Zero initially. Updated to the current value
+         * @param[out]       result        The change in value, formatted in the same way as the metric itself
+         *
+         * @return @c true if the metric supports deltas, @c false otherwise (in which case neither argument is modified)
+         *
+         * @remarks thread-safe
+         */
+        virtual bool delta(std::uint64_t & checkpoint, std::string & result) const noexcept(false)
+        {
+            (void)(checkpoint);
+            (void)(result);
+
+            return false;
+        }
+
+        /*!
+         * Get whether the metric's value is a total for the interval since
+         * the previous render, rather than a running total.
+         *
+         * @return @c true if the value is a per-interval total
+         *
+         * @remarks thread-safe
+         */
+        virtual bool per_interval() const noexcept
+        {
+            return false;
+        }
+
+        /*!
+         * Sets whether the metric should always be rendered as the change in
+         * its value since the previous render, rather than as its current
+         * value. Each renderer tracks its own previous values. Has no
+         * effect on metrics that don't support deltas.
+         *
+         * @param[in]    enabled    @c true to render deltas, @c false to render current values
+         *
+         * @see Metric::delta
+         * @see Renderer::delta
+         *
+         * @remarks thread-safe
+         */
+        void render_delta(const bool enabled) noexcept
+        {
+            m_render_delta = enabled;
+        }
+
+        /*!
+         * Get whether the metric is always rendered as a delta.
+         *
+         * @return @c true if the metric is rendered as a delta
+         *
+         * @see Metric::render_delta(const bool)
+         *
+         * @remarks thread-safe
+         */
+        bool render_delta() const noexcept
+        {
+            return m_render_delta;
+        }
+
         /*!
          * Registers a "hook" function against the metric that will be called
          * when the metric's value changes, in accordance with the hook rate
@@ -574,10 +887,112 @@ namespace measuro
             }
         }
 
+        /*!
+         * Implements Metric::delta for a metric with the native type T.
+         * Unsigned values that have fallen since the checkpoint are assumed
+         * to have been reset, so the delta is the current value.
+         *
+         * @param[in]        current       The metric's current value
+         * @param[in,out]    checkpoint    @see Metric::delta
+         *
+         * @return the change in value, formatted like the metric itself
+         */
+        template<typename T>
+        static std::string delta_of(const T current, std::uint64_t & checkpoint) noexcept(false)
+        {
+            static_assert(sizeof(T) <= sizeof(std::uint64_t), "Native type too large for a delta checkpoint");
+
+            T last = 0;
+            std::memcpy(&last, &checkpoint, sizeof(T));
+            checkpoint = 0;
+            std::memcpy(&checkpoint, &current, sizeof(T));
+
+            T change = ((std::is_unsigned<T>::value) && (current < last)) ? current : T(current - last);
+
+            std::stringstream formatter;
+            formatter << std::fixed << std::setprecision(2) << change;
+
+            return formatter.str();
+        }
+
         mutable std::mutex m_metric_mutex; //!< Mutex for protecting concurrent access to the metric's members
         std::function<std::chrono::steady_clock::time_point ()> m_time_function; //!< Function used to determine the time
 
     private:
+        friend class Registry;
+        friend class Renderer;
+        friend class MetricIndex;
+
+        static const unsigned ID_INDEX_BITS = 32; //!< Number of low bits of an ID that hold its index, @see ::id()
+
+        /*!
+         * Get the dense index part of an ID, @see ::id()
+         */
+        static std::uint64_t index_of(const std::uint64_t id) noexcept
+        {
+            return id & ((std::uint64_t(1) << ID_INDEX_BITS) - 1);
+        }
+
+        /*!
+         * Get a new, globally unique calculation pass identifier. A pass is a
+         * single traversal of a set of metrics during which each metric is
+         * calculated at most once.
+         *
+         * @return pass identifier
+         */
+        static std::uint64_t next_calculation_pass() noexcept
+        {
+            static std::atomic<std::uint64_t> next_pass(1);
+
+            return next_pass.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /*!
+         * Claims the metric for calculation in the specified pass.
+         *
+         * @param[in]    pass    The calculation pass
+         *
+         * @return @c true if the caller should calculate the metric, @c false if it has already been claimed in this pass
+         */
+        bool claim_calculation(const std::uint64_t pass) noexcept
+        {
+            std::uint64_t claimed = m_claimed_pass.load(std::memory_order_relaxed);
+
+            while (claimed != pass)
+            {
+                if (m_claimed_pass.compare_exchange_weak(claimed, pass, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /*!
+         * Marks the metric's calculation in the specified pass as complete.
+         *
+         * @param[in]    pass    The calculation pass
+         */
+        void complete_calculation(const std::uint64_t pass) noexcept
+        {
+            m_completed_pass.store(pass, std::memory_order_release);
+        }
+
+        /*!
+         * Waits for a calculation claimed by another thread in the specified
+         * pass to complete.
+         *
+         * @param[in]    pass    The calculation pass
+         */
+        void await_calculation(const std::uint64_t pass) const noexcept
+        {
+            while (m_completed_pass.load(std::memory_order_acquire) != pass)
+            {
+                std::this_thread::yield();
+            }
+        }
+
         Kind m_kind; //!< Metric kind
         std::string m_name; //!< Metric name
         std::string m_unit; //!< Metric unit
@@ -586,6 +1001,10 @@ namespace measuro
         std::chrono::milliseconds m_hook_rate_limit; //!< hook rate limit, the minimum number of milliseconds between hook function calls
         std::vector<std::function<void (const Metric & metric)> > m_hooks; //!< Array of registered hook functions
         std::atomic<bool> m_has_hooks; //!< Are there any registered hooks? If not, a shortcut is taken in Metric::update
+        std::atomic<std::uint64_t> m_claimed_pass; //!< The last calculation pass in which the metric was claimed for calculation
+        std::atomic<std::uint64_t> m_completed_pass; //!< The last calculation pass in which the metric's calculation completed
+        std::atomic<bool> m_render_delta; //!< Should the metric always be rendered as a delta?
+        std::uint64_t m_id; //!< ID assigned by the registry, or std::numeric_limits<std::uint64_t>::max() if unregistered
 
     };
 
@@ -605,1755 +1024,6889 @@ namespace measuro
     };
 
     /*!
-     * @class NumberMetric
-     *
-     * @brief A metric representing signed/unsigned integer and floating point numbers
-     *
-     * A template class for metrics to be represented as numeric values.
-     * Various arithmetic and assignment operators are overloaded for
-     * manipulating metric objects easily.
-     *
-     * @par Template arguments
+     * @class ThreadSlot
      *
-     * @par
-     * K - the metric's kind
+     * @brief Assigns each thread a small, stable integer
      *
-     * @par
-     * T - the metric's native type
+     * Used by metrics that spread their state across several slots to reduce
+     * contention between threads. Threads are numbered in the order in which
+     * they first ask for their index.
      *
      * @remarks thread-safe
      */
-    template<Metric::Kind K, typename T>
-    class NumberMetric : public Metric, public DiscoverableNativeType<T>
+    class ThreadSlot
     {
     public:
         /*!
-         * Constructor.
+         * Get the calling thread's index.
          *
-         * @param[in]    name                  @see Metric::Metric
-         * @param[in]    unit                  @see Metric::Metric
-         * @param[in]    description           @see Metric::Metric
-         * @param[in]    time_function         @see Metric::Metric
-         * @param[in]    initial_value         Value with which to initialise the metric
-         * @param[in]    hook_rate_limit    @see Metric::Metric
+         * @return index of the calling thread
          */
-        NumberMetric(const std::string & name, const std::string & unit, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
-                const T initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(K, name, unit, description, time_function, hook_rate_limit), m_value(initial_value)
+        static std::size_t index() noexcept
         {
+            static std::atomic<std::size_t> next_index(0);
+            thread_local std::size_t thread_index = next_index.fetch_add(1, std::memory_order_relaxed);
+
+            return thread_index;
         }
 
         /*!
-         * Constructor.
+         * Get a slot count suitable for the host: the number of hardware
+         * threads rounded up to a power of 2, between 1 and @c limit.
          *
-         * @see NumberMetric::NumberMetric(const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const T initial_value, const std::chrono::milliseconds)
+         * @param[in]    limit    Maximum slot count. Must be a power of 2
+         *
+         * @return slot count
          */
-        NumberMetric(const char * name, const char * unit, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
-                const T initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(K, name, unit, description, time_function, hook_rate_limit), m_value(initial_value)
+        static std::size_t count(const std::size_t limit = 64) noexcept
         {
-        }
+            std::size_t wanted = std::thread::hardware_concurrency();
+            std::size_t result = 1;
 
-        NumberMetric(const NumberMetric &) = delete;
-        NumberMetric(NumberMetric &&) = delete;
-        NumberMetric & operator=(const NumberMetric &) = delete;
-        NumberMetric & operator=(NumberMetric &&) = delete;
+            while ((result < wanted) && (result < limit))
+            {
+                result <<= 1;
+            }
 
-        /*!
-         * Get the metric value as a std::string.
-         *
-         * @remarks thread-safe
+            return result;
+        }
+    };
+
+    /*!
+     * @class CpuSlot
+     *
+     * @brief Maps the CPU a thread is running on to a small, stable integer
+     *
+     * Used by metrics that spread their state across one slot per CPU. A
+     * thread's slot changes when it migrates, so slots are only ever updated
+     * atomically, but threads on different CPUs never share a slot. CPUs are
+     * numbered NUMA node by NUMA node (as described by
+     * /sys/devices/system/node), so that the slots of the CPUs on one node
+     * are contiguous, and form a group (see ::group_of). Any remaining slots
+     * form a final group.
+     *
+     * On Linux with glibc 2.35 or later, the CPU is read from the restartable
+     * sequences area that glibc registers for each thread, which costs a
+     * single load. Otherwise, sched_getcpu() is used where available, and the
+     * calling thread's ThreadSlot where not.
+     *
+     * @remarks thread-safe
+     */
+    class CpuSlot
+    {
+    public:
+        /*!
+         * Get the slot of the CPU the calling thread is running on.
+         *
+         * @return slot index, less than ::count
          */
-        operator std::string() const noexcept(false) override final
+        static std::size_t index() noexcept
         {
-            std::stringstream formatter;
+            const Layout & cpus = layout();
 
-            formatter << std::fixed << std::setprecision(2) << m_value;
+            const int cpu = current_cpu();
+            if ((cpu < 0) || (std::size_t(cpu) >= cpus.position.size()))
+            {
+                return ThreadSlot::index() & (cpus.count - 1);
+            }
 
-            return formatter.str();
+            return cpus.position[cpu];
         }
 
         /*!
-         * Get the metric value as its native type (template argument T).
+         * Get the number of CPU slots: the number of configured CPUs rounded
+         * up to a power of 2.
          *
-         * @remarks thread-safe
+         * @return slot count
          */
-        explicit operator T() const noexcept override final
+        static std::size_t count() noexcept
         {
-            return m_value;
+            return layout().count;
         }
 
         /*!
-         * Assignment operator.
-         *
-         * @param[in]    rhs    Value to assign to the metric
+         * Get the number of groups of slots: one for each NUMA node with
+         * CPUs, and one for any remaining slots. Without node information,
+         * all slots are in one group.
          *
-         * @remarks thread-safe
+         * @return group count
          */
-        void operator=(T rhs) noexcept(false)
+        static std::size_t group_count() noexcept
         {
-            update([this, rhs]()
-            {
-                m_value = rhs;
-            });
+            const Layout & cpus = layout();
+            return cpus.group_start.empty() ? 1 : cpus.group_start.size() - 1;
         }
 
         /*!
-         * Pre-increment operator.
+         * Get the group of a slot.
          *
-         * @return incremented value
+         * @param[in]    slot    The slot, less than ::count
          *
-         * @remarks thread-safe
+         * @return group index, less than ::group_count
          */
-        T operator++() noexcept
+        static std::size_t group_of(const std::size_t slot) noexcept
         {
-            T new_val = m_value;
-
-            update([this, & new_val]()
-            {
-                new_val = ++m_value;
-            });
-
-            return new_val;
+            const Layout & cpus = layout();
+            return cpus.group.empty() ? 0 : cpus.group[slot];
         }
 
         /*!
-         * Post-increment operator.
-         *
-         * @param ignored
+         * Get the first slot of a group. The group's slots run up to the
+         * first slot of the next group (or ::count, for the last group).
          *
-         * @return original value (before increment operation)
+         * @param[in]    group    The group, up to and including ::group_count
          *
-         * @remarks thread-safe
+         * @return slot index
          */
-        T operator++(int) noexcept
+        static std::size_t group_start(const std::size_t group) noexcept
         {
-            T old_val = m_value;
-
-            update([this, & old_val]()
+            const Layout & cpus = layout();
+            if (cpus.group_start.empty())
             {
-                old_val = m_value++;
-            });
+                return (group == 0) ? 0 : cpus.count;
+            }
 
-            return old_val;
+            return cpus.group_start[group];
         }
 
         /*!
-         * Pre-decrement operator.
-         *
-         * @return decremented value
+         * Get whether CPUs are read from the restartable sequences area
+         * registered for the calling thread, rather than with a system call.
          *
-         * @remarks thread-safe
+         * @return @c true if restartable sequences are used
          */
-        T operator--() noexcept
+        static bool restartable() noexcept
         {
-            T new_val = m_value;
+#if defined(MEASURO_RSEQ_CPU_ID)
+            return (__rseq_size > 0) && (rseq_area()->cpu_id != std::uint32_t(RSEQ_CPU_ID_UNINITIALIZED));
+#else
+            return false;
+#endif
+        }
 
-            update([this, & new_val]()
-            {
-                new_val = --m_value;
-            });
+    private:
+        /*!
+         * The slot of each CPU.
+         */
+        struct Layout
+        {
+            std::vector<std::size_t> position; //!< Slot of each CPU, by CPU number
+            std::vector<std::size_t> group_start; //!< First slot of each group, followed by ::count
+            std::vector<std::size_t> group; //!< Group of each slot
+            std::size_t count; //!< Number of slots, a power of 2
+        };
 
-            return new_val;
+#if defined(MEASURO_RSEQ_CPU_ID)
+        /*!
+         * Get the restartable sequences area registered for the calling
+         * thread.
+         */
+        static const volatile struct rseq * rseq_area() noexcept
+        {
+            return reinterpret_cast<const volatile struct rseq *>(static_cast<const char *>(__builtin_thread_pointer()) + __rseq_offset);
         }
+#endif
 
         /*!
-         * Post-decrement operator.
-         *
-         * @param ignored
-         *
-         * @return original value (before decrement operation)
+         * Get the CPU the calling thread is running on.
          *
-         * @remarks thread-safe
+         * @return CPU number, or a negative value if it can't be determined
          */
-        T operator--(int) noexcept
+        static int current_cpu() noexcept
         {
-            T old_val = m_value;
-
-            update([this, & old_val]()
+#if defined(MEASURO_RSEQ_CPU_ID)
+            if (__rseq_size > 0)
             {
-                old_val = m_value--;
-            });
+                const std::uint32_t cpu = rseq_area()->cpu_id;
+                if (cpu < std::uint32_t(std::numeric_limits<int>::max()))
+                {
+                    return int(cpu);
+                }
+            }
+#endif
+#if defined(__linux__)
+            return sched_getcpu();
+#else
+            return -1;
+#endif
+        }
 
-            return old_val;
+        /*!
+         * Get the layout of the host's CPUs, determining it on first use.
+         */
+        static const Layout & layout() noexcept
+        {
+            static const Layout instance = build_layout();
+            return instance;
         }
 
         /*!
-         * Adds the specified value to the metric.
-         *
-         * @param[in]    rhs    Value to add
+         * Parses a CPU (or node) list of the form used by sysfs (e.g.
+         * "0-3,8-11").
          *
-         * @return the value of the metric, after the add operation
+         * @param[in]    list    The list
          *
-         * @remarks thread-safe
+         * @return CPU (or node) numbers, in the order listed
          */
-        T operator+=(const T & rhs) noexcept
+        static std::vector<std::size_t> parse_cpu_list(const std::string & list) noexcept(false)
         {
-            T new_val = m_value;
+            std::vector<std::size_t> result;
 
-            update([this, rhs, & new_val]()
+            std::istringstream ranges(list);
+            std::string range;
+            while (std::getline(ranges, range, ','))
             {
-                new_val = m_value += rhs;
-            });
+                if ((range.empty()) || (!std::isdigit(static_cast<unsigned char>(range[0]))))
+                {
+                    continue;
+                }
 
-            return new_val;
+                const auto dash = range.find('-');
+                const std::size_t first = std::strtoul(range.c_str(), nullptr, 10);
+                const std::size_t last = (dash == std::string::npos) ? first : std::strtoul(range.c_str() + dash + 1, nullptr, 10);
+
+                for (std::size_t cpu = first; cpu <= last; ++cpu)
+                {
+                    result.push_back(cpu);
+                }
+            }
+
+            return result;
         }
 
         /*!
-         * Subtracts the specified value from the metric.
-         *
-         * @param[in]    rhs    Value to subtract
-         *
-         * @return the value of the metric, after the subtract operation
-         *
-         * @remarks thread-safe
+         * Determines the layout of the host's CPUs: the CPUs of each NUMA
+         * node in turn, followed by any CPUs that don't belong to a node.
+         * Nodes are read from /sys/devices/system/node/online, since node
+         * numbers needn't be contiguous.
          */
-        T operator-=(const T & rhs) noexcept
+        static Layout build_layout() noexcept
         {
-            T new_val = m_value;
+            Layout result;
+            result.count = 1;
 
-            update([this, rhs, & new_val]()
+#if defined(__linux__)
+            const long configured = sysconf(_SC_NPROCESSORS_CONF);
+            const std::size_t cpus = (configured > 0) ? std::size_t(configured) : std::max(1u, std::thread::hardware_concurrency());
+#else
+            const std::size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+#endif
+
+            while (result.count < cpus)
             {
-                new_val = m_value -= rhs;
-            });
+                result.count <<= 1;
+            }
 
-            return new_val;
-        }
+            try
+            {
+                const std::size_t unassigned = std::numeric_limits<std::size_t>::max();
+                result.position.assign(cpus, unassigned);
 
-    private:
-        std::atomic<T> m_value; //!< Metric's value
+                std::vector<std::size_t> nodes;
+                std::ifstream online("/sys/devices/system/node/online");
+                std::string online_list;
+                if ((online) && (std::getline(online, online_list)))
+                {
+                    nodes = parse_cpu_list(online_list);
+                }
+
+                std::size_t next = 0;
+                for (const auto node : nodes)
+                {
+                    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                    std::string list;
+                    if ((!file) || (!std::getline(file, list)))
+                    {
+                        continue;
+                    }
+
+                    const std::size_t first = next;
+                    for (const auto cpu : parse_cpu_list(list))
+                    {
+                        if ((cpu < cpus) && (result.position[cpu] == unassigned))
+                        {
+                            result.position[cpu] = next++;
+                        }
+                    }
+
+                    if (next > first)
+                    {
+                        result.group_start.push_back(first);
+                    }
+                }
+
+                // The remaining slots, including those beyond the number of CPUs, form the last group
+                if (next < result.count)
+                {
+                    result.group_start.push_back(next);
+                }
+                result.group_start.push_back(result.count);
 
+                for (auto & position : result.position)
+                {
+                    if (position == unassigned)
+                    {
+                        position = next++;
+                    }
+                }
+
+                result.group.assign(result.count, 0);
+                for (std::size_t group = 0; (group + 1) < result.group_start.size(); ++group)
+                {
+                    for (std::size_t slot = result.group_start[group]; slot < result.group_start[group + 1]; ++slot)
+                    {
+                        result.group[slot] = group;
+                    }
+                }
+            }
+            catch (...)
+            {
+                // Fall back to thread slots for every CPU, in a single group
+                result.position.clear();
+                result.group_start.clear();
+                result.group.clear();
+            }
+
+            return result;
+        }
     };
 
     /*!
-     * @class NumberMetric<Metric::Kind::FLOAT, float>
+     * How a sharded metric chooses the shard updated by a thread.
      *
-     * @brief Specialisation of NumberMetric for float values.
+     * @see NumberMetric::promote
+     */
+    enum class ShardBy
+    {
+        THREAD, //!< One shard per ThreadSlot
+        CPU //!< One shard per CpuSlot
+    };
+
+    /*!
+     * @class Sampling
      *
-     * @see NumberMetric
+     * @brief Describes how a counter samples its increments
+     *
+     * Very frequently incremented counters can trade accuracy for speed by
+     * recording only a fraction of their increments. A sampled counter
+     * records one in every @c N increments (on average, or exactly) and adds
+     * @c N to its value each time, so that its value remains an estimate of
+     * the true count. Increments that are not recorded do not touch the
+     * counter's shared state and do not trigger hooks.
      *
      * @remarks thread-safe
      */
-    template<>
-    class NumberMetric<Metric::Kind::FLOAT, float> : public Metric, public DiscoverableNativeType<float>
+    class Sampling
     {
     public:
         /*!
-         * Constructor.
-         *
-         * @see NumberMetric
+         * Sampling mode.
          */
-        NumberMetric(const std::string & name, const std::string & unit, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
-                const float initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::FLOAT, name, unit, description, time_function, hook_rate_limit), m_value(initial_value)
+        enum class Mode
+        {
+            NONE, //!< Every increment is recorded
+            RANDOM, //!< Each increment is recorded with probability 1/N
+            EVERY_NTH //!< Every Nth increment made by each thread is recorded
+        };
+
+        /*!
+         * Constructor. Creates a configuration that records every increment.
+         */
+        Sampling() noexcept : m_mode(Mode::NONE), m_interval(1)
         {
         }
 
         /*!
-         * Constructor.
+         * Creates a configuration that records each increment with
+         * probability 1/@c interval, using a per-thread pseudo-random number
+         * generator. The counter's value is an unbiased estimate of the true
+         * count.
          *
-         * @see NumberMetric
+         * @param[in]    interval    The sampling interval, N. Must be at least 1
+         *
+         * @return the configuration
+         *
+         * @throws MetricConfigError
          */
-        NumberMetric(const char * name, const char * unit, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
-                const float initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::FLOAT, name, unit, description, time_function, hook_rate_limit), m_value(initial_value)
+        static Sampling random(const std::uint32_t interval) noexcept(false)
         {
+            return Sampling(Mode::RANDOM, interval);
         }
 
-        NumberMetric(const NumberMetric &) = delete;
-        NumberMetric(NumberMetric &&) = delete;
-        NumberMetric & operator=(const NumberMetric &) = delete;
-        NumberMetric & operator=(NumberMetric &&) = delete;
-
         /*!
-         * Get the metric value as a std::string. Always represented to 2
-         * decimal places.
+         * Creates a configuration that records every @c interval th increment
+         * made by each thread. The counter's value never exceeds the true
+         * count, and trails it by less than @c interval per thread that
+         * increments it.
          *
-         * @remarks thread-safe
+         * @param[in]    interval    The sampling interval, N. Must be at least 1
+         *
+         * @return the configuration
+         *
+         * @throws MetricConfigError
          */
-        operator std::string() const noexcept(false) override final
+        static Sampling every_nth(const std::uint32_t interval) noexcept(false)
         {
-            std::stringstream formatter;
-
-            formatter << std::fixed << std::setprecision(2) << m_value;
+            return Sampling(Mode::EVERY_NTH, interval);
+        }
 
-            return formatter.str();
+        /*!
+         * Get the sampling mode.
+         *
+         * @return the sampling mode
+         */
+        Mode mode() const noexcept
+        {
+            return m_mode;
         }
 
         /*!
-         * Get the metric value as a float.
+         * Get the sampling interval, N.
          *
-         * @remarks thread-safe
+         * @return the sampling interval, which is 1 if every increment is recorded
          */
-        explicit operator float() const noexcept override final
+        std::uint32_t interval() const noexcept
         {
-            return m_value;
+            return m_interval;
         }
 
         /*!
-         * Assignment operator.
+         * Get whether increments are sampled, rather than all recorded.
          *
-         * @param[in]    rhs    Value to assign to the metric
+         * @return @c true if increments are sampled
+         */
+        bool sampled() const noexcept
+        {
+            return (m_mode != Mode::NONE) && (m_interval > 1);
+        }
+
+        /*!
+         * Get whether an increment should be recorded under random sampling.
+         * Uses a xorshift generator local to the calling thread, so that no
+         * state is shared between threads.
          *
-         * @remarks thread-safe
+         * @return @c true with probability 1/N
          */
-        void operator=(float rhs) noexcept(false)
+        bool draw() const noexcept
         {
-            update([this, rhs]()
-            {
-                m_value = rhs;
-            });
+            thread_local std::uint64_t state = 0x9E3779B97F4A7C15ull * (ThreadSlot::index() + 1);
+
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+
+            // Maps the high 32 bits onto [0, N) without a division
+            return (((state >> 32) * m_interval) >> 32) == 0;
         }
 
     private:
-        std::atomic<float> m_value; //!< Metric's value
+        Sampling(const Mode mode, const std::uint32_t interval) noexcept(false) : m_mode(mode), m_interval(interval)
+        {
+            if (interval == 0)
+            {
+                throw MetricConfigError("Sampling interval must be at least 1");
+            }
+        }
 
+        Mode m_mode; //!< Sampling mode
+        std::uint32_t m_interval; //!< Sampling interval, N
     };
 
     /*!
-     * @class RateMetric
-     *
-     * @brief Tracks the rate of change of a "distance" NumberMetric
-     *
-     * The rate is always expressed per second. The rate is calculated only on
-     * calls to ::calculate, and even then at most once per second. The rest
-     * of the time, the metric's value is pulled from a cache. A result proxy
-     * function can be used to modify the calculated rate before it is stored.
-     * This is particularly useful for performing unit conversions.
+     * @class SamplingCountdown
      *
-     * @par Template arguments
+     * @brief Counts down to the next recorded increment of an every-Nth
+     * sampled counter, separately for each thread
      *
-     * @par
-     * D - the type of the metric object whose rate is to be tracked
+     * Each thread's countdown is held in memory local to the thread, so an
+     * increment that is not recorded touches no shared state. Each countdown
+     * is given a process-wide ID, recycled when the countdown is destroyed,
+     * that indexes the per-thread counts. The ID's low 32 bits are the index
+     * and its high 32 bits a generation, so that a thread's count left over
+     * from a destroyed countdown is not mistaken for the count of a new
+     * countdown at the same index.
      *
      * @remarks thread-safe
      */
-    template<typename D>
-    class RateMetric : public Metric, public DiscoverableNativeType<float>
+    class SamplingCountdown
     {
     public:
         /*!
          * Constructor.
          *
-         * @param[in]    distance              The metric whose rate is to be tracked
-         * @param[in]    result_proxy          A function used to modify a calculated rate before it is committed
-         * @param[in]    name                  @see Metric::Metric
-         * @param[in]    unit                  @see Metric::Metric
-         * @param[in]    description           @see Metric::Metric
-         * @param[in]    time_function         @see Metric::Metric
-         * @param[in]    hook_rate_limit    @see Metric::Metric
+         * @param[in]    interval    The sampling interval, N. Must be at least 1
          */
-        RateMetric(std::shared_ptr<D> & distance, std::function<float (float)> result_proxy, const std::string & name, const std::string & unit, const std::string & description,
-                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::RATE, name, unit, description, time_function, hook_rate_limit), m_distance(distance), m_result_proxy(result_proxy),
-          m_last_distance(0), m_cache(0.0f)
+        explicit SamplingCountdown(const std::uint32_t interval) noexcept(false)
+        : m_interval(interval), m_id(acquire()), m_threads(0)
         {
         }
 
-        /*!
-         * @see RateMetric::RateMetric(std::shared_ptr<D> &, std::function<float (float)>, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
-         */
-        RateMetric(std::shared_ptr<D> & distance, std::function<float (float)> result_proxy, const char * name, const char * unit, const char * description,
-                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::RATE, name, unit, description, time_function, hook_rate_limit), m_distance(distance), m_result_proxy(result_proxy),
-          m_last_distance(0), m_cache(0.0f)
+        ~SamplingCountdown() noexcept
         {
+            release(m_id);
         }
 
+        SamplingCountdown(const SamplingCountdown &) = delete;
+        SamplingCountdown(SamplingCountdown &&) = delete;
+        SamplingCountdown & operator=(const SamplingCountdown &) = delete;
+        SamplingCountdown & operator=(SamplingCountdown &&) = delete;
+
         /*!
-         * @see RateMetric::RateMetric(std::shared_ptr<D> &, std::function<float (float)>, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
+         * Count an increment made by the calling thread.
+         *
+         * @return @c true if the increment is the Nth since the calling thread's last recorded increment
          */
-        RateMetric(std::shared_ptr<D> & distance, const std::string & name, const std::string & unit, const std::string & description,
-                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::RATE, name, unit, description, time_function, hook_rate_limit), m_distance(distance), m_last_distance(0), m_cache(0.0f)
+        bool tick() noexcept
         {
+            thread_local std::vector<Count> counts;
+
+            const std::size_t index = std::size_t(m_id & INDEX_MASK);
+            const std::uint32_t generation = std::uint32_t(m_id >> 32);
+
+            if (index >= counts.size())
+            {
+                try
+                {
+                    counts.resize(index + 1);
+                }
+                catch (...)
+                {
+                    // Not recording keeps the counter's value within the true count
+                    return false;
+                }
+            }
+
+            Count & count = counts[index];
+            if (count.generation != generation)
+            {
+                count.generation = generation;
+                count.remaining = m_interval;
+                m_threads.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (--count.remaining == 0)
+            {
+                count.remaining = m_interval;
+                return true;
+            }
+
+            return false;
         }
 
         /*!
-         * @see RateMetric::RateMetric(std::shared_ptr<D> &, std::function<float (float)>, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
+         * Get the number of threads that have counted increments.
+         *
+         * @return thread count
          */
-        RateMetric(std::shared_ptr<D> & distance, const char * name, const char * unit, const char * description,
-                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::RATE, name, unit, description, time_function, hook_rate_limit), m_distance(distance), m_last_distance(0), m_cache(0.0f)
+        std::uint64_t threads() const noexcept
         {
+            return m_threads.load(std::memory_order_relaxed);
         }
 
-        RateMetric(const RateMetric &) = delete;
-        RateMetric(RateMetric &&) = delete;
-        RateMetric & operator=(const RateMetric &) = delete;
-        RateMetric & operator=(RateMetric &&) = delete;
-
+    private:
         /*!
-         * Get the metric value as a std::string. Always represented
-         * to 2 decimal places.
-         *
-         * @remarks thread-safe
+         * A thread's count for one countdown.
          */
-        operator std::string() const noexcept(false) override final
+        struct Count
         {
-            std::stringstream formatter;
-            formatter << std::fixed << std::setprecision(2) << m_cache;
-            return formatter.str();
-        }
+            Count() noexcept : generation(0), remaining(0)
+            {
+            }
+
+            std::uint32_t generation; //!< Generation of the countdown counted, or 0 if none
+            std::uint32_t remaining; //!< Increments remaining until the next is recorded
+        };
 
         /*!
-         * Get the metric value as a float.
-         *
-         * @remarks thread-safe
+         * IDs available for reuse, and the next index never used.
          */
-        explicit operator float() const noexcept override final
+        struct Ids
         {
-            return m_cache;
-        }
+            Ids() noexcept : next(0)
+            {
+            }
+
+            std::mutex lock; //!< Guards the IDs
+            std::vector<std::uint64_t> free; //!< Released IDs, with their generations advanced
+            std::uint64_t next; //!< Next index never used
+        };
+
+        static constexpr std::uint64_t INDEX_MASK = 0xFFFFFFFFull; //!< Selects the index from an ID
 
         /*!
-         * For a given value @c val apply the specified proxy function and
-         * return the result. Alternatively if no proxy function is specified,
-         * return @c val
-         *
-         * @param[in]    val    Value to proxy
-         *
-         * @return proxied value
-         *
-         * @remarks thread-safe if proxy function is also thread-safe
+         * Get the process-wide IDs. Never destroyed, so that countdowns
+         * belonging to static metrics can release their IDs at exit.
          */
-        float proxy_value(float val) const
+        static Ids & ids() noexcept(false)
         {
-            return ((m_result_proxy) ? m_result_proxy(val) : val);
+            static Ids * instance = new Ids();
+
+            return *instance;
         }
 
-        /*!
-         * Calculates the rate. Internally the calculations are cached.
-         * The cache is updated at most once per second, so there is no need to
-         * (but little harm in) calling this method more frequently than that.
-         *
-         * As with all metric kinds this method is called automatically before
-         * rendering, thus ensuring the metric's value is up-to-date prior to
-         * the render operation.
-         *
-         * If the metric's value is needed outside of a render operation, it's
-         * recommended that rather than call this method applications instead
-         * rely on their regular render operation (assuming there is one) to
-         * keep the cache up-to-date. Reading the value is then simply a case
-         * of casting the metric to a @c float or @c std::string
-         */
-        void calculate() override final
+        static std::uint64_t acquire() noexcept(false)
         {
-            auto now_time = m_time_function();
+            Ids & all = ids();
 
-            if (now_time - m_last_calc_time >= std::chrono::milliseconds(1000))
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(all.lock);
+
+            if (!all.free.empty())
             {
-                update([this, & now_time]()
-                {
-                    float distance = static_cast<typename D::NativeType>(*m_distance);
+                std::uint64_t id = all.free.back();
+                all.free.pop_back();
+                return id;
+            }
 
-                    auto time_elapsed_sec = float(std::chrono::duration_cast<std::chrono::milliseconds>(now_time - m_last_calc_time).count()) / 1000;
-                    auto distance_travelled = float(distance - m_last_distance);
+            if (all.next > INDEX_MASK)
+            {
+                throw MetricConfigError("Too many every-Nth sampled metrics");
+            }
 
-                    if (time_elapsed_sec != 0.0)
-                    {
-                        float value = distance_travelled / time_elapsed_sec;
-                        m_cache = proxy_value(value);
-                    }
+            // Generations start at 1, so that a zeroed Count matches no countdown
+            return (std::uint64_t(1) << 32) | all.next++;
+        }
 
-                    m_last_distance = distance;
-                    m_last_calc_time = now_time;
-                });
+        static void release(const std::uint64_t id) noexcept
+        {
+            std::uint64_t generation = (id >> 32) + 1;
+            if (generation > INDEX_MASK)
+            {
+                generation = 1;
             }
-        }
 
-    private:
-        std::shared_ptr<D> m_distance; //!< Distance metric whose rate is to be tracked
-        std::function<float (float)> m_result_proxy; //!< Proxy function to use for rate values
-        std::atomic<float> m_last_distance; //!< The distance value last read
-        std::atomic<float> m_cache; //!< Most recently calculated rate
-        std::chrono::steady_clock::time_point m_last_calc_time; //!< Last time at which the cache was updated
+            try
+            {
+                Ids & all = ids();
+
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(all.lock);
+                all.free.push_back((generation << 32) | (id & INDEX_MASK));
+            }
+            catch (...)
+            {
+                // The index is not reused
+            }
+        }
 
+        const std::uint32_t m_interval; //!< Sampling interval, N
+        const std::uint64_t m_id; //!< Index of the per-thread counts, and generation
+        std::atomic<std::uint64_t> m_threads; //!< Number of threads that have counted increments
     };
 
     /*!
-     * @class SumMetric
+     * @class NumberMetric
      *
-     * @brief Sums the values of other metrics
+     * @brief A metric representing signed/unsigned integer and floating point numbers
      *
-     * Adds the values of multiple other "target" metrics together. Unlike
-     * RateMetric, SumMetric doesn't use hooks, but simply defers the summing
-     * operation until it is rendered (or cast to a std::string).
+     * A template class for metrics to be represented as numeric values.
+     * Various arithmetic and assignment operators are overloaded for
+     * manipulating metric objects easily.
      *
      * @par Template arguments
      *
      * @par
-     * D - the type of the metric objects to be summed
+     * K - the metric's kind
+     *
+     * @par
+     * T - the metric's native type
      *
      * @remarks thread-safe
      */
-    template<typename D>
-    class SumMetric : public Metric, public DiscoverableNativeType<typename D::NativeType>
+    template<Metric::Kind K, typename T>
+    class NumberMetric : public Metric, public DiscoverableNativeType<T>
     {
     public:
         /*!
          * Constructor.
          *
-         * @param[in]    targets               List of target metrics whose values are to be summed
          * @param[in]    name                  @see Metric::Metric
          * @param[in]    unit                  @see Metric::Metric
          * @param[in]    description           @see Metric::Metric
          * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    initial_value         Value with which to initialise the metric
          * @param[in]    hook_rate_limit    @see Metric::Metric
+         * @param[in]    sampling              How increments are sampled. By default, every increment is recorded. @see Sampling
          */
-        SumMetric(std::initializer_list<std::shared_ptr<D> > targets, const std::string & name, const std::string & unit, const std::string & description,
-                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::SUM, name, unit, description, time_function, hook_rate_limit), m_cache(0)
+        NumberMetric(const std::string & name, const std::string & unit, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const T initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero(),
+                const Sampling sampling = Sampling()) noexcept(false)
+        : Metric(K, name, unit, description, time_function, hook_rate_limit), m_value(initial_value), m_interval(0), m_reset_on_render(false),
+          m_sampling(sampling),
+          m_adaptive(false), m_contention_threshold(1000), m_contention(0), m_shard_by(ShardBy::THREAD), m_shards(nullptr)
         {
-            for (auto target : targets)
-            {
-                add_target(target);
-            }
+            init_sampling();
         }
 
         /*!
-         * @see SumMetric::SumMetric(std::initializer_list<std::shared_ptr<D> >, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
+         * Constructor.
+         *
+         * @see NumberMetric::NumberMetric(const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const T initial_value, const std::chrono::milliseconds, const Sampling)
          */
-        SumMetric(const std::string & name, const std::string & unit, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::SUM, name, unit, description, time_function, hook_rate_limit), m_cache(0)
+        NumberMetric(const char * name, const char * unit, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const T initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero(),
+                const Sampling sampling = Sampling()) noexcept(false)
+        : Metric(K, name, unit, description, time_function, hook_rate_limit), m_value(initial_value), m_interval(0), m_reset_on_render(false),
+          m_sampling(sampling),
+          m_adaptive(false), m_contention_threshold(1000), m_contention(0), m_shard_by(ShardBy::THREAD), m_shards(nullptr)
         {
+            init_sampling();
         }
 
+        NumberMetric(const NumberMetric &) = delete;
+        NumberMetric(NumberMetric &&) = delete;
+        NumberMetric & operator=(const NumberMetric &) = delete;
+        NumberMetric & operator=(NumberMetric &&) = delete;
+
         /*!
-         * @see SumMetric::SumMetric(std::initializer_list<std::shared_ptr<D> >, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
+         * Destructor.
          */
-        SumMetric(std::initializer_list<std::shared_ptr<D> > targets, const char * name, const char * unit, const char * description,
-                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::SUM, name, unit, description, time_function, hook_rate_limit), m_cache(0)
+        ~NumberMetric() noexcept
         {
-            for (auto target : targets)
-            {
-                add_target(target);
-            }
+            delete m_shards.load();
         }
 
         /*!
-         * @see SumMetric::SumMetric(std::initializer_list<std::shared_ptr<D> >, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
+         * Get the metric value as a std::string.
+         *
+         * @remarks thread-safe
          */
-        SumMetric(const char * name, const char * unit, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::SUM, name, unit, description, time_function, hook_rate_limit), m_cache(0)
+        operator std::string() const noexcept(false) override final
         {
-        }
+            std::stringstream formatter;
 
-        SumMetric(const SumMetric &) = delete;
-        SumMetric(SumMetric &&) = delete;
-        SumMetric & operator=(const SumMetric &) = delete;
-        SumMetric & operator=(SumMetric &&) = delete;
+            formatter << std::fixed << std::setprecision(2) << T(*this);
+
+            return formatter.str();
+        }
 
         /*!
-         * Adds a target metric to the list of those to be summed.
-         *
-         * @param[in]    target    The metric to be included in the sum operation
+         * Get the metric value as its native type (template argument T). If
+         * the metric is reset on render, this is the total for the interval
+         * that ended at the last render.
          *
          * @remarks thread-safe
          */
-        void add_target(std::shared_ptr<D> & target) noexcept(false)
+        explicit operator T() const noexcept override final
         {
-            // TODO: Replace with std::scoped_lock on migration to C++17
-            std::lock_guard<std::mutex> lock(m_metric_mutex);
-
-            m_targets.push_back(target);
-            m_cache = m_cache + static_cast<typename D::NativeType>(*target);
+            return (m_reset_on_render) ? m_interval.load() : total();
         }
 
         /*!
-         * Get the sum as the native type defined by the target metric type.
-         *
-         * @remarks thread-safe
+         * @see Metric::numeric_value
          */
-        explicit operator typename D::NativeType() const noexcept override final
+        double numeric_value() const noexcept override final
         {
-            return m_cache;
+            return double(T(*this));
         }
 
         /*!
-         * Get the sum as a std::string. Always represented to 2 decimal
-         * places for float metrics.
-         *
-         * @remarks thread-safe
+         * @see Metric::delta
          */
-        operator std::string() const noexcept(false) override final
+        bool delta(std::uint64_t & checkpoint, std::string & result) const noexcept(false) override final
         {
-            std::stringstream formatter;
-            formatter << std::fixed << std::setprecision(2) << m_cache;
+            if (m_reset_on_render)
+            {
+                // Already rendered per interval
+                return false;
+            }
 
-            return formatter.str();
+            result = delta_of(total(), checkpoint);
+            return true;
         }
 
         /*!
-         * Get the number of metrics being summed.
+         * Get the metric's sampling configuration.
          *
-         * @return the number of metrics
+         * @return the sampling configuration
          *
          * @remarks thread-safe
          */
-        std::size_t target_count() const noexcept
+        Sampling sampling() const noexcept
         {
-            // TODO: Replace with std::scoped_lock on migration to C++17
-            std::lock_guard<std::mutex> lock(m_metric_mutex);
-
-            return m_targets.size();
+            return m_sampling;
         }
 
         /*!
-         * Adds the values of the target metrics together and caches the
-         * result. This is a relatively expensive operation, so call it as
-         * infrequently as possible.
+         * Get the bound on the error in the metric's value introduced by
+         * sampling its increments. For random sampling, this is the half-width
+         * of the 95% confidence interval around the value, assuming the
+         * sampled increments were all increments of 1. For every-Nth sampling,
+         * this is the largest number of increments that may not yet have been
+         * recorded.
          *
-         * As with all metric kinds this method is called automatically before
-         * rendering, thus ensuring the metric's value is up-to-date prior to
-         * the render operation.
+         * @return the error bound, which is zero if increments are not sampled
          *
-         * If the metric's value is needed outside of a render operation, it's
-         * recommended that rather than call this method applications instead
-         * rely on their regular render operation (assuming there is one) to
-         * keep the metric up-to-date. Reading the value is then simply a case
-         * of casting the metric to an integral or @c std::string
+         * @remarks thread-safe
          */
-        void calculate() override final
+        double error_bound() const noexcept
         {
-            update([this]()
+            if (!m_sampling.sampled())
             {
-                // TODO: Replace with std::scoped_lock on migration to C++17
-                std::lock_guard<std::mutex> lock(m_metric_mutex);
+                return 0.0;
+            }
 
-                typename D::NativeType total = 0;
-                for (std::size_t index=0;index<m_targets.size();++index)
-                {
-                    total += static_cast<const typename D::NativeType>(*m_targets[index]);
-                }
+            double unrecorded_per_sample = double(m_sampling.interval() - 1);
 
-                m_cache = total;
-            });
-        }
-
-    private:
-        std::vector<std::shared_ptr<D> > m_targets; //!< Array of targets to be summed
-        std::atomic<typename D::NativeType> m_cache;
+            if (m_sampling.mode() == Sampling::Mode::RANDOM)
+            {
+                // Each increment contributes a variance of N - 1 to the estimate
+                return 1.96 * std::sqrt(std::fabs(numeric_value()) * unrecorded_per_sample);
+            }
 
-    };
+            return unrecorded_per_sample * double(m_countdown->threads());
+        }
 
-    /*!
-     * @class StringMetric
-     *
-     * @brief A metric that is assigned a string.
-     *
-     * @remarks thread-safe
-     */
-    class StringMetric : public Metric, public DiscoverableNativeType<std::string>
-    {
-    public:
         /*!
+         * Get the metric's sampling error bound (labelled "error"), if its
+         * increments are sampled.
          *
-         * @param[in]    name                  @see Metric::Metric
-         * @param[in]    description           @see Metric::Metric
-         * @param[in]    time_function         @see Metric::Metric
-         * @param[in]    initial_value         Value with which to initialise the metric
-         * @param[in]    hook_rate_limit       @see Metric::Metric
+         * @see Metric::series
          */
-        StringMetric(const std::string & name, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
-                const std::string & initial_value, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::STR, name, description, time_function, hook_rate_limit), m_value(initial_value)
+        std::vector<std::pair<std::string, std::string> > series() const noexcept(false) override final
         {
-        }
+            std::vector<std::pair<std::string, std::string> > result;
 
-        /*!
-         * @see StringMetric::StringMetric(const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::string &, const std::chrono::milliseconds)
-         */
-        StringMetric(const char * name, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
-                const char * initial_value, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::STR, name, description, time_function, hook_rate_limit), m_value(initial_value)
-        {
-        }
+            if (m_sampling.sampled())
+            {
+                std::stringstream formatter;
+                formatter << std::fixed << std::setprecision(2) << error_bound();
+                result.push_back(std::make_pair(std::string("error"), formatter.str()));
+            }
 
-        StringMetric(const StringMetric &) = delete;
-        StringMetric(StringMetric &&) = delete;
-        StringMetric & operator=(const StringMetric &) = delete;
-        StringMetric & operator=(StringMetric &&) = delete;
+            return result;
+        }
 
         /*!
-         * Get the value of the metric as a string.
+         * Sets whether the metric is promoted to a sharded representation
+         * when its updates become contended. While enabled (and until the
+         * metric is promoted), updates are made with a compare-and-swap, and
+         * each failed attempt counts towards the metric's contention. If
+         * @c contention_threshold failures occur between two calculations of
+         * the metric (i.e. between renders), the metric is promoted.
+         *
+         * @param[in]    enabled                 @c true to promote the metric when contended
+         * @param[in]    contention_threshold    Number of failed updates between calculations that triggers promotion
+         * @param[in]    by                      How the promoted metric's shards are chosen
+         *
+         * @see NumberMetric::promote
+         *
+         * @remarks thread-safe
          */
-        operator std::string() const noexcept(false) override final
+        void adaptive(const bool enabled, const std::uint64_t contention_threshold = 1000, const ShardBy by = ShardBy::THREAD) noexcept
         {
-            // TODO: Replace with std::scoped_lock on migration to C++17
-            std::lock_guard<std::mutex> lock(m_metric_mutex);
-
-            return m_value;
+            m_contention_threshold = std::max(std::uint64_t(1), contention_threshold);
+            m_shard_by = by;
+            m_adaptive = enabled;
         }
 
         /*!
-         * Assign a new value to the metric.
+         * Get whether the metric is promoted to a sharded representation when
+         * its updates become contended.
          *
-         * @param[in]    rhs    The new value to assign
+         * @return @c true if the metric adapts to contention
+         *
+         * @remarks thread-safe
          */
-        void operator=(const char * rhs) noexcept(false)
+        bool adaptive() const noexcept
         {
-            update([this, rhs]()
-            {
-                // TODO: Replace with std::scoped_lock on migration to C++17
-                std::lock_guard<std::mutex> lock(m_metric_mutex);
-
-                m_value = std::string(rhs);
-            });
+            return m_adaptive;
         }
 
         /*!
-         * @see StringMetric::operator=(const char *)
+         * Promotes the metric to a sharded representation, if it hasn't been
+         * already. Afterwards, updates add to one of several counters, each
+         * on its own cache line, and reads sum them. Call this on creation to
+         * make promotion of a known hot metric permanent.
+         *
+         * With ShardBy::THREAD, the counter is chosen by the calling thread's
+         * ThreadSlot, so threads beyond the slot count share counters. With
+         * ShardBy::CPU, there is a counter for each CPU, chosen by the
+         * calling thread's CpuSlot, so that any number of threads running on
+         * different CPUs never share a counter. The counters of each NUMA
+         * node's CPUs are allocated in pages of their own by the first update
+         * from one of those CPUs, so that on Linux the kernel places them on
+         * that node.
+         *
+         * Once promoted, the increment, decrement and compound assignment
+         * operators return the metric's value as seen by the calling thread's
+         * counter, which may not include recent updates by other threads. Read
+         * the metric to get its exact value.
+         *
+         * @param[in]    by    How shards are chosen
+         *
+         * @remarks thread-safe
          */
-        void operator=(const std::string & rhs) noexcept(false)
+        void promote(const ShardBy by = ShardBy::THREAD) noexcept(false)
         {
-            update([this, rhs]()
+            if (m_shards.load(std::memory_order_acquire) != nullptr)
             {
-                // TODO: Replace with std::scoped_lock on migration to C++17
-                std::lock_guard<std::mutex> lock(m_metric_mutex);
+                return;
+            }
 
-                m_value = rhs;
-            });
-        }
+            // Shards per CPU are allocated a group at a time, by the first update from each group
+            const std::size_t groups = (by == ShardBy::CPU) ? CpuSlot::group_count() : 1;
+            std::unique_ptr<ShardSet> set(new ShardSet(by, groups));
+            if (by == ShardBy::THREAD)
+            {
+                set->groups[0].store(new ShardGroup(ThreadSlot::count()), std::memory_order_relaxed);
+            }
 
-    private:
-        std::string m_value; //!< Metric's value
+            // Set before the shards are published, so that a promoted metric always has its promotion time
+            set->promoted_at = m_time_function().time_since_epoch().count();
 
-    };
+            ShardSet * expected = nullptr;
+            if (m_shards.compare_exchange_strong(expected, set.get(), std::memory_order_acq_rel))
+            {
+                set.release();
+            }
+        }
 
-    /*!
-     * @class BoolMetric
-     *
-     * @brief A metric that can have 1 of 2 states: @c true or @c false.
-     *
-     * @remarks thread-safe
-     */
-    class BoolMetric : public Metric, public DiscoverableNativeType<bool>
-    {
-    public:
         /*!
-         * Constructor.
+         * Get how the metric's shards are chosen: as promoted, if the metric
+         * has been promoted, or as configured by ::adaptive otherwise.
          *
-         * @param[in]    name                  @see Metric::Metric
-         * @param[in]    description           @see Metric::Metric
-         * @param[in]    time_function         @see Metric::Metric
-         * @param[in]    initial_value         Value with which to initialise the metric
-         * @param[in]    true_rep              String representation of the metric when its value is @c true. Default = TRUE
-         * @param[in]    false_rep             String representation of the metric when its value is @c false. Default = FALSE
-         * @param[in]    hook_rate_limit    @see Metric::Metric
+         * @return shard selection
+         *
+         * @remarks thread-safe
          */
-        BoolMetric(const std::string & name, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
-                const bool initial_value, const std::string true_rep = "TRUE", const std::string false_rep = "FALSE",
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::BOOL, name, description, time_function, hook_rate_limit), m_value(initial_value), m_true_rep(true_rep),
-          m_false_rep(false_rep)
+        ShardBy shard_by() const noexcept
         {
+            ShardSet * set = m_shards.load(std::memory_order_acquire);
+            return (set != nullptr) ? set->by : m_shard_by.load();
         }
 
         /*!
-         * @see BoolMetric::BoolMetric(const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const bool, const std::string, const std::string, const std::chrono::milliseconds)
+         * Get whether the metric has been promoted to a sharded
+         * representation.
+         *
+         * @return @c true if the metric is sharded
+         *
+         * @remarks thread-safe
          */
-        BoolMetric(const char * name, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
-                const bool initial_value, const std::string true_rep = "TRUE", const std::string false_rep = "FALSE",
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
-        : Metric(Metric::Kind::BOOL, name, description, time_function, hook_rate_limit), m_value(initial_value), m_true_rep(true_rep),
-          m_false_rep(false_rep)
+        bool promoted() const noexcept
         {
+            return m_shards.load(std::memory_order_acquire) != nullptr;
         }
 
-        BoolMetric(const BoolMetric &) = delete;
-        BoolMetric(BoolMetric &&) = delete;
-        BoolMetric & operator=(const BoolMetric &) = delete;
-        BoolMetric & operator=(BoolMetric &&) = delete;
-
         /*!
-         * Get the appropriate @c true or @c false string representation of the
-         * metric based on its value.
+         * Get the time at which the metric was promoted to a sharded
+         * representation, according to its time function.
+         *
+         * @return time of promotion. Only meaningful if the metric has been promoted
+         *
+         * @remarks thread-safe
          */
-        operator std::string() const noexcept override final
+        std::chrono::steady_clock::time_point promoted_at() const noexcept
         {
-            if (m_value)
-            {
-                return m_true_rep;
-            }
-            else
-            {
-                return m_false_rep;
-            }
+            ShardSet * set = m_shards.load(std::memory_order_acquire);
+            return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration((set != nullptr) ? set->promoted_at : 0));
         }
 
         /*!
-         * Get the value of the metric as a bool.
+         * Sets whether the metric is reset to zero each time it is rendered.
+         * When set, ::calculate atomically exchanges the running value for
+         * zero, and the metric is rendered (and cast) as the total for the
+         * interval since the previous render. No updates are lost between
+         * the read and the reset.
+         *
+         * @param[in]    enabled    @c true to reset the metric on each render
+         *
+         * @remarks thread-safe
          */
-        explicit operator bool() const noexcept override final
+        void reset_on_render(const bool enabled) noexcept
         {
-            return m_value;
+            m_reset_on_render = enabled;
         }
 
         /*!
-         * Assign a new value to the metric.
+         * Get whether the metric is reset to zero each time it is rendered.
          *
-         * @param[in]    rhs    The new value to assign
+         * @return @c true if the metric is reset on render
+         *
+         * @remarks thread-safe
          */
-        void operator=(bool rhs) noexcept
+        bool reset_on_render() const noexcept
         {
-            update([this, rhs]()
-            {
-                m_value = rhs;
-            });
+            return m_reset_on_render;
         }
 
         /*!
-         * Set the value of the metric to the logical not of its current value,
-         * i.e. if it's current value is @c true then set it to @c false and
-         * vice versa.
+         * @see Metric::per_interval
          */
-        bool operator!() noexcept
+        bool per_interval() const noexcept override final
         {
-            return !m_value;
+            return m_reset_on_render;
         }
 
-    private:
-        std::atomic<bool> m_value; //!< Metric's value
-        const std::string m_true_rep; //!< @c true string representation
-        const std::string m_false_rep; //!< @c false string representation
-
-    };
-
-    /*!
-     * @class Throttle
-     *
-     * @brief Limits the rate at which operations are performed on a metric
-     *
-     * Performance can suffer dramatically if a metric is updated with high
-     * frequency. This class serves as an adapter for limiting the rate at
-     * which a metric is updated in 2 ways: time (minimum time interval
-     * between updates) and attempted operation count (minimum attempted
-     * operations between updates). Instances of this class are not
-     * thread-safe. The performance advantages of its use are in part a result
-     * of eliminating locks and atomics.
-     *
-     * @par Template arguments
-     *
-     * @par
-     * T - the type of the metric object to be throttled
-     *
-     * @remarks thread-hostile
-     */
-    template<typename T>
-    class Throttle
-    {
-    public:
         /*!
-         * Constructor.
+         * Atomically replaces the metric's running value.
          *
-         * @param[in]    metric           The metric to throttle
-         * @param[in]    time_limit       The minimum number of milliseconds between updates
-         * @param[in]    op_limit         The number of attempted operations between updates
-         * @param[in]    time_function    Function used to determine the time. Used for simulation in testing
+         * @param[in]    value    The new value
+         *
+         * @return the value before the exchange
+         *
+         * @remarks thread-safe
          */
-        Throttle(std::shared_ptr<T> & metric, const std::chrono::milliseconds time_limit, const std::uint64_t op_limit = 1000,
-                std::function<std::chrono::steady_clock::time_point ()> time_function = []{return std::chrono::steady_clock::now();})
-        : m_metric(metric), m_time_limit(time_limit), m_next_update(time_function() + time_limit), m_time_function(time_function),
-          m_op_limit(((op_limit == 0) ? 1 : op_limit)), m_op_count(0)
+        T exchange(const T value = 0) noexcept(false)
         {
-        }
+            T old_val = 0;
 
-        ~Throttle()
-        {
+            update([this, value, & old_val]()
+            {
+                old_val = take(value);
+            });
+
+            return old_val;
         }
 
         /*!
-         * Assign a new value to the throttled metric according to the
-         * specified throttling rules.
-         *
-         * @param[in]    rhs    The new value to assign
-         *
-         * @remarks thread-hostile
+         * If the metric is reset on render, moves the running value into the
+         * interval total and resets it to zero.
          */
-        void operator=(const typename T::NativeType rhs) noexcept(false)
+        void calculate() override final
         {
-            if (check_update())
+            // Contention is measured between calculations
+            m_contention.store(0, std::memory_order_relaxed);
+
+            if (m_reset_on_render)
             {
-                (*m_metric) = rhs;
+                update([this]()
+                {
+                    m_interval = take(0);
+                });
             }
         }
 
         /*!
-         * Allows the de-reference operator to be used with Throttle objects.
-         * Helps avoid confusion with the typical use of Metric handles that
-         * requires de-referencing due to them being managed by a
-         * std::shared_ptr
+         * Assignment operator.
          *
-         * @return reference to the Throttle object
+         * @param[in]    rhs    Value to assign to the metric
          *
-         * @remarks thread-hostile
+         * @remarks thread-safe
          */
-        Throttle<T> & operator*() noexcept
+        void operator=(T rhs) noexcept(false)
         {
-            return (*this);
+            update([this, rhs]()
+            {
+                take(rhs);
+            });
         }
 
         /*!
-         * Get the configured time limit (minimum number of milliseconds
-         * between updates).
+         * Pre-increment operator. If increments are sampled, the increment may
+         * not be recorded, and the value returned is the metric's current
+         * estimate.
          *
-         * @return configured time limit in milliseconds
+         * @return incremented value
          *
-         * @remarks thread-hostile
+         * @remarks thread-safe
          */
-        std::chrono::milliseconds time_limit() const noexcept
+        T operator++() noexcept
         {
-            return m_time_limit;
-        }
+            if (m_sampling.sampled())
+            {
+                return sampled_increment(false);
+            }
 
-        /*!
-         * Get the configured attempted operations limit (number of attempted
-         * operations between updates).
-         *
-         * @return configured attempted operations limit
-         *
-         * @remarks thread-hostile
-         */
-        std::uint64_t op_limit() const noexcept
-        {
-            return m_op_limit;
+            T new_val = m_value;
+
+            update([this, & new_val]()
+            {
+                new_val = add(1);
+            });
+
+            return new_val;
         }
 
-    private:
         /*!
-         * Given the configured time and attempted operations limits, determine
-         * if an update should succeed.
+         * Post-increment operator. If increments are sampled, the increment
+         * may not be recorded.
          *
-         * @return @c true if the update should succeed, @c false otherwise
+         * @param ignored
          *
-         * @remarks thread-hostile
+         * @return original value (before increment operation)
+         *
+         * @remarks thread-safe
          */
-        inline bool check_update() noexcept
+        T operator++(int) noexcept
         {
-            if (++m_op_count % m_op_limit == 0)
+            if (m_sampling.sampled())
             {
-                auto now = m_time_function();
-                if (now >= m_next_update)
-                {
-                    m_next_update = now + m_time_limit;
-                    return true;
-                }
-                else
-                {
-                    return false;
-                }
+                return sampled_increment(true);
             }
-            else
+
+            T old_val = m_value;
+
+            update([this, & old_val]()
             {
-                return false;
-            }
-        }
+                old_val = T(add(1) - 1);
+            });
 
-        std::shared_ptr<T> m_metric; //!< The metric being throttled
-        const std::chrono::milliseconds m_time_limit; //!< Time limit (milliseconds between updates)
-        std::chrono::steady_clock::time_point m_next_update; //!< Time at/after which an update may next succeed
-        std::function<std::chrono::steady_clock::time_point ()> m_time_function; //!< Function used to determine the time
-        const std::uint64_t m_op_limit; //!< Attempted operation limit (attempted operations between updates)
-        std::uint64_t m_op_count; //!< Total attempted operations
-    };
+            return old_val;
+        }
 
-    /*!
-     * @brief Throttle template specialisation for NumberMetric objects
-     *
-     * A template specialisation of Throttle providing addition operator
-     * overloads useful for manipulating NumberMetric objects. These operator
-     * overloads remember their right-hand side operand when the addition
-     * operation can't be performed on the metric due to throttling. The
-     * stored value is then added to the metric when the next addition
-     * operation is committed. As with Throttle, this class is not thread-safe.
-     *
-     * @see Throttle
-     *
-     * @par Template arguments
-     *
-     * @par
-     * K - the kind of the NumberMetric being throttled
-     *
-     * @par
-     * T - the native type of the NumberMetric being throttled
-     *
-     * @remarks thread-hostile
-     */
-    template<Metric::Kind K, typename T>
-    class Throttle<NumberMetric<K, T> >
-    {
-    public:
         /*!
-         * @see Throttle
+         * Pre-decrement operator.
+         *
+         * @return decremented value
+         *
+         * @remarks thread-safe
          */
-        Throttle(std::shared_ptr<NumberMetric<K, T> > & metric, const std::chrono::milliseconds time_limit, const std::uint64_t op_limit = 1000,
-                std::function<std::chrono::steady_clock::time_point ()> time_function = []{return std::chrono::steady_clock::now();})
-        : m_metric(metric), m_time_limit(time_limit), m_next_update(time_function() + time_limit), m_time_function(time_function),
-          m_op_limit(((op_limit == 0) ? 1 : op_limit)), m_op_count(0), m_pending_val(0)
+        T operator--() noexcept
         {
-        }
+            T new_val = m_value;
 
-        ~Throttle()
-        {
+            update([this, & new_val]()
+            {
+                new_val = add(T(0) - 1);
+            });
+
+            return new_val;
         }
 
         /*!
-         * @see Throttle
+         * Post-decrement operator.
+         *
+         * @param ignored
+         *
+         * @return original value (before decrement operation)
+         *
+         * @remarks thread-safe
          */
-        void operator=(const T & rhs) noexcept
+        T operator--(int) noexcept
         {
-            if (check_update())
+            T old_val = m_value;
+
+            update([this, & old_val]()
             {
-                (*m_metric) = rhs;
-                m_pending_val = 0;
-            }
+                old_val = T(add(T(0) - 1) + 1);
+            });
+
+            return old_val;
         }
 
         /*!
-         * Adds the specified value to the metric if allowed by the throttling
-         * parameters.
+         * Adds the specified value to the metric.
          *
-         * @param[in]    rhs    Number to be added to the metric
+         * @param[in]    rhs    Value to add
          *
-         * @return @c true if the metric was updated, @c false if it was not due to throttling
+         * @return the value of the metric, after the add operation
          *
-         * @remarks thread-hostile
+         * @remarks thread-safe
          */
-        bool operator+=(const T & rhs) noexcept
+        T operator+=(const T & rhs) noexcept
         {
-            m_pending_val += rhs;
+            T new_val = m_value;
 
-            if (check_update())
-            {
-                commit();
-                return true;
-            }
-            else
+            update([this, rhs, & new_val]()
             {
-                return false;
-            }
+                new_val = add(rhs);
+            });
+
+            return new_val;
         }
 
         /*!
-         * Increments the metric if allowed by the throttling parameters.
+         * Subtracts the specified value from the metric.
          *
-         * @return @c true if the metric was updated, @c false if it was not due to throttling
+         * @param[in]    rhs    Value to subtract
          *
-         * @remarks thread-hostile
+         * @return the value of the metric, after the subtract operation
+         *
+         * @remarks thread-safe
          */
-        bool operator++() noexcept
+        T operator-=(const T & rhs) noexcept
         {
-            ++m_pending_val;
+            T new_val = m_value;
 
-            if (check_update())
-            {
-                commit();
-                return true;
-            }
-            else
+            update([this, rhs, & new_val]()
             {
-                return false;
-            }
+                new_val = add(T(T(0) - rhs));
+            });
+
+            return new_val;
         }
 
+    private:
+        static const std::size_t LINE_SIZE = 64; //!< Size of a cache line, in bytes
+
         /*!
-         * @see Throttle::operator*
+         * One counter of a sharded metric. Padded to a cache line, and
+         * allocated on a cache line boundary, so that threads in different
+         * slots do not contend.
          */
-        Throttle<NumberMetric<K, T> > & operator*() noexcept
+        struct Shard
         {
-            return (*this);
-        }
+            std::atomic<T> value; //!< The shard's part of the metric's value
+            char padding[LINE_SIZE - sizeof(std::atomic<T>)]; //!< Padding to a cache line
+        };
 
         /*!
-         * Updates the metric with any pending addition operations deferred due
-         * to throttling.
+         * The shards of one group of slots (see CpuSlot::group_of), in pages
+         * of their own. The shards are zeroed by the constructing thread, so
+         * on Linux the pages are placed on that thread's NUMA node by the
+         * kernel's first-touch policy.
          */
-        inline void commit() noexcept
+        struct ShardGroup
         {
-            (*m_metric) += m_pending_val;
-            m_pending_val = 0;
-        }
+            /*!
+             * Allocates and zeroes the shards.
+             *
+             * @param[in]    size    The number of shards
+             *
+             * @throws std::bad_alloc if the shards can't be allocated
+             */
+            explicit ShardGroup(const std::size_t size) noexcept(false) : shards(nullptr), size(size), bytes(0)
+            {
+#if defined(__linux__)
+                const long page = sysconf(_SC_PAGESIZE);
+                const std::size_t page_size = (page > 0) ? std::size_t(page) : 4096;
+                bytes = (((size * sizeof(Shard)) + page_size - 1) / page_size) * page_size;
+
+                void * pages = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (pages == MAP_FAILED)
+                {
+                    throw std::bad_alloc();
+                }
+
+                shards = static_cast<Shard *>(pages);
+#else
+                // Aligned to a cache line, so that each shard has a line to itself
+                std::size_t space = (size * sizeof(Shard)) + LINE_SIZE;
+                storage.reset(new char[space]);
+
+                void * aligned = storage.get();
+                std::align(LINE_SIZE, size * sizeof(Shard), aligned, space);
+                shards = static_cast<Shard *>(aligned);
+#endif
+
+                for (std::size_t i = 0; i < size; ++i)
+                {
+                    new (&shards[i]) Shard();
+                    shards[i].value.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            ~ShardGroup() noexcept
+            {
+#if defined(__linux__)
+                munmap(shards, bytes);
+#endif
+            }
+
+            ShardGroup(const ShardGroup &) = delete;
+            ShardGroup & operator=(const ShardGroup &) = delete;
+
+            Shard * shards; //!< The shards
+            std::size_t size; //!< Number of shards
+            std::size_t bytes; //!< Size of the pages holding the shards
+            std::unique_ptr<char[]> storage; //!< Storage for the shards, where pages aren't allocated directly
+        };
 
         /*!
-         * @see Throttle::time_limit
+         * The shards of a sharded metric, in groups that are allocated as
+         * they're first updated.
          */
-        std::chrono::milliseconds time_limit() const noexcept
+        struct ShardSet
         {
-            return m_time_limit;
-        }
+            /*!
+             * Creates a set with no groups allocated.
+             *
+             * @param[in]    by        How shards are chosen
+             * @param[in]    count     The number of groups
+             */
+            ShardSet(const ShardBy by, const std::size_t count) noexcept(false)
+                : by(by), groups(new std::atomic<ShardGroup *>[count]), count(count), promoted_at(0)
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    groups[i].store(nullptr, std::memory_order_relaxed);
+                }
+            }
+
+            ~ShardSet() noexcept
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    delete groups[i].load();
+                }
+            }
+
+            ShardSet(const ShardSet &) = delete;
+            ShardSet & operator=(const ShardSet &) = delete;
+
+            ShardBy by; //!< How shards are chosen
+            std::unique_ptr<std::atomic<ShardGroup *>[]> groups; //!< The groups of shards, null until first updated
+            std::size_t count; //!< Number of groups
+            std::chrono::steady_clock::duration::rep promoted_at; //!< Time of promotion, since the time function's epoch
+        };
 
         /*!
-         * @see Throttle::op_limit
+         * Get a group of shards, allocating it if this is its first update.
+         *
+         * @param[in]    set      The shards
+         * @param[in]    group    The group
+         *
+         * @return the group, or null if it couldn't be allocated
          */
-        std::uint64_t op_limit() const noexcept
+        static ShardGroup * shard_group(ShardSet & set, const std::size_t group) noexcept
         {
-            return m_op_limit;
+            ShardGroup * current = set.groups[group].load(std::memory_order_acquire);
+            if (current != nullptr)
+            {
+                return current;
+            }
+
+            try
+            {
+                std::unique_ptr<ShardGroup> created(new ShardGroup(CpuSlot::group_start(group + 1) - CpuSlot::group_start(group)));
+                if (set.groups[group].compare_exchange_strong(current, created.get(), std::memory_order_acq_rel))
+                {
+                    return created.release();
+                }
+            }
+            catch (...)
+            {
+                // The caller falls back to the compact value
+            }
+
+            return current;
         }
 
-    private:
         /*!
-         * @see Throttle::check_update
+         * Adds to the metric's value (wrapping, so adding the two's
+         * complement subtracts), using whichever representation is current.
+         *
+         * @param[in]    amount    The amount to add
+         *
+         * @return the value after the addition. Only exact if the metric isn't sharded
          */
-        inline bool check_update() noexcept
+        T add(const T amount) noexcept
         {
-            if (++m_op_count % m_op_limit == 0)
+            ShardSet * set = m_shards.load(std::memory_order_acquire);
+            if (set != nullptr)
             {
-                auto now = m_time_function();
-                if (now >= m_next_update)
+                Shard * shard = nullptr;
+                if (set->by == ShardBy::CPU)
                 {
-                    m_next_update = now + m_time_limit;
-                    return true;
+                    const std::size_t slot = CpuSlot::index();
+                    const std::size_t group = CpuSlot::group_of(slot);
+                    ShardGroup * shards = shard_group(*set, group);
+                    if (shards != nullptr)
+                    {
+                        shard = &shards->shards[slot - CpuSlot::group_start(group)];
+                    }
                 }
                 else
                 {
-                    return false;
+                    ShardGroup * shards = set->groups[0].load(std::memory_order_relaxed);
+                    shard = &shards->shards[ThreadSlot::index() & (shards->size - 1)];
+                }
+
+                if (shard == nullptr)
+                {
+                    return T(m_value.fetch_add(amount) + amount);
                 }
+
+                T shard_value = shard->value.fetch_add(amount, std::memory_order_relaxed);
+                return T(m_value.load(std::memory_order_relaxed) + shard_value + amount);
             }
-            else
+
+            if (!m_adaptive.load(std::memory_order_relaxed))
             {
-                return false;
+                return T(m_value.fetch_add(amount) + amount);
             }
-        }
 
-        std::shared_ptr<NumberMetric<K, T> > m_metric; //!< @see Throttle
-        const std::chrono::milliseconds m_time_limit; //!< @see Throttle
-        std::chrono::steady_clock::time_point m_next_update; //!< @see Throttle
-        std::function<std::chrono::steady_clock::time_point ()> m_time_function; //!< @see Throttle
-        const std::uint64_t m_op_limit; //!< @see Throttle
-        std::uint64_t m_op_count; //!< @see Throttle
-        T m_pending_val; //!< Uncommitted value waiting to be added to the metric
-    };
+            T expected = m_value.load(std::memory_order_relaxed);
+            while (!m_value.compare_exchange_weak(expected, T(expected + amount)))
+            {
+                if ((m_contention.fetch_add(1, std::memory_order_relaxed) + 1) >= m_contention_threshold.load(std::memory_order_relaxed))
+                {
+                    try
+                    {
+                        promote(m_shard_by);
+                    }
+                    catch (...)
+                    {
+                        // Stay compact if the shards can't be allocated
+                        m_adaptive = false;
+                    }
 
-    /*!
-     * @class Renderer
-     *
-     * @brief Interface for metric "renderers" (output objects)
-     *
-     * @remarks thread-hostile
-     */
-    class Renderer
-    {
-    public:
-        Renderer() : m_suppressed_exception(false)
-        {
-        }
+                    return add(amount);
+                }
+            }
 
-        virtual ~Renderer()
-        {
+            return T(expected + amount);
         }
 
         /*!
-         * For a given render operation, called once before all calls to
-         * @link Renderer::render @endlink
-         *
-         * @see Renderer::render
+         * Get the metric's running value: the sum of all its shards, if it's
+         * sharded.
          */
-        virtual void before()
+        T total() const noexcept
         {
-            return;
+            T result = m_value.load();
+
+            ShardSet * set = m_shards.load(std::memory_order_acquire);
+            if (set != nullptr)
+            {
+                for (std::size_t group = 0; group < set->count; ++group)
+                {
+                    ShardGroup * shards = set->groups[group].load(std::memory_order_acquire);
+                    for (std::size_t i = 0; (shards != nullptr) && (i < shards->size); ++i)
+                    {
+                        result = T(result + shards->shards[i].value.load(std::memory_order_relaxed));
+                    }
+                }
+            }
+
+            return result;
         }
 
         /*!
-         * For a given render operation, called once after all calls to
-         * @link Renderer::render @endlink
+         * Atomically replaces the metric's running value. If the metric is
+         * sharded, each shard is exchanged for zero, so no update is counted
+         * twice or lost.
          *
-         * @see Renderer::render
+         * @param[in]    replacement    The new value
+         *
+         * @return the running value before the exchange
          */
-        virtual void after()
+        T take(const T replacement) noexcept
         {
-            return;
+            T result = m_value.exchange(replacement);
+
+            ShardSet * set = m_shards.load(std::memory_order_acquire);
+            if (set != nullptr)
+            {
+                for (std::size_t group = 0; group < set->count; ++group)
+                {
+                    ShardGroup * shards = set->groups[group].load(std::memory_order_acquire);
+                    for (std::size_t i = 0; (shards != nullptr) && (i < shards->size); ++i)
+                    {
+                        result = T(result + shards->shards[i].value.exchange(0, std::memory_order_relaxed));
+                    }
+                }
+            }
+
+            return result;
         }
 
         /*!
-         * For a given render operation, called once for each metric to be
-         * rendered.
-         *
-         * @param[in]    metric    The metric to be rendered
+         * Creates the per-thread countdown, if every-Nth sampling is used.
          */
-        virtual void render(const std::shared_ptr<Metric> & metric)
+        void init_sampling() noexcept(false)
         {
-            (void)(metric);
-            return;
+            if ((m_sampling.sampled()) && (m_sampling.mode() == Sampling::Mode::EVERY_NTH))
+            {
+                m_countdown.reset(new SamplingCountdown(m_sampling.interval()));
+            }
         }
 
         /*!
-         * Sets or unsets the "suppressed exception" flag which is used to
-         * indicate if an exception thrown in a derived method of
-         * after was suppressed. This will happen to prevent exceptions
-         * propagating out of the RendererContext destructor.
-         *
-         * @param[in]    state    The state to which to set the flag
-         *
-         * @see Renderer::after
+         * Get whether the calling thread's current increment should be
+         * recorded.
          */
-        void suppressed_exception(bool state) noexcept
+        bool record_increment() noexcept
         {
-            m_suppressed_exception = state;
+            if (m_sampling.mode() == Sampling::Mode::RANDOM)
+            {
+                return m_sampling.draw();
+            }
+
+            return m_countdown->tick();
         }
 
         /*!
-         * Gets the state of the "suppressed exception" flag.
+         * Increments the metric under sampling, adding N to the metric if the
+         * increment is recorded.
          *
-         * @see Renderer::suppressed_exception(bool)
-         *
-         * @return @c true if the flag is set, @c false otherwise
+         * @param[in]    post    @c true to return the value before the increment, @c false to return the value after
          */
-        bool suppressed_exception() const noexcept
+        T sampled_increment(const bool post) noexcept
         {
-            return m_suppressed_exception;
+            if (!record_increment())
+            {
+                return total();
+            }
+
+            T result = 0;
+            T step = T(m_sampling.interval());
+
+            update([this, post, step, & result]()
+            {
+                T new_val = add(step);
+                result = (post) ? T(new_val - step) : new_val;
+            });
+
+            return result;
         }
 
-    private:
-        bool m_suppressed_exception; //!< The flag - @c true if an exception was suppressed, @c false otherwise
+        std::atomic<T> m_value; //!< Metric's value
+        std::atomic<T> m_interval; //!< Total for the last completed interval, if the metric is reset on render
+        std::atomic<bool> m_reset_on_render; //!< Is the metric reset to zero on each render?
+        const Sampling m_sampling; //!< How increments are sampled
+        std::unique_ptr<SamplingCountdown> m_countdown; //!< Per-thread countdown, for every-Nth sampling
+        std::atomic<bool> m_adaptive; //!< Is the metric promoted to a sharded representation when contended?
+        std::atomic<std::uint64_t> m_contention_threshold; //!< Failed updates between calculations that trigger promotion
+        std::atomic<std::uint64_t> m_contention; //!< Failed updates since the last calculation
+        std::atomic<ShardBy> m_shard_by; //!< How shards are chosen on adaptive promotion
+        std::atomic<ShardSet *> m_shards; //!< Shards, once promoted. Never freed until the metric is destroyed
 
     };
 
     /*!
-     * @class PlainRenderer
+     * @class NumberMetric<Metric::Kind::FLOAT, float>
      *
-     * @brief Renders metrics as simple line-delimited key value pairs in the form \<metric name\> = \<metric value\>
+     * @brief Specialisation of NumberMetric for float values.
      *
-     * @remarks thread-hostile
+     * @see NumberMetric
+     *
+     * @remarks thread-safe
      */
-    class PlainRenderer : public Renderer
+    template<>
+    class NumberMetric<Metric::Kind::FLOAT, float> : public Metric, public DiscoverableNativeType<float>
     {
     public:
         /*!
          * Constructor.
          *
-         * @param[in]    destination    Output stream to which to write the rendered metrics. This stream object @b must persist beyond the life of the renderer
+         * @see NumberMetric
          */
-        PlainRenderer(std::ostream & destination) noexcept : m_destination(destination)
+        NumberMetric(const std::string & name, const std::string & unit, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const float initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::FLOAT, name, unit, description, time_function, hook_rate_limit), m_value(initial_value)
         {
         }
 
-        virtual ~PlainRenderer() noexcept override
+        /*!
+         * Constructor.
+         *
+         * @see NumberMetric
+         */
+        NumberMetric(const char * name, const char * unit, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const float initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::FLOAT, name, unit, description, time_function, hook_rate_limit), m_value(initial_value)
+        {
+        }
+
+        NumberMetric(const NumberMetric &) = delete;
+        NumberMetric(NumberMetric &&) = delete;
+        NumberMetric & operator=(const NumberMetric &) = delete;
+        NumberMetric & operator=(NumberMetric &&) = delete;
+
+        /*!
+         * Get the metric value as a std::string. Always represented to 2
+         * decimal places.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            std::stringstream formatter;
+
+            formatter << std::fixed << std::setprecision(2) << m_value;
+
+            return formatter.str();
+        }
+
+        /*!
+         * Get the metric value as a float.
+         *
+         * @remarks thread-safe
+         */
+        explicit operator float() const noexcept override final
         {
+            return m_value;
         }
 
         /*!
-         * Adds a newline to the stream and flushes its buffer.
+         * @see Metric::numeric_value
          */
-        virtual void after() noexcept(false) override
+        double numeric_value() const noexcept override final
         {
-            m_destination << std::endl;
+            return double(m_value);
         }
 
         /*!
-         * Renders a metric as \<metric name\> = \<metric value\> \<metric unit\>\\n
-         * and writes it to the output stream.
+         * @see Metric::delta
+         */
+        bool delta(std::uint64_t & checkpoint, std::string & result) const noexcept(false) override final
+        {
+            result = delta_of(m_value.load(), checkpoint);
+            return true;
+        }
+
+        /*!
+         * Assignment operator.
          *
-         * @param[in]    metric    The metric to render
+         * @param[in]    rhs    Value to assign to the metric
+         *
+         * @remarks thread-safe
          */
-        void render(const std::shared_ptr<Metric> & metric) noexcept(false) override final
+        void operator=(float rhs) noexcept(false)
         {
-            std::string unit_part = metric->unit();
-            if (unit_part.size() > 0)
-            {
-                m_destination << metric->name() << " = " << std::string((*metric)) << ' ' << unit_part << '\n';
-            }
-            else
+            update([this, rhs]()
             {
-                m_destination << metric->name() << " = " << std::string((*metric)) << '\n';
-            }
+                m_value = rhs;
+            });
         }
 
     private:
-        std::ostream & m_destination; //!< Output stream to which to write rendered output
+        std::atomic<float> m_value; //!< Metric's value
 
     };
 
     /*!
-     * @class JsonStringLiteral
+     * @class RateMetric
      *
-     * @brief A valid, quoted and escaped JSON string literal
+     * @brief Tracks the rate of change of a "distance" NumberMetric
      *
-     * Converts a data buffer to a JSON string literal for insertion
-     * directly in JSON data. The string literal representation contains
-     * the source data with leading and trailing double quotes along with
-     * appropriately escaped characters according to standards (see
-     * https://tools.ietf.org/html/rfc7159).
+     * The rate is always expressed per second. The rate is calculated only on
+     * calls to ::calculate, and even then at most once per second. The rest
+     * of the time, the metric's value is pulled from a cache. A result proxy
+     * function can be used to modify the calculated rate before it is stored.
+     * This is particularly useful for performing unit conversions.
+     *
+     * @par Template arguments
+     *
+     * @par
+     * D - the type of the metric object whose rate is to be tracked
+     *
+     * @remarks thread-safe
      */
-    class JsonStringLiteral
+    template<typename D>
+    class RateMetric : public Metric, public DiscoverableNativeType<float>
     {
-
     public:
         /*!
          * Constructor.
          *
-         * @param[in]    data    Contents of the string literal
+         * @param[in]    distance              The metric whose rate is to be tracked
+         * @param[in]    result_proxy          A function used to modify a calculated rate before it is committed
+         * @param[in]    name                  @see Metric::Metric
+         * @param[in]    unit                  @see Metric::Metric
+         * @param[in]    description           @see Metric::Metric
+         * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    hook_rate_limit    @see Metric::Metric
          */
-        explicit JsonStringLiteral(const std::string & data) noexcept(false)
+        RateMetric(std::shared_ptr<D> & distance, std::function<float (float)> result_proxy, const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::RATE, name, unit, description, time_function, hook_rate_limit), m_distance(distance), m_result_proxy(result_proxy),
+          m_last_distance(0), m_cache(0.0f)
         {
-            literalise(data, m_result);
         }
 
         /*!
-         * Constructor.
-         *
-         * @param[in]    data    Contents of the string literal
+         * @see RateMetric::RateMetric(std::shared_ptr<D> &, std::function<float (float)>, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
          */
-        explicit JsonStringLiteral(const char * data) noexcept(false)
+        RateMetric(std::shared_ptr<D> & distance, std::function<float (float)> result_proxy, const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::RATE, name, unit, description, time_function, hook_rate_limit), m_distance(distance), m_result_proxy(result_proxy),
+          m_last_distance(0), m_cache(0.0f)
         {
-            std::string strData(data);
-
-            literalise(strData, m_result);
         }
 
-        JsonStringLiteral(const JsonStringLiteral & rhs) = default;
-        JsonStringLiteral(JsonStringLiteral && rhs) noexcept(false) : m_result(std::move(rhs.m_result))
+        /*!
+         * @see RateMetric::RateMetric(std::shared_ptr<D> &, std::function<float (float)>, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
+         */
+        RateMetric(std::shared_ptr<D> & distance, const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::RATE, name, unit, description, time_function, hook_rate_limit), m_distance(distance), m_last_distance(0), m_cache(0.0f)
         {
         }
 
-        JsonStringLiteral & operator=(JsonStringLiteral & rhs) = default;
-        JsonStringLiteral & operator=(JsonStringLiteral && rhs) noexcept(false)
+        /*!
+         * @see RateMetric::RateMetric(std::shared_ptr<D> &, std::function<float (float)>, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
+         */
+        RateMetric(std::shared_ptr<D> & distance, const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::RATE, name, unit, description, time_function, hook_rate_limit), m_distance(distance), m_last_distance(0), m_cache(0.0f)
         {
-            if (this != &rhs)
-            {
-                m_result = std::move(rhs.m_result);
-                rhs.m_result.clear();
-            }
+        }
 
-            return (*this);
-        }
+        RateMetric(const RateMetric &) = delete;
+        RateMetric(RateMetric &&) = delete;
+        RateMetric & operator=(const RateMetric &) = delete;
+        RateMetric & operator=(RateMetric &&) = delete;
 
         /*!
-         * Get a pointer to a null-terminated string containing the JSON string literal,
-         * including leading and terminating double quotes, and appropriately escaped
-         * source characters.
+         * Get the metric value as a std::string. Always represented
+         * to 2 decimal places.
+         *
+         * @remarks thread-safe
          */
-        operator const char * () const noexcept
+        operator std::string() const noexcept(false) override final
         {
-            return m_result.c_str();
+            std::stringstream formatter;
+            formatter << std::fixed << std::setprecision(2) << m_cache;
+            return formatter.str();
         }
 
-    private:
         /*!
-         * Create a JSON-compatible string literal representation of in, and write it to
-         * out.
+         * Get the metric value as a float.
          *
-         * @param[in]     in     The string from which to create a JSON string literal
-         * @param[out]    out    The result
+         * @remarks thread-safe
          */
-        void literalise(const std::string & in, std::string & out) const noexcept(false)
+        explicit operator float() const noexcept override final
         {
-            out.push_back('"');
-
-            for (auto c : in)
-            {
-                if ((c >= 0) && (c <= 0x1f))
-                {
-                    switch(c)
-                    {
-                    case 8: // Backspace
-                        out.push_back('\\');
-                        out.push_back('b');
-                        break;
-                    case 9: // Horizontal tab
-                        out.push_back('\\');
-                        out.push_back('t');
-                        break;
-                    case 10: // Line feed
-                        out.push_back('\\');
-                        out.push_back('n');
-                        break;
-                    case 12: // Form feed
-                        out.push_back('\\');
-                        out.push_back('f');
-                        break;
-                    case 13: // Carriage return
-                        out.push_back('\\');
-                        out.push_back('r');
-                        break;
-                    default:
-                        escape_as_hex(c, out);
-                        break;
-                    }
-                }
-                else
-                {
-                    switch(c)
-                    {
-                    case '"':
-                    case '\\':
-                    case '/':
-                        // Must be escaped
-                        out.push_back('\\');
-                        out.push_back(c);
-                        break;
-                    default:
-                        out.push_back(c);
-                        break;
-                    }
-                }
-            }
-
-            out.push_back('"');
+            return m_cache;
         }
 
         /*!
-         * Escape c as a JSON hex escape sequence of the form \uXXXX, where XXXX is a
-         * 32-bit integer in hexadecimal notation, and append it to out.
-         *
-         * @param[in]     c      The character to escape
-         * @param[out]    out    The string to which the escaped character will be appended
+         * @see Metric::numeric_value
          */
-        void escape_as_hex(char c, std::string & out) const noexcept
+        double numeric_value() const noexcept override final
         {
-            std::stringstream formatter;
-
-            formatter << "\\u00" << std::uppercase << std::setfill('0') << std::setw(2) << std::hex << static_cast<std::uint16_t>(c);
-
-            out += formatter.str();
+            return double(m_cache);
         }
 
-        std::string m_result; //!< The normalised JSON string literal
-
-    };
-
-    /*!
-     * @class JsonRenderer
-     *
-     * @brief Renders metrics as a JSON object
-     *
-     * Rendered metrics consist of a single JSON dictionary whose keys are
-     * metric names that each refer to a single JSON dictionary containing
-     * information about the metric. Specifically, the metric's @em value,
-     * @em unit, @em kind and @em description. Note that rendered JSON is never
-     * pretty-printed (but the example below is for convenience).
-     *
-     * @include json_renderer_example.json
-     *
-     * @remarks thread-hostile
-     */
-    class JsonRenderer : public Renderer
-    {
-    public:
         /*!
-         * Constructor.
+         * For a given value @c val apply the specified proxy function and
+         * return the result. Alternatively if no proxy function is specified,
+         * return @c val
          *
-         * @param[in]    destination    Output stream to which to write the rendered metrics. This stream object @b must persist beyond the life of the renderer
+         * @param[in]    val    Value to proxy
          *
-         * @remarks thread-hostile
-         */
-        JsonRenderer(std::ostream & destination) noexcept : m_destination(destination), m_count(0)
-        {
-        }
-
-        virtual ~JsonRenderer() noexcept
-        {
-        }
-
-        /*!
-         * Writes the leading brace of the JSON object to the output stream.
+         * @return proxied value
          *
-         * @remarks thread-hostile
+         * @remarks thread-safe if proxy function is also thread-safe
          */
-        virtual void before() noexcept(false) override
+        float proxy_value(float val) const
         {
-            m_count = 0;
-            m_destination << '{';
+            return ((m_result_proxy) ? m_result_proxy(val) : val);
         }
 
         /*!
-         * Writes the trailing brace of the JSON object to the output stream,
-         * then flushes the stream's buffer.
+         * Get the metric whose rate is tracked.
          *
-         * @remarks thread-hostile
+         * @see Metric::dependencies
          */
-        virtual void after() noexcept(false) override
+        std::vector<std::shared_ptr<Metric> > dependencies() const noexcept(false) override final
         {
-            m_destination << '}';
-            m_destination.flush();
+            return std::vector<std::shared_ptr<Metric> >(1, m_distance);
         }
 
         /*!
-         * Renders the metric as a JSON object.
-         *
-         * @example json_renderer_example.json
+         * Calculates the rate. Internally the calculations are cached.
+         * The cache is updated at most once per second, so there is no need to
+         * (but little harm in) calling this method more frequently than that.
          *
-         * @param[in]    metric    The metric to render
+         * As with all metric kinds this method is called automatically before
+         * rendering, thus ensuring the metric's value is up-to-date prior to
+         * the render operation.
          *
-         * @remarks thread-hostile
+         * If the metric's value is needed outside of a render operation, it's
+         * recommended that rather than call this method applications instead
+         * rely on their regular render operation (assuming there is one) to
+         * keep the cache up-to-date. Reading the value is then simply a case
+         * of casting the metric to a @c float or @c std::string
          */
-        void render(const std::shared_ptr<Metric> & metric) noexcept(false) override final
+        void calculate() override final
         {
-            if (m_count > 0)
-            {
-                m_destination << ',';
-            }
-
-            m_destination << JsonStringLiteral(metric->name()) << ":{";
+            auto now_time = m_time_function();
 
-            m_destination << JsonStringLiteral("value") << ':';
-            switch(metric->kind())
+            if (now_time - m_last_calc_time >= std::chrono::milliseconds(1000))
             {
-            case Metric::Kind::UINT:
-            case Metric::Kind::INT:
-            case Metric::Kind::FLOAT:
-            case Metric::Kind::RATE:
-            case Metric::Kind::SUM:
-                m_destination << std::string((*metric));
-                break;
-            case Metric::Kind::STR:
-                m_destination << JsonStringLiteral((*metric));
-                break;
-            case Metric::Kind::BOOL:
-                if (bool(*metric))
-                {
-                    m_destination << "true";
-                }
-                else
+                update([this, & now_time]()
                 {
-                    m_destination << "false";
-                }
-                break;
-            }
-            m_destination << ',';
+                    float distance = static_cast<typename D::NativeType>(*m_distance);
 
-            m_destination << JsonStringLiteral("unit") << ':' << JsonStringLiteral(metric->unit()) << ',';
-            m_destination << JsonStringLiteral("kind") << ':' << JsonStringLiteral(metric->kind_name()) << ',';
-            m_destination << JsonStringLiteral("description") << ':' << JsonStringLiteral(metric->description());
+                    auto time_elapsed_sec = float(std::chrono::duration_cast<std::chrono::milliseconds>(now_time - m_last_calc_time).count()) / 1000;
+                    auto distance_travelled = float(distance - m_last_distance);
 
-            m_destination << '}';
+                    if (time_elapsed_sec != 0.0)
+                    {
+                        float value = distance_travelled / time_elapsed_sec;
+                        m_cache = proxy_value(value);
+                    }
 
-            ++m_count;
+                    m_last_distance = distance;
+                    m_last_calc_time = now_time;
+                });
+            }
         }
 
     private:
-        std::ostream & m_destination; //!< Output stream to which to write rendered output
-        std::size_t m_count; //!< Number of metrics written to the stream since the start of the current render operation
+        std::shared_ptr<D> m_distance; //!< Distance metric whose rate is to be tracked
+        std::function<float (float)> m_result_proxy; //!< Proxy function to use for rate values
+        std::atomic<float> m_last_distance; //!< The distance value last read
+        std::atomic<float> m_cache; //!< Most recently calculated rate
+        std::chrono::steady_clock::time_point m_last_calc_time; //!< Last time at which the cache was updated
 
     };
 
     /*!
-     * @class PrometheusRenderer
+     * @class SumMetric
      *
-     * @brief Renders metrics in the Prometheus text-based exposition format.
+     * @brief Sums the values of other metrics
      *
-     * Rendered metrics consist of
+     * Adds the values of multiple other "target" metrics together. Unlike
+     * RateMetric, SumMetric doesn't use hooks, but simply defers the summing
+     * operation until it is rendered (or cast to a std::string).
      *
-     * Reference: https://github.com/prometheus/docs/blob/main/content/docs/instrumenting/exposition_formats.md#text-based-format
+     * @par Template arguments
      *
-     * @include prometheus_renderer_example.txt
+     * @par
+     * D - the type of the metric objects to be summed
      *
-     * @remarks thread-hostile
+     * @remarks thread-safe
      */
-    class PrometheusRenderer : public Renderer
+    template<typename D>
+    class SumMetric : public Metric, public DiscoverableNativeType<typename D::NativeType>
     {
     public:
         /*!
          * Constructor.
          *
-         * @param[in]    destination         Output stream to which to write the rendered metrics. This stream object @b must persist beyond the life of the renderer
-         * @param[in]    timestamp_getter    Function that returns the current timestamp in milliseconds since the Unix epoch
-         * @param[in]    app_name            Name of the application to which the metrics belong. It must match regex: [a-zA-Z_:][a-zA-Z0-9_:]*
-         * 
-         * @throws RenderError
-         *
-         * @remarks thread-hostile
+         * @param[in]    targets               List of target metrics whose values are to be summed
+         * @param[in]    name                  @see Metric::Metric
+         * @param[in]    unit                  @see Metric::Metric
+         * @param[in]    description           @see Metric::Metric
+         * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    hook_rate_limit    @see Metric::Metric
          */
-        PrometheusRenderer(std::ostream & destination, std::function<std::int64_t ()> timestamp_getter,
-                const std::string & app_name = "") : m_destination(destination), m_timestamp_getter(timestamp_getter),
-                m_count(0), m_app_name(app_name), m_METRIC_NAME_PATTERN("[a-zA-Z_:][a-zA-Z0-9_:]*"),
-                m_METRIC_NAME_CHAR_PATTERN("[a-zA-Z0-9_:]"), m_METRIC_UNIT_CHAR_PATTERN("[a-zA-Z0-9]")
+        SumMetric(std::initializer_list<std::shared_ptr<D> > targets, const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::SUM, name, unit, description, time_function, hook_rate_limit), m_cache(0)
         {
-            if (!std::regex_match(m_app_name, m_METRIC_NAME_PATTERN))
+            for (auto target : targets)
             {
-                throw RenderError("Application name contains invalid characters. It must match regex: [a-zA-Z_:][a-zA-Z0-9_:]*");
+                add_target(target);
             }
         }
 
-        virtual ~PrometheusRenderer() noexcept
+        /*!
+         * @see SumMetric::SumMetric(std::initializer_list<std::shared_ptr<D> >, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
+         */
+        SumMetric(const std::string & name, const std::string & unit, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::SUM, name, unit, description, time_function, hook_rate_limit), m_cache(0)
         {
         }
 
         /*!
-         *
-         *
-         * @remarks thread-hostile
+         * @see SumMetric::SumMetric(std::initializer_list<std::shared_ptr<D> >, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
          */
-        virtual void before() noexcept(false) override
+        SumMetric(std::initializer_list<std::shared_ptr<D> > targets, const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::SUM, name, unit, description, time_function, hook_rate_limit), m_cache(0)
         {
-            m_count = 0;
+            for (auto target : targets)
+            {
+                add_target(target);
+            }
         }
 
         /*!
-         *
-         *
-         * @remarks thread-hostile
+         * @see SumMetric::SumMetric(std::initializer_list<std::shared_ptr<D> >, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
          */
-        virtual void after() noexcept(false) override
+        SumMetric(const char * name, const char * unit, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::SUM, name, unit, description, time_function, hook_rate_limit), m_cache(0)
         {
-            m_destination << std::endl;
         }
 
+        SumMetric(const SumMetric &) = delete;
+        SumMetric(SumMetric &&) = delete;
+        SumMetric & operator=(const SumMetric &) = delete;
+        SumMetric & operator=(SumMetric &&) = delete;
+
         /*!
-         * Renders the metric as an entry in a Prometheus metric set.
-         *
-         * @example prometheus_renderer_example.txt
+         * Adds a target metric to the list of those to be summed.
          *
-         * @param[in]    metric    The metric to render
+         * @param[in]    target    The metric to be included in the sum operation
          *
-         * @remarks thread-hostile
+         * @remarks thread-safe
          */
-        void render(const std::shared_ptr<Metric> & metric) noexcept(false) override final
+        void add_target(std::shared_ptr<D> & target) noexcept(false)
         {
-            std::string metric_value;
-
-            switch(metric->kind())
-            {
-            case Metric::Kind::UINT:
-            case Metric::Kind::INT:
-            case Metric::Kind::FLOAT:
-            case Metric::Kind::RATE:
-            case Metric::Kind::SUM:
-                metric_value = std::string((*metric));
-                break;
-            case Metric::Kind::BOOL:
-                if (bool(*metric))
-                {
-                    metric_value = "1";
-                }
-                else
-                {
-                    metric_value = "0";
-                }
-                break;
-            default:
-                /*
-                 * Only numeric metrics are supported by this renderer.
-                 */
-                return;
-            }
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_metric_mutex);
 
-            std::string name_dirty{metric->name()};
-            std::string name_sanitised;
-            if (!sanitise_name(name_dirty, name_sanitised))
-            {
-                return;
-            }
+            m_targets.push_back(target);
+            m_cache = m_cache + static_cast<typename D::NativeType>(*target);
+        }
 
-            if (m_count > 0)
-            {
-                m_destination << '\n';
-            }
+        /*!
+         * Get the sum as the native type defined by the target metric type.
+         *
+         * @remarks thread-safe
+         */
+        explicit operator typename D::NativeType() const noexcept override final
+        {
+            return m_cache;
+        }
 
-            if (!m_app_name.empty())
-            {
-                name_sanitised = m_app_name + "::" + name_sanitised;
-            }
+        /*!
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return double(m_cache.load());
+        }
 
-            std::string unit_dirty{metric->unit()};
-            std::string unit_sanitised;
-            if (!unit_dirty.empty())
-            {
-                sanitise_unit(unit_dirty, unit_sanitised);
-                name_sanitised.push_back('_');
-                name_sanitised.append(unit_sanitised);
-            }
+        /*!
+         * @see Metric::delta
+         */
+        bool delta(std::uint64_t & checkpoint, std::string & result) const noexcept(false) override final
+        {
+            result = delta_of(m_cache.load(), checkpoint);
+            return true;
+        }
 
-            std::string help_str_dirty{metric->description()};
-            std::string help_str_sanitised;
-            if (!help_str_dirty.empty())
-            {
-                escape_str(help_str_dirty, help_str_sanitised);
+        /*!
+         * Get the sum as a std::string. Always represented to 2 decimal
+         * places for float metrics.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            std::stringstream formatter;
+            formatter << std::fixed << std::setprecision(2) << m_cache;
 
-                m_destination << "# HELP " << name_sanitised << ' ' << help_str_sanitised << '\n';
-            }
+            return formatter.str();
+        }
 
-            m_destination << name_sanitised << ' ' << metric_value << ' ' << m_timestamp_getter();
+        /*!
+         * Get the number of metrics being summed.
+         *
+         * @return the number of metrics
+         *
+         * @remarks thread-safe
+         */
+        std::size_t target_count() const noexcept
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_metric_mutex);
 
-            ++m_count;
+            return m_targets.size();
         }
 
-    private:
-        bool sanitise_name(const std::string & in,
-                std::string & out)
+        /*!
+         * Get the metrics being summed.
+         *
+         * @see Metric::dependencies
+         */
+        std::vector<std::shared_ptr<Metric> > dependencies() const noexcept(false) override final
         {
-            /*
-             * Ref: https://prometheus.io/docs/concepts/data_model/#metric-names-and-labels
-             */
-
-            out.clear();
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_metric_mutex);
 
-            for (auto in_c : in)
-            {
-                std::smatch match_char;
-                std::string target;
-                target.push_back(in_c);
+            return std::vector<std::shared_ptr<Metric> >(m_targets.begin(), m_targets.end());
+        }
 
-                if (std::regex_match(target, match_char, m_METRIC_NAME_CHAR_PATTERN))
-                {
-                    out.push_back(in_c);
-                }
-                else if (in_c == '.')
-                {
-                    /*
-                    * Ref: https://prometheus.io/docs/concepts/data_model/#metric-names-and-labels
-                    */
-                    out.push_back(':');
-                    out.push_back(':');
-                }
-            }
+        /*!
+         * Removes a metric that's being removed from the registry from the
+         * list of those to be summed.
+         *
+         * @see Metric::drop_dependency
+         */
+        bool drop_dependency(const Metric & dependency) noexcept(false) override final
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_metric_mutex);
 
-            std::smatch match_name;
-            if (!std::regex_match(out, match_name, m_METRIC_NAME_PATTERN))
+            m_targets.erase(std::remove_if(m_targets.begin(), m_targets.end(), [&dependency](const std::shared_ptr<D> & target)
             {
-                /*
-                * Final check - if the transformed name isn't valid, give up and
-                * let the caller know.
-                */
-                out.clear();
-                return false;
-            }
+                return target.get() == &dependency;
+            }), m_targets.end());
 
             return true;
         }
 
-        void sanitise_unit(const std::string & in,
-                std::string & out)
+        /*!
+         * Adds the values of the target metrics together and caches the
+         * result. This is a relatively expensive operation, so call it as
+         * infrequently as possible.
+         *
+         * As with all metric kinds this method is called automatically before
+         * rendering, thus ensuring the metric's value is up-to-date prior to
+         * the render operation.
+         *
+         * If the metric's value is needed outside of a render operation, it's
+         * recommended that rather than call this method applications instead
+         * rely on their regular render operation (assuming there is one) to
+         * keep the metric up-to-date. Reading the value is then simply a case
+         * of casting the metric to an integral or @c std::string
+         */
+        void calculate() override final
         {
-            /*
-             * Ref: https://prometheus.io/docs/concepts/data_model/#metric-names-and-labels
-             */
-
-            for (auto in_c : in)
+            update([this]()
             {
-                std::smatch match_char;
-                std::string target;
-                target.push_back(in_c);
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_metric_mutex);
 
-                if (std::regex_match(target, match_char, m_METRIC_UNIT_CHAR_PATTERN))
+                typename D::NativeType total = 0;
+                for (std::size_t index=0;index<m_targets.size();++index)
                 {
-                    out.push_back(std::tolower(static_cast<unsigned char>(in_c)));
+                    total += static_cast<const typename D::NativeType>(*m_targets[index]);
                 }
-            }
+
+                m_cache = total;
+            });
         }
 
-        void escape_str(const std::string & in,
-                std::string & out)
-        {
-            /*
-             * Ref: https://github.com/prometheus/docs/blob/main/content/docs/instrumenting/exposition_formats.md#comments-help-text-and-type-information
-             */
+    private:
+        std::vector<std::shared_ptr<D> > m_targets; //!< Array of targets to be summed
+        std::atomic<typename D::NativeType> m_cache;
 
-            out.clear();
+    };
 
-            for (auto in_c : in)
-            {
-                switch(in_c)
-                {
-                case '\n':
-                    out.push_back('\\');
-                    out.push_back('n');
-                    break;
-                case '\\':
-                    out.push_back('\\');
+    /*!
+     * @class StringMetric
+     *
+     * @brief A metric that is assigned a string.
+     *
+     * @remarks thread-safe
+     */
+    class StringMetric : public Metric, public DiscoverableNativeType<std::string>
+    {
+    public:
+        /*!
+         *
+         * @param[in]    name                  @see Metric::Metric
+         * @param[in]    description           @see Metric::Metric
+         * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    initial_value         Value with which to initialise the metric
+         * @param[in]    hook_rate_limit       @see Metric::Metric
+         */
+        StringMetric(const std::string & name, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const std::string & initial_value, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::STR, name, description, time_function, hook_rate_limit), m_value(initial_value)
+        {
+        }
+
+        /*!
+         * @see StringMetric::StringMetric(const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::string &, const std::chrono::milliseconds)
+         */
+        StringMetric(const char * name, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const char * initial_value, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::STR, name, description, time_function, hook_rate_limit), m_value(initial_value)
+        {
+        }
+
+        StringMetric(const StringMetric &) = delete;
+        StringMetric(StringMetric &&) = delete;
+        StringMetric & operator=(const StringMetric &) = delete;
+        StringMetric & operator=(StringMetric &&) = delete;
+
+        /*!
+         * Get the value of the metric as a string.
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_metric_mutex);
+
+            return m_value;
+        }
+
+        /*!
+         * Assign a new value to the metric.
+         *
+         * @param[in]    rhs    The new value to assign
+         */
+        void operator=(const char * rhs) noexcept(false)
+        {
+            update([this, rhs]()
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_metric_mutex);
+
+                m_value = std::string(rhs);
+            });
+        }
+
+        /*!
+         * @see StringMetric::operator=(const char *)
+         */
+        void operator=(const std::string & rhs) noexcept(false)
+        {
+            update([this, rhs]()
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_metric_mutex);
+
+                m_value = rhs;
+            });
+        }
+
+    private:
+        std::string m_value; //!< Metric's value
+
+    };
+
+    /*!
+     * @class BoolMetric
+     *
+     * @brief A metric that can have 1 of 2 states: @c true or @c false.
+     *
+     * @remarks thread-safe
+     */
+    class BoolMetric : public Metric, public DiscoverableNativeType<bool>
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name                  @see Metric::Metric
+         * @param[in]    description           @see Metric::Metric
+         * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    initial_value         Value with which to initialise the metric
+         * @param[in]    true_rep              String representation of the metric when its value is @c true. Default = TRUE
+         * @param[in]    false_rep             String representation of the metric when its value is @c false. Default = FALSE
+         * @param[in]    hook_rate_limit    @see Metric::Metric
+         */
+        BoolMetric(const std::string & name, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const bool initial_value, const std::string true_rep = "TRUE", const std::string false_rep = "FALSE",
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::BOOL, name, description, time_function, hook_rate_limit), m_value(initial_value), m_true_rep(true_rep),
+          m_false_rep(false_rep)
+        {
+        }
+
+        /*!
+         * @see BoolMetric::BoolMetric(const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const bool, const std::string, const std::string, const std::chrono::milliseconds)
+         */
+        BoolMetric(const char * name, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const bool initial_value, const std::string true_rep = "TRUE", const std::string false_rep = "FALSE",
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::BOOL, name, description, time_function, hook_rate_limit), m_value(initial_value), m_true_rep(true_rep),
+          m_false_rep(false_rep)
+        {
+        }
+
+        BoolMetric(const BoolMetric &) = delete;
+        BoolMetric(BoolMetric &&) = delete;
+        BoolMetric & operator=(const BoolMetric &) = delete;
+        BoolMetric & operator=(BoolMetric &&) = delete;
+
+        /*!
+         * Get the appropriate @c true or @c false string representation of the
+         * metric based on its value.
+         */
+        operator std::string() const noexcept override final
+        {
+            if (m_value)
+            {
+                return m_true_rep;
+            }
+            else
+            {
+                return m_false_rep;
+            }
+        }
+
+        /*!
+         * Get the value of the metric as a bool.
+         */
+        explicit operator bool() const noexcept override final
+        {
+            return m_value;
+        }
+
+        /*!
+         * Assign a new value to the metric.
+         *
+         * @param[in]    rhs    The new value to assign
+         */
+        void operator=(bool rhs) noexcept
+        {
+            update([this, rhs]()
+            {
+                m_value = rhs;
+            });
+        }
+
+        /*!
+         * Set the value of the metric to the logical not of its current value,
+         * i.e. if it's current value is @c true then set it to @c false and
+         * vice versa.
+         */
+        bool operator!() noexcept
+        {
+            return !m_value;
+        }
+
+    private:
+        std::atomic<bool> m_value; //!< Metric's value
+        const std::string m_true_rep; //!< @c true string representation
+        const std::string m_false_rep; //!< @c false string representation
+
+    };
+
+    /*!
+     * @class MeanMetric
+     *
+     * @brief Tracks the mean of a series of samples
+     *
+     * Samples are accumulated as a (sum, count) pair that is always updated
+     * as a unit, so a reader never sees a sum without its matching count.
+     * The pairs are spread across per-thread slots, each protected by a
+     * sequence lock, so concurrent writers rarely touch the same cache line.
+     *
+     * The mean is calculated only on calls to ::calculate, and covers the
+     * samples added since the previous call (i.e. since the last render). If
+     * no samples were added in that interval, the mean is zero. Optionally
+     * the running sum and count can be rendered alongside the mean.
+     *
+     * @remarks thread-safe
+     */
+    class MeanMetric : public Metric, public DiscoverableNativeType<float>
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name                  @see Metric::Metric
+         * @param[in]    unit                  @see Metric::Metric
+         * @param[in]    description           @see Metric::Metric
+         * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    render_totals         If @c true, the running sum and count are rendered alongside the mean
+         * @param[in]    hook_rate_limit       @see Metric::Metric
+         */
+        MeanMetric(const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const bool render_totals = false,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::MEAN, name, unit, description, time_function, hook_rate_limit), m_slot_count(ThreadSlot::count()),
+          m_slots(new Slot[m_slot_count]), m_render_totals(render_totals), m_last_sum(0), m_last_count(0), m_cache(0.0f)
+        {
+        }
+
+        /*!
+         * @see MeanMetric::MeanMetric(const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const bool, const std::chrono::milliseconds)
+         */
+        MeanMetric(const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const bool render_totals = false,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::MEAN, name, unit, description, time_function, hook_rate_limit), m_slot_count(ThreadSlot::count()),
+          m_slots(new Slot[m_slot_count]), m_render_totals(render_totals), m_last_sum(0), m_last_count(0), m_cache(0.0f)
+        {
+        }
+
+        MeanMetric(const MeanMetric &) = delete;
+        MeanMetric(MeanMetric &&) = delete;
+        MeanMetric & operator=(const MeanMetric &) = delete;
+        MeanMetric & operator=(MeanMetric &&) = delete;
+
+        /*!
+         * Get the mean as a std::string. Always represented to 2 decimal
+         * places.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            std::stringstream formatter;
+            formatter << std::fixed << std::setprecision(2) << m_cache;
+            return formatter.str();
+        }
+
+        /*!
+         * Get the mean as a float.
+         *
+         * @remarks thread-safe
+         */
+        explicit operator float() const noexcept override final
+        {
+            return m_cache;
+        }
+
+        /*!
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return double(m_cache);
+        }
+
+        /*!
+         * Adds samples to the metric.
+         *
+         * @param[in]    value    The sample value, or the sum of the sample values if @c count is greater than 1
+         * @param[in]    count    The number of samples represented by @c value
+         *
+         * @remarks thread-safe
+         */
+        void add(const double value, const std::uint64_t count = 1) noexcept(false)
+        {
+            update([this, value, count]()
+            {
+                Slot & slot = m_slots[ThreadSlot::index() & (m_slot_count - 1)];
+
+                /*
+                 * An odd sequence number marks the slot as being written. Slots
+                 * are only shared when there are more threads than slots, so the
+                 * compare-exchange almost never has to retry.
+                 */
+                std::uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+                while ((sequence & 1) || (!slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed)))
+                {
+                    sequence = slot.sequence.load(std::memory_order_relaxed);
+                }
+
+                // Pairs with the reader's fence, so that a reader that sees the new values also sees the odd sequence number
+                std::atomic_thread_fence(std::memory_order_release);
+
+                slot.sum.store(slot.sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+                slot.count.store(slot.count.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+
+                slot.sequence.store(sequence + 2, std::memory_order_release);
+            });
+        }
+
+        /*!
+         * Reads the running sum and count of all samples added to the metric.
+         * The two values are always consistent with one another.
+         *
+         * @param[out]    sum      Sum of all sample values
+         * @param[out]    count    Number of samples
+         *
+         * @remarks thread-safe
+         */
+        void totals(double & sum, std::uint64_t & count) const noexcept
+        {
+            sum = 0;
+            count = 0;
+
+            for (std::size_t index=0;index<m_slot_count;++index)
+            {
+                const Slot & slot = m_slots[index];
+                std::uint64_t before = 0;
+                std::uint64_t after = 0;
+                double slot_sum = 0;
+                std::uint64_t slot_count = 0;
+
+                do
+                {
+                    before = slot.sequence.load(std::memory_order_acquire);
+                    slot_sum = slot.sum.load(std::memory_order_relaxed);
+                    slot_count = slot.count.load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    after = slot.sequence.load(std::memory_order_relaxed);
+                }
+                while ((before & 1) || (before != after));
+
+                sum += slot_sum;
+                count += slot_count;
+            }
+        }
+
+        /*!
+         * Get the labelled running sum and count, if the metric was created
+         * with @c render_totals set. The values are those read by the last
+         * call to ::calculate
+         *
+         * @remarks thread-safe
+         */
+        std::vector<std::pair<std::string, std::string> > series() const noexcept(false) override final
+        {
+            std::vector<std::pair<std::string, std::string> > result;
+
+            if (m_render_totals)
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_metric_mutex);
+
+                std::stringstream sum_formatter;
+                sum_formatter << std::fixed << std::setprecision(2) << m_last_sum;
+
+                result.push_back(std::make_pair(std::string("sum"), sum_formatter.str()));
+                result.push_back(std::make_pair(std::string("count"), std::to_string(m_last_count)));
+            }
+
+            return result;
+        }
+
+        /*!
+         * Calculates the mean of the samples added since the previous call.
+         *
+         * As with all metric kinds this method is called automatically before
+         * rendering, thus ensuring the metric's value is up-to-date prior to
+         * the render operation. Because the mean covers the interval between
+         * calls, applications should rely on their regular render operation
+         * rather than calling this method themselves.
+         */
+        void calculate() override final
+        {
+            update([this]()
+            {
+                double sum = 0;
+                std::uint64_t count = 0;
+                totals(sum, count);
+
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_metric_mutex);
+
+                if (count > m_last_count)
+                {
+                    m_cache = float((sum - m_last_sum) / double(count - m_last_count));
+                }
+                else
+                {
+                    m_cache = 0.0f;
+                }
+
+                m_last_sum = sum;
+                m_last_count = count;
+            });
+        }
+
+    private:
+        /*!
+         * @struct Slot
+         *
+         * @brief A (sum, count) pair guarded by a sequence lock, padded so
+         * that the hot members of adjacent slots never share a cache line.
+         */
+        struct Slot
+        {
+            Slot() noexcept : sequence(0), sum(0), count(0)
+            {
+            }
+
+            std::atomic<std::uint64_t> sequence; //!< Sequence number. Odd while a write is in progress
+            std::atomic<double> sum; //!< Sum of the samples added to the slot
+            std::atomic<std::uint64_t> count; //!< Number of samples added to the slot
+            char padding[128 - sizeof(std::atomic<std::uint64_t>) * 2 - sizeof(std::atomic<double>)]; //!< Padding
+        };
+
+        const std::size_t m_slot_count; //!< Number of slots. Always a power of 2
+        std::unique_ptr<Slot[]> m_slots; //!< Per-thread (sum, count) slots
+        const bool m_render_totals; //!< Should the running sum and count be rendered?
+        double m_last_sum; //!< Sum read by the last call to ::calculate
+        std::uint64_t m_last_count; //!< Count read by the last call to ::calculate
+        std::atomic<float> m_cache; //!< Mean calculated by the last call to ::calculate
+
+    };
+
+    /*!
+     * @class ExpressionPool
+     *
+     * @brief Compiles and evaluates the arithmetic expressions of derived
+     * metrics
+     *
+     * All expressions in a pool are compiled into one table of nodes.
+     * Identical subexpressions, including those in different expressions, are
+     * stored only once: the operands of @c + and @c * are put in a canonical
+     * order so that, for example, @c a+b and @c b+a share a node, and
+     * operations on constants are folded at compile time. A compiled
+     * expression is the list of node indices it uses, each after its
+     * operands, so evaluating it is a single loop over that list.
+     *
+     * Each node counts the compiled expressions that use it. A node is freed,
+     * releasing the metric it reads, when the last of them is released with
+     * ::release, and its slot in the table is reused. Nodes added by a
+     * compilation that fails are freed before the error is thrown.
+     *
+     * Between ::begin_pass and ::end_pass (i.e. during a render), each node is
+     * evaluated at most once, however many expressions share it.
+     *
+     * Expressions are made up of:
+     *
+     * - Numbers, e.g. @c 100 or @c 0.5
+     * - Metric names, e.g. @c cache.hits. Names containing characters other
+     *   than letters, digits, @c _, @c . and @c : must be quoted with
+     *   backticks, e.g. @c `cache-hits`
+     * - The operators @c +, @c -, @c * and @c / (including unary @c -),
+     *   with the usual precedence
+     * - Parentheses, nested at most ::NESTING_LIMIT deep (counting unary
+     *   @c - as a level)
+     *
+     * Division by zero evaluates to zero.
+     *
+     * @remarks thread-safe
+     */
+    class ExpressionPool
+    {
+    public:
+        //! Function that maps a metric name in an expression to the metric
+        typedef std::function<std::shared_ptr<Metric> (const std::string &)> Resolver;
+
+        //! A compiled expression: node indices, each after its operands, ending with the root
+        typedef std::vector<std::size_t> Program;
+
+        //! Deepest nesting of parentheses and unary @c - allowed in an expression
+        static constexpr std::size_t NESTING_LIMIT = 256;
+
+        /*!
+         * Constructor.
+         */
+        ExpressionPool() noexcept : m_pass(0), m_memoise(false)
+        {
+        }
+
+        ExpressionPool(const ExpressionPool &) = delete;
+        ExpressionPool(ExpressionPool &&) = delete;
+        ExpressionPool & operator=(const ExpressionPool &) = delete;
+        ExpressionPool & operator=(ExpressionPool &&) = delete;
+
+        /*!
+         * Compiles an expression, adding any nodes it needs to the pool.
+         *
+         * @param[in]    expression    The expression text
+         * @param[in]    resolver      Function used to look up the metrics named in the expression. Called before the pool is locked
+         *
+         * @return the compiled expression, which must be released with ::release when no longer needed
+         *
+         * @throws ExpressionError if the expression is malformed or nested more than ::NESTING_LIMIT deep
+         *
+         * @remarks thread-safe
+         */
+        Program compile(const std::string & expression, Resolver resolver) noexcept(false)
+        {
+            std::vector<Token> tokens = tokenise(expression, resolver);
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_pool_mutex);
+
+            Program program;
+            try
+            {
+                std::size_t position = 0;
+                Operand result = parse_sum(expression, tokens, position, 0);
+                if (position != tokens.size())
+                {
+                    throw ExpressionError("Unexpected token at position " + std::to_string(tokens[position].offset) + " in expression \"" + expression + "\"");
+                }
+
+                program = order(materialise(result));
+            }
+            catch (...)
+            {
+                free_unused();
+                throw;
+            }
+
+            for (auto index : program)
+            {
+                ++m_nodes[index].refs;
+            }
+
+            return program;
+        }
+
+        /*!
+         * Releases a compiled expression, freeing the nodes no other compiled
+         * expression uses.
+         *
+         * @param[in]    program    The compiled expression
+         *
+         * @remarks thread-safe
+         */
+        void release(const Program & program) noexcept
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_pool_mutex);
+
+            for (auto index : program)
+            {
+                if (--m_nodes[index].refs == 0)
+                {
+                    free_node(index);
+                }
+            }
+        }
+
+        /*!
+         * Get the distinct metrics read by a compiled expression.
+         *
+         * @param[in]    program    The compiled expression
+         *
+         * @return the metrics named in the expression
+         *
+         * @remarks thread-safe
+         */
+        std::vector<std::shared_ptr<Metric> > variables(const Program & program) const noexcept(false)
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_pool_mutex);
+
+            std::vector<std::shared_ptr<Metric> > result;
+            for (auto index : program)
+            {
+                if (m_nodes[index].op == Op::VARIABLE)
+                {
+                    result.push_back(m_nodes[index].variable);
+                }
+            }
+
+            return result;
+        }
+
+        /*!
+         * Evaluates a compiled expression.
+         *
+         * @param[in]    program    The compiled expression
+         *
+         * @return the value of the expression
+         *
+         * @remarks thread-safe
+         */
+        double evaluate(const Program & program) noexcept(false)
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_pool_mutex);
+
+            if (!m_memoise)
+            {
+                ++m_pass;
+            }
+
+            for (auto index : program)
+            {
+                if (m_evaluated[index] == m_pass)
+                {
+                    continue;
+                }
+
+                const Node & node = m_nodes[index];
+                double result = 0.0;
+                switch (node.op)
+                {
+                case Op::CONSTANT:
+                    result = node.constant;
+                    break;
+                case Op::VARIABLE:
+                    result = node.variable->numeric_value();
+                    break;
+                case Op::NEGATE:
+                    result = -m_values[node.lhs];
+                    break;
+                default:
+                    result = apply(node.op, m_values[node.lhs], m_values[node.rhs]);
+                    break;
+                }
+
+                m_values[index] = result;
+                m_evaluated[index] = m_pass;
+            }
+
+            return (program.empty()) ? 0.0 : m_values[program.back()];
+        }
+
+        /*!
+         * Starts a pass during which the value of each node is evaluated at
+         * most once. Called by the registry before calculating metrics.
+         *
+         * @remarks thread-safe
+         */
+        void begin_pass() noexcept
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_pool_mutex);
+
+            ++m_pass;
+            m_memoise = true;
+        }
+
+        /*!
+         * Ends a pass started by ::begin_pass. Subsequent evaluations always
+         * read the current values of the metrics involved.
+         *
+         * @remarks thread-safe
+         */
+        void end_pass() noexcept
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_pool_mutex);
+
+            m_memoise = false;
+        }
+
+        /*!
+         * Get the number of distinct nodes in the pool.
+         *
+         * @return node count, excluding freed nodes
+         *
+         * @remarks thread-safe
+         */
+        std::size_t size() const noexcept
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_pool_mutex);
+
+            return m_node_index.size();
+        }
+
+    private:
+        /*!
+         * @enum Op
+         *
+         * Node operation. Binary operations must come last.
+         */
+        enum class Op : std::uint8_t { CONSTANT = 0, VARIABLE = 1, NEGATE = 2, ADD = 3, SUBTRACT = 4, MULTIPLY = 5, DIVIDE = 6 };
+
+        /*!
+         * @struct Node
+         *
+         * @brief A single operation in the node table
+         */
+        struct Node
+        {
+            Op op; //!< Operation
+            double constant; //!< Value of a Op::CONSTANT node
+            std::shared_ptr<Metric> variable; //!< Metric read by a Op::VARIABLE node
+            std::size_t lhs; //!< Index of the left (or only) operand
+            std::size_t rhs; //!< Index of the right operand
+            std::size_t refs; //!< Number of compiled expressions that use the node
+        };
+
+        /*!
+         * @struct Token
+         *
+         * @brief A lexical token of an expression
+         */
+        struct Token
+        {
+            char symbol; //!< Operator or parenthesis character, 'n' for a number or 'v' for a metric
+            double number; //!< Value of a number token
+            std::shared_ptr<Metric> variable; //!< Metric named by a metric token
+            std::size_t offset; //!< Position of the token in the expression text
+        };
+
+        /*!
+         * @struct Operand
+         *
+         * @brief The result of parsing part of an expression: either a
+         * constant not yet added to the node table, or a node
+         */
+        struct Operand
+        {
+            bool constant; //!< Is the operand a constant?
+            double value; //!< Value of a constant operand
+            std::size_t index; //!< Node index of a non-constant operand
+        };
+
+        //! Key identifying a node's content: (operation, constant bits, metric, lhs, rhs)
+        typedef std::tuple<std::uint8_t, std::uint64_t, const Metric *, std::size_t, std::size_t> NodeKey;
+
+        /*!
+         * Applies a binary operation.
+         */
+        static double apply(const Op op, const double lhs, const double rhs) noexcept
+        {
+            switch (op)
+            {
+            case Op::ADD:
+                return lhs + rhs;
+            case Op::SUBTRACT:
+                return lhs - rhs;
+            case Op::MULTIPLY:
+                return lhs * rhs;
+            case Op::DIVIDE:
+                return (rhs == 0.0) ? 0.0 : lhs / rhs;
+            default:
+                return 0.0;
+            }
+        }
+
+        /*!
+         * Splits an expression into tokens, resolving metric names.
+         */
+        static std::vector<Token> tokenise(const std::string & expression, Resolver & resolver) noexcept(false)
+        {
+            std::vector<Token> tokens;
+            std::size_t position = 0;
+
+            while (position < expression.length())
+            {
+                const char current = expression[position];
+                Token token = {current, 0.0, nullptr, position};
+
+                if (std::isspace(static_cast<unsigned char>(current)))
+                {
+                    ++position;
+                    continue;
+                }
+                else if ((current == '+') || (current == '-') || (current == '*') || (current == '/') || (current == '(') || (current == ')'))
+                {
+                    ++position;
+                }
+                else if ((std::isdigit(static_cast<unsigned char>(current))) || (current == '.'))
+                {
+                    const char * begin = expression.c_str() + position;
+                    char * end = nullptr;
+                    token.symbol = 'n';
+                    token.number = std::strtod(begin, &end);
+                    if (end == begin)
+                    {
+                        throw ExpressionError("Invalid number at position " + std::to_string(position) + " in expression \"" + expression + "\"");
+                    }
+
+                    position += (end - begin);
+                }
+                else if (current == '`')
+                {
+                    std::size_t close = expression.find('`', position + 1);
+                    if (close == std::string::npos)
+                    {
+                        throw ExpressionError("Unterminated metric name at position " + std::to_string(position) + " in expression \"" + expression + "\"");
+                    }
+
+                    token.symbol = 'v';
+                    token.variable = resolver(expression.substr(position + 1, close - position - 1));
+                    position = close + 1;
+                }
+                else if ((std::isalpha(static_cast<unsigned char>(current))) || (current == '_'))
+                {
+                    std::size_t end = position;
+                    while ((end < expression.length()) && ((std::isalnum(static_cast<unsigned char>(expression[end]))) ||
+                            (expression[end] == '_') || (expression[end] == '.') || (expression[end] == ':')))
+                    {
+                        ++end;
+                    }
+
+                    token.symbol = 'v';
+                    token.variable = resolver(expression.substr(position, end - position));
+                    position = end;
+                }
+                else
+                {
+                    throw ExpressionError("Unexpected character '" + std::string(1, current) + "' at position " + std::to_string(position) + " in expression \"" + expression + "\"");
+                }
+
+                tokens.push_back(token);
+            }
+
+            return tokens;
+        }
+
+        /*!
+         * Parses a sequence of terms separated by @c + or @c -, nested
+         * @c depth levels deep.
+         */
+        Operand parse_sum(const std::string & expression, const std::vector<Token> & tokens, std::size_t & position,
+                const std::size_t depth) noexcept(false)
+        {
+            Operand result = parse_product(expression, tokens, position, depth);
+
+            while ((position < tokens.size()) && ((tokens[position].symbol == '+') || (tokens[position].symbol == '-')))
+            {
+                Op op = (tokens[position++].symbol == '+') ? Op::ADD : Op::SUBTRACT;
+                result = add_operation(op, result, parse_product(expression, tokens, position, depth));
+            }
+
+            return result;
+        }
+
+        /*!
+         * Parses a sequence of factors separated by @c * or @c /, nested
+         * @c depth levels deep.
+         */
+        Operand parse_product(const std::string & expression, const std::vector<Token> & tokens, std::size_t & position,
+                const std::size_t depth) noexcept(false)
+        {
+            Operand result = parse_factor(expression, tokens, position, depth);
+
+            while ((position < tokens.size()) && ((tokens[position].symbol == '*') || (tokens[position].symbol == '/')))
+            {
+                Op op = (tokens[position++].symbol == '*') ? Op::MULTIPLY : Op::DIVIDE;
+                result = add_operation(op, result, parse_factor(expression, tokens, position, depth));
+            }
+
+            return result;
+        }
+
+        /*!
+         * Parses a number, metric, negation or parenthesised expression,
+         * nested @c depth levels deep.
+         */
+        Operand parse_factor(const std::string & expression, const std::vector<Token> & tokens, std::size_t & position,
+                const std::size_t depth) noexcept(false)
+        {
+            if (position >= tokens.size())
+            {
+                throw ExpressionError("Unexpected end of expression \"" + expression + "\"");
+            }
+
+            const Token & token = tokens[position++];
+            if (((token.symbol == '-') || (token.symbol == '(')) && (depth >= NESTING_LIMIT))
+            {
+                throw ExpressionError("Expression \"" + expression + "\" is nested more than " + std::to_string(NESTING_LIMIT) + " levels deep");
+            }
+
+            switch (token.symbol)
+            {
+            case 'n':
+                return Operand{true, token.number, 0};
+            case 'v':
+                {
+                    Node node = {Op::VARIABLE, 0.0, token.variable, 0, 0, 0};
+                    return Operand{false, 0.0, add_node(node)};
+                }
+            case '-':
+                {
+                    Operand operand = parse_factor(expression, tokens, position, depth + 1);
+                    if (operand.constant)
+                    {
+                        return Operand{true, -operand.value, 0};
+                    }
+
+                    Node node = {Op::NEGATE, 0.0, nullptr, operand.index, 0, 0};
+                    return Operand{false, 0.0, add_node(node)};
+                }
+            case '(':
+                {
+                    Operand result = parse_sum(expression, tokens, position, depth + 1);
+                    if ((position >= tokens.size()) || (tokens[position].symbol != ')'))
+                    {
+                        throw ExpressionError("Missing ')' in expression \"" + expression + "\"");
+                    }
+
+                    ++position;
+                    return result;
+                }
+            default:
+                throw ExpressionError("Unexpected token at position " + std::to_string(token.offset) + " in expression \"" + expression + "\"");
+            }
+        }
+
+        /*!
+         * Get the index of the node for an operand, adding a constant node
+         * if necessary.
+         */
+        std::size_t materialise(const Operand & operand) noexcept(false)
+        {
+            if (operand.constant)
+            {
+                Node node = {Op::CONSTANT, operand.value, nullptr, 0, 0, 0};
+                return add_node(node);
+            }
+
+            return operand.index;
+        }
+
+        /*!
+         * Adds (or finds) a binary operation node, folding constants and
+         * ordering the operands of commutative operations.
+         */
+        Operand add_operation(const Op op, const Operand & lhs, const Operand & rhs) noexcept(false)
+        {
+            if ((lhs.constant) && (rhs.constant))
+            {
+                return Operand{true, apply(op, lhs.value, rhs.value), 0};
+            }
+
+            std::size_t lhs_index = materialise(lhs);
+            std::size_t rhs_index = materialise(rhs);
+            if (((op == Op::ADD) || (op == Op::MULTIPLY)) && (lhs_index > rhs_index))
+            {
+                std::swap(lhs_index, rhs_index);
+            }
+
+            Node node = {op, 0.0, nullptr, lhs_index, rhs_index, 0};
+            return Operand{false, 0.0, add_node(node)};
+        }
+
+        /*!
+         * Get the key identifying a node's content.
+         */
+        static NodeKey key_of(const Node & node) noexcept
+        {
+            std::uint64_t constant_bits = 0;
+            std::memcpy(&constant_bits, &node.constant, sizeof(constant_bits));
+
+            return NodeKey(static_cast<std::uint8_t>(node.op), constant_bits, node.variable.get(), node.lhs, node.rhs);
+        }
+
+        /*!
+         * Adds a node to the table, unless an identical node already exists.
+         * The node is added to a freed slot if there is one.
+         *
+         * @return index of the node
+         */
+        std::size_t add_node(const Node & node) noexcept(false)
+        {
+            NodeKey key = key_of(node);
+            auto existing = m_node_index.find(key);
+            if (existing != m_node_index.end())
+            {
+                return existing->second;
+            }
+
+            std::size_t index = (m_free.empty()) ? m_nodes.size() : m_free.back();
+            auto inserted = m_node_index.insert(std::make_pair(key, index)).first;
+
+            if (m_free.empty())
+            {
+                try
+                {
+                    m_nodes.push_back(node);
+                    m_values.push_back(0.0);
+                    m_evaluated.push_back(0);
+                }
+                catch (...)
+                {
+                    m_node_index.erase(inserted);
+                    m_nodes.resize(index);
+                    m_values.resize(index);
+                    m_evaluated.resize(index);
+                    throw;
+                }
+            }
+            else
+            {
+                m_free.pop_back();
+                m_nodes[index] = node;
+                m_values[index] = 0.0;
+                m_evaluated[index] = 0;
+            }
+
+            return index;
+        }
+
+        /*!
+         * Get the nodes needed to evaluate a node, each after its operands,
+         * ending with the node itself.
+         */
+        Program order(const std::size_t root) const noexcept(false)
+        {
+            Program program;
+            std::vector<bool> visited(m_nodes.size(), false);
+
+            // Each node is pushed twice: once to visit its operands, then (once they're done) to be emitted
+            std::vector<std::pair<std::size_t, bool> > pending(1, std::make_pair(root, false));
+            while (!pending.empty())
+            {
+                auto current = pending.back();
+                pending.pop_back();
+
+                if (current.second)
+                {
+                    program.push_back(current.first);
+                    continue;
+                }
+                else if (visited[current.first])
+                {
+                    continue;
+                }
+
+                visited[current.first] = true;
+                pending.push_back(std::make_pair(current.first, true));
+
+                const Node & node = m_nodes[current.first];
+                if (node.op >= Op::ADD)
+                {
+                    pending.push_back(std::make_pair(node.rhs, false));
+                    pending.push_back(std::make_pair(node.lhs, false));
+                }
+                else if (node.op == Op::NEGATE)
+                {
+                    pending.push_back(std::make_pair(node.lhs, false));
+                }
+            }
+
+            return program;
+        }
+
+        /*!
+         * Frees a node that no compiled expression uses, releasing the metric
+         * it reads.
+         */
+        void free_node(const std::size_t index) noexcept
+        {
+            m_node_index.erase(key_of(m_nodes[index]));
+            m_nodes[index].variable.reset();
+
+            try
+            {
+                m_free.push_back(index);
+            }
+            catch (...)
+            {
+                // The slot is not reused
+            }
+        }
+
+        /*!
+         * Frees every node that no compiled expression uses, i.e. those added
+         * by a compilation that failed.
+         */
+        void free_unused() noexcept
+        {
+            for (auto entry = m_node_index.begin(); entry != m_node_index.end();)
+            {
+                std::size_t index = (entry++)->second;
+                if (m_nodes[index].refs == 0)
+                {
+                    free_node(index);
+                }
+            }
+        }
+
+        static_assert(sizeof(double) == sizeof(std::uint64_t), "double must be 64 bits wide");
+
+        mutable std::mutex m_pool_mutex; //!< Mutex for the pool
+        std::vector<Node> m_nodes; //!< Node table, including freed slots
+        std::vector<std::size_t> m_free; //!< Freed slots in the node table, for reuse
+        std::map<NodeKey, std::size_t> m_node_index; //!< Index of live node table entries by content
+        std::vector<double> m_values; //!< Last evaluated value of each node
+        std::vector<std::uint64_t> m_evaluated; //!< Pass in which each node was last evaluated
+        std::uint64_t m_pass; //!< Current evaluation pass
+        bool m_memoise; //!< Are node values being reused within the current pass?
+
+    };
+
+    /*!
+     * @class DerivedMetric
+     *
+     * @brief A metric whose value is an arithmetic expression over other
+     * metrics, such as a ratio or a percentage
+     *
+     * The expression is compiled once, on construction, by an
+     * ExpressionPool which may be shared with other derived metrics. It is
+     * evaluated only on calls to ::calculate, so updates to the metrics it
+     * refers to cost nothing extra. The syntax of expressions is described
+     * in ExpressionPool.
+     *
+     * @remarks thread-safe
+     */
+    class DerivedMetric : public Metric, public DiscoverableNativeType<float>
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    pool                  The pool in which to compile the expression
+         * @param[in]    expression            The expression from which the metric value is calculated
+         * @param[in]    resolver              Function used to look up the metrics named in the expression
+         * @param[in]    name                  @see Metric::Metric
+         * @param[in]    unit                  @see Metric::Metric
+         * @param[in]    description           @see Metric::Metric
+         * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    hook_rate_limit       @see Metric::Metric
+         *
+         * @throws ExpressionError if the expression is malformed or nested too deeply. @see ExpressionPool::NESTING_LIMIT
+         */
+        DerivedMetric(std::shared_ptr<ExpressionPool> pool, const std::string & expression, ExpressionPool::Resolver resolver,
+                const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::DERIVED, name, unit, description, time_function, hook_rate_limit), m_pool(pool), m_expression(expression),
+          m_program(pool->compile(expression, resolver)), m_variables(pool->variables(m_program)), m_cache(0.0f)
+        {
+        }
+
+        /*!
+         * @see DerivedMetric::DerivedMetric(std::shared_ptr<ExpressionPool>, const std::string &, ExpressionPool::Resolver, const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds)
+         */
+        DerivedMetric(std::shared_ptr<ExpressionPool> pool, const char * expression, ExpressionPool::Resolver resolver,
+                const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::DERIVED, name, unit, description, time_function, hook_rate_limit), m_pool(pool), m_expression(expression),
+          m_program(pool->compile(expression, resolver)), m_variables(pool->variables(m_program)), m_cache(0.0f)
+        {
+        }
+
+        ~DerivedMetric() noexcept
+        {
+            m_pool->release(m_program);
+        }
+
+        DerivedMetric(const DerivedMetric &) = delete;
+        DerivedMetric(DerivedMetric &&) = delete;
+        DerivedMetric & operator=(const DerivedMetric &) = delete;
+        DerivedMetric & operator=(DerivedMetric &&) = delete;
+
+        /*!
+         * Get the metric value as a std::string. Always represented to 2
+         * decimal places.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            std::stringstream formatter;
+            formatter << std::fixed << std::setprecision(2) << m_cache;
+            return formatter.str();
+        }
+
+        /*!
+         * Get the metric value as a float.
+         *
+         * @remarks thread-safe
+         */
+        explicit operator float() const noexcept override final
+        {
+            return m_cache;
+        }
+
+        /*!
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return double(m_cache.load());
+        }
+
+        /*!
+         * Get the expression text the metric was created with.
+         *
+         * @return expression text
+         *
+         * @remarks thread-safe
+         */
+        std::string expression() const noexcept(false)
+        {
+            return m_expression;
+        }
+
+        /*!
+         * @see Metric::dependencies
+         */
+        std::vector<std::shared_ptr<Metric> > dependencies() const noexcept(false) override final
+        {
+            return m_variables;
+        }
+
+        /*!
+         * Evaluates the expression.
+         *
+         * As with all metric kinds this method is called automatically before
+         * rendering, thus ensuring the metric's value is up-to-date prior to
+         * the render operation. It is only necessary to call this method
+         * manually if the up-to-date metric value is required outside
+         * of a render operation.
+         */
+        void calculate() override final
+        {
+            update([this]()
+            {
+                m_cache = float(m_pool->evaluate(m_program));
+            });
+        }
+
+    private:
+        std::shared_ptr<ExpressionPool> m_pool; //!< Pool in which the expression is compiled
+        const std::string m_expression; //!< Expression text
+        const ExpressionPool::Program m_program; //!< Compiled expression
+        const std::vector<std::shared_ptr<Metric> > m_variables; //!< Metrics read by the expression
+        std::atomic<float> m_cache; //!< Most recently calculated value
+
+    };
+
+    /*!
+     * @class WindowedMetric
+     *
+     * @brief Counts events over several moving time windows, e.g. the last
+     * 1, 5 and 15 minutes
+     *
+     * Time is divided into buckets of a fixed width (the resolution), held
+     * in a ring sized to cover the longest window. Each bucket is a single
+     * 64-bit word packing the bucket's epoch (its position in time) with its
+     * count, so adding to the current bucket is one relaxed atomic add.
+     * Buckets are rotated lazily: the first add in a new epoch resets the
+     * bucket it lands in, so there is no timer. All memory is allocated on
+     * construction.
+     *
+     * Window statistics are calculated only on calls to ::calculate and
+     * cover the completed buckets in each window, so they lag by at most one
+     * bucket. Each window reports the total count, and the largest and
+     * smallest bucket counts. The metric's value is the total for the
+     * first window; all windows are rendered as series values.
+     *
+     * @remarks thread-safe
+     */
+    class WindowedMetric : public Metric, public DiscoverableNativeType<std::uint64_t>
+    {
+    public:
+        /*!
+         * @struct Window
+         *
+         * @brief Statistics for a single window
+         */
+        struct Window
+        {
+            std::chrono::milliseconds length; //!< Length of the window
+            std::uint64_t sum; //!< Total count in the window
+            std::uint64_t max; //!< Largest count in a single bucket in the window
+            std::uint64_t min; //!< Smallest count in a single bucket in the window
+        };
+
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name                  @see Metric::Metric
+         * @param[in]    unit                  @see Metric::Metric
+         * @param[in]    description           @see Metric::Metric
+         * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    windows               Lengths of the windows. Each must be a multiple of @c resolution
+         * @param[in]    resolution            Width of each bucket
+         * @param[in]    hook_rate_limit       @see Metric::Metric
+         *
+         * @throws MetricConfigError if the windows or resolution are invalid
+         */
+        WindowedMetric(const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const std::vector<std::chrono::milliseconds> & windows = default_windows(),
+                const std::chrono::milliseconds resolution = std::chrono::seconds(5),
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::WINDOWED, name, unit, description, time_function, hook_rate_limit), m_resolution(resolution.count()),
+          m_bucket_count(bucket_count(windows, resolution)), m_buckets(new std::atomic<std::uint64_t>[m_bucket_count]),
+          m_start(m_time_function())
+        {
+            init(windows);
+        }
+
+        /*!
+         * @see WindowedMetric::WindowedMetric(const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::vector<std::chrono::milliseconds> &, const std::chrono::milliseconds, const std::chrono::milliseconds)
+         */
+        WindowedMetric(const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const std::vector<std::chrono::milliseconds> & windows = default_windows(),
+                const std::chrono::milliseconds resolution = std::chrono::seconds(5),
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::WINDOWED, name, unit, description, time_function, hook_rate_limit), m_resolution(resolution.count()),
+          m_bucket_count(bucket_count(windows, resolution)), m_buckets(new std::atomic<std::uint64_t>[m_bucket_count]),
+          m_start(m_time_function())
+        {
+            init(windows);
+        }
+
+        WindowedMetric(const WindowedMetric &) = delete;
+        WindowedMetric(WindowedMetric &&) = delete;
+        WindowedMetric & operator=(const WindowedMetric &) = delete;
+        WindowedMetric & operator=(WindowedMetric &&) = delete;
+
+        /*!
+         * Get the default window lengths: 1, 5 and 15 minutes.
+         *
+         * @return default window lengths
+         */
+        static std::vector<std::chrono::milliseconds> default_windows() noexcept(false)
+        {
+            return std::vector<std::chrono::milliseconds>{std::chrono::minutes(1), std::chrono::minutes(5), std::chrono::minutes(15)};
+        }
+
+        /*!
+         * Get the total for the first window as a std::string.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            return std::to_string(std::uint64_t(*this));
+        }
+
+        /*!
+         * Get the total for the first window, as of the last call to
+         * ::calculate
+         *
+         * @remarks thread-safe
+         */
+        explicit operator std::uint64_t() const noexcept override final
+        {
+            return m_cache;
+        }
+
+        /*!
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return double(m_cache.load());
+        }
+
+        /*!
+         * Adds to the count in the current bucket.
+         *
+         * @param[in]    count    The number of events to add
+         *
+         * @remarks thread-safe
+         */
+        void add(const std::uint64_t count = 1) noexcept(false)
+        {
+            update([this, count]()
+            {
+                const std::uint64_t epoch = current_epoch();
+                const std::uint64_t tag = (epoch & TAG_MASK) << COUNT_BITS;
+                std::atomic<std::uint64_t> & bucket = m_buckets[epoch % m_bucket_count];
+
+                std::uint64_t word = bucket.load(std::memory_order_relaxed);
+                while ((word & ~COUNT_MASK) != tag)
+                {
+                    // First add in this epoch: claim the bucket from the epoch it last held
+                    if (bucket.compare_exchange_weak(word, tag | count, std::memory_order_relaxed, std::memory_order_relaxed))
+                    {
+                        return;
+                    }
+                }
+
+                bucket.fetch_add(count, std::memory_order_relaxed);
+            });
+        }
+
+        /*!
+         * Get the statistics for each window, as of the last call to
+         * ::calculate, in the order the windows were specified.
+         *
+         * @return window statistics
+         *
+         * @remarks thread-safe
+         */
+        std::vector<Window> windows() const noexcept(false)
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_metric_mutex);
+
+            return m_windows;
+        }
+
+        /*!
+         * Get the statistics for each window as series values, labelled with
+         * the window length (e.g. @c 5m, @c 5m.max and @c 5m.min).
+         *
+         * @remarks thread-safe
+         */
+        std::vector<std::pair<std::string, std::string> > series() const noexcept(false) override final
+        {
+            std::vector<std::pair<std::string, std::string> > result;
+
+            for (const auto & window : windows())
+            {
+                std::string label = (window.length.count() % 60000 == 0) ? std::to_string(window.length.count() / 60000) + "m" :
+                        std::to_string(window.length.count() / 1000) + "s";
+
+                result.push_back(std::make_pair(label, std::to_string(window.sum)));
+                result.push_back(std::make_pair(label + ".max", std::to_string(window.max)));
+                result.push_back(std::make_pair(label + ".min", std::to_string(window.min)));
+            }
+
+            return result;
+        }
+
+        /*!
+         * Calculates the statistics for each window from the completed
+         * buckets it covers. Buckets that have not been added to in their
+         * epoch count as zero.
+         *
+         * As with all metric kinds this method is called automatically before
+         * rendering, thus ensuring the metric's value is up-to-date prior to
+         * the render operation. It is only necessary to call this method
+         * manually if the up-to-date metric value is required outside
+         * of a render operation.
+         */
+        void calculate() override final
+        {
+            update([this]()
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_metric_mutex);
+
+                const std::uint64_t epoch = current_epoch();
+
+                for (auto & window : m_windows)
+                {
+                    const std::uint64_t buckets = std::uint64_t(window.length.count()) / m_resolution;
+                    window.sum = 0;
+                    window.max = 0;
+                    window.min = std::numeric_limits<std::uint64_t>::max();
+
+                    for (std::uint64_t age=1;age<=buckets;++age)
+                    {
+                        std::uint64_t count = 0;
+                        if (age <= epoch)
+                        {
+                            const std::uint64_t word = m_buckets[(epoch - age) % m_bucket_count].load(std::memory_order_relaxed);
+                            if ((word >> COUNT_BITS) == ((epoch - age) & TAG_MASK))
+                            {
+                                count = word & COUNT_MASK;
+                            }
+                        }
+
+                        window.sum += count;
+                        window.max = std::max(window.max, count);
+                        window.min = std::min(window.min, count);
+                    }
+                }
+
+                m_cache = m_windows[0].sum;
+            });
+        }
+
+    private:
+        static constexpr unsigned int COUNT_BITS = 40; //!< Number of low bits of a bucket word holding the count
+        static constexpr std::uint64_t COUNT_MASK = (std::uint64_t(1) << COUNT_BITS) - 1; //!< Mask for the count in a bucket word
+        static constexpr std::uint64_t TAG_MASK = (std::uint64_t(1) << (64 - COUNT_BITS)) - 1; //!< Mask for the epoch tag, before shifting
+
+        /*!
+         * Validates the window configuration and calculates the number of
+         * buckets needed: enough for the longest window, plus the current
+         * bucket.
+         */
+        static std::size_t bucket_count(const std::vector<std::chrono::milliseconds> & windows,
+                const std::chrono::milliseconds resolution) noexcept(false)
+        {
+            if (resolution.count() <= 0)
+            {
+                throw MetricConfigError("Windowed metric resolution must be positive");
+            }
+
+            if (windows.empty())
+            {
+                throw MetricConfigError("Windowed metric must have at least one window");
+            }
+
+            std::size_t result = 0;
+            for (auto window : windows)
+            {
+                if ((window.count() <= 0) || (window.count() % resolution.count() != 0))
+                {
+                    throw MetricConfigError("Windowed metric window of " + std::to_string(window.count()) +
+                            "ms is not a positive multiple of the resolution (" + std::to_string(resolution.count()) + "ms)");
+                }
+
+                result = std::max(result, std::size_t(window.count() / resolution.count()));
+            }
+
+            return result + 1;
+        }
+
+        /*!
+         * Initialises the buckets and window statistics. Called by the
+         * constructors.
+         */
+        void init(const std::vector<std::chrono::milliseconds> & windows) noexcept(false)
+        {
+            for (std::size_t index=0;index<m_bucket_count;++index)
+            {
+                // Tag every bucket with an epoch that can't be current, so it starts empty
+                m_buckets[index].store(std::uint64_t(TAG_MASK) << COUNT_BITS, std::memory_order_relaxed);
+            }
+
+            for (auto window : windows)
+            {
+                Window stats = {window, 0, 0, 0};
+                m_windows.push_back(stats);
+            }
+
+            m_cache = 0;
+        }
+
+        /*!
+         * Get the number of whole buckets elapsed since the metric was
+         * created.
+         */
+        std::uint64_t current_epoch() const noexcept
+        {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(m_time_function() - m_start).count();
+
+            return (elapsed > 0) ? std::uint64_t(elapsed) / m_resolution : 0;
+        }
+
+        const std::uint64_t m_resolution; //!< Width of each bucket, in milliseconds
+        const std::size_t m_bucket_count; //!< Number of buckets in the ring
+        std::unique_ptr<std::atomic<std::uint64_t>[]> m_buckets; //!< Ring of (epoch tag, count) words
+        const std::chrono::steady_clock::time_point m_start; //!< Start of epoch 0
+        std::vector<Window> m_windows; //!< Window statistics calculated by the last call to ::calculate
+        std::atomic<std::uint64_t> m_cache; //!< Total for the first window
+
+    };
+
+    /*!
+     * @class EwmaMetric
+     *
+     * @brief A gauge smoothed by an exponentially weighted moving average
+     *
+     * Each sample assigned to the metric holds until the next one, and the
+     * metric's value is the time-weighted average of those samples, with
+     * the weight of older samples halving every half-life. Each assignment
+     * writes the new average, the sample and the time into a record from a
+     * small ring, then publishes the record's version with a
+     * compare-exchange on a single 64-bit word, so assigning a sample takes
+     * no lock and readers always see the three together. Decay since the
+     * last sample is applied when the value is read, so an idle metric
+     * costs nothing.
+     *
+     * Times are kept at 10 millisecond granularity, relative to the
+     * metric's creation.
+     *
+     * @remarks thread-safe
+     */
+    class EwmaMetric : public Metric, public DiscoverableNativeType<float>
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name                  @see Metric::Metric
+         * @param[in]    unit                  @see Metric::Metric
+         * @param[in]    description           @see Metric::Metric
+         * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    half_life             Time over which the weight of a sample halves
+         * @param[in]    hook_rate_limit       @see Metric::Metric
+         *
+         * @throws MetricConfigError if the half-life isn't positive
+         */
+        EwmaMetric(const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds half_life,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::EWMA, name, unit, description, time_function, hook_rate_limit), m_half_life_ticks(half_life_ticks(half_life)),
+          m_start(m_time_function()), m_current(0), m_claims(0), m_records(new Record[RECORDS])
+        {
+        }
+
+        /*!
+         * @see EwmaMetric::EwmaMetric(const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::chrono::milliseconds, const std::chrono::milliseconds)
+         */
+        EwmaMetric(const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::chrono::milliseconds half_life,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::EWMA, name, unit, description, time_function, hook_rate_limit), m_half_life_ticks(half_life_ticks(half_life)),
+          m_start(m_time_function()), m_current(0), m_claims(0), m_records(new Record[RECORDS])
+        {
+        }
+
+        EwmaMetric(const EwmaMetric &) = delete;
+        EwmaMetric(EwmaMetric &&) = delete;
+        EwmaMetric & operator=(const EwmaMetric &) = delete;
+        EwmaMetric & operator=(EwmaMetric &&) = delete;
+
+        /*!
+         * Get the smoothed value as a std::string. Always represented to 2
+         * decimal places.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            std::stringstream formatter;
+            formatter << std::fixed << std::setprecision(2) << float(*this);
+            return formatter.str();
+        }
+
+        /*!
+         * Get the smoothed value as a float, decayed towards the last sample
+         * up to the current time. Zero if no samples have been assigned.
+         *
+         * @remarks thread-safe
+         */
+        explicit operator float() const noexcept override final
+        {
+            float average = 0.0f;
+            float sample = 0.0f;
+            std::uint64_t updated = 0;
+
+            std::uint64_t version = 0;
+            do
+            {
+                version = m_current.load(std::memory_order_acquire);
+                if (version == 0)
+                {
+                    return 0.0f;
+                }
+            }
+            while (!read(version, average, sample, updated));
+
+            return decay(average, sample, elapsed(ticks(), updated));
+        }
+
+        /*!
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return double(float(*this));
+        }
+
+        /*!
+         * Assigns a new sample. The previous sample is folded into the
+         * average for the time it held.
+         *
+         * @param[in]    sample    The new sample
+         *
+         * @remarks thread-safe
+         */
+        void operator=(const float sample) noexcept(false)
+        {
+            update([this, sample]()
+            {
+                for (;;)
+                {
+                    std::uint64_t current = m_current.load(std::memory_order_acquire);
+
+                    float average = sample;
+                    float previous = 0.0f;
+                    std::uint64_t updated = 0;
+                    if ((current != 0) && (!read(current, average, previous, updated)))
+                    {
+                        // Overwritten since it was current, so a newer record has been published
+                        continue;
+                    }
+
+                    // Read after the current record, so the sample it holds was assigned no later. The first sample starts the average
+                    const std::uint64_t now = ticks();
+                    if (current != 0)
+                    {
+                        average = decay(average, previous, elapsed(now, updated));
+                    }
+
+                    const std::uint64_t version = claim();
+                    Record & record = m_records[version % RECORDS];
+                    record.values.store(pack(average, sample), std::memory_order_relaxed);
+                    record.tick.store(now, std::memory_order_relaxed);
+
+                    // Pending until the publication succeeds or fails, so the record can't be claimed while it may become current
+                    record.version.store(version | PENDING, std::memory_order_release);
+                    const bool published = m_current.compare_exchange_strong(current, version, std::memory_order_acq_rel, std::memory_order_acquire);
+                    record.version.store(version, std::memory_order_release);
+
+                    if (published)
+                    {
+                        return;
+                    }
+                }
+            });
+        }
+
+        /*!
+         * Get the half-life of the metric.
+         *
+         * @return half-life
+         *
+         * @remarks thread-safe
+         */
+        std::chrono::milliseconds half_life() const noexcept
+        {
+            return std::chrono::milliseconds(std::int64_t(m_half_life_ticks) * TICK_MS);
+        }
+
+    private:
+        static constexpr std::int64_t TICK_MS = 10; //!< Milliseconds per time tick
+
+        /*!
+         * Validates a half-life and converts it to ticks.
+         */
+        static double half_life_ticks(const std::chrono::milliseconds half_life) noexcept(false)
+        {
+            if (half_life.count() <= 0)
+            {
+                throw MetricConfigError("EWMA metric half-life must be positive");
+            }
+
+            return double(half_life.count()) / double(TICK_MS);
+        }
+
+        static constexpr std::size_t RECORDS = 32; //!< Number of records in the ring. Assignments in progress at once beyond this wait for one to finish
+        static constexpr std::uint64_t PENDING = std::uint64_t(1) << 63; //!< Version flag of a record that's being published
+        static constexpr std::uint64_t BUSY = std::numeric_limits<std::uint64_t>::max(); //!< Version of a record that's being written
+
+        /*!
+         * An average, the sample that has held since it was calculated, and
+         * the tick at which it was calculated. Fields are written only while
+         * the version is ::BUSY, so a reader that sees the same version
+         * before and after reading them has a consistent copy.
+         */
+        struct Record
+        {
+            Record() noexcept : version(0), values(0), tick(0)
+            {
+            }
+
+            std::atomic<std::uint64_t> version; //!< Version of the values, 0 if never written, or ::BUSY
+            std::atomic<std::uint64_t> values; //!< Packed (average, sample)
+            std::atomic<std::uint64_t> tick; //!< Tick at which the average was calculated
+        };
+
+        /*!
+         * Packs an average and a sample into a single word.
+         */
+        static std::uint64_t pack(const float average, const float sample) noexcept
+        {
+            std::uint32_t average_bits = 0;
+            std::uint32_t sample_bits = 0;
+            std::memcpy(&average_bits, &average, sizeof(average_bits));
+            std::memcpy(&sample_bits, &sample, sizeof(sample_bits));
+
+            return (std::uint64_t(average_bits) << 32) | sample_bits;
+        }
+
+        /*!
+         * Unpacks a word created by ::pack
+         */
+        static void unpack(const std::uint64_t values, float & average, float & sample) noexcept
+        {
+            const std::uint32_t average_bits = std::uint32_t(values >> 32);
+            const std::uint32_t sample_bits = std::uint32_t(values);
+            std::memcpy(&average, &average_bits, sizeof(average));
+            std::memcpy(&sample, &sample_bits, sizeof(sample));
+        }
+
+        /*!
+         * Reads a published record.
+         *
+         * @param[in]     version    Version of the record
+         * @param[out]    average    The average
+         * @param[out]    sample     The sample that has held since the average was calculated
+         * @param[out]    tick       Tick at which the average was calculated
+         *
+         * @return @c false if the record has been reclaimed for a newer version, in which case the outputs are undefined
+         */
+        bool read(const std::uint64_t version, float & average, float & sample, std::uint64_t & tick) const noexcept
+        {
+            const Record & record = m_records[version % RECORDS];
+
+            const std::uint64_t before = record.version.load(std::memory_order_acquire);
+            if ((before & ~PENDING) != version)
+            {
+                return false;
+            }
+
+            unpack(record.values.load(std::memory_order_relaxed), average, sample);
+            tick = record.tick.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return ((record.version.load(std::memory_order_relaxed) & ~PENDING) == version);
+        }
+
+        /*!
+         * Claims a record to write a new version to. Records that are
+         * current, or being written or published, aren't claimed.
+         *
+         * @return the new version, whose record is ::BUSY
+         */
+        std::uint64_t claim() noexcept
+        {
+            for (;;)
+            {
+                const std::uint64_t version = m_claims.fetch_add(1, std::memory_order_relaxed) + 1;
+                Record & record = m_records[version % RECORDS];
+
+                std::uint64_t previous = record.version.load(std::memory_order_acquire);
+                if ((previous == BUSY) || ((previous & PENDING) != 0) || ((previous != 0) && (previous == m_current.load(std::memory_order_acquire))))
+                {
+                    continue;
+                }
+
+                if (record.version.compare_exchange_strong(previous, BUSY, std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    // Orders the writes that follow after the version change, for readers of the previous version
+                    std::atomic_thread_fence(std::memory_order_release);
+                    return version;
+                }
+            }
+        }
+
+        /*!
+         * Get the number of ticks between two times, or 0 if @c then is
+         * later.
+         */
+        static std::uint64_t elapsed(const std::uint64_t now, const std::uint64_t then) noexcept
+        {
+            return (now > then) ? (now - then) : 0;
+        }
+
+        /*!
+         * Decays an average towards the sample that has held since it was
+         * calculated.
+         *
+         * @param[in]    average    The average
+         * @param[in]    sample     The sample that has held since
+         * @param[in]    elapsed    Number of ticks since the average was calculated
+         */
+        float decay(const float average, const float sample, const std::uint64_t elapsed) const noexcept
+        {
+            return sample + ((average - sample) * float(std::exp2(-double(elapsed) / m_half_life_ticks)));
+        }
+
+        /*!
+         * Get the current time in ticks since the metric was created.
+         */
+        std::uint64_t ticks() const noexcept
+        {
+            return std::uint64_t(std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(m_time_function() - m_start).count() / TICK_MS));
+        }
+
+        static_assert(sizeof(float) == sizeof(std::uint32_t), "float must be 32 bits wide");
+
+        const double m_half_life_ticks; //!< Half-life, in ticks
+        const std::chrono::steady_clock::time_point m_start; //!< Time of tick 0
+        std::atomic<std::uint64_t> m_current; //!< Version of the current record, or 0 if no samples have been assigned
+        std::atomic<std::uint64_t> m_claims; //!< Last version claimed
+        std::unique_ptr<Record[]> m_records; //!< Ring of records, indexed by version
+
+    };
+
+    /*!
+     * @class CategoryMetric
+     *
+     * @brief A fixed set of labelled counters, such as one per HTTP status
+     * class or error code
+     *
+     * The counters are stored in one contiguous array and incremented by
+     * category index, so counting a category on the hot path is a single
+     * atomic add with no handle to choose. Applications typically declare an
+     * enum whose values match the order of the category labels and pass its
+     * values directly to ::add
+     *
+     * The metric's value is the total of all categories. Each category is
+     * rendered as a series value labelled with its name.
+     *
+     * @remarks thread-safe
+     */
+    class CategoryMetric : public Metric, public DiscoverableNativeType<std::uint64_t>
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name                  @see Metric::Metric
+         * @param[in]    unit                  @see Metric::Metric
+         * @param[in]    description           @see Metric::Metric
+         * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    categories            Category labels, in index order. Must be non-empty and unique
+         * @param[in]    hook_rate_limit       @see Metric::Metric
+         *
+         * @throws MetricConfigError if the categories are invalid
+         */
+        CategoryMetric(const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::vector<std::string> & categories,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::CATEGORY, name, unit, description, time_function, hook_rate_limit),
+          m_categories(validate(categories)), m_counters(new std::atomic<std::uint64_t>[m_categories.size()])
+        {
+            reset_counters();
+        }
+
+        /*!
+         * @see CategoryMetric::CategoryMetric(const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::vector<std::string> &, const std::chrono::milliseconds)
+         */
+        CategoryMetric(const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::vector<std::string> & categories,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::CATEGORY, name, unit, description, time_function, hook_rate_limit),
+          m_categories(validate(categories)), m_counters(new std::atomic<std::uint64_t>[m_categories.size()])
+        {
+            reset_counters();
+        }
+
+        CategoryMetric(const CategoryMetric &) = delete;
+        CategoryMetric(CategoryMetric &&) = delete;
+        CategoryMetric & operator=(const CategoryMetric &) = delete;
+        CategoryMetric & operator=(CategoryMetric &&) = delete;
+
+        /*!
+         * Get the total of all categories as a std::string.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            return std::to_string(std::uint64_t(*this));
+        }
+
+        /*!
+         * Get the total of all categories.
+         *
+         * @remarks thread-safe
+         */
+        explicit operator std::uint64_t() const noexcept override final
+        {
+            std::uint64_t total = 0;
+            for (std::size_t index=0;index<m_categories.size();++index)
+            {
+                total += m_counters[index].load(std::memory_order_relaxed);
+            }
+
+            return total;
+        }
+
+        /*!
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return double(std::uint64_t(*this));
+        }
+
+        /*!
+         * Adds to the counter for a category.
+         *
+         * @param[in]    category    Index of the category
+         * @param[in]    count       Amount to add
+         *
+         * @throws CategoryError if the category index is out of range
+         *
+         * @remarks thread-safe
+         */
+        void add(const std::size_t category, const std::uint64_t count = 1) noexcept(false)
+        {
+            if (category >= m_categories.size())
+            {
+                throw CategoryError("Category " + std::to_string(category) + " is out of range for metric " + name());
+            }
+
+            update([this, category, count]()
+            {
+                m_counters[category].fetch_add(count, std::memory_order_relaxed);
+            });
+        }
+
+        /*!
+         * Adds to the counter for a category identified by an enum value.
+         *
+         * @see CategoryMetric::add(const std::size_t, const std::uint64_t)
+         */
+        template<typename E, typename = typename std::enable_if<std::is_enum<E>::value>::type>
+        void add(const E category, const std::uint64_t count = 1) noexcept(false)
+        {
+            add(static_cast<std::size_t>(category), count);
+        }
+
+        /*!
+         * Get the counter for a category.
+         *
+         * @param[in]    category    Index of the category
+         *
+         * @return the category's count
+         *
+         * @throws CategoryError if the category index is out of range
+         *
+         * @remarks thread-safe
+         */
+        std::uint64_t count(const std::size_t category) const noexcept(false)
+        {
+            if (category >= m_categories.size())
+            {
+                throw CategoryError("Category " + std::to_string(category) + " is out of range for metric " + name());
+            }
+
+            return m_counters[category].load(std::memory_order_relaxed);
+        }
+
+        /*!
+         * Get the index of a category from its label. Avoid calling this in
+         * performance-critical code.
+         *
+         * @param[in]    label    The category label
+         *
+         * @return index of the category
+         *
+         * @throws CategoryError if there is no category with the label
+         *
+         * @remarks thread-safe
+         */
+        std::size_t index(const std::string & label) const noexcept(false)
+        {
+            auto found = std::find(m_categories.begin(), m_categories.end(), label);
+            if (found == m_categories.end())
+            {
+                throw CategoryError("No category called \"" + label + "\" exists in metric " + name());
+            }
+
+            return std::size_t(found - m_categories.begin());
+        }
+
+        /*!
+         * Get the category labels, in index order.
+         *
+         * @return category labels
+         *
+         * @remarks thread-safe
+         */
+        const std::vector<std::string> & categories() const noexcept
+        {
+            return m_categories;
+        }
+
+        /*!
+         * Get the count of each category, labelled with the category name.
+         *
+         * @remarks thread-safe
+         */
+        std::vector<std::pair<std::string, std::string> > series() const noexcept(false) override final
+        {
+            std::vector<std::pair<std::string, std::string> > result;
+            for (std::size_t index=0;index<m_categories.size();++index)
+            {
+                result.push_back(std::make_pair(m_categories[index], std::to_string(m_counters[index].load(std::memory_order_relaxed))));
+            }
+
+            return result;
+        }
+
+    private:
+        /*!
+         * Checks that a set of category labels is non-empty and unique.
+         *
+         * @return the labels
+         */
+        static const std::vector<std::string> & validate(const std::vector<std::string> & categories) noexcept(false)
+        {
+            if (categories.empty())
+            {
+                throw MetricConfigError("Category metric must have at least one category");
+            }
+
+            for (std::size_t index=0;index<categories.size();++index)
+            {
+                if (std::find(categories.begin() + index + 1, categories.end(), categories[index]) != categories.end())
+                {
+                    throw MetricConfigError("Category \"" + categories[index] + "\" is declared more than once");
+                }
+            }
+
+            return categories;
+        }
+
+        /*!
+         * Sets every counter to zero. Called by the constructors.
+         */
+        void reset_counters() noexcept
+        {
+            for (std::size_t index=0;index<m_categories.size();++index)
+            {
+                m_counters[index].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        const std::vector<std::string> m_categories; //!< Category labels, in index order
+        std::unique_ptr<std::atomic<std::uint64_t>[]> m_counters; //!< Counter for each category
+
+    };
+
+    /*!
+     * @class StateMetric
+     *
+     * @brief The current state of a state machine, such as a connection or a
+     * leader election, with the time spent in each state
+     *
+     * The metric has a fixed set of states, declared on creation, and starts
+     * in the first of them. A transition atomically replaces a single word
+     * holding the new state index and the time of the transition, so
+     * changing state never allocates. The time stored never moves backwards,
+     * even when concurrent transitions read the clock out of order. The time
+     * spent in the state being left and the number of transitions into the
+     * new state are added to per-state totals.
+     *
+     * Each time the metric is calculated (i.e. on each render) it works out,
+     * for the interval since the previous calculation, the percentage of time
+     * spent in each state and the number of transitions into each state.
+     * These are rendered as series values labelled "<state>.percent" and
+     * "<state>.transitions". The metric's value is the name of the current
+     * state, except when rendered by a PrometheusRenderer, which renders the
+     * state index.
+     *
+     * Times are measured in milliseconds.
+     *
+     * @remarks thread-safe
+     */
+    class StateMetric : public Metric, public DiscoverableNativeType<std::uint64_t>
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name                  @see Metric::Metric
+         * @param[in]    unit                  @see Metric::Metric
+         * @param[in]    description           @see Metric::Metric
+         * @param[in]    time_function         @see Metric::Metric
+         * @param[in]    states                State names, in index order. Must be non-empty and unique. The metric starts in the first state
+         * @param[in]    hook_rate_limit       @see Metric::Metric
+         *
+         * @throws MetricConfigError if the states are invalid
+         */
+        StateMetric(const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::vector<std::string> & states,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::STATE, name, unit, description, time_function, hook_rate_limit),
+          m_states(validate(states)), m_start(m_time_function()), m_current(0),
+          m_time(new std::atomic<std::uint64_t>[m_states.size()]), m_transitions(new std::atomic<std::uint64_t>[m_states.size()]),
+          m_last_calculation(0), m_last_time(m_states.size(), 0), m_last_transitions(m_states.size(), 0),
+          m_interval_percent(m_states.size(), 0.0), m_interval_transitions(m_states.size(), 0)
+        {
+            reset_totals();
+        }
+
+        /*!
+         * @see StateMetric::StateMetric(const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::vector<std::string> &, const std::chrono::milliseconds)
+         */
+        StateMetric(const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, const std::vector<std::string> & states,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::STATE, name, unit, description, time_function, hook_rate_limit),
+          m_states(validate(states)), m_start(m_time_function()), m_current(0),
+          m_time(new std::atomic<std::uint64_t>[m_states.size()]), m_transitions(new std::atomic<std::uint64_t>[m_states.size()]),
+          m_last_calculation(0), m_last_time(m_states.size(), 0), m_last_transitions(m_states.size(), 0),
+          m_interval_percent(m_states.size(), 0.0), m_interval_transitions(m_states.size(), 0)
+        {
+            reset_totals();
+        }
+
+        StateMetric(const StateMetric &) = delete;
+        StateMetric(StateMetric &&) = delete;
+        StateMetric & operator=(const StateMetric &) = delete;
+        StateMetric & operator=(StateMetric &&) = delete;
+
+        /*!
+         * Get the name of the current state.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            return m_states[state_of(m_current.load())];
+        }
+
+        /*!
+         * Get the index of the current state.
+         *
+         * @remarks thread-safe
+         */
+        explicit operator std::uint64_t() const noexcept override final
+        {
+            return state_of(m_current.load());
+        }
+
+        /*!
+         * Get the index of the current state.
+         *
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return double(std::uint64_t(*this));
+        }
+
+        /*!
+         * Changes the current state.
+         *
+         * @param[in]    state    Index of the new state
+         *
+         * @throws CategoryError if the state index is out of range
+         *
+         * @remarks thread-safe
+         */
+        void transition(const std::size_t state) noexcept(false)
+        {
+            if (state >= m_states.size())
+            {
+                throw CategoryError("State " + std::to_string(state) + " is out of range for metric " + name());
+            }
+
+            update([this, state]()
+            {
+                auto now = ticks();
+                auto previous = m_current.load();
+
+                // A concurrent transition may have stored a time later than the one read here, so the stored time never moves backwards
+                std::uint64_t entered = 0;
+                do
+                {
+                    entered = std::max(now, time_of(previous));
+                }
+                while (!m_current.compare_exchange_weak(previous, pack(state, entered)));
+
+                auto previous_state = state_of(previous);
+
+                m_time[previous_state].fetch_add(entered - time_of(previous), std::memory_order_relaxed);
+                if (previous_state != state)
+                {
+                    m_transitions[state].fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        /*!
+         * Changes the current state to one identified by an enum value.
+         *
+         * @see StateMetric::transition(const std::size_t)
+         */
+        template<typename E, typename = typename std::enable_if<std::is_enum<E>::value>::type>
+        void transition(const E state) noexcept(false)
+        {
+            transition(static_cast<std::size_t>(state));
+        }
+
+        /*!
+         * Get the total time spent in a state since the metric was created,
+         * including time spent so far if it's the current state.
+         *
+         * @param[in]    state    Index of the state
+         *
+         * @return total time in the state
+         *
+         * @throws CategoryError if the state index is out of range
+         *
+         * @remarks thread-safe
+         */
+        std::chrono::milliseconds time_in(const std::size_t state) const noexcept(false)
+        {
+            check(state);
+
+            return std::chrono::milliseconds(total_time(state, m_current.load(), ticks()));
+        }
+
+        /*!
+         * Get the number of transitions into a state since the metric was
+         * created. Transitions from a state to itself are not counted.
+         *
+         * @param[in]    state    Index of the state
+         *
+         * @return number of transitions into the state
+         *
+         * @throws CategoryError if the state index is out of range
+         *
+         * @remarks thread-safe
+         */
+        std::uint64_t transitions(const std::size_t state) const noexcept(false)
+        {
+            check(state);
+
+            return m_transitions[state].load(std::memory_order_relaxed);
+        }
+
+        /*!
+         * Get the percentage of the interval that ended at the last
+         * calculation that was spent in a state.
+         *
+         * @param[in]    state    Index of the state
+         *
+         * @return percentage of the interval spent in the state, or 0 if the metric hasn't been calculated
+         *
+         * @throws CategoryError if the state index is out of range
+         *
+         * @remarks thread-safe
+         */
+        double interval_percent(const std::size_t state) const noexcept(false)
+        {
+            check(state);
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_interval_mutex);
+            return m_interval_percent[state];
+        }
+
+        /*!
+         * Get the number of transitions into a state in the interval that
+         * ended at the last calculation.
+         *
+         * @param[in]    state    Index of the state
+         *
+         * @return number of transitions into the state in the interval
+         *
+         * @throws CategoryError if the state index is out of range
+         *
+         * @remarks thread-safe
+         */
+        std::uint64_t interval_transitions(const std::size_t state) const noexcept(false)
+        {
+            check(state);
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_interval_mutex);
+            return m_interval_transitions[state];
+        }
+
+        /*!
+         * Get the index of a state from its name. Avoid calling this in
+         * performance-critical code.
+         *
+         * @param[in]    label    The state name
+         *
+         * @return index of the state
+         *
+         * @throws CategoryError if there is no state with the name
+         *
+         * @remarks thread-safe
+         */
+        std::size_t index(const std::string & label) const noexcept(false)
+        {
+            auto found = std::find(m_states.begin(), m_states.end(), label);
+            if (found == m_states.end())
+            {
+                throw CategoryError("No state called \"" + label + "\" exists in metric " + name());
+            }
+
+            return std::size_t(found - m_states.begin());
+        }
+
+        /*!
+         * Get the state names, in index order.
+         *
+         * @return state names
+         *
+         * @remarks thread-safe
+         */
+        const std::vector<std::string> & states() const noexcept
+        {
+            return m_states;
+        }
+
+        /*!
+         * Works out the time spent in, and transitions into, each state since
+         * the previous calculation.
+         */
+        void calculate() override final
+        {
+            auto now = ticks();
+            auto current = m_current.load();
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_interval_mutex);
+
+            auto length = now - m_last_calculation;
+            for (std::size_t index=0;index<m_states.size();++index)
+            {
+                auto time = total_time(index, current, now);
+                auto transitions = m_transitions[index].load(std::memory_order_relaxed);
+
+                // A transition in progress may briefly make the total lag behind the open period
+                auto interval_time = (time > m_last_time[index]) ? (time - m_last_time[index]) : 0;
+
+                m_interval_percent[index] = (length > 0) ? std::min(100.0, (100.0 * double(interval_time)) / double(length)) : 0.0;
+                m_interval_transitions[index] = transitions - m_last_transitions[index];
+
+                m_last_time[index] = std::max(time, m_last_time[index]);
+                m_last_transitions[index] = transitions;
+            }
+
+            m_last_calculation = now;
+        }
+
+        /*!
+         * Get the percentage of time spent in, and transitions into, each
+         * state in the interval that ended at the last calculation.
+         *
+         * @remarks thread-safe
+         */
+        std::vector<std::pair<std::string, std::string> > series() const noexcept(false) override final
+        {
+            std::vector<std::pair<std::string, std::string> > result;
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_interval_mutex);
+            for (std::size_t index=0;index<m_states.size();++index)
+            {
+                std::stringstream formatter;
+                formatter << std::fixed << std::setprecision(2) << m_interval_percent[index];
+
+                result.push_back(std::make_pair(m_states[index] + ".percent", formatter.str()));
+                result.push_back(std::make_pair(m_states[index] + ".transitions", std::to_string(m_interval_transitions[index])));
+            }
+
+            return result;
+        }
+
+    private:
+        static constexpr unsigned int STATE_BITS = 16; //!< Bits of the current state word that hold the state index
+        static constexpr std::uint64_t TIME_MASK = (std::uint64_t(1) << (64 - STATE_BITS)) - 1; //!< Mask of the bits that hold the transition time
+
+        /*!
+         * Checks that a set of state names is non-empty, unique and small
+         * enough to be indexed by the current state word.
+         *
+         * @return the names
+         */
+        static const std::vector<std::string> & validate(const std::vector<std::string> & states) noexcept(false)
+        {
+            if (states.empty())
+            {
+                throw MetricConfigError("State metric must have at least one state");
+            }
+
+            if (states.size() > (std::size_t(1) << STATE_BITS))
+            {
+                throw MetricConfigError("State metric has too many states");
+            }
+
+            for (std::size_t index=0;index<states.size();++index)
+            {
+                if (std::find(states.begin() + index + 1, states.end(), states[index]) != states.end())
+                {
+                    throw MetricConfigError("State \"" + states[index] + "\" is declared more than once");
+                }
+            }
+
+            return states;
+        }
+
+        static std::uint64_t pack(const std::size_t state, const std::uint64_t time) noexcept
+        {
+            return (std::uint64_t(state) << (64 - STATE_BITS)) | (time & TIME_MASK);
+        }
+
+        static std::size_t state_of(const std::uint64_t word) noexcept
+        {
+            return std::size_t(word >> (64 - STATE_BITS));
+        }
+
+        static std::uint64_t time_of(const std::uint64_t word) noexcept
+        {
+            return word & TIME_MASK;
+        }
+
+        /*!
+         * Throws CategoryError if a state index is out of range.
+         */
+        void check(const std::size_t state) const noexcept(false)
+        {
+            if (state >= m_states.size())
+            {
+                throw CategoryError("State " + std::to_string(state) + " is out of range for metric " + name());
+            }
+        }
+
+        /*!
+         * Get the number of milliseconds since the metric was created.
+         */
+        std::uint64_t ticks() const noexcept
+        {
+            return std::uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(m_time_function() - m_start).count());
+        }
+
+        /*!
+         * Get the total time spent in a state, given the current state word
+         * and time.
+         */
+        std::uint64_t total_time(const std::size_t state, const std::uint64_t current, const std::uint64_t now) const noexcept
+        {
+            auto time = m_time[state].load(std::memory_order_relaxed);
+            if ((state_of(current) == state) && (now > time_of(current)))
+            {
+                time += now - time_of(current);
+            }
+
+            return time;
+        }
+
+        /*!
+         * Sets every total to zero. Called by the constructors.
+         */
+        void reset_totals() noexcept
+        {
+            for (std::size_t index=0;index<m_states.size();++index)
+            {
+                m_time[index].store(0, std::memory_order_relaxed);
+                m_transitions[index].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        const std::vector<std::string> m_states; //!< State names, in index order
+        const std::chrono::steady_clock::time_point m_start; //!< Time at which the metric was created
+        std::atomic<std::uint64_t> m_current; //!< Index of the current state and the time it was entered
+        std::unique_ptr<std::atomic<std::uint64_t>[]> m_time; //!< Time spent in each state, up to the last transition out of it
+        std::unique_ptr<std::atomic<std::uint64_t>[]> m_transitions; //!< Transitions into each state
+        mutable std::mutex m_interval_mutex; //!< Guards the interval members below
+        std::uint64_t m_last_calculation; //!< Time of the last calculation
+        std::vector<std::uint64_t> m_last_time; //!< Total time in each state at the last calculation
+        std::vector<std::uint64_t> m_last_transitions; //!< Total transitions into each state at the last calculation
+        std::vector<double> m_interval_percent; //!< Percentage of the last interval spent in each state
+        std::vector<std::uint64_t> m_interval_transitions; //!< Transitions into each state in the last interval
+
+    };
+
+    /*!
+     * @class CallbackBatch
+     *
+     * @brief A user function that reports the values of one or more callback
+     * gauges, evaluated only when they are rendered
+     *
+     * Values that the application already holds in its own data structures,
+     * such as queue sizes or pool occupancy, can be reported without
+     * mirroring every change into a metric. The batch's callback is passed a
+     * vector with one element per value and fills it in. It is called once
+     * per calculation pass (i.e. once per render of any of its gauges), from
+     * within ::calculate, so it's never called on the application's hot
+     * path. Each value is reported by a CallbackMetric.
+     *
+     * The batch is itself a float metric, whose value is the time taken by
+     * the last call of the callback, in milliseconds. If a call takes longer
+     * than the batch's time limit, the overrun is counted (and rendered as a
+     * series value labelled "overruns") and the next call is skipped, with the
+     * gauges keeping their previous values. The callback can't be interrupted,
+     * so the limit bounds how often a slow callback is called rather than how
+     * long a single call takes.
+     *
+     * Exceptions thrown by the callback propagate out of ::calculate (and so
+     * out of Registry::render).
+     *
+     * @remarks thread-safe
+     */
+    class CallbackBatch : public Metric, public DiscoverableNativeType<float>
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name               @see Metric::Metric
+         * @param[in]    description        @see Metric::Metric
+         * @param[in]    time_function      @see Metric::Metric. Also used to time the callback
+         * @param[in]    value_count        Number of values the callback fills. Must be at least 1
+         * @param[in]    callback           Function that fills in the values. Elements it doesn't set keep their previous values
+         * @param[in]    time_limit         Maximum time a call of the callback should take. Specify std::chrono::milliseconds::zero() for no limit
+         *
+         * @throws MetricConfigError if there are no values or no callback
+         */
+        CallbackBatch(const std::string & name, const std::string & description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const std::size_t value_count, std::function<void (std::vector<float> & values)> callback,
+                const std::chrono::milliseconds time_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::FLOAT, name, "ms", description, time_function, std::chrono::milliseconds::zero()),
+          m_callback(validate(value_count, callback)), m_time_limit(time_limit), m_values(value_count, 0.0f), m_duration(0.0f), m_overruns(0), m_skip(false)
+        {
+        }
+
+        /*!
+         * @see CallbackBatch::CallbackBatch(const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, const std::size_t, std::function<void (std::vector<float> &)>, const std::chrono::milliseconds)
+         */
+        CallbackBatch(const char * name, const char * description, std::function<std::chrono::steady_clock::time_point ()> time_function,
+                const std::size_t value_count, std::function<void (std::vector<float> & values)> callback,
+                const std::chrono::milliseconds time_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::FLOAT, name, "ms", description, time_function, std::chrono::milliseconds::zero()),
+          m_callback(validate(value_count, callback)), m_time_limit(time_limit), m_values(value_count, 0.0f), m_duration(0.0f), m_overruns(0), m_skip(false)
+        {
+        }
+
+        CallbackBatch(const CallbackBatch &) = delete;
+        CallbackBatch(CallbackBatch &&) = delete;
+        CallbackBatch & operator=(const CallbackBatch &) = delete;
+        CallbackBatch & operator=(CallbackBatch &&) = delete;
+
+        /*!
+         * Get the duration of the last call of the callback, in milliseconds,
+         * as a std::string. Always represented to 2 decimal places.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            std::stringstream formatter;
+            formatter << std::fixed << std::setprecision(2) << m_duration;
+            return formatter.str();
+        }
+
+        /*!
+         * Get the duration of the last call of the callback, in milliseconds.
+         *
+         * @remarks thread-safe
+         */
+        explicit operator float() const noexcept override final
+        {
+            return m_duration;
+        }
+
+        /*!
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return double(m_duration.load());
+        }
+
+        /*!
+         * Get the number of values the callback fills.
+         *
+         * @return number of values
+         *
+         * @remarks thread-safe
+         */
+        std::size_t size() const noexcept(false)
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_batch_mutex);
+            return m_values.size();
+        }
+
+        /*!
+         * Get a value as filled in by the last call of the callback.
+         *
+         * @param[in]    index    Index of the value
+         *
+         * @return the value
+         *
+         * @remarks thread-safe
+         */
+        float value(const std::size_t index) const noexcept(false)
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_batch_mutex);
+            return m_values.at(index);
+        }
+
+        /*!
+         * Get the maximum time a call of the callback should take.
+         *
+         * @return the time limit, or zero if there is no limit
+         *
+         * @remarks thread-safe
+         */
+        std::chrono::milliseconds time_limit() const noexcept
+        {
+            return m_time_limit;
+        }
+
+        /*!
+         * Get the number of calls of the callback that have exceeded the time
+         * limit.
+         *
+         * @return number of overruns
+         *
+         * @remarks thread-safe
+         */
+        std::uint64_t overruns() const noexcept
+        {
+            return m_overruns;
+        }
+
+        /*!
+         * Get the number of overruns (labelled "overruns").
+         *
+         * @see Metric::series
+         */
+        std::vector<std::pair<std::string, std::string> > series() const noexcept(false) override final
+        {
+            std::vector<std::pair<std::string, std::string> > result;
+            result.push_back(std::make_pair(std::string("overruns"), std::to_string(m_overruns.load())));
+
+            return result;
+        }
+
+        /*!
+         * Calls the callback, unless the previous call overran the time limit,
+         * and times it.
+         *
+         * As with all metric kinds this method is called automatically before
+         * rendering. The registry calculates a batch once per render, before
+         * any of its gauges.
+         */
+        void calculate() override final
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_batch_mutex);
+
+            if (m_skip)
+            {
+                m_skip = false;
+                return;
+            }
+
+            std::vector<float> values(m_values);
+
+            auto start = m_time_function();
+            m_callback(values);
+            auto elapsed = m_time_function() - start;
+
+            values.resize(m_values.size(), 0.0f);
+            m_values.swap(values);
+
+            if ((m_time_limit != std::chrono::milliseconds::zero()) && (elapsed > m_time_limit))
+            {
+                ++m_overruns;
+                m_skip = true;
+            }
+
+            update([this, elapsed]()
+            {
+                m_duration = std::chrono::duration_cast<std::chrono::duration<float, std::milli> >(elapsed).count();
+            });
+        }
+
+    private:
+        /*!
+         * Checks that a batch has at least one value and a callback.
+         *
+         * @return the callback
+         */
+        static std::function<void (std::vector<float> &)> validate(const std::size_t value_count,
+                std::function<void (std::vector<float> &)> callback) noexcept(false)
+        {
+            if (value_count == 0)
+            {
+                throw MetricConfigError("Callback batch must have at least one value");
+            }
+
+            if (!callback)
+            {
+                throw MetricConfigError("Callback batch must have a callback");
+            }
+
+            return callback;
+        }
+
+        mutable std::mutex m_batch_mutex; //!< Serialises calls of the callback and guards the values
+        const std::function<void (std::vector<float> &)> m_callback; //!< Function that fills in the values
+        const std::chrono::milliseconds m_time_limit; //!< Maximum time a call of the callback should take
+        std::vector<float> m_values; //!< Values filled in by the last call of the callback
+        std::atomic<float> m_duration; //!< Duration of the last call of the callback, in milliseconds
+        std::atomic<std::uint64_t> m_overruns; //!< Number of calls that exceeded the time limit
+        bool m_skip; //!< Is the next call skipped, because the previous one overran?
+
+    };
+
+    /*!
+     * @class CallbackMetric
+     *
+     * @brief A gauge whose value is reported by a CallbackBatch when it's
+     * rendered
+     *
+     * The gauge takes one of the values filled in by its batch's callback.
+     * Nothing is written to the gauge between renders, so reporting the value
+     * has no cost on the application's hot path. The metric value is
+     * always expressed as a float.
+     *
+     * @remarks thread-safe
+     */
+    class CallbackMetric : public Metric, public DiscoverableNativeType<float>
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name               @see Metric::Metric
+         * @param[in]    unit               @see Metric::Metric
+         * @param[in]    description        @see Metric::Metric
+         * @param[in]    time_function      @see Metric::Metric
+         * @param[in]    batch              The batch whose callback reports the gauge's value
+         * @param[in]    index              Index of the gauge's value in the batch
+         * @param[in]    hook_rate_limit    @see Metric::Metric
+         *
+         * @throws MetricConfigError if there is no batch or the index is out of range
+         */
+        CallbackMetric(const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, std::shared_ptr<CallbackBatch> batch,
+                const std::size_t index, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::CALLBACK, name, unit, description, time_function, hook_rate_limit),
+          m_batch(validate(batch, index)), m_index(index), m_value(0.0f)
+        {
+        }
+
+        /*!
+         * @see CallbackMetric::CallbackMetric(const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, std::shared_ptr<CallbackBatch>, const std::size_t, const std::chrono::milliseconds)
+         */
+        CallbackMetric(const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, std::shared_ptr<CallbackBatch> batch,
+                const std::size_t index, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::CALLBACK, name, unit, description, time_function, hook_rate_limit),
+          m_batch(validate(batch, index)), m_index(index), m_value(0.0f)
+        {
+        }
+
+        CallbackMetric(const CallbackMetric &) = delete;
+        CallbackMetric(CallbackMetric &&) = delete;
+        CallbackMetric & operator=(const CallbackMetric &) = delete;
+        CallbackMetric & operator=(CallbackMetric &&) = delete;
+
+        /*!
+         * Get the metric value as a std::string. Always represented to 2
+         * decimal places.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            std::stringstream formatter;
+            formatter << std::fixed << std::setprecision(2) << m_value;
+            return formatter.str();
+        }
+
+        /*!
+         * Get the metric value as a float.
+         *
+         * @remarks thread-safe
+         */
+        explicit operator float() const noexcept override final
+        {
+            return m_value;
+        }
+
+        /*!
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return double(m_value.load());
+        }
+
+        /*!
+         * Get the batch whose callback reports the gauge's value.
+         *
+         * @return the batch
+         *
+         * @remarks thread-safe
+         */
+        std::shared_ptr<CallbackBatch> batch() const noexcept
+        {
+            return m_batch;
+        }
+
+        /*!
+         * @see Metric::dependencies
+         */
+        std::vector<std::shared_ptr<Metric> > dependencies() const noexcept(false) override final
+        {
+            return std::vector<std::shared_ptr<Metric> >(1, m_batch);
+        }
+
+        /*!
+         * Takes the gauge's value from its batch. The batch must be calculated
+         * first, which the registry does automatically before rendering.
+         */
+        void calculate() override final
+        {
+            float latest = m_batch->value(m_index);
+
+            update([this, latest]()
+            {
+                m_value = latest;
+            });
+        }
+
+    private:
+        /*!
+         * Checks that a batch exists and has a value at the specified index.
+         *
+         * @return the batch
+         */
+        static std::shared_ptr<CallbackBatch> validate(std::shared_ptr<CallbackBatch> batch, const std::size_t index) noexcept(false)
+        {
+            if (!batch)
+            {
+                throw MetricConfigError("Callback metric must have a batch");
+            }
+
+            if (index >= batch->size())
+            {
+                throw MetricConfigError("Callback metric index " + std::to_string(index) + " is out of range for batch " + batch->name());
+            }
+
+            return batch;
+        }
+
+        const std::shared_ptr<CallbackBatch> m_batch; //!< Batch whose callback reports the gauge's value
+        const std::size_t m_index; //!< Index of the gauge's value in the batch
+        std::atomic<float> m_value; //!< Value as of the last calculation
+
+    };
+
+    /*!
+     * @class RollUpMetric
+     *
+     * @brief The aggregate value of an interior node of a registry's name
+     * hierarchy
+     *
+     * When a registry is in roll-up mode, each dotted prefix of a numeric
+     * metric's name (e.g. "net" and "net.eth0" for "net.eth0.rx_bytes") is
+     * rendered as the sum of the numeric metrics beneath it. Objects of this
+     * class hold those sums. They are created and updated only by the
+     * registry, during render operations, and are never registered as
+     * metrics in their own right.
+     *
+     * The value is rendered as an integer if every metric beneath the node
+     * is an unsigned or signed metric, and to 2 decimal places otherwise.
+     *
+     * @remarks thread-safe
+     */
+    class RollUpMetric : public Metric, public DiscoverableNativeType<double>
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name             @see Metric::Metric
+         * @param[in]    time_function    @see Metric::Metric
+         */
+        RollUpMetric(const std::string & name, std::function<std::chrono::steady_clock::time_point ()> time_function) noexcept(false)
+        : Metric(Metric::Kind::SUM, name, "", "Sum of " + name + ".*", time_function, std::chrono::milliseconds::zero()),
+          m_total(0.0), m_integral(true)
+        {
+        }
+
+        RollUpMetric(const RollUpMetric &) = delete;
+        RollUpMetric(RollUpMetric &&) = delete;
+        RollUpMetric & operator=(const RollUpMetric &) = delete;
+        RollUpMetric & operator=(RollUpMetric &&) = delete;
+
+        /*!
+         * Get the aggregate value as a std::string.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            if (m_integral)
+            {
+                return std::to_string(std::llround(m_total.load()));
+            }
+
+            std::stringstream formatter;
+            formatter << std::fixed << std::setprecision(2) << m_total;
+            return formatter.str();
+        }
+
+        /*!
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return m_total;
+        }
+
+        /*!
+         * @see Metric::delta
+         */
+        bool delta(std::uint64_t & checkpoint, std::string & result) const noexcept(false) override final
+        {
+            if (m_integral)
+            {
+                result = delta_of(std::int64_t(std::llround(m_total.load())), checkpoint);
+            }
+            else
+            {
+                result = delta_of(m_total.load(), checkpoint);
+            }
+
+            return true;
+        }
+
+        /*!
+         * Sets the aggregate value. Called by the registry.
+         *
+         * @param[in]    total       Sum of the metrics beneath the node
+         * @param[in]    integral    @c true if every metric beneath the node is an unsigned or signed metric
+         *
+         * @remarks thread-safe
+         */
+        void set(const double total, const bool integral) noexcept
+        {
+            m_total = total;
+            m_integral = integral;
+        }
+
+    private:
+        std::atomic<double> m_total; //!< Sum of the metrics beneath the node
+        std::atomic<bool> m_integral; //!< Is every metric beneath the node an unsigned or signed metric?
+
+    };
+
+    /*!
+     * @class CounterBlock
+     *
+     * @brief A fixed group of unsigned counters held in a single contiguous
+     * allocation and updated by index
+     *
+     * Code that updates the same set of counters together (e.g. once per
+     * request) touches one or two cache lines rather than one per counter.
+     * The counters are packed into a block aligned to a cache line. Each
+     * counter is rendered and looked up as a BlockCounter under its own name.
+     *
+     * A block can optionally keep a copy of its counters for each ThreadSlot,
+     * so that threads updating the block don't contend. The copies are folded
+     * into the block's counters when the counters are calculated (i.e. before
+     * each render), or by calling ::fold. Until then, reads of a counter don't
+     * include updates made since it was last folded.
+     *
+     * @remarks thread-safe
+     */
+    class CounterBlock
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    names         Name of each counter, in index order
+         * @param[in]    per_thread    @c true to keep a copy of the counters for each thread slot
+         *
+         * @throws MetricConfigError if there are no counters
+         */
+        CounterBlock(const std::vector<std::string> & names, const bool per_thread = false) noexcept(false)
+        : m_names(validate(names)), m_stride(((names.size() + LINE_COUNTERS - 1) / LINE_COUNTERS) * LINE_COUNTERS),
+          m_row_mask(per_thread ? ThreadSlot::count() - 1 : 0), m_per_thread(per_thread), m_counters(nullptr)
+        {
+            const std::size_t count = m_stride * (per_thread ? m_row_mask + 2 : 1);
+            std::size_t space = (count * sizeof(std::atomic<std::uint64_t>)) + LINE_SIZE;
+            m_storage.reset(new char[space]);
+
+            void * aligned = m_storage.get();
+            std::align(LINE_SIZE, count * sizeof(std::atomic<std::uint64_t>), aligned, space);
+            m_counters = static_cast<std::atomic<std::uint64_t> *>(aligned);
+
+            for (std::size_t index = 0; index < count; ++index)
+            {
+                new (&m_counters[index]) std::atomic<std::uint64_t>(0);
+            }
+        }
+
+        CounterBlock(const CounterBlock &) = delete;
+        CounterBlock(CounterBlock &&) = delete;
+        CounterBlock & operator=(const CounterBlock &) = delete;
+        CounterBlock & operator=(CounterBlock &&) = delete;
+
+        /*!
+         * Get the number of counters in the block.
+         *
+         * @return number of counters
+         *
+         * @remarks thread-safe
+         */
+        std::size_t size() const noexcept
+        {
+            return m_names.size();
+        }
+
+        /*!
+         * Get the name of a counter.
+         *
+         * @param[in]    index    Index of the counter
+         *
+         * @return the counter's name
+         *
+         * @throws std::out_of_range if @c index is out of range
+         *
+         * @remarks thread-safe
+         */
+        const std::string & name(const std::size_t index) const noexcept(false)
+        {
+            return m_names.at(index);
+        }
+
+        /*!
+         * Get whether the block keeps a copy of its counters for each thread
+         * slot.
+         *
+         * @return @c true if counters are kept per thread
+         *
+         * @remarks thread-safe
+         */
+        bool per_thread() const noexcept
+        {
+            return m_per_thread;
+        }
+
+        /*!
+         * Adds to a counter.
+         *
+         * @param[in]    index     Index of the counter
+         * @param[in]    amount    The amount to add
+         *
+         * @throws std::out_of_range if @c index is out of range
+         *
+         * @remarks thread-safe
+         */
+        void add(const std::size_t index, const std::uint64_t amount = 1) noexcept(false)
+        {
+            if (index >= m_names.size())
+            {
+                throw std::out_of_range("Counter " + std::to_string(index) + " is out of range for a block of " + std::to_string(m_names.size()));
+            }
+
+            std::atomic<std::uint64_t> * row = m_counters;
+            if (m_per_thread)
+            {
+                row += m_stride * (1 + (ThreadSlot::index() & m_row_mask));
+            }
+
+            row[index].fetch_add(amount, std::memory_order_relaxed);
+        }
+
+        /*!
+         * Get the value of a counter, as of the last time it was folded if the
+         * block keeps per-thread copies.
+         *
+         * @param[in]    index    Index of the counter
+         *
+         * @return the counter's value
+         *
+         * @throws std::out_of_range if @c index is out of range
+         *
+         * @remarks thread-safe
+         */
+        std::uint64_t value(const std::size_t index) const noexcept(false)
+        {
+            if (index >= m_names.size())
+            {
+                throw std::out_of_range("Counter " + std::to_string(index) + " is out of range for a block of " + std::to_string(m_names.size()));
+            }
+
+            return m_counters[index].load();
+        }
+
+        /*!
+         * Folds the per-thread copies of a counter into the counter. Has no
+         * effect unless the block keeps per-thread copies.
+         *
+         * @param[in]    index    Index of the counter
+         *
+         * @throws std::out_of_range if @c index is out of range
+         *
+         * @remarks thread-safe
+         */
+        void fold(const std::size_t index) noexcept(false)
+        {
+            if (index >= m_names.size())
+            {
+                throw std::out_of_range("Counter " + std::to_string(index) + " is out of range for a block of " + std::to_string(m_names.size()));
+            }
+
+            if (!m_per_thread)
+            {
+                return;
+            }
+
+            std::uint64_t pending = 0;
+            for (std::size_t row = 1; row <= (m_row_mask + 1); ++row)
+            {
+                pending += m_counters[(row * m_stride) + index].exchange(0, std::memory_order_relaxed);
+            }
+
+            m_counters[index].fetch_add(pending);
+        }
+
+        /*!
+         * Folds the per-thread copies of every counter into the counters.
+         *
+         * @remarks thread-safe
+         */
+        void fold() noexcept
+        {
+            for (std::size_t index = 0; index < m_names.size(); ++index)
+            {
+                fold(index);
+            }
+        }
+
+    private:
+        static const std::size_t LINE_SIZE = 64; //!< Size of a cache line, in bytes
+        static const std::size_t LINE_COUNTERS = LINE_SIZE / sizeof(std::atomic<std::uint64_t>); //!< Number of counters in a cache line
+
+        /*!
+         * Checks that there is at least one counter.
+         *
+         * @return the counter names
+         */
+        static const std::vector<std::string> & validate(const std::vector<std::string> & names) noexcept(false)
+        {
+            if (names.empty())
+            {
+                throw MetricConfigError("Counter block must have at least one counter");
+            }
+
+            return names;
+        }
+
+        const std::vector<std::string> m_names; //!< Counter names, in index order
+        const std::size_t m_stride; //!< Number of counters in a row, rounded up to whole cache lines
+        const std::size_t m_row_mask; //!< Number of per-thread rows, less 1
+        const bool m_per_thread; //!< Are counters kept per thread?
+        std::unique_ptr<char[]> m_storage; //!< Allocation holding the counters
+        std::atomic<std::uint64_t> * m_counters; //!< The block's counters, followed by a row for each thread slot if counters are kept per thread
+
+    };
+
+    /*!
+     * @class BlockCounter
+     *
+     * @brief One counter of a CounterBlock, rendered and looked up like any
+     * other metric
+     *
+     * The counter's value is held in its block. Hooks are triggered when the
+     * counter is calculated (i.e. before each render) rather than on each
+     * update. The metric value is always expressed as an unsigned integer.
+     *
+     * @remarks thread-safe
+     */
+    class BlockCounter : public Metric, public DiscoverableNativeType<std::uint64_t>
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name               @see Metric::Metric
+         * @param[in]    unit               @see Metric::Metric
+         * @param[in]    description        @see Metric::Metric
+         * @param[in]    time_function      @see Metric::Metric
+         * @param[in]    block              The block holding the counter's value
+         * @param[in]    index              Index of the counter in the block
+         * @param[in]    hook_rate_limit    @see Metric::Metric
+         *
+         * @throws MetricConfigError if there is no block or the index is out of range
+         */
+        BlockCounter(const std::string & name, const std::string & unit, const std::string & description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, std::shared_ptr<CounterBlock> block,
+                const std::size_t index, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::BLOCK, name, unit, description, time_function, hook_rate_limit),
+          m_block(validate(block, index)), m_index(index)
+        {
+        }
+
+        /*!
+         * @see BlockCounter::BlockCounter(const std::string &, const std::string &, const std::string &, std::function<std::chrono::steady_clock::time_point ()>, std::shared_ptr<CounterBlock>, const std::size_t, const std::chrono::milliseconds)
+         */
+        BlockCounter(const char * name, const char * unit, const char * description,
+                std::function<std::chrono::steady_clock::time_point ()> time_function, std::shared_ptr<CounterBlock> block,
+                const std::size_t index, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        : Metric(Metric::Kind::BLOCK, name, unit, description, time_function, hook_rate_limit),
+          m_block(validate(block, index)), m_index(index)
+        {
+        }
+
+        BlockCounter(const BlockCounter &) = delete;
+        BlockCounter(BlockCounter &&) = delete;
+        BlockCounter & operator=(const BlockCounter &) = delete;
+        BlockCounter & operator=(BlockCounter &&) = delete;
+
+        /*!
+         * Get the metric value as a std::string.
+         *
+         * @remarks thread-safe
+         */
+        operator std::string() const noexcept(false) override final
+        {
+            return std::to_string(m_block->value(m_index));
+        }
+
+        /*!
+         * Get the metric value as an unsigned integer.
+         *
+         * @remarks thread-safe
+         */
+        explicit operator std::uint64_t() const noexcept override final
+        {
+            return m_block->value(m_index);
+        }
+
+        /*!
+         * @see Metric::numeric_value
+         */
+        double numeric_value() const noexcept override final
+        {
+            return double(m_block->value(m_index));
+        }
+
+        /*!
+         * @see Metric::delta
+         */
+        bool delta(std::uint64_t & checkpoint, std::string & result) const noexcept(false) override final
+        {
+            result = delta_of(m_block->value(m_index), checkpoint);
+            return true;
+        }
+
+        /*!
+         * Increment operator (prefix).
+         *
+         * @remarks thread-safe
+         */
+        void operator++() noexcept(false)
+        {
+            m_block->add(m_index, 1);
+        }
+
+        /*!
+         * Compound addition operator.
+         *
+         * @param[in]    amount    The amount to add
+         *
+         * @remarks thread-safe
+         */
+        void operator+=(const std::uint64_t amount) noexcept(false)
+        {
+            m_block->add(m_index, amount);
+        }
+
+        /*!
+         * Get the block holding the counter's value.
+         *
+         * @return the block
+         *
+         * @remarks thread-safe
+         */
+        std::shared_ptr<CounterBlock> block() const noexcept
+        {
+            return m_block;
+        }
+
+        /*!
+         * Get the index of the counter in its block.
+         *
+         * @return the index
+         *
+         * @remarks thread-safe
+         */
+        std::size_t index() const noexcept
+        {
+            return m_index;
+        }
+
+        /*!
+         * Folds the block's per-thread copies of the counter into the
+         * counter.
+         */
+        void calculate() override final
+        {
+            update([this]()
+            {
+                m_block->fold(m_index);
+            });
+        }
+
+    private:
+        /*!
+         * Checks that a block exists and has a counter at the specified index.
+         *
+         * @return the block
+         */
+        static std::shared_ptr<CounterBlock> validate(std::shared_ptr<CounterBlock> block, const std::size_t index) noexcept(false)
+        {
+            if (!block)
+            {
+                throw MetricConfigError("Block counter must have a block");
+            }
+
+            if (index >= block->size())
+            {
+                throw MetricConfigError("Block counter index " + std::to_string(index) + " is out of range for a block of " + std::to_string(block->size()));
+            }
+
+            return block;
+        }
+
+        const std::shared_ptr<CounterBlock> m_block; //!< Block holding the counter's value
+        const std::size_t m_index; //!< Index of the counter in the block
+
+    };
+
+    /*!
+     * @class Throttle
+     *
+     * @brief Limits the rate at which operations are performed on a metric
+     *
+     * Performance can suffer dramatically if a metric is updated with high
+     * frequency. This class serves as an adapter for limiting the rate at
+     * which a metric is updated in 2 ways: time (minimum time interval
+     * between updates) and attempted operation count (minimum attempted
+     * operations between updates). Instances of this class are not
+     * thread-safe. The performance advantages of its use are in part a result
+     * of eliminating locks and atomics.
+     *
+     * @par Template arguments
+     *
+     * @par
+     * T - the type of the metric object to be throttled
+     *
+     * @remarks thread-hostile
+     */
+    template<typename T>
+    class Throttle
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    metric           The metric to throttle
+         * @param[in]    time_limit       The minimum number of milliseconds between updates
+         * @param[in]    op_limit         The number of attempted operations between updates
+         * @param[in]    time_function    Function used to determine the time. Used for simulation in testing
+         */
+        Throttle(std::shared_ptr<T> & metric, const std::chrono::milliseconds time_limit, const std::uint64_t op_limit = 1000,
+                std::function<std::chrono::steady_clock::time_point ()> time_function = []{return std::chrono::steady_clock::now();})
+        : m_metric(metric), m_time_limit(time_limit), m_next_update(time_function() + time_limit), m_time_function(time_function),
+          m_op_limit(((op_limit == 0) ? 1 : op_limit)), m_op_count(0)
+        {
+        }
+
+        ~Throttle()
+        {
+        }
+
+        /*!
+         * Assign a new value to the throttled metric according to the
+         * specified throttling rules.
+         *
+         * @param[in]    rhs    The new value to assign
+         *
+         * @remarks thread-hostile
+         */
+        void operator=(const typename T::NativeType rhs) noexcept(false)
+        {
+            if (check_update())
+            {
+                (*m_metric) = rhs;
+            }
+        }
+
+        /*!
+         * Allows the de-reference operator to be used with Throttle objects.
+         * Helps avoid confusion with the typical use of Metric handles that
+         * requires de-referencing due to them being managed by a
+         * std::shared_ptr
+         *
+         * @return reference to the Throttle object
+         *
+         * @remarks thread-hostile
+         */
+        Throttle<T> & operator*() noexcept
+        {
+            return (*this);
+        }
+
+        /*!
+         * Get the configured time limit (minimum number of milliseconds
+         * between updates).
+         *
+         * @return configured time limit in milliseconds
+         *
+         * @remarks thread-hostile
+         */
+        std::chrono::milliseconds time_limit() const noexcept
+        {
+            return m_time_limit;
+        }
+
+        /*!
+         * Get the configured attempted operations limit (number of attempted
+         * operations between updates).
+         *
+         * @return configured attempted operations limit
+         *
+         * @remarks thread-hostile
+         */
+        std::uint64_t op_limit() const noexcept
+        {
+            return m_op_limit;
+        }
+
+    private:
+        /*!
+         * Given the configured time and attempted operations limits, determine
+         * if an update should succeed.
+         *
+         * @return @c true if the update should succeed, @c false otherwise
+         *
+         * @remarks thread-hostile
+         */
+        inline bool check_update() noexcept
+        {
+            if (++m_op_count % m_op_limit == 0)
+            {
+                auto now = m_time_function();
+                if (now >= m_next_update)
+                {
+                    m_next_update = now + m_time_limit;
+                    return true;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        std::shared_ptr<T> m_metric; //!< The metric being throttled
+        const std::chrono::milliseconds m_time_limit; //!< Time limit (milliseconds between updates)
+        std::chrono::steady_clock::time_point m_next_update; //!< Time at/after which an update may next succeed
+        std::function<std::chrono::steady_clock::time_point ()> m_time_function; //!< Function used to determine the time
+        const std::uint64_t m_op_limit; //!< Attempted operation limit (attempted operations between updates)
+        std::uint64_t m_op_count; //!< Total attempted operations
+    };
+
+    /*!
+     * @brief Throttle template specialisation for NumberMetric objects
+     *
+     * A template specialisation of Throttle providing addition operator
+     * overloads useful for manipulating NumberMetric objects. These operator
+     * overloads remember their right-hand side operand when the addition
+     * operation can't be performed on the metric due to throttling. The
+     * stored value is then added to the metric when the next addition
+     * operation is committed. As with Throttle, this class is not thread-safe.
+     *
+     * @see Throttle
+     *
+     * @par Template arguments
+     *
+     * @par
+     * K - the kind of the NumberMetric being throttled
+     *
+     * @par
+     * T - the native type of the NumberMetric being throttled
+     *
+     * @remarks thread-hostile
+     */
+    template<Metric::Kind K, typename T>
+    class Throttle<NumberMetric<K, T> >
+    {
+    public:
+        /*!
+         * @see Throttle
+         */
+        Throttle(std::shared_ptr<NumberMetric<K, T> > & metric, const std::chrono::milliseconds time_limit, const std::uint64_t op_limit = 1000,
+                std::function<std::chrono::steady_clock::time_point ()> time_function = []{return std::chrono::steady_clock::now();})
+        : m_metric(metric), m_time_limit(time_limit), m_next_update(time_function() + time_limit), m_time_function(time_function),
+          m_op_limit(((op_limit == 0) ? 1 : op_limit)), m_op_count(0), m_pending_val(0)
+        {
+        }
+
+        ~Throttle()
+        {
+        }
+
+        /*!
+         * @see Throttle
+         */
+        void operator=(const T & rhs) noexcept
+        {
+            if (check_update())
+            {
+                (*m_metric) = rhs;
+                m_pending_val = 0;
+            }
+        }
+
+        /*!
+         * Adds the specified value to the metric if allowed by the throttling
+         * parameters.
+         *
+         * @param[in]    rhs    Number to be added to the metric
+         *
+         * @return @c true if the metric was updated, @c false if it was not due to throttling
+         *
+         * @remarks thread-hostile
+         */
+        bool operator+=(const T & rhs) noexcept
+        {
+            m_pending_val += rhs;
+
+            if (check_update())
+            {
+                commit();
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        /*!
+         * Increments the metric if allowed by the throttling parameters.
+         *
+         * @return @c true if the metric was updated, @c false if it was not due to throttling
+         *
+         * @remarks thread-hostile
+         */
+        bool operator++() noexcept
+        {
+            ++m_pending_val;
+
+            if (check_update())
+            {
+                commit();
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        /*!
+         * @see Throttle::operator*
+         */
+        Throttle<NumberMetric<K, T> > & operator*() noexcept
+        {
+            return (*this);
+        }
+
+        /*!
+         * Updates the metric with any pending addition operations deferred due
+         * to throttling.
+         */
+        inline void commit() noexcept
+        {
+            (*m_metric) += m_pending_val;
+            m_pending_val = 0;
+        }
+
+        /*!
+         * @see Throttle::time_limit
+         */
+        std::chrono::milliseconds time_limit() const noexcept
+        {
+            return m_time_limit;
+        }
+
+        /*!
+         * @see Throttle::op_limit
+         */
+        std::uint64_t op_limit() const noexcept
+        {
+            return m_op_limit;
+        }
+
+    private:
+        /*!
+         * @see Throttle::check_update
+         */
+        inline bool check_update() noexcept
+        {
+            if (++m_op_count % m_op_limit == 0)
+            {
+                auto now = m_time_function();
+                if (now >= m_next_update)
+                {
+                    m_next_update = now + m_time_limit;
+                    return true;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        std::shared_ptr<NumberMetric<K, T> > m_metric; //!< @see Throttle
+        const std::chrono::milliseconds m_time_limit; //!< @see Throttle
+        std::chrono::steady_clock::time_point m_next_update; //!< @see Throttle
+        std::function<std::chrono::steady_clock::time_point ()> m_time_function; //!< @see Throttle
+        const std::uint64_t m_op_limit; //!< @see Throttle
+        std::uint64_t m_op_count; //!< @see Throttle
+        T m_pending_val; //!< Uncommitted value waiting to be added to the metric
+    };
+
+    /*!
+     * @class RenderFilter
+     *
+     * @brief Selects metrics to render by name prefix
+     *
+     * A metric matches if its name begins with any of the filter's include
+     * prefixes and none of its exclude prefixes. The prefixes are compiled
+     * once, on construction: each list is sorted and prefixes covered by
+     * shorter ones are dropped. In the compiled form, the metrics a render
+     * visits form one contiguous range of names per include prefix, each
+     * found with a single binary search. Excluded names within a range are
+     * skipped over in a single step too.
+     *
+     * @remarks thread-compatible
+     */
+    class RenderFilter
+    {
+    public:
+        /*!
+         * Constructor. The filter matches every metric.
+         */
+        RenderFilter() noexcept(false) : m_include(1)
+        {
+        }
+
+        /*!
+         * Constructor.
+         *
+         * @param[in]    include    Prefixes of the names of metrics to render. If empty, every metric is rendered unless excluded
+         * @param[in]    exclude    Prefixes of the names of metrics not to render, even if they match an include prefix
+         */
+        RenderFilter(const std::vector<std::string> & include, const std::vector<std::string> & exclude = std::vector<std::string>()) noexcept(false)
+        : m_include(compile(include.empty() ? std::vector<std::string>(1) : include)), m_exclude(compile(exclude))
+        {
+        }
+
+        /*!
+         * Get whether a metric's name matches the filter.
+         *
+         * @param[in]    name    Name of the metric
+         *
+         * @return @c true if the metric would be rendered
+         *
+         * @remarks thread-safe
+         */
+        bool matches(const std::string & name) const noexcept
+        {
+            return (covering(m_include, name) != nullptr) && (covering(m_exclude, name) == nullptr);
+        }
+
+        /*!
+         * Get the prefix that excludes a name from the filter, if any.
+         *
+         * @param[in]    name    Name of the metric
+         *
+         * @return the matching exclude prefix, or @c nullptr if the name isn't excluded
+         *
+         * @remarks thread-safe
+         */
+        const std::string * excluded_by(const std::string & name) const noexcept
+        {
+            return covering(m_exclude, name);
+        }
+
+        /*!
+         * Get the compiled include prefixes: sorted, with none beginning with
+         * another.
+         *
+         * @return the include prefixes
+         *
+         * @remarks thread-safe
+         */
+        const std::vector<std::string> & include() const noexcept
+        {
+            return m_include;
+        }
+
+        /*!
+         * Get the compiled exclude prefixes: sorted, with none beginning with
+         * another.
+         *
+         * @return the exclude prefixes
+         *
+         * @remarks thread-safe
+         */
+        const std::vector<std::string> & exclude() const noexcept
+        {
+            return m_exclude;
+        }
+
+        /*!
+         * Get a filter matching only the metrics that match both this filter
+         * and another.
+         *
+         * @param[in]    other    The other filter
+         *
+         * @return the combined filter
+         *
+         * @remarks thread-safe
+         */
+        RenderFilter intersect(const RenderFilter & other) const noexcept(false)
+        {
+            RenderFilter result;
+            result.m_include.clear();
+
+            // Where one prefix begins with the other, the longer one selects the names matching both
+            for (const auto & mine : m_include)
+            {
+                for (const auto & theirs : other.m_include)
+                {
+                    if (starts_with(theirs, mine))
+                    {
+                        result.m_include.push_back(theirs);
+                    }
+                    else if (starts_with(mine, theirs))
+                    {
+                        result.m_include.push_back(mine);
+                    }
+                }
+            }
+
+            std::vector<std::string> exclude(m_exclude);
+            exclude.insert(exclude.end(), other.m_exclude.begin(), other.m_exclude.end());
+
+            result.m_include = compile(result.m_include);
+            result.m_exclude = compile(exclude);
+            return result;
+        }
+
+        /*!
+         * Get whether a name begins with a prefix.
+         *
+         * @param[in]    name      The name
+         * @param[in]    prefix    The prefix
+         *
+         * @return @c true if @c name begins with @c prefix
+         */
+        static bool starts_with(const std::string & name, const std::string & prefix) noexcept
+        {
+            return name.compare(0, prefix.length(), prefix) == 0;
+        }
+
+    private:
+        /*!
+         * Sorts a list of prefixes, dropping those that begin with another.
+         */
+        static std::vector<std::string> compile(std::vector<std::string> prefixes) noexcept(false)
+        {
+            std::sort(prefixes.begin(), prefixes.end());
+
+            std::vector<std::string> result;
+            for (auto & prefix : prefixes)
+            {
+                // A prefix sorts directly before the prefixes that begin with it
+                if ((result.empty()) || (!starts_with(prefix, result.back())))
+                {
+                    result.push_back(std::move(prefix));
+                }
+            }
+
+            return result;
+        }
+
+        /*!
+         * Finds the prefix in a compiled list with which a name begins. Only
+         * the greatest prefix not after the name can match, as every prefix
+         * between a matching prefix and the name would begin with it.
+         */
+        static const std::string * covering(const std::vector<std::string> & prefixes, const std::string & name) noexcept
+        {
+            auto after = std::upper_bound(prefixes.begin(), prefixes.end(), name);
+            if ((after == prefixes.begin()) || (!starts_with(name, *(after - 1))))
+            {
+                return nullptr;
+            }
+
+            return &(*(after - 1));
+        }
+
+        std::vector<std::string> m_include; //!< Compiled include prefixes
+        std::vector<std::string> m_exclude; //!< Compiled exclude prefixes
+    };
+
+    /*!
+     * @class Renderer
+     *
+     * @brief Interface for metric "renderers" (output objects)
+     *
+     * @remarks thread-hostile
+     */
+    class Renderer
+    {
+    public:
+        Renderer() : m_suppressed_exception(false), m_delta(false), m_rates(false), m_registry_state(std::numeric_limits<std::size_t>::max())
+        {
+        }
+
+        virtual ~Renderer()
+        {
+        }
+
+        /*!
+         * For a given render operation, called once before all calls to
+         * @link Renderer::render @endlink
+         *
+         * @see Renderer::render
+         */
+        virtual void before()
+        {
+            return;
+        }
+
+        /*!
+         * For a given render operation, called once after all calls to
+         * @link Renderer::render @endlink
+         *
+         * @see Renderer::render
+         */
+        virtual void after()
+        {
+            return;
+        }
+
+        /*!
+         * For a given render operation, called once for each metric to be
+         * rendered.
+         *
+         * @param[in]    metric    The metric to be rendered
+         */
+        virtual void render(const std::shared_ptr<Metric> & metric)
+        {
+            (void)(metric);
+            return;
+        }
+
+        /*!
+         * Sets whether the renderer renders every metric that supports it as
+         * the change in its value since this renderer last rendered it,
+         * rather than as its current value. The first render of a metric
+         * shows the change since zero.
+         *
+         * @param[in]    enabled    @c true to render deltas, @c false to render current values
+         *
+         * @see Metric::render_delta
+         */
+        void delta(const bool enabled) noexcept
+        {
+            m_delta = enabled;
+        }
+
+        /*!
+         * Get whether the renderer renders deltas.
+         *
+         * @return @c true if deltas are rendered
+         */
+        bool delta() const noexcept
+        {
+            return m_delta;
+        }
+
+        /*!
+         * Sets whether the renderer renders the per-second rate of change of
+         * every unsigned, signed, sum and block counter metric alongside its
+         * value, as a series value labelled "rate". Rates are worked out from the values
+         * and times of consecutive renders by this renderer, which are kept
+         * in a single array, so no rate metrics need to be created. The first
+         * render of a metric shows a rate of zero.
+         *
+         * @param[in]    enabled        @c true to render rates
+         * @param[in]    name_prefix    If not empty, only render rates for metrics whose names begin with this prefix
+         */
+        void rates(const bool enabled, const std::string & name_prefix = "") noexcept(false)
+        {
+            m_rates = enabled;
+            m_rate_prefix = name_prefix;
+        }
+
+        /*!
+         * Get whether the renderer renders rates.
+         *
+         * @return @c true if rates are rendered
+         */
+        bool rates() const noexcept
+        {
+            return m_rates;
+        }
+
+        /*!
+         * Sets the filter that selects the metrics this renderer renders. It
+         * applies to every render by the renderer, including scheduled
+         * renders. A render of a name prefix renders only the metrics that
+         * match both the prefix and the filter.
+         *
+         * @param[in]    filter    The filter
+         */
+        void filter(const RenderFilter & filter) noexcept(false)
+        {
+            m_filter = filter;
+        }
+
+        /*!
+         * Get the filter that selects the metrics this renderer renders.
+         *
+         * @return the filter
+         */
+        const RenderFilter & filter() const noexcept
+        {
+            return m_filter;
+        }
+
+        /*!
+         * Sets or unsets the "suppressed exception" flag which is used to
+         * indicate if an exception thrown in a derived method of
+         * after was suppressed. This will happen to prevent exceptions
+         * propagating out of the RendererContext destructor.
+         *
+         * @param[in]    state    The state to which to set the flag
+         *
+         * @see Renderer::after
+         */
+        void suppressed_exception(bool state) noexcept
+        {
+            m_suppressed_exception = state;
+        }
+
+        /*!
+         * Gets the state of the "suppressed exception" flag.
+         *
+         * @see Renderer::suppressed_exception(bool)
+         *
+         * @return @c true if the flag is set, @c false otherwise
+         */
+        bool suppressed_exception() const noexcept
+        {
+            return m_suppressed_exception;
+        }
+
+    protected:
+        /*!
+         * Get the value of a metric as it should be rendered: either its
+         * current value or, if this renderer or the metric is in delta mode,
+         * the change since this renderer last rendered it. Renderers should
+         * call this rather than casting the metric to a std::string.
+         *
+         * Each call in delta mode moves the metric's checkpoint, so call this
+         * method once per metric per render.
+         *
+         * @param[in]    metric    The metric being rendered
+         *
+         * @return the value to render
+         */
+        std::string value(const std::shared_ptr<Metric> & metric) noexcept(false)
+        {
+            if ((m_delta) || (metric->render_delta()))
+            {
+                MetricState * state = state_of(*metric);
+
+                std::string result;
+                if ((state != nullptr) && (metric->delta(state->checkpoint, result)))
+                {
+                    return result;
+                }
+            }
+
+            return std::string(*metric);
+        }
+
+        /*!
+         * Get the labelled values of a metric as they should be rendered: the
+         * metric's own series values followed, if this renderer renders
+         * rates for the metric, by its rate. Renderers should call this
+         * rather than Metric::series.
+         *
+         * Each call in rate mode moves the metric's rate checkpoint, so call
+         * this method once per metric per render.
+         *
+         * @param[in]    metric    The metric being rendered
+         *
+         * @return list of (label, value) pairs
+         */
+        std::vector<std::pair<std::string, std::string> > series(const std::shared_ptr<Metric> & metric) noexcept(false)
+        {
+            auto result = metric->series();
+
+            if ((m_rates) &&
+                    ((metric->kind() == Metric::Kind::UINT) || (metric->kind() == Metric::Kind::INT) || (metric->kind() == Metric::Kind::SUM) ||
+                     (metric->kind() == Metric::Kind::BLOCK)) &&
+                    ((m_rate_prefix.empty()) || (metric->name().compare(0, m_rate_prefix.size(), m_rate_prefix) == 0)))
+            {
+                MetricState * state = state_of(*metric);
+                if (state != nullptr)
+                {
+                    std::stringstream formatter;
+                    formatter << std::fixed << std::setprecision(2) << rate(*metric, state->rate);
+                    result.push_back(std::make_pair(std::string("rate"), formatter.str()));
+                }
+            }
+
+            return result;
+        }
+
+    private:
+        friend class Registry;
+
+        /*!
+         * A metric's value and the time at which it was rendered, from which
+         * its rate is worked out on the next render.
+         */
+        struct RateSample
+        {
+            double value; //!< Value of the metric when last rendered
+            std::chrono::steady_clock::time_point time; //!< Time of the render, or the minimum time point if it has never been rendered
+        };
+
+        /*!
+         * What the renderer remembers about a metric between renders.
+         */
+        struct MetricState
+        {
+            std::uint64_t id; //!< ID of the metric, @see Metric::id()
+            std::uint64_t checkpoint; //!< Value of the metric when last rendered in delta mode
+            RateSample rate; //!< Value of the metric and render time when last rendered in rate mode
+        };
+
+        /*!
+         * What the renderer remembers about the metrics of a registry.
+         */
+        struct RegistryState
+        {
+            std::uint64_t registry; //!< Serial number of the registry
+            std::vector<MetricState> metrics; //!< State of each metric, indexed by the index part of its ID. Never larger than the registry's ID table
+        };
+
+        /*!
+         * Selects the state of the metrics of the registry that's rendering.
+         * Called by the registry at the start of each render.
+         *
+         * @param[in]    registry    Serial number of the registry
+         */
+        void select_registry(const std::uint64_t registry) noexcept(false)
+        {
+            for (m_registry_state = 0; m_registry_state < m_registry_states.size(); ++m_registry_state)
+            {
+                if (m_registry_states[m_registry_state].registry == registry)
+                {
+                    return;
+                }
+            }
+
+            RegistryState state = {registry, std::vector<MetricState>()};
+            m_registry_states.push_back(state);
+        }
+
+        /*!
+         * Get the state of a metric of the registry that's rendering. The
+         * state of a removed metric is reset when its index is given to a
+         * new metric.
+         *
+         * @param[in]    metric    The metric
+         *
+         * @return the state, or @c nullptr if the metric isn't in a registry or no registry is rendering
+         */
+        MetricState * state_of(const Metric & metric) noexcept(false)
+        {
+            if ((metric.m_id == std::numeric_limits<std::uint64_t>::max()) || (m_registry_state >= m_registry_states.size()))
+            {
+                return nullptr;
+            }
+
+            auto & states = m_registry_states[m_registry_state].metrics;
+            const std::size_t index = std::size_t(Metric::index_of(metric.m_id));
+            if (index >= states.size())
+            {
+                states.resize(index + 1, unseen(std::numeric_limits<std::uint64_t>::max()));
+            }
+
+            MetricState & state = states[index];
+            if (state.id != metric.m_id)
+            {
+                state = unseen(metric.m_id);
+            }
+
+            return &state;
+        }
+
+        /*!
+         * Get the state of a metric that hasn't been rendered.
+         *
+         * @param[in]    id    ID of the metric
+         */
+        static MetricState unseen(const std::uint64_t id) noexcept
+        {
+            MetricState state = {id, 0, {0.0, std::chrono::steady_clock::time_point::min()}};
+            return state;
+        }
+
+        /*!
+         * Works out a metric's per-second rate of change since it was last
+         * rendered, and records its current value and the render time.
+         *
+         * @param[in]    metric    The metric
+         * @param[in]    sample    The metric's value and render time when last rendered
+         *
+         * @return the rate
+         */
+        double rate(const Metric & metric, RateSample & sample) noexcept(false)
+        {
+            const double current = metric.numeric_value();
+            double result = 0.0;
+
+            if ((sample.time != std::chrono::steady_clock::time_point::min()) && (m_render_time > sample.time))
+            {
+                double change = current - sample.value;
+                if ((metric.per_interval()) || (((metric.kind() == Metric::Kind::UINT) || (metric.kind() == Metric::Kind::BLOCK)) && (change < 0)))
+                {
+                    // Either the value already covers just the interval, or the counter was reset
+                    change = current;
+                }
+
+                result = change / std::chrono::duration_cast<std::chrono::duration<double> >(m_render_time - sample.time).count();
+            }
+
+            sample.value = current;
+            sample.time = m_render_time;
+
+            return result;
+        }
+
+        bool m_suppressed_exception; //!< The flag - @c true if an exception was suppressed, @c false otherwise
+        bool m_delta; //!< Are all metrics rendered as deltas?
+        bool m_rates; //!< Are rates rendered?
+        std::string m_rate_prefix; //!< Name prefix of the metrics whose rates are rendered, or empty for all metrics
+        RenderFilter m_filter; //!< Selects the metrics the renderer renders
+        std::chrono::steady_clock::time_point m_render_time; //!< Time of the current render operation, set by the registry
+        std::vector<RegistryState> m_registry_states; //!< State of the metrics of each registry the renderer has rendered
+        std::size_t m_registry_state; //!< Position in ::m_registry_states of the registry that's rendering
+
+    };
+
+    /*!
+     * @class PlainRenderer
+     *
+     * @brief Renders metrics as simple line-delimited key value pairs in the form \<metric name\> = \<metric value\>
+     *
+     * @remarks thread-hostile
+     */
+    class PlainRenderer : public Renderer
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    destination    Output stream to which to write the rendered metrics. This stream object @b must persist beyond the life of the renderer
+         */
+        PlainRenderer(std::ostream & destination) noexcept : m_destination(destination)
+        {
+        }
+
+        virtual ~PlainRenderer() noexcept override
+        {
+        }
+
+        /*!
+         * Adds a newline to the stream and flushes its buffer.
+         */
+        virtual void after() noexcept(false) override
+        {
+            m_destination << std::endl;
+        }
+
+        /*!
+         * Renders a metric as \<metric name\> = \<metric value\> \<metric unit\>\\n
+         * and writes it to the output stream. Any series values are written on
+         * the following lines as \<metric name\>.\<label\> = \<value\>\\n
+         *
+         * @param[in]    metric    The metric to render
+         */
+        void render(const std::shared_ptr<Metric> & metric) noexcept(false) override final
+        {
+            std::string unit_part = metric->unit();
+            if (unit_part.size() > 0)
+            {
+                m_destination << metric->name() << " = " << value(metric) << ' ' << unit_part << '\n';
+            }
+            else
+            {
+                m_destination << metric->name() << " = " << value(metric) << '\n';
+            }
+
+            for (auto entry : series(metric))
+            {
+                m_destination << metric->name() << '.' << entry.first << " = " << entry.second << '\n';
+            }
+        }
+
+    private:
+        std::ostream & m_destination; //!< Output stream to which to write rendered output
+
+    };
+
+    /*!
+     * @class JsonStringLiteral
+     *
+     * @brief A valid, quoted and escaped JSON string literal
+     *
+     * Converts a data buffer to a JSON string literal for insertion
+     * directly in JSON data. The string literal representation contains
+     * the source data with leading and trailing double quotes along with
+     * appropriately escaped characters according to standards (see
+     * https://tools.ietf.org/html/rfc7159).
+     */
+    class JsonStringLiteral
+    {
+
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    data    Contents of the string literal
+         */
+        explicit JsonStringLiteral(const std::string & data) noexcept(false)
+        {
+            literalise(data, m_result);
+        }
+
+        /*!
+         * Constructor.
+         *
+         * @param[in]    data    Contents of the string literal
+         */
+        explicit JsonStringLiteral(const char * data) noexcept(false)
+        {
+            std::string strData(data);
+
+            literalise(strData, m_result);
+        }
+
+        JsonStringLiteral(const JsonStringLiteral & rhs) = default;
+        JsonStringLiteral(JsonStringLiteral && rhs) noexcept(false) : m_result(std::move(rhs.m_result))
+        {
+        }
+
+        JsonStringLiteral & operator=(JsonStringLiteral & rhs) = default;
+        JsonStringLiteral & operator=(JsonStringLiteral && rhs) noexcept(false)
+        {
+            if (this != &rhs)
+            {
+                m_result = std::move(rhs.m_result);
+                rhs.m_result.clear();
+            }
+
+            return (*this);
+        }
+
+        /*!
+         * Get a pointer to a null-terminated string containing the JSON string literal,
+         * including leading and terminating double quotes, and appropriately escaped
+         * source characters.
+         */
+        operator const char * () const noexcept
+        {
+            return m_result.c_str();
+        }
+
+    private:
+        /*!
+         * Create a JSON-compatible string literal representation of in, and write it to
+         * out.
+         *
+         * @param[in]     in     The string from which to create a JSON string literal
+         * @param[out]    out    The result
+         */
+        void literalise(const std::string & in, std::string & out) const noexcept(false)
+        {
+            out.push_back('"');
+
+            for (auto c : in)
+            {
+                if ((c >= 0) && (c <= 0x1f))
+                {
+                    switch(c)
+                    {
+                    case 8: // Backspace
+                        out.push_back('\\');
+                        out.push_back('b');
+                        break;
+                    case 9: // Horizontal tab
+                        out.push_back('\\');
+                        out.push_back('t');
+                        break;
+                    case 10: // Line feed
+                        out.push_back('\\');
+                        out.push_back('n');
+                        break;
+                    case 12: // Form feed
+                        out.push_back('\\');
+                        out.push_back('f');
+                        break;
+                    case 13: // Carriage return
+                        out.push_back('\\');
+                        out.push_back('r');
+                        break;
+                    default:
+                        escape_as_hex(c, out);
+                        break;
+                    }
+                }
+                else
+                {
+                    switch(c)
+                    {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        // Must be escaped
+                        out.push_back('\\');
+                        out.push_back(c);
+                        break;
+                    default:
+                        out.push_back(c);
+                        break;
+                    }
+                }
+            }
+
+            out.push_back('"');
+        }
+
+        /*!
+         * Escape c as a JSON hex escape sequence of the form \uXXXX, where XXXX is a
+         * 32-bit integer in hexadecimal notation, and append it to out.
+         *
+         * @param[in]     c      The character to escape
+         * @param[out]    out    The string to which the escaped character will be appended
+         */
+        void escape_as_hex(char c, std::string & out) const noexcept
+        {
+            std::stringstream formatter;
+
+            formatter << "\\u00" << std::uppercase << std::setfill('0') << std::setw(2) << std::hex << static_cast<std::uint16_t>(c);
+
+            out += formatter.str();
+        }
+
+        std::string m_result; //!< The normalised JSON string literal
+
+    };
+
+    /*!
+     * @class JsonRenderer
+     *
+     * @brief Renders metrics as a JSON object
+     *
+     * Rendered metrics consist of a single JSON dictionary whose keys are
+     * metric names that each refer to a single JSON dictionary containing
+     * information about the metric. Specifically, the metric's @em value,
+     * @em unit, @em kind and @em description, plus a @em series dictionary
+     * for metrics with labelled values (see Metric::series). Note that
+     * rendered JSON is never pretty-printed (but the example below is for
+     * convenience).
+     *
+     * @include json_renderer_example.json
+     *
+     * @remarks thread-hostile
+     */
+    class JsonRenderer : public Renderer
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    destination    Output stream to which to write the rendered metrics. This stream object @b must persist beyond the life of the renderer
+         *
+         * @remarks thread-hostile
+         */
+        JsonRenderer(std::ostream & destination) noexcept : m_destination(destination), m_count(0)
+        {
+        }
+
+        virtual ~JsonRenderer() noexcept
+        {
+        }
+
+        /*!
+         * Writes the leading brace of the JSON object to the output stream.
+         *
+         * @remarks thread-hostile
+         */
+        virtual void before() noexcept(false) override
+        {
+            m_count = 0;
+            m_destination << '{';
+        }
+
+        /*!
+         * Writes the trailing brace of the JSON object to the output stream,
+         * then flushes the stream's buffer.
+         *
+         * @remarks thread-hostile
+         */
+        virtual void after() noexcept(false) override
+        {
+            m_destination << '}';
+            m_destination.flush();
+        }
+
+        /*!
+         * Renders the metric as a JSON object.
+         *
+         * @example json_renderer_example.json
+         *
+         * @param[in]    metric    The metric to render
+         *
+         * @remarks thread-hostile
+         */
+        void render(const std::shared_ptr<Metric> & metric) noexcept(false) override final
+        {
+            if (m_count > 0)
+            {
+                m_destination << ',';
+            }
+
+            m_destination << JsonStringLiteral(metric->name()) << ":{";
+
+            m_destination << JsonStringLiteral("value") << ':';
+            switch(metric->kind())
+            {
+            case Metric::Kind::UINT:
+            case Metric::Kind::INT:
+            case Metric::Kind::FLOAT:
+            case Metric::Kind::RATE:
+            case Metric::Kind::SUM:
+            case Metric::Kind::MEAN:
+            case Metric::Kind::DERIVED:
+            case Metric::Kind::WINDOWED:
+            case Metric::Kind::EWMA:
+            case Metric::Kind::CATEGORY:
+            case Metric::Kind::CALLBACK:
+            case Metric::Kind::BLOCK:
+                m_destination << value(metric);
+                break;
+            case Metric::Kind::STR:
+            case Metric::Kind::STATE:
+                m_destination << JsonStringLiteral((*metric));
+                break;
+            case Metric::Kind::BOOL:
+                if (bool(*metric))
+                {
+                    m_destination << "true";
+                }
+                else
+                {
+                    m_destination << "false";
+                }
+                break;
+            }
+            m_destination << ',';
+
+            m_destination << JsonStringLiteral("unit") << ':' << JsonStringLiteral(metric->unit()) << ',';
+            m_destination << JsonStringLiteral("kind") << ':' << JsonStringLiteral(metric->kind_name()) << ',';
+            m_destination << JsonStringLiteral("description") << ':' << JsonStringLiteral(metric->description());
+
+            auto entries = series(metric);
+            if (!entries.empty())
+            {
+                m_destination << ',' << JsonStringLiteral("series") << ":{";
+                for (std::size_t index=0;index<entries.size();++index)
+                {
+                    if (index > 0)
+                    {
+                        m_destination << ',';
+                    }
+
+                    m_destination << JsonStringLiteral(entries[index].first) << ':' << entries[index].second;
+                }
+                m_destination << '}';
+            }
+
+            m_destination << '}';
+
+            ++m_count;
+        }
+
+    private:
+        std::ostream & m_destination; //!< Output stream to which to write rendered output
+        std::size_t m_count; //!< Number of metrics written to the stream since the start of the current render operation
+
+    };
+
+    /*!
+     * @class PrometheusRenderer
+     *
+     * @brief Renders metrics in the Prometheus text-based exposition format.
+     *
+     * Rendered metrics consist of
+     *
+     * Reference: https://github.com/prometheus/docs/blob/main/content/docs/instrumenting/exposition_formats.md#text-based-format
+     *
+     * @include prometheus_renderer_example.txt
+     *
+     * @remarks thread-hostile
+     */
+    class PrometheusRenderer : public Renderer
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    destination         Output stream to which to write the rendered metrics. This stream object @b must persist beyond the life of the renderer
+         * @param[in]    timestamp_getter    Function that returns the current timestamp in milliseconds since the Unix epoch
+         * @param[in]    app_name            Name of the application to which the metrics belong. It must match regex: [a-zA-Z_:][a-zA-Z0-9_:]*
+         * 
+         * @throws RenderError
+         *
+         * @remarks thread-hostile
+         */
+        PrometheusRenderer(std::ostream & destination, std::function<std::int64_t ()> timestamp_getter,
+                const std::string & app_name = "") : m_destination(destination), m_timestamp_getter(timestamp_getter),
+                m_count(0), m_app_name(app_name), m_METRIC_NAME_PATTERN("[a-zA-Z_:][a-zA-Z0-9_:]*"),
+                m_METRIC_NAME_CHAR_PATTERN("[a-zA-Z0-9_:]"), m_METRIC_UNIT_CHAR_PATTERN("[a-zA-Z0-9]")
+        {
+            if (!std::regex_match(m_app_name, m_METRIC_NAME_PATTERN))
+            {
+                throw RenderError("Application name contains invalid characters. It must match regex: [a-zA-Z_:][a-zA-Z0-9_:]*");
+            }
+        }
+
+        virtual ~PrometheusRenderer() noexcept
+        {
+        }
+
+        /*!
+         *
+         *
+         * @remarks thread-hostile
+         */
+        virtual void before() noexcept(false) override
+        {
+            m_count = 0;
+        }
+
+        /*!
+         *
+         *
+         * @remarks thread-hostile
+         */
+        virtual void after() noexcept(false) override
+        {
+            m_destination << std::endl;
+        }
+
+        /*!
+         * Renders the metric as an entry in a Prometheus metric set.
+         *
+         * @example prometheus_renderer_example.txt
+         *
+         * @param[in]    metric    The metric to render
+         *
+         * @remarks thread-hostile
+         */
+        void render(const std::shared_ptr<Metric> & metric) noexcept(false) override final
+        {
+            std::string metric_value;
+
+            switch(metric->kind())
+            {
+            case Metric::Kind::UINT:
+            case Metric::Kind::INT:
+            case Metric::Kind::FLOAT:
+            case Metric::Kind::RATE:
+            case Metric::Kind::SUM:
+            case Metric::Kind::MEAN:
+            case Metric::Kind::DERIVED:
+            case Metric::Kind::WINDOWED:
+            case Metric::Kind::EWMA:
+            case Metric::Kind::CATEGORY:
+            case Metric::Kind::CALLBACK:
+            case Metric::Kind::BLOCK:
+                metric_value = value(metric);
+                break;
+            case Metric::Kind::STATE:
+                metric_value = std::to_string(std::uint64_t(*metric));
+                break;
+            case Metric::Kind::BOOL:
+                if (bool(*metric))
+                {
+                    metric_value = "1";
+                }
+                else
+                {
+                    metric_value = "0";
+                }
+                break;
+            default:
+                /*
+                 * Only numeric metrics are supported by this renderer.
+                 */
+                return;
+            }
+
+            std::string name_dirty{metric->name()};
+            std::string name_sanitised;
+            if (!sanitise_name(name_dirty, name_sanitised))
+            {
+                return;
+            }
+
+            if (m_count > 0)
+            {
+                m_destination << '\n';
+            }
+
+            if (!m_app_name.empty())
+            {
+                name_sanitised = m_app_name + "::" + name_sanitised;
+            }
+
+            std::string unit_dirty{metric->unit()};
+            std::string unit_sanitised;
+            if (!unit_dirty.empty())
+            {
+                sanitise_unit(unit_dirty, unit_sanitised);
+                name_sanitised.push_back('_');
+                name_sanitised.append(unit_sanitised);
+            }
+
+            std::string help_str_dirty{metric->description()};
+            std::string help_str_sanitised;
+            if (!help_str_dirty.empty())
+            {
+                escape_str(help_str_dirty, help_str_sanitised);
+
+                m_destination << "# HELP " << name_sanitised << ' ' << help_str_sanitised << '\n';
+            }
+
+            auto timestamp = m_timestamp_getter();
+            m_destination << name_sanitised << ' ' << metric_value << ' ' << timestamp;
+
+            for (auto entry : series(metric))
+            {
+                std::string label_sanitised;
+                escape_label_value(entry.first, label_sanitised);
+
+                m_destination << '\n' << name_sanitised << "{series=\"" << label_sanitised << "\"} " << entry.second << ' ' << timestamp;
+            }
+
+            ++m_count;
+        }
+
+    private:
+        bool sanitise_name(const std::string & in,
+                std::string & out)
+        {
+            /*
+             * Ref: https://prometheus.io/docs/concepts/data_model/#metric-names-and-labels
+             */
+
+            out.clear();
+
+            for (auto in_c : in)
+            {
+                std::smatch match_char;
+                std::string target;
+                target.push_back(in_c);
+
+                if (std::regex_match(target, match_char, m_METRIC_NAME_CHAR_PATTERN))
+                {
+                    out.push_back(in_c);
+                }
+                else if (in_c == '.')
+                {
+                    /*
+                    * Ref: https://prometheus.io/docs/concepts/data_model/#metric-names-and-labels
+                    */
+                    out.push_back(':');
+                    out.push_back(':');
+                }
+            }
+
+            std::smatch match_name;
+            if (!std::regex_match(out, match_name, m_METRIC_NAME_PATTERN))
+            {
+                /*
+                * Final check - if the transformed name isn't valid, give up and
+                * let the caller know.
+                */
+                out.clear();
+                return false;
+            }
+
+            return true;
+        }
+
+        void sanitise_unit(const std::string & in,
+                std::string & out)
+        {
+            /*
+             * Ref: https://prometheus.io/docs/concepts/data_model/#metric-names-and-labels
+             */
+
+            for (auto in_c : in)
+            {
+                std::smatch match_char;
+                std::string target;
+                target.push_back(in_c);
+
+                if (std::regex_match(target, match_char, m_METRIC_UNIT_CHAR_PATTERN))
+                {
+                    out.push_back(std::tolower(static_cast<unsigned char>(in_c)));
+                }
+            }
+        }
+
+        void escape_str(const std::string & in,
+                std::string & out)
+        {
+            /*
+             * Ref: https://github.com/prometheus/docs/blob/main/content/docs/instrumenting/exposition_formats.md#comments-help-text-and-type-information
+             */
+
+            out.clear();
+
+            for (auto in_c : in)
+            {
+                switch(in_c)
+                {
+                case '\n':
+                    out.push_back('\\');
+                    out.push_back('n');
+                    break;
+                case '\\':
+                    out.push_back('\\');
                     out.push_back('\\');
                     break;
                 default:
@@ -2363,1072 +7916,4881 @@ namespace measuro
             }
         }
 
-        std::ostream & m_destination; //!< Output stream to which to write rendered output
-        std::function<std::int64_t ()> m_timestamp_getter; //!< Code to call in order to retrieve the current timestamp, in milliseconds since the Unix epoch
-        std::size_t m_count; //!< Number of metrics written to the stream since the start of the current render operation
-        std::string m_app_name; //!< Name of the application to use as a metric namespace
-        const std::regex m_METRIC_NAME_PATTERN;
-        const std::regex m_METRIC_NAME_CHAR_PATTERN;
-        const std::regex m_METRIC_UNIT_CHAR_PATTERN;
-
-    };
+        void escape_label_value(const std::string & in,
+                std::string & out)
+        {
+            /*
+             * Ref: https://github.com/prometheus/docs/blob/main/content/docs/instrumenting/exposition_formats.md#comments-help-text-and-type-information
+             */
+
+            escape_str(in, out);
+
+            std::string escaped;
+            for (auto in_c : out)
+            {
+                if (in_c == '"')
+                {
+                    escaped.push_back('\\');
+                }
+                escaped.push_back(in_c);
+            }
+
+            out.swap(escaped);
+        }
+
+        std::ostream & m_destination; //!< Output stream to which to write rendered output
+        std::function<std::int64_t ()> m_timestamp_getter; //!< Code to call in order to retrieve the current timestamp, in milliseconds since the Unix epoch
+        std::size_t m_count; //!< Number of metrics written to the stream since the start of the current render operation
+        std::string m_app_name; //!< Name of the application to use as a metric namespace
+        const std::regex m_METRIC_NAME_PATTERN;
+        const std::regex m_METRIC_NAME_CHAR_PATTERN;
+        const std::regex m_METRIC_UNIT_CHAR_PATTERN;
+
+    };
+
+    using UintHandle = std::shared_ptr<NumberMetric<Metric::Kind::UINT, std::uint64_t> >; //!< Handle to an unsigned metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using IntHandle = std::shared_ptr<NumberMetric<Metric::Kind::INT, std::int64_t> >; //!< Handle to an signed metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using FloatHandle = std::shared_ptr<NumberMetric<Metric::Kind::FLOAT, float> >; //!< Handle to an float metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using RateOfUintHandle = std::shared_ptr<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >; //!< Handle to a rate of unsigned metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using RateOfIntHandle = std::shared_ptr<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >; //!< Handle to a rate of signed metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using RateOfFloatHandle = std::shared_ptr<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > >; //!< Handle to a rate of float metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using RateOfSumOfUintHandle = std::shared_ptr<RateMetric<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >; //!< Handle to a rate of sum of unsigned metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using RateOfSumOfIntHandle = std::shared_ptr<RateMetric<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >; //!< Handle to a rate of sum of signed metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using RateOfSumOfFloatHandle = std::shared_ptr<RateMetric<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >; //!< Handle to a rate of sum of float metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using SumOfUintHandle = std::shared_ptr<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >; //!< Handle to a sum of unsigned metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using SumOfIntHandle = std::shared_ptr<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >; //!< Handle to a sum of signed metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using SumOfFloatHandle = std::shared_ptr<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > >; //!< Handle to a sum of float metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using SumOfRateOfUintHandle = std::shared_ptr<SumMetric<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >; //!< Handle to a sum of rate of unsigned metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using SumOfRateOfIntHandle = std::shared_ptr<SumMetric<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >; //!< Handle to a sum of rate of signed metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using SumOfRateOfFloatHandle = std::shared_ptr<SumMetric<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >; //!< Handle to a sum of rate of float metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using StringHandle = std::shared_ptr<StringMetric>; //!< Handle to a string metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using BoolHandle = std::shared_ptr<BoolMetric>; //!< Handle to a boolean metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using MeanHandle = std::shared_ptr<MeanMetric>; //!< Handle to a mean metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using DerivedHandle = std::shared_ptr<DerivedMetric>; //!< Handle to a derived metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using WindowedHandle = std::shared_ptr<WindowedMetric>; //!< Handle to a windowed counter metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using EwmaHandle = std::shared_ptr<EwmaMetric>; //!< Handle to an EWMA metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using CategoryHandle = std::shared_ptr<CategoryMetric>; //!< Handle to a category counter metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using StateHandle = std::shared_ptr<StateMetric>; //!< Handle to a state machine metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using CallbackHandle = std::shared_ptr<CallbackMetric>; //!< Handle to a callback gauge metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using CallbackBatchHandle = std::shared_ptr<CallbackBatch>; //!< Handle to a callback batch. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using BlockCounterHandle = std::shared_ptr<BlockCounter>; //!< Handle to a counter of a counter block. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+    using CounterBlockHandle = std::shared_ptr<CounterBlock>; //!< Handle to a counter block. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+
+    using UintThrottle = Throttle<NumberMetric<Metric::Kind::UINT, std::uint64_t> >; //!< Throttle object throttling an unsigned metric
+    using IntThrottle = Throttle<NumberMetric<Metric::Kind::INT, std::int64_t> >; //!< Throttle object throttling a signed metric
+    using FloatThrottle = Throttle<NumberMetric<Metric::Kind::FLOAT, float> >; //!< Throttle object throttling a float metric
+    using StringThrottle = Throttle<StringMetric>; //!< Throttle object throttling a string metric
+    using BoolThrottle = Throttle<BoolMetric>; //!< Throttle object throttling a boolean metric
+
+    /*!
+     * @class MetricRef
+     *
+     * @brief A non-owning reference to a metric in a registry
+     *
+     * Unlike a handle, a reference doesn't keep its metric alive, so copying
+     * one is as cheap as copying a pointer and an ID, and never touches a
+     * reference count shared with other threads. A reference may be used
+     * for as long as its metric remains in the registry that holds it. Where
+     * metrics may have been removed since the reference was made, check it
+     * with Registry::valid() first: the check compares the metric's ID, which
+     * is never reused, so a reference is never mistaken for one to a metric
+     * created later. Get a reference from a handle, or from a metric's ID
+     * using Registry::resolve().
+     *
+     * @remarks thread-safe
+     */
+    template<typename T>
+    class MetricRef
+    {
+    public:
+        typedef T element_type; //!< Type of the referenced metric
+
+        /*!
+         * Constructor. Creates a reference to no metric.
+         */
+        MetricRef() noexcept : m_metric(nullptr), m_id(std::numeric_limits<std::uint64_t>::max())
+        {
+        }
+
+        /*!
+         * Constructor.
+         *
+         * @param[in]    handle    Handle to the metric
+         */
+        MetricRef(const std::shared_ptr<T> & handle) noexcept
+        : m_metric(handle.get()), m_id((handle) ? handle->id() : std::numeric_limits<std::uint64_t>::max())
+        {
+        }
+
+        /*!
+         * Constructor.
+         *
+         * @param[in]    metric    The metric
+         */
+        explicit MetricRef(T * metric) noexcept
+        : m_metric(metric), m_id((metric != nullptr) ? metric->id() : std::numeric_limits<std::uint64_t>::max())
+        {
+        }
+
+        /*!
+         * Get the referenced metric.
+         *
+         * @return pointer to the metric, or @c nullptr if the reference is empty
+         */
+        T * get() const noexcept
+        {
+            return m_metric;
+        }
+
+        /*!
+         * Get the ID the referenced metric had when the reference was made.
+         *
+         * @return the ID, or the maximum std::uint64_t value if the reference is empty or the metric wasn't in a registry
+         */
+        std::uint64_t id() const noexcept
+        {
+            return m_id;
+        }
+
+        /*!
+         * Access the referenced metric. The reference must not be empty.
+         */
+        T * operator->() const noexcept
+        {
+            return m_metric;
+        }
+
+        /*!
+         * Access the referenced metric. The reference must not be empty.
+         */
+        T & operator*() const noexcept
+        {
+            return *m_metric;
+        }
+
+        /*!
+         * Does the reference refer to a metric?
+         */
+        explicit operator bool() const noexcept
+        {
+            return m_metric != nullptr;
+        }
+
+        /*!
+         * Do the references refer to the same metric?
+         */
+        bool operator==(const MetricRef & other) const noexcept
+        {
+            return m_metric == other.m_metric;
+        }
+
+        /*!
+         * Do the references refer to different metrics?
+         */
+        bool operator!=(const MetricRef & other) const noexcept
+        {
+            return m_metric != other.m_metric;
+        }
+
+    private:
+        T * m_metric; //!< The referenced metric
+        std::uint64_t m_id; //!< ID of the referenced metric, @see Metric::id()
+
+    };
+
+    static_assert(std::is_trivially_copyable<MetricRef<Metric> >::value, "MetricRef must be trivially copyable");
+
+    using UintRef = MetricRef<UintHandle::element_type>; //!< Reference to an unsigned metric
+    using IntRef = MetricRef<IntHandle::element_type>; //!< Reference to a signed metric
+    using FloatRef = MetricRef<FloatHandle::element_type>; //!< Reference to a float metric
+    using StringRef = MetricRef<StringHandle::element_type>; //!< Reference to a string metric
+    using BoolRef = MetricRef<BoolHandle::element_type>; //!< Reference to a boolean metric
+    using MeanRef = MetricRef<MeanHandle::element_type>; //!< Reference to a mean metric
+    using DerivedRef = MetricRef<DerivedHandle::element_type>; //!< Reference to a derived metric
+    using WindowedRef = MetricRef<WindowedHandle::element_type>; //!< Reference to a windowed counter metric
+    using EwmaRef = MetricRef<EwmaHandle::element_type>; //!< Reference to an EWMA metric
+    using CategoryRef = MetricRef<CategoryHandle::element_type>; //!< Reference to a category counter metric
+    using StateRef = MetricRef<StateHandle::element_type>; //!< Reference to a state machine metric
+    using CallbackRef = MetricRef<CallbackHandle::element_type>; //!< Reference to a callback gauge metric
+    using BlockCounterRef = MetricRef<BlockCounterHandle::element_type>; //!< Reference to a counter of a counter block
+
+    /*!
+     * @class MetricKey
+     *
+     * @brief A metric name and its hash, for looking metrics up without
+     * allocating
+     *
+     * A key refers to the characters of the name it's constructed from,
+     * without copying them, so it must not outlive them. Constructing a key
+     * from a string literal in a @c constexpr context computes its hash at
+     * compile time:
+     *
+     * @code
+     * static constexpr measuro::MetricKey REQUESTS("app.requests");
+     * auto requests = registry(measuro::UINT::KIND, REQUESTS);
+     * @endcode
+     *
+     * @remarks thread-safe
+     */
+    class MetricKey
+    {
+    public:
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name    Null-terminated name of the metric
+         */
+        constexpr MetricKey(const char * name) noexcept
+        : m_name(name), m_length(length_of(name)), m_hash(finish(hash_terminated(name, FNV_OFFSET)))
+        {
+        }
+
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name      Name of the metric, which needn't be null-terminated
+         * @param[in]    length    Number of characters in the name
+         */
+        constexpr MetricKey(const char * name, const std::size_t length) noexcept
+        : m_name(name), m_length(length), m_hash(finish(hash_counted(name, length, FNV_OFFSET)))
+        {
+        }
+
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name    Name of the metric
+         */
+        MetricKey(const std::string & name) noexcept
+        : m_name(name.data()), m_length(name.length()), m_hash(finish(hash_counted(name.data(), name.length(), FNV_OFFSET)))
+        {
+        }
+
+#if __cplusplus >= 201703L
+        /*!
+         * Constructor.
+         *
+         * @param[in]    name    Name of the metric
+         */
+        constexpr MetricKey(const std::string_view name) noexcept
+        : m_name(name.data()), m_length(name.length()), m_hash(finish(hash_counted(name.data(), name.length(), FNV_OFFSET)))
+        {
+        }
+#endif
+
+        /*!
+         * Get the characters of the name. They aren't necessarily
+         * null-terminated.
+         *
+         * @return pointer to the first character of the name
+         */
+        constexpr const char * data() const noexcept
+        {
+            return m_name;
+        }
+
+        /*!
+         * Get the length of the name.
+         *
+         * @return number of characters in the name
+         */
+        constexpr std::size_t length() const noexcept
+        {
+            return m_length;
+        }
+
+        /*!
+         * Get the hash of the name.
+         *
+         * @return the hash
+         */
+        constexpr std::uint64_t hash() const noexcept
+        {
+            return m_hash;
+        }
+
+        /*!
+         * Get a copy of the name.
+         *
+         * @return the name
+         */
+        std::string str() const noexcept(false)
+        {
+            return std::string(m_name, m_length);
+        }
+
+        /*!
+         * Is this the key of a name?
+         *
+         * @param[in]    name    The name
+         * @param[in]    hash    Hash of the name
+         *
+         * @return true if the name matches the key
+         */
+        bool matches(const std::string & name, const std::uint64_t hash) const noexcept
+        {
+            return (hash == m_hash) && (name.length() == m_length) && (std::memcmp(name.data(), m_name, m_length) == 0);
+        }
+
+    private:
+        static constexpr std::uint64_t FNV_OFFSET = 14695981039346656037ULL; //!< FNV-1a offset basis
+        static constexpr std::uint64_t FNV_PRIME = 1099511628211ULL; //!< FNV-1a prime
+
+        /*!
+         * Get the length of a null-terminated string.
+         */
+        static constexpr std::size_t length_of(const char * name) noexcept
+        {
+            return (*name == '\0') ? 0 : 1 + length_of(name + 1);
+        }
+
+        /*!
+         * Get the FNV-1a hash of a null-terminated string.
+         */
+        static constexpr std::uint64_t hash_terminated(const char * name, const std::uint64_t hash) noexcept
+        {
+            return (*name == '\0') ? hash : hash_terminated(name + 1, (hash ^ std::uint64_t(static_cast<unsigned char>(*name))) * FNV_PRIME);
+        }
+
+        /*!
+         * Get the FNV-1a hash of a string of known length.
+         */
+        static constexpr std::uint64_t hash_counted(const char * name, const std::size_t length, const std::uint64_t hash) noexcept
+        {
+            return (length == 0) ? hash : hash_counted(name + 1, length - 1, (hash ^ std::uint64_t(static_cast<unsigned char>(*name))) * FNV_PRIME);
+        }
+
+        /*!
+         * Mixes an FNV-1a hash so that its low bits, which choose a metric's
+         * slot in the index, depend on every bit of the name.
+         */
+        static constexpr std::uint64_t finish(const std::uint64_t hash) noexcept
+        {
+            return fold(fold(fold(hash) * 0xff51afd7ed558ccdULL) * 0xc4ceb9fe1a85ec53ULL);
+        }
+
+        /*!
+         * @see finish()
+         */
+        static constexpr std::uint64_t fold(const std::uint64_t hash) noexcept
+        {
+            return hash ^ (hash >> 33);
+        }
+
+        const char * m_name; //!< Characters of the name
+        std::size_t m_length; //!< Number of characters in the name
+        std::uint64_t m_hash; //!< Hash of the name
+
+    };
+
+    /*!
+     * @class MetricIndex
+     *
+     * @brief Maps metric names to metrics, with lookups that take no lock
+     *
+     * Names are spread across a fixed number of shards by hash. Each shard is
+     * an open-addressing hash table of pointers to immutable entries.
+     * Insertions and removals lock only their shard and publish each change
+     * with a single atomic store, so lookups never lock and never wait. When
+     * a shard's table becomes half full, a new table is published in its
+     * place.
+     *
+     * Removed entries and replaced tables are retired rather than freed,
+     * because a lookup may still be reading them. Lookups hold a Guard, which
+     * counts them in against the current epoch. reclaim() advances the epoch
+     * and waits for the lookups counted in against earlier epochs to finish
+     * before freeing what was retired. The wait is only ever made by the
+     * thread reclaiming memory.
+     *
+     * @remarks thread-safe
+     */
+    class MetricIndex
+    {
+    public:
+        /*!
+         * A metric in the index.
+         */
+        struct Entry
+        {
+            std::string name; //!< Name of the metric
+            std::shared_ptr<Metric> metric; //!< The metric
+            bool lookup; //!< Can the metric be looked up by name?
+            std::uint64_t hash; //!< Hash of the name, @see MetricKey::hash()
+            std::uint64_t id; //!< ID of the metric, @see Metric::id()
+            std::size_t position; //!< Position of the entry in its shard's list of entries
+        };
+
+        /*!
+         * @class Guard
+         *
+         * @brief Protects the entries found by a thread from reclamation
+         *
+         * Entries found by MetricIndex::find() or MetricIndex::at() remain
+         * valid for as long as a guard created before finding them exists.
+         * Creating a guard costs an atomic increment of a counter shared by
+         * the threads in the caller's ThreadSlot.
+         */
+        class Guard
+        {
+        public:
+            /*!
+             * Constructor.
+             *
+             * @param[in]    index    The index in which entries will be found
+             */
+            explicit Guard(const MetricIndex & index) noexcept
+            {
+                ReaderSlot & slot = index.m_readers[ThreadSlot::index() & index.m_reader_mask];
+                m_count = &slot.count[index.m_epoch.load() & 1];
+                m_count->fetch_add(1);
+            }
+
+            Guard(const Guard &) = delete;
+            Guard(Guard &&) = delete;
+            Guard & operator=(const Guard &) = delete;
+            Guard & operator=(Guard &&) = delete;
+
+            /*!
+             * Destructor.
+             */
+            ~Guard() noexcept
+            {
+                m_count->fetch_sub(1);
+            }
+
+        private:
+            std::atomic<std::uint64_t> * m_count; //!< The reader count incremented by the guard
+
+        };
+
+        /*!
+         * Constructor.
+         */
+        MetricIndex() noexcept(false)
+        : m_shards(new Shard[SHARD_COUNT]), m_version(0), m_id_chunks(new std::atomic<std::atomic<const Entry *> *>[ID_CHUNK_COUNT]), m_id_count(0),
+          m_epoch(0), m_readers(nullptr), m_reader_mask(ThreadSlot::count() - 1)
+        {
+            for (std::size_t index = 0; index < ID_CHUNK_COUNT; ++index)
+            {
+                m_id_chunks[index].store(nullptr, std::memory_order_relaxed);
+            }
+
+            // Aligned to a cache line, so that each ThreadSlot's reader counts have a line to themselves
+            std::size_t space = ((m_reader_mask + 1) * sizeof(ReaderSlot)) + LINE_SIZE;
+            m_reader_storage.reset(new char[space]);
+
+            void * aligned = m_reader_storage.get();
+            std::align(LINE_SIZE, (m_reader_mask + 1) * sizeof(ReaderSlot), aligned, space);
+            m_readers = static_cast<ReaderSlot *>(aligned);
+
+            for (std::size_t index = 0; index <= m_reader_mask; ++index)
+            {
+                new (&m_readers[index]) ReaderSlot();
+            }
+        }
+
+        MetricIndex(const MetricIndex &) = delete;
+        MetricIndex(MetricIndex &&) = delete;
+        MetricIndex & operator=(const MetricIndex &) = delete;
+        MetricIndex & operator=(MetricIndex &&) = delete;
+
+        /*!
+         * Finds a metric by name. Takes no lock and doesn't allocate. Unless
+         * the caller excludes removals by other means, it must hold a Guard.
+         *
+         * @param[in]    key    Name of the metric
+         *
+         * @return the metric's entry, or @c nullptr if there is no metric with the name
+         *
+         * @remarks thread-safe
+         */
+        const Entry * find(const MetricKey & key) const noexcept
+        {
+            const Table * table = m_shards[shard_of(key.hash())].table.load();
+
+            for (std::size_t position = std::size_t(key.hash()) & table->mask; ; position = (position + 1) & table->mask)
+            {
+                const Entry * entry = table->slots[position].load();
+                if (entry == nullptr)
+                {
+                    return nullptr;
+                }
+
+                if ((entry != tombstone()) && key.matches(entry->name, entry->hash))
+                {
+                    return entry;
+                }
+            }
+        }
+
+        /*!
+         * Finds a metric by ID. Takes no lock. Unless the caller excludes
+         * removals by other means, it must hold a Guard.
+         *
+         * @param[in]    id    ID of the metric
+         *
+         * @return the metric's entry, or @c nullptr if there is no metric with the ID, including if the ID's metric has been removed and its index reused
+         *
+         * @remarks thread-safe
+         */
+        const Entry * at(const std::uint64_t id) const noexcept
+        {
+            const std::uint64_t position = index_of(id);
+            if (position >= m_id_count.load())
+            {
+                return nullptr;
+            }
+
+            const Entry * entry = m_id_chunks[std::size_t(position / ID_CHUNK_SIZE)].load()[std::size_t(position % ID_CHUNK_SIZE)].load();
+            if ((entry == nullptr) || (entry->id != id))
+            {
+                return nullptr;
+            }
+
+            return entry;
+        }
+
+        /*!
+         * Get the dense index part of an ID, @see Metric::id()
+         *
+         * @param[in]    id    The ID
+         *
+         * @return the index
+         */
+        static std::uint64_t index_of(const std::uint64_t id) noexcept
+        {
+            return Metric::index_of(id);
+        }
+
+        /*!
+         * Adds a metric, unless the name is already taken. The metric is
+         * given the lowest free index, with a generation that no earlier
+         * metric at the index had.
+         *
+         * @param[in]    name      Name of the metric
+         * @param[in]    metric    The metric
+         * @param[in]    lookup    @see Entry::lookup
+         *
+         * @return the metric's entry, or @c nullptr if there is already a metric with the name
+         *
+         * @throws MetricConfigError if the index already holds the maximum number of metrics
+         *
+         * @remarks thread-safe
+         */
+        const Entry * insert(const std::string & name, std::shared_ptr<Metric> metric, const bool lookup) noexcept(false)
+        {
+            const std::uint64_t hash = MetricKey(name).hash();
+            std::unique_ptr<Entry> entry(new Entry());
+            entry->name = name;
+            entry->metric = metric;
+            entry->lookup = lookup;
+            entry->hash = hash;
+
+            Shard & shard = m_shards[shard_of(hash)];
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            if (find(name) != nullptr)
+            {
+                return nullptr;
+            }
+
+            Table * table = shard.table.load();
+            if (((shard.used + 1) * 2) > (table->mask + 1))
+            {
+                std::size_t capacity = INITIAL_SLOTS;
+                while (((shard.entries.size() + 1) * 2) > capacity)
+                {
+                    capacity *= 2;
+                }
+
+                table = rebuild(shard, capacity);
+            }
+
+            shard.entries.reserve(shard.entries.size() + 1);
+            assign_id(*entry);
+            entry->position = shard.entries.size();
+            metric->m_id = entry->id;
+
+            shard.entries.push_back(std::move(entry));
+            place(*table, shard.entries.back().get());
+            ++shard.used;
+            ++m_version;
+
+            return shard.entries.back().get();
+        }
+
+        /*!
+         * Removes a metric. Its entry is retired, to be freed by reclaim(),
+         * and its index becomes free once the entry has been freed.
+         *
+         * @param[in]    key    Name of the metric
+         *
+         * @return the removed metric, or @c nullptr if there is no metric with the name
+         *
+         * @remarks thread-safe
+         */
+        std::shared_ptr<Metric> remove(const MetricKey & key) noexcept(false)
+        {
+            Shard & shard = m_shards[shard_of(key.hash())];
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            Table * table = shard.table.load();
+            for (std::size_t position = std::size_t(key.hash()) & table->mask; ; position = (position + 1) & table->mask)
+            {
+                const Entry * entry = table->slots[position].load();
+                if (entry == nullptr)
+                {
+                    return nullptr;
+                }
+
+                if ((entry != tombstone()) && key.matches(entry->name, entry->hash))
+                {
+                    // TODO: Replace with std::scoped_lock on migration to C++17
+                    std::lock_guard<std::mutex> retired_lock(m_retired_mutex);
+                    m_retired_entries.reserve(m_retired_entries.size() + 1);
+
+                    table->slots[position].store(tombstone());
+                    const std::uint64_t index = index_of(entry->id);
+                    m_id_chunks[std::size_t(index / ID_CHUNK_SIZE)].load()[std::size_t(index % ID_CHUNK_SIZE)].store(nullptr);
+
+                    std::unique_ptr<Entry> removed(std::move(shard.entries[entry->position]));
+                    if (removed->position != (shard.entries.size() - 1))
+                    {
+                        shard.entries[removed->position] = std::move(shard.entries.back());
+                        shard.entries[removed->position]->position = removed->position;
+                    }
+
+                    shard.entries.pop_back();
+                    ++m_version;
+
+                    auto metric = removed->metric;
+                    m_retired_entries.push_back(std::move(removed));
+                    return metric;
+                }
+            }
+        }
+
+        /*!
+         * Frees the entries and tables retired since the last call, once no
+         * lookup can still be reading them. Blocks until lookups that began
+         * before the call have finished. Lookups that begin during the call
+         * aren't waited for.
+         *
+         * @remarks thread-safe
+         */
+        void reclaim() noexcept(false)
+        {
+            std::vector<std::unique_ptr<Entry> > entries;
+            std::vector<std::unique_ptr<Table> > tables;
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_retired_mutex);
+
+                entries.swap(m_retired_entries);
+                tables.swap(m_retired_tables);
+            }
+
+            if (entries.empty() && tables.empty())
+            {
+                return;
+            }
+
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_reclaim_mutex);
+
+                // Once each epoch parity has been seen with no readers, no
+                // reader that began before the epoch was advanced remains
+                for (int flip = 0; flip < 2; ++flip)
+                {
+                    const std::uint64_t epoch = m_epoch.fetch_add(1);
+                    for (std::size_t index = 0; index <= m_reader_mask; ++index)
+                    {
+                        while (m_readers[index].count[epoch & 1].load() != 0)
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                }
+            }
+
+            std::vector<std::uint64_t> ids;
+            for (const auto & entry : entries)
+            {
+                ids.push_back(entry->id);
+            }
+
+            free_ids(ids);
+        }
+
+        /*!
+         * Reserves an ID for a metric that isn't in the index, such as a
+         * roll-up node, so that it has an index of its own in tables indexed
+         * by ::index_of. The ID doesn't resolve.
+         *
+         * @return the ID
+         *
+         * @throws MetricConfigError if every ID is taken
+         *
+         * @remarks thread-safe
+         */
+        std::uint64_t reserve_id() noexcept(false)
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_id_mutex);
+
+            const std::uint64_t id = take_id();
+            const std::uint64_t index = index_of(id);
+            m_id_chunks[std::size_t(index / ID_CHUNK_SIZE)].load()[std::size_t(index % ID_CHUNK_SIZE)].store(nullptr);
+            m_id_count.store(std::max(m_id_count.load(), index + 1));
+
+            return id;
+        }
+
+        /*!
+         * Frees an ID reserved by ::reserve_id, so that its index can be
+         * reused.
+         *
+         * @param[in]    id    The ID
+         *
+         * @remarks thread-safe
+         */
+        void release_id(const std::uint64_t id) noexcept(false)
+        {
+            free_ids(std::vector<std::uint64_t>(1, id));
+        }
+
+        /*!
+         * Get the number of indexes that have been assigned: one more than
+         * the highest index any metric has had at once. Tables indexed by
+         * ::index_of needn't be any larger.
+         *
+         * @return the number of indexes
+         *
+         * @remarks thread-safe
+         */
+        std::size_t index_count() const noexcept
+        {
+            return std::size_t(m_id_count.load());
+        }
+
+        /*!
+         * Prepares the index to have metrics added in bulk, so that its
+         * tables needn't grow as each is added.
+         *
+         * @param[in]    count    Number of metrics that are about to be added
+         *
+         * @remarks thread-safe
+         */
+        void reserve(const std::size_t count) noexcept(false)
+        {
+            // Names are spread evenly between shards, on average
+            const std::size_t per_shard = (count / SHARD_COUNT) + 1;
+
+            for (std::size_t index = 0; index < SHARD_COUNT; ++index)
+            {
+                Shard & shard = m_shards[index];
+
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(shard.mutex);
+
+                const std::size_t required = shard.used + per_shard;
+                std::size_t capacity = shard.table.load()->mask + 1;
+                if ((required * 2) > capacity)
+                {
+                    while ((required * 2) > capacity)
+                    {
+                        capacity *= 2;
+                    }
+
+                    rebuild(shard, capacity);
+                }
+
+                shard.entries.reserve(shard.entries.size() + per_shard);
+            }
+        }
+
+        /*!
+         * Get a number that changes whenever a metric is added or removed.
+         *
+         * @return the index's version
+         *
+         * @remarks thread-safe
+         */
+        std::uint64_t version() const noexcept
+        {
+            return m_version;
+        }
+
+        /*!
+         * Get every entry, in name order. Unless the caller excludes removals
+         * by other means, the entries may be freed once the call returns.
+         *
+         * @return the entries, sorted by name
+         *
+         * @remarks thread-safe
+         */
+        std::vector<const Entry *> sorted() const noexcept(false)
+        {
+            std::vector<const Entry *> result;
+            for (std::size_t index = 0; index < SHARD_COUNT; ++index)
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_shards[index].mutex);
+
+                for (const auto & entry : m_shards[index].entries)
+                {
+                    result.push_back(entry.get());
+                }
+            }
+
+            std::sort(result.begin(), result.end(), [](const Entry * lhs, const Entry * rhs)
+            {
+                return lhs->name < rhs->name;
+            });
+
+            return result;
+        }
+
+    private:
+        static const std::size_t LINE_SIZE = 64; //!< Size of a cache line, in bytes
+        static const std::size_t SHARD_COUNT = 64; //!< Number of shards. Must be a power of 2
+        static const std::size_t INITIAL_SLOTS = 16; //!< Number of slots in a shard's first table. Must be a power of 2
+        static const std::size_t ID_CHUNK_SIZE = 4096; //!< Number of IDs in each chunk of the ID table
+        static const std::size_t ID_CHUNK_COUNT = 1024; //!< Maximum number of chunks in the ID table
+        static const unsigned INDEX_BITS = Metric::ID_INDEX_BITS; //!< Number of low bits of an ID that hold its index
+        static const std::uint64_t GENERATION_LIMIT = (std::uint64_t(1) << (64 - INDEX_BITS)) - 1; //!< Highest generation of an index, @see Metric::id()
+
+        /*!
+         * An open-addressing hash table, probed linearly.
+         */
+        struct Table
+        {
+            /*!
+             * Constructor.
+             *
+             * @param[in]    capacity    Number of slots. Must be a power of 2
+             */
+            Table(const std::size_t capacity) noexcept(false) : mask(capacity - 1), slots(new std::atomic<const Entry *>[capacity])
+            {
+                for (std::size_t index = 0; index < capacity; ++index)
+                {
+                    slots[index].store(nullptr, std::memory_order_relaxed);
+                }
+            }
+
+            const std::size_t mask; //!< Number of slots, less 1
+            std::unique_ptr<std::atomic<const Entry *>[]> slots; //!< The slots, each empty, pointing to an entry or holding the tombstone of a removed entry
+        };
+
+        /*!
+         * A shard of the index. Padded so that the shards' current table
+         * pointers, read by every lookup, don't share a cache line with
+         * another shard's mutex.
+         */
+        struct Shard
+        {
+            /*!
+             * Constructor.
+             */
+            Shard() noexcept(false) : table(nullptr), current(new Table(INITIAL_SLOTS)), used(0)
+            {
+                table.store(current.get());
+            }
+
+            mutable std::mutex mutex; //!< Serialises changes to the shard
+            std::atomic<Table *> table; //!< The current table
+            std::unique_ptr<Table> current; //!< Owns the current table
+            std::vector<std::unique_ptr<Entry> > entries; //!< Entries in the shard
+            std::size_t used; //!< Number of slots in the current table that aren't empty, including tombstones
+            char padding[64]; //!< Padding to a cache line
+        };
+
+        /*!
+         * Counts the lookups being made by the threads in a ThreadSlot, by
+         * the parity of the epoch in which they began. Padded to a cache
+         * line, and allocated on a cache line boundary.
+         */
+        struct ReaderSlot
+        {
+            /*!
+             * Constructor.
+             */
+            ReaderSlot() noexcept
+            {
+                count[0].store(0, std::memory_order_relaxed);
+                count[1].store(0, std::memory_order_relaxed);
+            }
+
+            std::atomic<std::uint64_t> count[2]; //!< Lookups in progress, by epoch parity
+            char padding[LINE_SIZE - (2 * sizeof(std::atomic<std::uint64_t>))]; //!< Padding to a cache line
+        };
+
+        /*!
+         * Get the value stored in a slot whose entry has been removed. Unlike
+         * an empty slot, a tombstone doesn't end a probe.
+         */
+        static const Entry * tombstone() noexcept
+        {
+            static const Entry marker = Entry();
+            return &marker;
+        }
+
+        /*!
+         * Get the shard to which a name belongs, from the top bits of its
+         * hash (the bottom bits choose its slot).
+         */
+        static std::size_t shard_of(const std::uint64_t hash) noexcept
+        {
+            return std::size_t(hash >> 58) & (SHARD_COUNT - 1);
+        }
+
+        /*!
+         * Stores an entry in the first empty slot from its hash. The table
+         * must have an empty slot.
+         */
+        static void place(Table & table, const Entry * entry) noexcept
+        {
+            std::size_t position = std::size_t(entry->hash) & table.mask;
+            while (table.slots[position].load(std::memory_order_relaxed) != nullptr)
+            {
+                position = (position + 1) & table.mask;
+            }
+
+            table.slots[position].store(entry);
+        }
+
+        /*!
+         * Replaces a shard's table with one of the specified capacity and
+         * without tombstones, and retires the old table. Must be called with
+         * the shard locked.
+         *
+         * @return the new table
+         */
+        Table * rebuild(Shard & shard, const std::size_t capacity) noexcept(false)
+        {
+            std::unique_ptr<Table> replacement(new Table(capacity));
+            for (const auto & existing : shard.entries)
+            {
+                place(*replacement, existing.get());
+            }
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_retired_mutex);
+
+            m_retired_tables.push_back(std::move(shard.current));
+            shard.current = std::move(replacement);
+            shard.table.store(shard.current.get());
+            shard.used = shard.entries.size();
+
+            return shard.current.get();
+        }
+
+        /*!
+         * Stores an entry in the ID table under the lowest free index, with
+         * the next generation of that index. The entry's ID is set before
+         * it's stored.
+         *
+         * @throws MetricConfigError if every ID is taken
+         */
+        void assign_id(Entry & entry) noexcept(false)
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_id_mutex);
+
+            entry.id = take_id();
+            const std::uint64_t index = index_of(entry.id);
+            m_id_chunks[std::size_t(index / ID_CHUNK_SIZE)].load()[std::size_t(index % ID_CHUNK_SIZE)].store(&entry);
+            m_id_count.store(std::max(m_id_count.load(), index + 1));
+        }
+
+        /*!
+         * Takes the ID with the lowest free index. Chunks of the ID table are
+         * allocated as they're needed and never move, so lookups by ID
+         * needn't lock. Must be called with the ID mutex locked, and the ID
+         * count updated afterwards.
+         *
+         * @throws MetricConfigError if every ID is taken
+         */
+        std::uint64_t take_id() noexcept(false)
+        {
+            if (!m_free_ids.empty())
+            {
+                const std::uint64_t id = m_free_ids.back();
+                m_free_ids.pop_back();
+
+                return id;
+            }
+
+            const std::uint64_t id = m_id_count.load(std::memory_order_relaxed);
+            if (id >= (ID_CHUNK_SIZE * ID_CHUNK_COUNT))
+            {
+                throw MetricConfigError("A registry can't hold more than " + std::to_string(ID_CHUNK_SIZE * ID_CHUNK_COUNT) + " metrics");
+            }
+
+            auto & chunk = m_id_chunks[std::size_t(id / ID_CHUNK_SIZE)];
+            if (chunk.load(std::memory_order_relaxed) == nullptr)
+            {
+                m_id_storage.emplace_back(new std::atomic<const Entry *>[ID_CHUNK_SIZE]);
+                chunk.store(m_id_storage.back().get());
+            }
+
+            return id;
+        }
+
+        /*!
+         * Makes the indexes of IDs free to reuse, each with its next
+         * generation. An index whose generations are used up is never
+         * reused.
+         */
+        void free_ids(const std::vector<std::uint64_t> & ids) noexcept(false)
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_id_mutex);
+
+            for (const auto id : ids)
+            {
+                if ((id >> INDEX_BITS) < GENERATION_LIMIT)
+                {
+                    m_free_ids.push_back(id + (std::uint64_t(1) << INDEX_BITS));
+                }
+            }
+
+            // Lowest index last
+            std::sort(m_free_ids.begin(), m_free_ids.end(), [](const std::uint64_t lhs, const std::uint64_t rhs)
+            {
+                return index_of(lhs) > index_of(rhs);
+            });
+        }
+
+        std::unique_ptr<Shard[]> m_shards; //!< The shards
+        std::atomic<std::uint64_t> m_version; //!< Incremented whenever an entry is added or removed
+        std::mutex m_id_mutex; //!< Serialises the assignment of IDs
+        std::unique_ptr<std::atomic<std::atomic<const Entry *> *>[]> m_id_chunks; //!< The ID table: chunks of entries, indexed by ID
+        std::vector<std::unique_ptr<std::atomic<const Entry *>[]> > m_id_storage; //!< Owns the chunks of the ID table
+        std::atomic<std::uint64_t> m_id_count; //!< Number of indexes ever assigned
+        std::vector<std::uint64_t> m_free_ids; //!< Next IDs of the indexes of reclaimed entries, highest index first
+        std::atomic<std::uint64_t> m_epoch; //!< The current epoch, whose parity chooses the reader count that new guards increment
+        std::unique_ptr<char[]> m_reader_storage; //!< Storage for the reader counts, with room to align them to a cache line
+        ReaderSlot * m_readers; //!< Reader counts, by ThreadSlot, in ::m_reader_storage
+        const std::size_t m_reader_mask; //!< Number of reader slots, less 1
+        std::mutex m_retired_mutex; //!< Protects the retired entries and tables
+        std::vector<std::unique_ptr<Entry> > m_retired_entries; //!< Removed entries, to be freed by reclaim()
+        std::vector<std::unique_ptr<Table> > m_retired_tables; //!< Replaced tables, to be freed by reclaim()
+        std::mutex m_reclaim_mutex; //!< Serialises reclamation
+
+    };
+
+    /*!
+     * @class Ingestion
+     *
+     * @brief Queues metric updates from producer threads for a background
+     * aggregator to apply
+     *
+     * While ingestion is enabled (see Registry::ingestion), each update made
+     * through this class is written as a compact record to a ring owned by
+     * the calling thread, and never touches the metric itself. A thread
+     * owned by the registry applies the records in batches, and the registry
+     * flushes all rings before each render. Each ring has a single producer
+     * and a single consumer, so neither side takes a lock.
+     *
+     * When a ring is full, the update is either dropped and counted, or
+     * applied to the metric directly, according to the overflow policy.
+     * While ingestion is disabled, every update is applied directly.
+     *
+     * Records from one thread are applied in the order in which they were
+     * made. Records from different threads are applied in no particular
+     * order, so the last of several concurrent assignments wins arbitrarily.
+     *
+     * @remarks thread-safe
+     */
+    class Ingestion
+    {
+    public:
+        /*!
+         * What happens to an update when the calling thread's ring is full.
+         */
+        enum class Overflow
+        {
+            DROP, //!< The update is discarded and counted
+            INLINE //!< The update is applied to the metric directly, and counted
+        };
+
+        /*!
+         * Constructor.
+         *
+         * @param[in]    time_function    Function used to determine the time. Used for testing - in production, use the default value
+         */
+        Ingestion(std::function<std::chrono::steady_clock::time_point ()> time_function = []{return std::chrono::steady_clock::now();}) noexcept
+        : m_time_function(time_function), m_serial(next_serial()), m_enabled(false), m_overflow(Overflow::DROP), m_capacity(1024),
+          m_interval(100), m_stop(false)
+        {
+        }
+
+        Ingestion(const Ingestion &) = delete;
+        Ingestion(Ingestion &&) = delete;
+        Ingestion & operator=(const Ingestion &) = delete;
+        Ingestion & operator=(Ingestion &&) = delete;
+
+        /*!
+         * Destructor. Stops the aggregator, applying any queued records.
+         */
+        ~Ingestion() noexcept
+        {
+            try
+            {
+                stop();
+            }
+            catch (...)
+            {
+            }
+
+            std::lock_guard<std::mutex> lock(m_rings_mutex);
+            for (auto & ring : m_rings)
+            {
+                ring->detached = true;
+            }
+        }
+
+        /*!
+         * Get whether updates are queued for the aggregator.
+         *
+         * @return @c true if ingestion is enabled
+         *
+         * @remarks thread-safe
+         */
+        bool enabled() const noexcept
+        {
+            return m_enabled;
+        }
+
+        /*!
+         * Adds to an unsigned metric.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    amount    The amount to add
+         *
+         * @remarks thread-safe
+         */
+        void add(const UintHandle & metric, const std::uint64_t amount) noexcept(false)
+        {
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                (*static_cast<NumberMetric<Metric::Kind::UINT, std::uint64_t> *>(r.metric)) += r.value.u;
+            });
+            record.value.u = amount;
+            submit(record);
+        }
+
+        /*!
+         * Adds to a signed metric.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    amount    The amount to add
+         *
+         * @remarks thread-safe
+         */
+        void add(const IntHandle & metric, const std::int64_t amount) noexcept(false)
+        {
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                (*static_cast<NumberMetric<Metric::Kind::INT, std::int64_t> *>(r.metric)) += r.value.i;
+            });
+            record.value.i = amount;
+            submit(record);
+        }
+
+        /*!
+         * Adds a sample to a mean metric.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    sample    The sample
+         *
+         * @remarks thread-safe
+         */
+        void add(const MeanHandle & metric, const double sample) noexcept(false)
+        {
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                static_cast<MeanMetric *>(r.metric)->add(r.value.f);
+            });
+            record.value.f = sample;
+            submit(record);
+        }
+
+        /*!
+         * Counts events in a windowed counter metric.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    count     Number of events
+         *
+         * @remarks thread-safe
+         */
+        void add(const WindowedHandle & metric, const std::uint64_t count = 1) noexcept(false)
+        {
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                static_cast<WindowedMetric *>(r.metric)->add(r.value.u);
+            });
+            record.value.u = count;
+            submit(record);
+        }
+
+        /*!
+         * Counts events in one category of a category counter metric.
+         *
+         * @param[in]    metric      The metric to update
+         * @param[in]    category    Index of the category
+         * @param[in]    count       Number of events
+         *
+         * @throws CategoryError if @c category is out of range
+         *
+         * @remarks thread-safe
+         */
+        void add(const CategoryHandle & metric, const std::size_t category, const std::uint64_t count = 1) noexcept(false)
+        {
+            if (category >= metric->categories().size())
+            {
+                throw CategoryError("Category " + std::to_string(category) + " is out of range for metric " + metric->name());
+            }
+
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                static_cast<CategoryMetric *>(r.metric)->add(r.index, r.value.u);
+            });
+            record.index = category;
+            record.value.u = count;
+            submit(record);
+        }
+
+        /*!
+         * Assigns a value to an unsigned metric.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    value     The new value
+         *
+         * @remarks thread-safe
+         */
+        void set(const UintHandle & metric, const std::uint64_t value) noexcept(false)
+        {
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                (*static_cast<NumberMetric<Metric::Kind::UINT, std::uint64_t> *>(r.metric)) = r.value.u;
+            });
+            record.value.u = value;
+            submit(record);
+        }
+
+        /*!
+         * Assigns a value to a signed metric.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    value     The new value
+         *
+         * @remarks thread-safe
+         */
+        void set(const IntHandle & metric, const std::int64_t value) noexcept(false)
+        {
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                (*static_cast<NumberMetric<Metric::Kind::INT, std::int64_t> *>(r.metric)) = r.value.i;
+            });
+            record.value.i = value;
+            submit(record);
+        }
+
+        /*!
+         * Assigns a value to a float metric.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    value     The new value
+         *
+         * @remarks thread-safe
+         */
+        void set(const FloatHandle & metric, const float value) noexcept(false)
+        {
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                (*static_cast<NumberMetric<Metric::Kind::FLOAT, float> *>(r.metric)) = float(r.value.f);
+            });
+            record.value.f = value;
+            submit(record);
+        }
+
+        /*!
+         * Adds a sample to an EWMA metric.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    sample    The sample
+         *
+         * @remarks thread-safe
+         */
+        void set(const EwmaHandle & metric, const float sample) noexcept(false)
+        {
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                (*static_cast<EwmaMetric *>(r.metric)) = float(r.value.f);
+            });
+            record.value.f = sample;
+            submit(record);
+        }
+
+        /*!
+         * Assigns a value to a string metric. The string is copied to the
+         * heap, so this is slower than the other updates.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    value     The new value
+         *
+         * @remarks thread-safe
+         */
+        void set(const StringHandle & metric, const std::string & value) noexcept(false)
+        {
+            Record record = make_record(metric.get(), &apply_string);
+            record.value.s = new std::string(value);
+            if (!submit(record))
+            {
+                delete record.value.s;
+            }
+        }
+
+        /*!
+         * Assigns a value to a boolean metric.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    value     The new value
+         *
+         * @remarks thread-safe
+         */
+        void set(const BoolHandle & metric, const bool value) noexcept(false)
+        {
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                (*static_cast<BoolMetric *>(r.metric)) = r.value.b;
+            });
+            record.value.b = value;
+            submit(record);
+        }
+
+        /*!
+         * Transitions a state machine metric.
+         *
+         * @param[in]    metric    The metric to update
+         * @param[in]    state     Index of the new state
+         *
+         * @throws CategoryError if @c state is out of range
+         *
+         * @remarks thread-safe
+         */
+        void set(const StateHandle & metric, const std::size_t state) noexcept(false)
+        {
+            if (state >= metric->states().size())
+            {
+                throw CategoryError("State " + std::to_string(state) + " is out of range for metric " + metric->name());
+            }
+
+            Record record = make_record(metric.get(), [](Record & r)
+            {
+                static_cast<StateMetric *>(r.metric)->transition(r.index);
+            });
+            record.index = state;
+            submit(record);
+        }
+
+        /*!
+         * Applies every queued record. Called by the registry before each
+         * render.
+         *
+         * @remarks thread-safe
+         */
+        void flush() noexcept(false)
+        {
+            // Only one thread at a time consumes from the rings
+            std::lock_guard<std::mutex> drain_lock(m_drain_mutex);
+
+            std::vector<std::shared_ptr<Ring> > rings;
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_rings_mutex);
+                rings = m_rings;
+            }
+
+            const auto now = m_time_function().time_since_epoch().count();
+            std::uint64_t pending = 0;
+            auto oldest = now;
+            for (auto & ring : rings)
+            {
+                ring->drain(pending, oldest);
+            }
+
+            if (m_occupancy)
+            {
+                (*m_occupancy) = pending;
+                (*m_lag) = float(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::duration(now - oldest)).count()) / 1000.0f;
+            }
+        }
+
+    private:
+        friend class Registry;
+
+        /*!
+         * An update queued for the aggregator.
+         */
+        struct Record
+        {
+            void (*apply)(Record &); //!< Applies the update to the metric
+            Metric * metric; //!< The metric to update
+            std::size_t index; //!< Category or state index, for category counter and state machine metrics
+            union
+            {
+                std::uint64_t u;
+                std::int64_t i;
+                double f;
+                bool b;
+                std::string * s; //!< Owned by the record until applied
+            } value; //!< The operand of the update
+        };
+
+        /*!
+         * A fixed-capacity ring of records written by one thread and read by
+         * the aggregator. The producer's and consumer's positions are on
+         * separate cache lines.
+         */
+        struct Ring
+        {
+            /*!
+             * Constructor.
+             *
+             * @param[in]    capacity    Number of records. Must be a power of 2
+             */
+            Ring(const std::size_t capacity) noexcept(false)
+            : records(new Record[capacity]), mask(capacity - 1), tail(0), cached_head(0), head(0), idle(true), pending_since(0),
+              owned(true), detached(false)
+            {
+            }
+
+            /*!
+             * Destructor. Frees the strings of records that were never
+             * applied.
+             */
+            ~Ring() noexcept
+            {
+                for (auto position = head.load(); position != tail.load(); ++position)
+                {
+                    if (records[position & mask].apply == &apply_string)
+                    {
+                        delete records[position & mask].value.s;
+                    }
+                }
+            }
+
+            /*!
+             * Appends a record. Called by the owning thread only.
+             *
+             * @param[in]    record           The record
+             * @param[in]    time_function    Function used to determine the time
+             *
+             * @return @c false if the ring is full
+             */
+            bool push(const Record & record, const std::function<std::chrono::steady_clock::time_point ()> & time_function) noexcept(false)
+            {
+                const auto position = tail.load(std::memory_order_relaxed);
+                if ((position - cached_head) > mask)
+                {
+                    cached_head = head.load(std::memory_order_acquire);
+                    if ((position - cached_head) > mask)
+                    {
+                        return false;
+                    }
+                }
+
+                records[position & mask] = record;
+
+                if (idle.load(std::memory_order_relaxed))
+                {
+                    idle.store(false, std::memory_order_relaxed);
+                    pending_since.store(time_function().time_since_epoch().count(), std::memory_order_relaxed);
+                }
+
+                tail.store(position + 1, std::memory_order_release);
+                return true;
+            }
+
+            /*!
+             * Applies the records in the ring. Called with the drain mutex
+             * held only.
+             *
+             * @param[in,out]    pending    Incremented by the number of records found
+             * @param[in,out]    oldest     Lowered to the time at which the oldest record found was queued, if earlier
+             */
+            void drain(std::uint64_t & pending, std::chrono::steady_clock::duration::rep & oldest) noexcept(false)
+            {
+                idle.store(true);
+                const auto since = pending_since.load();
+                const auto end = tail.load(std::memory_order_acquire);
+                auto position = head.load(std::memory_order_relaxed);
+                if (position == end)
+                {
+                    return;
+                }
+
+                pending += (end - position);
+                oldest = std::min(oldest, since);
+
+                while (position != end)
+                {
+                    Record & record = records[position & mask];
+                    ++position;
+
+                    try
+                    {
+                        record.apply(record);
+                    }
+                    catch (...)
+                    {
+                        // A record that can't be applied is discarded, so
+                        // that it doesn't hold up the rest
+                    }
+
+                    // Free space for the producer as we go
+                    if ((position & 63) == 0)
+                    {
+                        head.store(position, std::memory_order_release);
+                    }
+                }
+
+                head.store(position, std::memory_order_release);
+            }
+
+            std::unique_ptr<Record[]> records; //!< The records
+            const std::uint64_t mask; //!< Capacity, less 1
+            char padding0[64]; //!< Padding to separate the producer's position from the records pointer
+            std::atomic<std::uint64_t> tail; //!< Position of the next record to be written
+            std::uint64_t cached_head; //!< The producer's last view of the consumer's position
+            char padding1[64]; //!< Padding to separate the producer's position from the consumer's
+            std::atomic<std::uint64_t> head; //!< Position of the next record to be applied
+            char padding2[64]; //!< Padding to separate the consumer's position from the flags
+            std::atomic<bool> idle; //!< Was the ring drained since it was last written?
+            std::atomic<std::chrono::steady_clock::duration::rep> pending_since; //!< Time of the first write after the ring was last drained
+            std::atomic<bool> owned; //!< Is a thread writing to the ring?
+            std::atomic<bool> detached; //!< Has the ingestion object that created the ring been destroyed?
+        };
+
+        /*!
+         * The rings a thread writes to, one per ingestion object.
+         */
+        struct Bindings
+        {
+            /*!
+             * Destructor. Releases the thread's rings for use by other
+             * threads.
+             */
+            ~Bindings() noexcept
+            {
+                for (auto & binding : list)
+                {
+                    binding.second->owned.store(false, std::memory_order_release);
+                }
+            }
+
+            std::vector<std::pair<std::uint64_t, std::shared_ptr<Ring> > > list; //!< Serial of each ingestion object, and the thread's ring
+        };
+
+        /*!
+         * Applies a string record, freeing its copy of the string.
+         */
+        static void apply_string(Record & record) noexcept(false)
+        {
+            std::unique_ptr<std::string> value(record.value.s);
+            (*static_cast<StringMetric *>(record.metric)) = (*value);
+        }
+
+        /*!
+         * Creates a record.
+         */
+        static Record make_record(Metric * metric, void (*apply)(Record &)) noexcept
+        {
+            Record record;
+            record.apply = apply;
+            record.metric = metric;
+            record.index = 0;
+            record.value.u = 0;
+            return record;
+        }
+
+        /*!
+         * Get a number that identifies an ingestion object for the life of the
+         * process.
+         */
+        static std::uint64_t next_serial() noexcept
+        {
+            static std::atomic<std::uint64_t> serial(0);
+            return serial.fetch_add(1);
+        }
+
+        /*!
+         * Get the calling thread's ring, creating (or adopting the ring of an
+         * exited thread) on first use.
+         */
+        Ring & producer_ring() noexcept(false)
+        {
+            thread_local Bindings bindings;
+
+            for (const auto & binding : bindings.list)
+            {
+                if (binding.first == m_serial)
+                {
+                    return *(binding.second);
+                }
+            }
+
+            std::shared_ptr<Ring> ring;
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_rings_mutex);
+
+                for (auto & candidate : m_rings)
+                {
+                    bool expected = false;
+                    if (candidate->owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    {
+                        ring = candidate;
+                        break;
+                    }
+                }
+
+                if (!ring)
+                {
+                    ring = std::make_shared<Ring>(m_capacity);
+                    m_rings.push_back(ring);
+                }
+            }
+
+            // Forget the rings of destroyed ingestion objects
+            bindings.list.erase(std::remove_if(bindings.list.begin(), bindings.list.end(), [](const std::pair<std::uint64_t, std::shared_ptr<Ring> > & binding)
+            {
+                return binding.second->detached.load();
+            }), bindings.list.end());
+
+            bindings.list.push_back(std::make_pair(m_serial, ring));
+            return *ring;
+        }
+
+        /*!
+         * Queues a record, or applies it directly if ingestion is disabled or
+         * the overflow policy says so.
+         *
+         * @return @c false if the record was dropped
+         */
+        bool submit(Record & record) noexcept(false)
+        {
+            if (!m_enabled)
+            {
+                record.apply(record);
+                return true;
+            }
+
+            if (producer_ring().push(record, m_time_function))
+            {
+                // Make sure a record queued as ingestion is disabled isn't stranded
+                if (!m_enabled)
+                {
+                    flush();
+                }
+
+                return true;
+            }
+
+            if (m_overflow == Overflow::INLINE)
+            {
+                record.apply(record);
+                ++(*m_inline);
+                return true;
+            }
+
+            ++(*m_dropped);
+            return false;
+        }
+
+        /*!
+         * Sets the metrics that describe ingestion. Called by the registry
+         * with the configuration mutex held.
+         */
+        void instrument(UintHandle occupancy, FloatHandle lag, UintHandle dropped, UintHandle inline_applied) noexcept
+        {
+            std::lock_guard<std::mutex> drain_lock(m_drain_mutex);
+
+            m_occupancy = occupancy;
+            m_lag = lag;
+            m_dropped = dropped;
+            m_inline = inline_applied;
+        }
+
+        /*!
+         * Starts (or restarts) the aggregator. Called by the registry with
+         * the configuration mutex held.
+         */
+        void start(const std::size_t capacity, const Overflow overflow, const std::chrono::milliseconds interval) noexcept(false)
+        {
+            stop();
+
+            m_capacity = capacity;
+            m_overflow = overflow;
+            m_interval = interval;
+            m_stop = false;
+            m_aggregator = std::thread(std::bind(&Ingestion::aggregator_logic, this));
+            m_enabled = true;
+        }
+
+        /*!
+         * Stops the aggregator, if it's running, and applies any queued
+         * records. Afterwards, updates are applied directly.
+         */
+        void stop() noexcept(false)
+        {
+            m_enabled = false;
+
+            if (m_aggregator.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_cond_mutex);
+                    m_stop = true;
+                }
+
+                m_stop_cond.notify_one();
+                m_aggregator.join();
+            }
+
+            flush();
+        }
+
+        void aggregator_logic() noexcept
+        {
+            std::unique_lock<std::mutex> lock(m_cond_mutex);
+            while (!m_stop)
+            {
+                m_stop_cond.wait_for(lock, m_interval, [this]{return m_stop;});
+
+                lock.unlock();
+                try
+                {
+                    flush();
+                }
+                catch (...)
+                {
+                }
+                lock.lock();
+            }
+        }
+
+        std::function<std::chrono::steady_clock::time_point ()> m_time_function; //!< Function used to determine the time
+        const std::uint64_t m_serial; //!< Identifies the object for the life of the process
+        std::atomic<bool> m_enabled; //!< Are updates queued?
+        std::atomic<Overflow> m_overflow; //!< What happens to updates when a ring is full
+        std::atomic<std::size_t> m_capacity; //!< Capacity of rings created from now on
+        std::chrono::milliseconds m_interval; //!< Time between aggregator passes
+        std::mutex m_config_mutex; //!< Serialises configuration changes
+        std::mutex m_rings_mutex; //!< Mutex for the ring list
+        std::vector<std::shared_ptr<Ring> > m_rings; //!< Every ring created, in order of creation
+        std::mutex m_drain_mutex; //!< Held by the thread consuming records
+        UintHandle m_occupancy; //!< Records found at the last flush
+        FloatHandle m_lag; //!< Age of the oldest record found at the last flush
+        UintHandle m_dropped; //!< Records dropped because a ring was full
+        UintHandle m_inline; //!< Records applied directly because a ring was full
+        bool m_stop; //!< Flag indicating whether or not the aggregator should terminate
+        std::thread m_aggregator; //!< Thread in which records are applied
+        std::condition_variable m_stop_cond; //!< Condition variable used to notify the aggregator of a stop command
+        std::mutex m_cond_mutex; //!< Condition variable mutex
+    };
+
+    /*!
+     * @struct MetricSpec
+     *
+     * @brief Describes a metric to be created by Registry::create_metrics()
+     */
+    struct MetricSpec
+    {
+        std::string name; //!< Name of the metric. This must be unique with respect to all metrics in the registry
+        std::string unit; //!< Unit string to associate with the metric
+        std::string description; //!< Description of the metric
+    };
+
+    /*!
+     * @class Registry
+     *
+     * @brief Creates, tracks and renders metrics
+     *
+     * You probably only need a single Registry object for your entire
+     * application. It serves as a factory and clearing house for metric
+     * objects, providing helper methods to create, look up and render metrics.
+     *
+     * @remarks thread-safe
+     */
+    class Registry
+    {
+    public:
+        /*!
+         * @class RenderSchedule
+         *
+         * @brief Schedules a regular render operation to be performed every @em n seconds
+         *
+         * @remarks thread-safe
+         */
+        class RenderSchedule
+        {
+        public:
+            /*!
+             * Constructor.
+             *
+             * @param[in]    registry    Registry object containing the metrics to render
+             * @param[in]    renderer    The renderer to use in each render operation
+             * @param[in]    interval    Number of seconds between scheduled renders
+             */
+            RenderSchedule(Registry & registry, Renderer & renderer, const std::chrono::seconds interval) noexcept(false)
+            : m_registry(registry), m_renderer(renderer), m_stop(false), m_interval(interval), m_executor(std::bind(&RenderSchedule::executor_logic, this))
+            {
+            }
+
+            ~RenderSchedule() noexcept
+            {
+                try
+                {
+                    stop();
+                }
+                catch(...)
+                {
+                }
+            }
+
+            /*!
+             * Stops the scheduled render operation if it's active. Any thread
+             * spawned by the object is stopped.
+             */
+            void stop() noexcept(false)
+            {
+                m_stop = true;
+                m_stop_cond.notify_one();
+                m_executor.join();
+            }
+
+        private:
+            void executor_logic() noexcept(false)
+            {
+                do
+                {
+                    std::unique_lock<std::mutex> lock(m_cond_mutex);
+
+                    auto timeout_when = std::chrono::steady_clock::now() + m_interval;
+                    m_stop_cond.wait_until(lock, timeout_when, [&timeout_when, this](){return ((std::chrono::steady_clock::now() >= timeout_when) || (m_stop));});
+
+                    if (m_stop)
+                    {
+                        break;
+                    }
+
+                    m_registry.render(m_renderer);
+                }
+                while(!m_stop);
+            }
+
+            Registry & m_registry; //!< The registry managing the metrics to be rendered
+            Renderer & m_renderer; //!< The renderer to be used after each interval
+            std::atomic<bool> m_stop; //!< Flag indicating whether or not the scheduler should terminate
+            const std::chrono::seconds m_interval; //!< Number of seconds between each render
+            std::thread m_executor; //!< Thread in which asynchronous render operations should be performed
+            mutable std::condition_variable m_stop_cond; //!< Condition variable used to notify the scheduler of a stop command
+            mutable std::mutex m_cond_mutex; //!< Condition variable mutex
+
+        };
+
+        /*!
+         * Constructor.
+         *
+         * @param[in]    time_function    Function used to determine the time. Used for testing - in production, use the default value
+         */
+        Registry(std::function<std::chrono::steady_clock::time_point ()> time_function = []{return std::chrono::steady_clock::now();}) noexcept
+        : m_time_function(time_function), m_serial(next_serial()), m_parallel_min_metrics(10000),
+          m_parallel_max_threads(std::max(1u, std::min(4u, std::thread::hardware_concurrency()))),
+          m_expressions(std::make_shared<ExpressionPool>()), m_roll_up(false), m_roll_up_version(std::numeric_limits<std::uint64_t>::max()),
+          m_adaptive_sharding(false), m_contention_threshold(1000), m_shard_by(ShardBy::THREAD),
+          m_lookup_cache(false), m_generation(std::make_shared<std::atomic<std::uint64_t> >(0)),
+          m_ingestion(std::make_shared<Ingestion>(time_function))
+        {
+        }
+
+        /*!
+         * A record of an unsigned or signed metric's promotion to a sharded
+         * representation.
+         *
+         * @see Registry::adaptive_sharding
+         */
+        struct Promotion
+        {
+            std::string name; //!< Name of the metric
+            std::chrono::steady_clock::time_point time; //!< Time at which the metric was promoted
+            ShardBy by; //!< How the metric's shards are chosen
+        };
+
+        /*!
+         * Configures how metric calculations are spread across threads
+         * during render operations. Before rendering, metrics are calculated
+         * in dependency order (so that, for example, a rate metric is
+         * calculated after the sum whose rate it tracks). When a render
+         * covers at least @c min_metrics metrics, calculation is split
+         * between up to @c max_threads threads, including the rendering
+         * thread. By default, renders of 10000 or more metrics use up to 4
+         * threads.
+         *
+         * Hooks triggered by calculations may be called from any of these
+         * threads.
+         *
+         * @param[in]    min_metrics    Minimum number of metrics in a render operation for calculations to be performed in parallel
+         * @param[in]    max_threads    Maximum number of threads to use. Specify 1 to always calculate metrics in the rendering thread
+         *
+         * @remarks thread-safe
+         */
+        void parallel_calculation(const std::size_t min_metrics, const std::size_t max_threads) noexcept
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_render_mutex);
+
+            m_parallel_min_metrics = min_metrics;
+            m_parallel_max_threads = std::max(std::size_t(1), max_threads);
+        }
+
+        /*!
+         * Sets whether unsigned and signed metrics are promoted to a sharded
+         * representation when their updates become contended. Applies to
+         * existing metrics and to those created afterwards. Metrics that are
+         * never contended keep their compact representation. Metrics that
+         * were promoted stay promoted if this is later disabled.
+         *
+         * @param[in]    enabled                 @c true to promote contended metrics
+         * @param[in]    contention_threshold    Number of failed updates of a metric between renders that triggers its promotion
+         * @param[in]    by                      How promoted metrics' shards are chosen
+         *
+         * @see NumberMetric::adaptive
+         * @see Registry::promotions
+         *
+         * @remarks thread-safe
+         */
+        void adaptive_sharding(const bool enabled, const std::uint64_t contention_threshold = 1000, const ShardBy by = ShardBy::THREAD) noexcept
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_registry_mutex);
+
+            m_adaptive_sharding = enabled;
+            m_contention_threshold = contention_threshold;
+            m_shard_by = by;
+
+            for (auto & metric : m_uint_metrics)
+            {
+                metric->adaptive(enabled, contention_threshold, by);
+            }
+
+            for (auto & metric : m_int_metrics)
+            {
+                metric->adaptive(enabled, contention_threshold, by);
+            }
+        }
+
+        /*!
+         * Get the unsigned and signed metrics that have been promoted to a
+         * sharded representation, whether by adaptive sharding or by calling
+         * NumberMetric::promote, in order of promotion. Use this to find the
+         * metrics that should be promoted permanently on creation.
+         *
+         * @return promoted metrics and their times of promotion
+         *
+         * @remarks thread-safe
+         */
+        std::vector<Promotion> promotions() const noexcept(false)
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_registry_mutex);
+
+            std::vector<Promotion> result;
+            for (const auto & metric : m_uint_metrics)
+            {
+                if (metric->promoted())
+                {
+                    Promotion promotion = {metric->name(), metric->promoted_at(), metric->shard_by()};
+                    result.push_back(promotion);
+                }
+            }
+
+            for (const auto & metric : m_int_metrics)
+            {
+                if (metric->promoted())
+                {
+                    Promotion promotion = {metric->name(), metric->promoted_at(), metric->shard_by()};
+                    result.push_back(promotion);
+                }
+            }
+
+            std::stable_sort(result.begin(), result.end(), [](const Promotion & lhs, const Promotion & rhs)
+            {
+                return lhs.time < rhs.time;
+            });
+
+            return result;
+        }
+
+        /*!
+         * Sets whether updates made through ::ingest are queued for a
+         * background aggregator. While enabled, each producer thread writes
+         * its updates to its own ring of @c capacity records, and a thread
+         * owned by the registry applies them every @c interval, and before
+         * each render. On first use, creates the following metrics:
+         *
+         * - @c measuro.ingestion.occupancy: records found at the last flush
+         * - @c measuro.ingestion.lag: age, in milliseconds, of the oldest record found at the last flush
+         * - @c measuro.ingestion.dropped: updates dropped because a ring was full
+         * - @c measuro.ingestion.inline: updates applied directly because a ring was full
+         *
+         * Disabling ingestion applies every queued record before returning.
+         *
+         * @param[in]    enabled     @c true to queue updates
+         * @param[in]    capacity    Number of records in each ring created from now on. Must be a power of 2
+         * @param[in]    overflow    What happens to an update when a ring is full
+         * @param[in]    interval    Time between aggregator passes
+         *
+         * @throws MetricConfigError if @c capacity is not a power of 2
+         *
+         * @see Ingestion
+         *
+         * @remarks thread-safe
+         */
+        void ingestion(const bool enabled, const std::size_t capacity = 1024, const Ingestion::Overflow overflow = Ingestion::Overflow::DROP,
+                const std::chrono::milliseconds interval = std::chrono::milliseconds(100)) noexcept(false)
+        {
+            if ((capacity == 0) || ((capacity & (capacity - 1)) != 0))
+            {
+                throw MetricConfigError("Ingestion ring capacity must be a power of 2");
+            }
+
+            std::lock_guard<std::mutex> lock(m_ingestion->m_config_mutex);
+
+            if (!enabled)
+            {
+                m_ingestion->stop();
+                return;
+            }
+
+            if (!m_ingestion->m_occupancy)
+            {
+                m_ingestion->instrument(
+                        create_metric(UINT::KIND, "measuro.ingestion.occupancy", "record(s)", "Records awaiting ingestion at the last flush"),
+                        create_metric(FLOAT::KIND, "measuro.ingestion.lag", "ms", "Age of the oldest record awaiting ingestion at the last flush"),
+                        create_metric(UINT::KIND, "measuro.ingestion.dropped", "record(s)", "Updates dropped because an ingestion ring was full"),
+                        create_metric(UINT::KIND, "measuro.ingestion.inline", "record(s)", "Updates applied directly because an ingestion ring was full"));
+            }
+
+            m_ingestion->start(capacity, overflow, interval);
+        }
+
+        /*!
+         * Get whether updates made through ::ingest are queued for a
+         * background aggregator.
+         *
+         * @return @c true if ingestion is enabled
+         *
+         * @remarks thread-safe
+         */
+        bool ingestion() const noexcept
+        {
+            return m_ingestion->enabled();
+        }
+
+        /*!
+         * Get the object through which updates are queued for the background
+         * aggregator, e.g. @c registry.ingest().add(counter, 1). While
+         * ingestion is disabled, updates made through it are applied
+         * directly.
+         *
+         * @return the registry's ingestion object
+         *
+         * @see Registry::ingestion
+         *
+         * @remarks thread-safe
+         */
+        Ingestion & ingest() const noexcept
+        {
+            return *m_ingestion;
+        }
+
+        /*!
+         * Sets whether the registry rolls up numeric metrics through their
+         * dotted names. In roll-up mode, each render also renders every
+         * dotted prefix of the rendered metrics' names (e.g. "net" and
+         * "net.eth0" for "net.eth0.rx_bytes") as the sum of the unsigned,
+         * signed, float, rate, sum and block counter metrics beneath it. The sums are worked
+         * out in a single bottom-up pass over a name tree that is rebuilt
+         * only when metrics are added. They are not metrics in their own
+         * right: they can't be looked up, and they're never updated outside
+         * of a render. A prefix that is itself the name of a metric is not
+         * rolled up.
+         *
+         * @param[in]    enabled    @c true to roll up metrics
+         *
+         * @see RollUpMetric
+         *
+         * @remarks thread-safe
+         */
+        void roll_up(const bool enabled) noexcept
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_registry_mutex);
+
+            m_roll_up = enabled;
+        }
+
+        /*!
+         * Get whether the registry rolls up numeric metrics through their
+         * dotted names.
+         *
+         * @return @c true if metrics are rolled up
+         *
+         * @remarks thread-safe
+         */
+        bool roll_up() const noexcept
+        {
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_registry_mutex);
+
+            return m_roll_up;
+        }
+
+        /*!
+         * Sets whether lookups with ::resolve(const MetricKey) are served
+         * from per-thread caches. Each thread that resolves metrics keeps a
+         * small cache of the metrics it has found, so a repeated lookup
+         * neither searches the registry nor writes memory shared with other
+         * threads. Lookups that return a handle (the function call
+         * operators) aren't cached, as copying the handle from the registry
+         * costs as much as finding it. The caches are invalidated whenever a
+         * metric is removed.
+         *
+         * A cache refers to the metrics in it by ID, without keeping them
+         * alive, so removing a metric frees it as usual.
+         *
+         * @param[in]    enabled    @c true to cache lookups
+         *
+         * @remarks thread-safe
+         */
+        void lookup_cache(const bool enabled) noexcept
+        {
+            m_lookup_cache.store(enabled);
+        }
+
+        /*!
+         * Get whether lookups with ::resolve(const MetricKey) are served from
+         * per-thread caches.
+         *
+         * @return @c true if lookups are cached
+         *
+         * @remarks thread-safe
+         */
+        bool lookup_cache() const noexcept
+        {
+            return m_lookup_cache.load();
+        }
+
+        /*!
+         * Creates an unsigned integer metric.
+         *
+         * @param[in]    k                     Must be UINT::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    initial_value         Value with which to initialise the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    sampling              How increments of the metric are sampled. By default, every increment is recorded. @see Sampling
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        UintHandle create_metric(const UINT k, const std::string name, const std::string unit, const std::string description,
+                const std::uint64_t initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000),
+                const Sampling sampling = Sampling()) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<NumberMetric<Metric::Kind::UINT, std::uint64_t> >(name, unit, description, m_time_function, initial_value, hook_rate_limit, sampling);
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_registry_mutex);
+                metric->adaptive(m_adaptive_sharding, m_contention_threshold, m_shard_by);
+            }
+            register_metric<NumberMetric<Metric::Kind::UINT, std::uint64_t> >(name, metric, m_uint_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a signed integer metric.
+         *
+         * @param[in]    k                     Must be INT::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    initial_value         Value with which to initialise the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    sampling              How increments of the metric are sampled. By default, every increment is recorded. @see Sampling
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        IntHandle create_metric(const INT k, const std::string name, const std::string unit, const std::string description,
+                const std::uint64_t initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000),
+                const Sampling sampling = Sampling()) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<NumberMetric<Metric::Kind::INT, std::int64_t> >(name, unit, description, m_time_function, initial_value, hook_rate_limit, sampling);
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_registry_mutex);
+                metric->adaptive(m_adaptive_sharding, m_contention_threshold, m_shard_by);
+            }
+            register_metric<NumberMetric<Metric::Kind::INT, std::int64_t> >(name, metric, m_int_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a float metric.
+         *
+         * @param[in]    k                     Must be FLOAT::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    initial_value         Value with which to initialise the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        FloatHandle create_metric(const FLOAT k, const std::string name, const std::string unit, const std::string description,
+                const float initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<NumberMetric<Metric::Kind::FLOAT, float> >(name, unit, description, m_time_function, initial_value, hook_rate_limit);
+            register_metric<NumberMetric<Metric::Kind::FLOAT, float> >(name, metric, m_float_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates many unsigned integer metrics at once, each with an
+         * initial value of 0. Names are checked before any metric is created,
+         * the metrics share a single allocation and they're added to the
+         * registry under a single acquisition of its lock. This is much
+         * faster than creating the metrics one by one.
+         *
+         * The metrics share ownership of their allocation, so it's freed
+         * only when the last of their handles is destroyed.
+         *
+         * @param[in]    k                  Must be UINT::KIND
+         * @param[in]    specs              Names, units and descriptions of the metrics
+         * @param[in]    hook_rate_limit    Minimum number of milliseconds between hook operations triggered by changes to a metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return handles to the created metrics, in the same order as specs
+         *
+         * @throws MetricNameError if a name is used more than once, or is already taken. No metrics are created
+         *
+         * @remarks thread-safe
+         */
+        std::vector<UintHandle> create_metrics(const UINT k, const std::vector<MetricSpec> & specs,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            return create_bulk<UintHandle::element_type>(specs, hook_rate_limit, m_uint_metrics, [this](UintHandle::element_type & metric)
+            {
+                metric.adaptive(m_adaptive_sharding, m_contention_threshold, m_shard_by);
+            });
+        }
+
+        /*!
+         * Creates many signed integer metrics at once, each with an initial
+         * value of 0.
+         *
+         * @see Registry::create_metrics(const UINT, const std::vector<MetricSpec> &, const std::chrono::milliseconds)
+         */
+        std::vector<IntHandle> create_metrics(const INT k, const std::vector<MetricSpec> & specs,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            return create_bulk<IntHandle::element_type>(specs, hook_rate_limit, m_int_metrics, [this](IntHandle::element_type & metric)
+            {
+                metric.adaptive(m_adaptive_sharding, m_contention_threshold, m_shard_by);
+            });
+        }
+
+        /*!
+         * Creates many float metrics at once, each with an initial value of
+         * 0.
+         *
+         * @see Registry::create_metrics(const UINT, const std::vector<MetricSpec> &, const std::chrono::milliseconds)
+         */
+        std::vector<FloatHandle> create_metrics(const FLOAT k, const std::vector<MetricSpec> & specs,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            return create_bulk<FloatHandle::element_type>(specs, hook_rate_limit, m_float_metrics, [](FloatHandle::element_type &)
+            {
+            });
+        }
+
+        /*!
+         * Get an unsigned integer metric, creating it if it doesn't exist.
+         * This suits metrics whose names are only known at runtime, and is
+         * much cheaper than looking a metric up and creating it when the
+         * lookup throws MetricNameError.
+         *
+         * If the metric exists, no lock is taken and nothing is allocated:
+         * the unit and description are taken as null-terminated strings, such
+         * as string literals, and are only copied (like the other arguments,
+         * only used) if the metric is created. If several threads race to
+         * create the same metric, one creates it and all of them get a handle
+         * to it.
+         *
+         * @param[in]    k                     Must be UINT::KIND
+         * @param[in]    name                  Name of the metric
+         * @param[in]    unit                  Null-terminated unit string to associate with the metric, if it's created
+         * @param[in]    description           Null-terminated description of the metric, if it's created
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric, if it's created
+         * @param[in]    sampling              How increments of the metric are sampled, if it's created. @see Sampling
+         *
+         * @return a handle to the found or created metric
+         *
+         * @throws MetricTypeError if a metric of another kind has the name
+         *
+         * @remarks thread-safe
+         */
+        UintHandle get_or_create(const UINT k, const MetricKey name, const char * unit, const char * description,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), const Sampling sampling = Sampling()) noexcept(false)
+        {
+            (void)(k);
+
+            {
+                MetricIndex::Guard guard(m_index);
+                auto entry = find_as(name, Metric::Kind::UINT);
+                if (entry != nullptr)
+                {
+                    return std::static_pointer_cast<UintHandle::element_type>(entry->metric);
+                }
+            }
+
+            auto metric = std::make_shared<UintHandle::element_type>(name.str(), std::string(unit), std::string(description), m_time_function, 0, hook_rate_limit, sampling);
+            return register_or_adopt<UintHandle::element_type>(name, metric, m_uint_metrics, [this](UintHandle::element_type & created)
+            {
+                created.adaptive(m_adaptive_sharding, m_contention_threshold, m_shard_by);
+            });
+        }
+
+        /*!
+         * Get a signed integer metric, creating it if it doesn't exist.
+         *
+         * @see Registry::get_or_create(const UINT, const MetricKey, const char *, const char *, const std::chrono::milliseconds, const Sampling)
+         */
+        IntHandle get_or_create(const INT k, const MetricKey name, const char * unit, const char * description,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), const Sampling sampling = Sampling()) noexcept(false)
+        {
+            (void)(k);
+
+            {
+                MetricIndex::Guard guard(m_index);
+                auto entry = find_as(name, Metric::Kind::INT);
+                if (entry != nullptr)
+                {
+                    return std::static_pointer_cast<IntHandle::element_type>(entry->metric);
+                }
+            }
+
+            auto metric = std::make_shared<IntHandle::element_type>(name.str(), std::string(unit), std::string(description), m_time_function, 0, hook_rate_limit, sampling);
+            return register_or_adopt<IntHandle::element_type>(name, metric, m_int_metrics, [this](IntHandle::element_type & created)
+            {
+                created.adaptive(m_adaptive_sharding, m_contention_threshold, m_shard_by);
+            });
+        }
+
+        /*!
+         * Get a float metric, creating it if it doesn't exist.
+         *
+         * @see Registry::get_or_create(const UINT, const MetricKey, const char *, const char *, const std::chrono::milliseconds, const Sampling)
+         */
+        FloatHandle get_or_create(const FLOAT k, const MetricKey name, const char * unit, const char * description,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            {
+                MetricIndex::Guard guard(m_index);
+                auto entry = find_as(name, Metric::Kind::FLOAT);
+                if (entry != nullptr)
+                {
+                    return std::static_pointer_cast<FloatHandle::element_type>(entry->metric);
+                }
+            }
+
+            auto metric = std::make_shared<FloatHandle::element_type>(name.str(), std::string(unit), std::string(description), m_time_function, 0, hook_rate_limit);
+            return register_or_adopt<FloatHandle::element_type>(name, metric, m_float_metrics, [](FloatHandle::element_type &)
+            {
+            });
+        }
+
+        /*!
+         * Creates a metric that tracks the rate of change of an unsigned metric.
+         *
+         * @param[in]    k1                    Must be RATE::KIND
+         * @param[in]    k2                    Must be UINT::KIND
+         * @param[in]    distance              The metric whose rate of change is to be tracked
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
+         * @param[in]    description           Description of the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        RateOfUintHandle create_metric(const RATE k1, const UINT k2,
+                UintHandle & distance, const std::string name, const std::string unit, const std::string description,
+                std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+
+            auto metric = std::make_shared<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
+            register_metric<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that tracks the rate of change of an signed metric.
+         *
+         * @param[in]    k1                    Must be RATE::KIND
+         * @param[in]    k2                    Must be INT::KIND
+         * @param[in]    distance              The metric whose rate of change is to be tracked
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
+         * @param[in]    description           Description of the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        RateOfIntHandle create_metric(const RATE k1, const INT k2,
+                IntHandle & distance, const std::string name, const std::string unit, const std::string description,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+
+            auto metric = std::make_shared<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
+            register_metric<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that tracks the rate of change of an float metric.
+         *
+         * @param[in]    k1                    Must be RATE::KIND
+         * @param[in]    k2                    Must be FLOAT::KIND
+         * @param[in]    distance              The metric whose rate of change is to be tracked
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
+         * @param[in]    description           Description of the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        RateOfFloatHandle create_metric(const RATE k1, const FLOAT k2,
+                FloatHandle & distance, const std::string name, const std::string unit, const std::string description,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+
+            auto metric = std::make_shared<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
+            register_metric<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that tracks the rate of change of a sum of unsigned
+         * metrics.
+         *
+         * @param[in]    k1                    Must be RATE::KIND
+         * @param[in]    k2                    Must be SUM::KIND
+         * @param[in]    k3                    Must be UINT::KIND
+         * @param[in]    distance              The metric whose rate of change is to be tracked
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
+         * @param[in]    description           Description of the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        RateOfSumOfUintHandle create_metric(const RATE k1, const SUM k2, const UINT k3,
+                SumOfUintHandle & distance, const std::string name, const std::string unit, const std::string description,
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+            (void)(k3);
+
+            auto metric = std::make_shared<RateMetric<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
+            register_metric<RateMetric<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that tracks the rate of change of a sum of signed
+         * metrics.
+         *
+         * @param[in]    k1                    Must be RATE::KIND
+         * @param[in]    k2                    Must be SUM::KIND
+         * @param[in]    k3                    Must be INT::KIND
+         * @param[in]    distance              The metric whose rate of change is to be tracked
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
+         * @param[in]    description           Description of the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        RateOfSumOfIntHandle create_metric(const RATE k1, const SUM k2, const INT k3,
+                SumOfIntHandle & distance, const std::string name, const std::string unit, const std::string description,
+                std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+            (void)(k3);
+
+            auto metric = std::make_shared<RateMetric<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
+            register_metric<RateMetric<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that tracks the rate of change of a sum of float
+         * metrics.
+         *
+         * @param[in]    k1                    Must be RATE::KIND
+         * @param[in]    k2                    Must be SUM::KIND
+         * @param[in]    k3                    Must be FLOAT::KIND
+         * @param[in]    distance              The metric whose rate of change is to be tracked
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
+         * @param[in]    description           Description of the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        RateOfSumOfFloatHandle create_metric(const RATE k1, const SUM k2, const FLOAT k3,
+                SumOfFloatHandle & distance, const std::string name, const std::string unit, const std::string description,
+                std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+            (void)(k3);
+
+            auto metric = std::make_shared<RateMetric<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
+            register_metric<RateMetric<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that sums unsigned metrics.
+         *
+         * @param[in]    k1                    Must be SUM::KIND
+         * @param[in]    k2                    Must be UINT::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        SumOfUintHandle create_metric(const SUM k1, const UINT k2,
+                const std::string name, const std::string unit, const std::string description,
+                const std::initializer_list<UintHandle > targets = {},
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+
+            auto metric = std::make_shared<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >(name, unit, description, m_time_function, hook_rate_limit);
+
+            initialise_sum_with_targets(metric, targets);
+
+            register_metric<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that sums signed metrics.
+         *
+         * @param[in]    k1                    Must be SUM::KIND
+         * @param[in]    k2                    Must be INT::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        SumOfIntHandle create_metric(const SUM k1, const INT k2,
+                const std::string name, const std::string unit, const std::string description,
+                const std::initializer_list<IntHandle > targets = {},
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+
+            auto metric = std::make_shared<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >(name, unit, description, m_time_function, hook_rate_limit);
+
+            initialise_sum_with_targets(metric, targets);
+
+            register_metric<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that sums float metrics.
+         *
+         * @param[in]    k1                    Must be SUM::KIND
+         * @param[in]    k2                    Must be FLOAT::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        SumOfFloatHandle create_metric(const SUM k1, const FLOAT k2,
+                const std::string name, const std::string unit, const std::string description,
+                const std::initializer_list<FloatHandle > targets = {},
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+
+            auto metric = std::make_shared<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > >(name, unit, description, m_time_function, hook_rate_limit);
+
+            initialise_sum_with_targets(metric, targets);
+
+            register_metric<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that sums rate of unsigned metrics.
+         *
+         * @param[in]    k1                    Must be SUM::KIND
+         * @param[in]    k2                    Must be RATE::KIND
+         * @param[in]    k3                    Must be UINT::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        SumOfRateOfUintHandle create_metric(const SUM k1, const RATE k2, const UINT k3,
+                const std::string name, const std::string unit, const std::string description,
+                const std::initializer_list<RateOfUintHandle > targets = {},
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+            (void)(k3);
+
+            auto metric = std::make_shared<SumMetric<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >(name, unit, description, m_time_function, hook_rate_limit);
+
+            initialise_sum_with_targets(metric, targets);
+
+            register_metric<SumMetric<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that sums rate of signed metrics.
+         *
+         * @param[in]    k1                    Must be SUM::KIND
+         * @param[in]    k2                    Must be RATE::KIND
+         * @param[in]    k3                    Must be INT::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        SumOfRateOfIntHandle create_metric(const SUM k1, const RATE k2, const INT k3,
+                const std::string name, const std::string unit, const std::string description,
+                const std::initializer_list<RateOfIntHandle > targets = {},
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+            (void)(k3);
+
+            auto metric = std::make_shared<SumMetric<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >(name, unit, description, m_time_function, hook_rate_limit);
+
+            initialise_sum_with_targets(metric, targets);
+
+            register_metric<SumMetric<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that sums rate of float metrics.
+         *
+         * @param[in]    k1                    Must be SUM::KIND
+         * @param[in]    k2                    Must be RATE::KIND
+         * @param[in]    k3                    Must be FLOAT::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        SumOfRateOfFloatHandle create_metric(const SUM k1, const RATE k2, const FLOAT k3,
+                const std::string name, const std::string unit, const std::string description,
+                const std::initializer_list<RateOfFloatHandle > targets = {},
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k1);
+            (void)(k2);
+            (void)(k3);
+
+            auto metric = std::make_shared<SumMetric<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >(name, unit, description, m_time_function, hook_rate_limit);
+
+            initialise_sum_with_targets(metric, targets);
+
+            register_metric<SumMetric<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >(name, metric);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric whose value is a string.
+         *
+         * @param[in]    k                     Must be STR::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    description           Description of the metric
+         * @param[in]    initial_value         Value with which to initialise the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        StringHandle create_metric(const STR k, const std::string name, const std::string description,
+                const std::string initial_value = "", const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<StringMetric>(name, description, m_time_function, initial_value, hook_rate_limit);
+            register_metric<StringMetric>(name, metric, m_str_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric whose value is either @c true or @c false.
+         *
+         * @param[in]    k                     Must be BOOL::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    description           Description of the metric
+         * @param[in]    initial_value         Value with which to initialise the metric
+         * @param[in]    true_rep              String representation of the metric when its value is @c true
+         * @param[in]    false_rep             String representation of the metric when its value is @c false
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        BoolHandle create_metric(const BOOL k, const std::string name, const std::string description,
+                const bool initial_value = false, const std::string true_rep = "TRUE", const std::string false_rep = "FALSE",
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<BoolMetric>(name, description, m_time_function, initial_value, true_rep, false_rep, hook_rate_limit);
+            register_metric<BoolMetric>(name, metric, m_bool_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that tracks the mean of a series of samples. Each
+         * render shows the mean of the samples added since the previous
+         * render.
+         *
+         * @param[in]    k                     Must be MEAN::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    render_totals         If @c true, the running sum and count of samples are rendered alongside the mean
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        MeanHandle create_metric(const MEAN k, const std::string name, const std::string unit, const std::string description,
+                const bool render_totals = false, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<MeanMetric>(name, unit, description, m_time_function, render_totals, hook_rate_limit);
+            register_metric<MeanMetric>(name, metric, m_mean_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric whose value is an arithmetic expression over other
+         * metrics in the registry, e.g. @c "hits / (hits + misses) * 100".
+         * Expressions can use numbers, the names of existing numeric
+         * metrics, the operators @c +, @c -, @c * and @c / and parentheses.
+         * Names containing characters other than letters, digits, @c _,
+         * @c . and @c : must be quoted with backticks. Division by zero
+         * evaluates to zero.
+         *
+         * The expression is compiled once, here, and evaluated only when the
+         * metric is calculated (i.e. before each render). Subexpressions
+         * shared by several derived metrics are evaluated once per render.
+         *
+         * @param[in]    k                     Must be DERIVED::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    expression            Expression from which the metric's value is calculated
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError if the metric name is in use or the expression refers to a metric that doesn't exist
+         * @throws MetricTypeError if the expression refers to a metric that isn't numeric
+         * @throws ExpressionError if the expression is malformed or nested too deeply. @see ExpressionPool::NESTING_LIMIT
+         *
+         * @remarks thread-safe
+         */
+        DerivedHandle create_metric(const DERIVED k, const std::string name, const std::string unit, const std::string description,
+                const std::string expression, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            auto resolver = [this](const std::string & variable_name)
+            {
+                MetricIndex::Guard guard(m_index);
+
+                auto entry = m_index.find(variable_name);
+                if (entry == nullptr)
+                {
+                    throw MetricNameError("No metric exists called \"" + variable_name + "\"");
+                }
+                else if ((entry->metric->kind() == Metric::Kind::STR) || (entry->metric->kind() == Metric::Kind::BOOL))
+                {
+                    throw MetricTypeError("The metric called \"" + variable_name + "\" is of kind " + entry->metric->kind_name() +
+                            ", which can't be used in an expression");
+                }
+
+                return entry->metric;
+            };
+
+            auto metric = std::make_shared<DerivedMetric>(m_expressions, expression, resolver, name, unit, description, m_time_function, hook_rate_limit);
+            register_metric<DerivedMetric>(name, metric, m_derived_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that counts events over several moving time
+         * windows, e.g. the number of requests in the last 1, 5 and 15
+         * minutes. Adding to the metric costs a single atomic add, and its
+         * memory is fixed on creation.
+         *
+         * @param[in]    k                     Must be WINDOWED::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    windows               Lengths of the windows. Each must be a multiple of @c resolution. Default = 1, 5 and 15 minutes
+         * @param[in]    resolution            Granularity with which the windows move. Default = 5 seconds
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         * @throws MetricConfigError if the windows or resolution are invalid
+         *
+         * @remarks thread-safe
+         */
+        WindowedHandle create_metric(const WINDOWED k, const std::string name, const std::string unit, const std::string description,
+                const std::vector<std::chrono::milliseconds> windows = WindowedMetric::default_windows(),
+                const std::chrono::milliseconds resolution = std::chrono::seconds(5),
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<WindowedMetric>(name, unit, description, m_time_function, windows, resolution, hook_rate_limit);
+            register_metric<WindowedMetric>(name, metric, m_windowed_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a gauge smoothed by an exponentially weighted moving
+         * average. Samples are assigned to the metric as they would be to a
+         * float metric, without any locking.
+         *
+         * @param[in]    k                     Must be EWMA::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    half_life             Time over which the weight of a sample in the average halves
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         * @throws MetricConfigError if the half-life isn't positive
+         *
+         * @remarks thread-safe
+         */
+        EwmaHandle create_metric(const EWMA k, const std::string name, const std::string unit, const std::string description,
+                const std::chrono::milliseconds half_life, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<EwmaMetric>(name, unit, description, m_time_function, half_life, hook_rate_limit);
+            register_metric<EwmaMetric>(name, metric, m_ewma_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that counts a fixed set of categories, such as
+         * HTTP status classes, in a single array of counters indexed by
+         * category.
+         *
+         * @param[in]    k                     Must be CATEGORY::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    categories            Category labels, in index order. Must be non-empty and unique
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         * @throws MetricConfigError if the categories are invalid
+         *
+         * @remarks thread-safe
+         */
+        CategoryHandle create_metric(const CATEGORY k, const std::string name, const std::string unit, const std::string description,
+                const std::vector<std::string> categories, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<CategoryMetric>(name, unit, description, m_time_function, categories, hook_rate_limit);
+            register_metric<CategoryMetric>(name, metric, m_category_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a metric that tracks the current state of a state machine
+         * and the time spent in each of its states.
+         *
+         * @param[in]    k                     Must be STATE::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    states                State names, in index order. Must be non-empty and unique. The metric starts in the first state
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         * @throws MetricConfigError if the states are invalid
+         *
+         * @remarks thread-safe
+         */
+        StateHandle create_metric(const STATE k, const std::string name, const std::string unit, const std::string description,
+                const std::vector<std::string> states, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<StateMetric>(name, unit, description, m_time_function, states, hook_rate_limit);
+            register_metric<StateMetric>(name, metric, m_state_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a callback batch: a user function that fills in the values
+         * of several callback gauges at once, called only when they are
+         * rendered. The batch is registered as a float metric whose value is
+         * the time taken by the function, in milliseconds. It can't be looked
+         * up by name.
+         *
+         * @param[in]    name            Name of the batch. This must be unique with respect to all metrics in the registry
+         * @param[in]    description     Description of the batch
+         * @param[in]    value_count     Number of values the function fills in
+         * @param[in]    callback        Function that fills in the values
+         * @param[in]    time_limit      Maximum time a call of the function should take. Specify std::chrono::milliseconds::zero() for no limit. @see CallbackBatch
+         *
+         * @return a handle to the created batch, from which gauges can be created
+         *
+         * @throws MetricNameError
+         * @throws MetricConfigError if there are no values or no callback
+         *
+         * @remarks thread-safe
+         */
+        CallbackBatchHandle create_callback_batch(const std::string name, const std::string description, const std::size_t value_count,
+                std::function<void (std::vector<float> & values)> callback,
+                const std::chrono::milliseconds time_limit = std::chrono::milliseconds::zero()) noexcept(false)
+        {
+            auto batch = std::make_shared<CallbackBatch>(name, description, m_time_function, value_count, callback, time_limit);
+            register_metric<CallbackBatch>(name, batch);
+            return batch;
+        }
+
+        /*!
+         * Creates a gauge whose value is reported by a user function, called
+         * only when the gauge is rendered. A callback batch named
+         * "<name>.duration", whose value is the time taken by the function, is
+         * also created.
+         *
+         * @param[in]    k                     Must be CALLBACK::KIND
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    callback              Function that returns the gauge's value
+         * @param[in]    time_limit            Maximum time a call of the function should take. @see CallbackBatch
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError if either name is in use, in which case neither metric is registered
+         * @throws MetricConfigError if there is no callback
+         *
+         * @remarks thread-safe
+         */
+        CallbackHandle create_metric(const CALLBACK k, const std::string name, const std::string unit, const std::string description,
+                std::function<float ()> callback, const std::chrono::milliseconds time_limit = std::chrono::milliseconds::zero(),
+                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            if (!callback)
+            {
+                throw MetricConfigError("Callback metric must have a callback");
+            }
+
+            (void)(k);
+
+            const std::string batch_name = name + ".duration";
+            auto batch = std::make_shared<CallbackBatch>(batch_name, "Time taken to report " + name, m_time_function, 1,
+                    [callback](std::vector<float> & values){values[0] = callback();}, time_limit);
+            auto metric = std::make_shared<CallbackMetric>(name, unit, description, m_time_function, batch, 0, hook_rate_limit);
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_registry_mutex);
+
+            // Both names are checked first, so that neither is registered if either is in use
+            for (auto & taken : {name, batch_name})
+            {
+                if (m_index.find(taken) != nullptr)
+                {
+                    throw MetricNameError("A metric already exists with the name \"" + taken + "\"");
+                }
+            }
+
+            m_index.insert(batch_name, batch, false);
+            m_index.insert(name, metric, true);
+            m_callback_metrics.push_back(metric);
+
+            return metric;
+        }
+
+
+        /*!
+         * Creates a counter block: a group of unsigned counters held in a
+         * single contiguous allocation and updated by index. Each counter is
+         * registered as a block counter under its own name, so it is rendered
+         * and can be looked up like any other metric.
+         *
+         * @param[in]    names              Name of each counter, in index order. Each must be unique with respect to all metrics in the registry
+         * @param[in]    unit               Unit string to associate with the counters
+         * @param[in]    description        Description of the counters
+         * @param[in]    per_thread         @c true to keep a copy of the counters for each thread slot, folded in before each render. @see CounterBlock
+         * @param[in]    hook_rate_limit    Minimum number of milliseconds between invocations of the counters' hooks
+         *
+         * @return a handle to the created block
+         *
+         * @throws MetricNameError if a name is used twice or is already in use, in which case no counters are registered
+         * @throws MetricConfigError if there are no counters
+         *
+         * @remarks thread-safe
+         */
+        CounterBlockHandle create_counter_block(const std::vector<std::string> & names, const std::string unit, const std::string description,
+                const bool per_thread = false, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            auto block = std::make_shared<CounterBlock>(names, per_thread);
+
+            std::vector<BlockCounterHandle> counters;
+            for (std::size_t index = 0; index < names.size(); ++index)
+            {
+                counters.push_back(std::make_shared<BlockCounter>(names[index], unit, description, m_time_function, block, index, hook_rate_limit));
+            }
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_registry_mutex);
+
+            std::vector<std::string> sorted(names);
+            std::sort(sorted.begin(), sorted.end());
+            for (std::size_t index = 0; index < sorted.size(); ++index)
+            {
+                if (((index > 0) && (sorted[index] == sorted[index - 1])) || (m_index.find(sorted[index]) != nullptr))
+                {
+                    throw MetricNameError("A metric already exists with the name \"" + sorted[index] + "\"");
+                }
+            }
+
+            for (auto & counter : counters)
+            {
+                m_index.insert(counter->name(), counter, true);
+                m_block_metrics.push_back(counter);
+            }
+
+            return block;
+        }
+
+        /*!
+         * Creates a gauge whose value is reported by a callback batch.
+         *
+         * @param[in]    k                     Must be CALLBACK::KIND
+         * @param[in]    batch                 The batch whose callback reports the gauge's value
+         * @param[in]    index                 Index of the gauge's value in the batch
+         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
+         * @param[in]    unit                  Unit string to associate with the metric
+         * @param[in]    description           Description of the metric
+         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         *
+         * @return a handle to the created metric, which must be de-referenced before use
+         *
+         * @throws MetricNameError
+         * @throws MetricConfigError if the index is out of range
+         *
+         * @remarks thread-safe
+         */
+        CallbackHandle create_metric(const CALLBACK k, CallbackBatchHandle batch, const std::size_t index, const std::string name, const std::string unit,
+                const std::string description, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        {
+            (void)(k);
+
+            auto metric = std::make_shared<CallbackMetric>(name, unit, description, m_time_function, batch, index, hook_rate_limit);
+            register_metric<CallbackMetric>(name, metric, m_callback_metrics);
+            return metric;
+        }
+
+        /*!
+         * Creates a Throttle object for use with an unsigned metric. Throttle
+         * objects impose limits on the rate of operations performed on a
+         * metric.
+         *
+         * @param[in]    metric        The metric to throttle
+         * @param[in]    time_limit    The minimum number of milliseconds between updates of the metric
+         * @param[in]    op_limit      The number of attempted update operations between each actual update of the metric
+         *
+         * @return the created Throttle object
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        UintThrottle create_throttle(UintHandle & metric, const std::chrono::milliseconds time_limit, std::uint64_t op_limit = 1)
+        {
+            return UintThrottle(metric, time_limit, op_limit, m_time_function);
+        }
+
+        /*!
+         * Creates a Throttle object for use with an signed metric. Throttle
+         * objects impose limits on the rate of operations performed on a
+         * metric.
+         *
+         * @param[in]    metric        The metric to throttle
+         * @param[in]    time_limit    The minimum number of milliseconds between updates of the metric
+         * @param[in]    op_limit      The number of attempted update operations between each actual update of the metric
+         *
+         * @return the created Throttle object
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        IntThrottle create_throttle(IntHandle & metric, const std::chrono::milliseconds time_limit, std::uint64_t op_limit = 1)
+        {
+            return IntThrottle(metric, time_limit, op_limit, m_time_function);
+        }
+
+        /*!
+         * Creates a Throttle object for use with a float metric. Throttle
+         * objects impose limits on the rate of operations performed on a
+         * metric.
+         *
+         * @param[in]    metric        The metric to throttle
+         * @param[in]    time_limit    The minimum number of milliseconds between updates of the metric
+         * @param[in]    op_limit      The number of attempted update operations between each actual update of the metric
+         *
+         * @return the created Throttle object
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        FloatThrottle create_throttle(FloatHandle & metric, const std::chrono::milliseconds time_limit, std::uint64_t op_limit = 1)
+        {
+            return FloatThrottle(metric, time_limit, op_limit, m_time_function);
+        }
 
-    using UintHandle = std::shared_ptr<NumberMetric<Metric::Kind::UINT, std::uint64_t> >; //!< Handle to an unsigned metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using IntHandle = std::shared_ptr<NumberMetric<Metric::Kind::INT, std::int64_t> >; //!< Handle to an signed metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using FloatHandle = std::shared_ptr<NumberMetric<Metric::Kind::FLOAT, float> >; //!< Handle to an float metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using RateOfUintHandle = std::shared_ptr<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >; //!< Handle to a rate of unsigned metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using RateOfIntHandle = std::shared_ptr<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >; //!< Handle to a rate of signed metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using RateOfFloatHandle = std::shared_ptr<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > >; //!< Handle to a rate of float metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using RateOfSumOfUintHandle = std::shared_ptr<RateMetric<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >; //!< Handle to a rate of sum of unsigned metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using RateOfSumOfIntHandle = std::shared_ptr<RateMetric<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >; //!< Handle to a rate of sum of signed metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using RateOfSumOfFloatHandle = std::shared_ptr<RateMetric<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >; //!< Handle to a rate of sum of float metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using SumOfUintHandle = std::shared_ptr<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >; //!< Handle to a sum of unsigned metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using SumOfIntHandle = std::shared_ptr<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >; //!< Handle to a sum of signed metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using SumOfFloatHandle = std::shared_ptr<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > >; //!< Handle to a sum of float metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using SumOfRateOfUintHandle = std::shared_ptr<SumMetric<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >; //!< Handle to a sum of rate of unsigned metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using SumOfRateOfIntHandle = std::shared_ptr<SumMetric<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >; //!< Handle to a sum of rate of signed metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using SumOfRateOfFloatHandle = std::shared_ptr<SumMetric<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >; //!< Handle to a sum of rate of float metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using StringHandle = std::shared_ptr<StringMetric>; //!< Handle to a string metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
-    using BoolHandle = std::shared_ptr<BoolMetric>; //!< Handle to a boolean metric. Behind the scenes this is a std::shared_ptr, so must be de-referenced before use
+        /*!
+         * Creates a Throttle object for use with an string metric. Throttle
+         * objects impose limits on the rate of operations performed on a
+         * metric.
+         *
+         * @param[in]    metric        The metric to throttle
+         * @param[in]    time_limit    The minimum number of milliseconds between updates of the metric
+         * @param[in]    op_limit      The number of attempted update operations between each actual update of the metric
+         *
+         * @return the created Throttle object
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        StringThrottle create_throttle(StringHandle & metric, const std::chrono::milliseconds time_limit, std::uint64_t op_limit = 1)
+        {
+            return StringThrottle(metric, time_limit, op_limit, m_time_function);
+        }
 
-    using UintThrottle = Throttle<NumberMetric<Metric::Kind::UINT, std::uint64_t> >; //!< Throttle object throttling an unsigned metric
-    using IntThrottle = Throttle<NumberMetric<Metric::Kind::INT, std::int64_t> >; //!< Throttle object throttling a signed metric
-    using FloatThrottle = Throttle<NumberMetric<Metric::Kind::FLOAT, float> >; //!< Throttle object throttling a float metric
-    using StringThrottle = Throttle<StringMetric>; //!< Throttle object throttling a string metric
-    using BoolThrottle = Throttle<BoolMetric>; //!< Throttle object throttling a boolean metric
+        /*!
+         * Creates a Throttle object for use with an bool metric. Throttle
+         * objects impose limits on the rate of operations performed on a
+         * metric.
+         *
+         * @param[in]    metric        The metric to throttle
+         * @param[in]    time_limit    The minimum number of milliseconds between updates of the metric
+         * @param[in]    op_limit      The number of attempted update operations between each actual update of the metric
+         *
+         * @return the created Throttle object
+         *
+         * @throws MetricNameError
+         *
+         * @remarks thread-safe
+         */
+        BoolThrottle create_throttle(BoolHandle & metric, const std::chrono::milliseconds time_limit, std::uint64_t op_limit = 1)
+        {
+            return BoolThrottle(metric, time_limit, op_limit, m_time_function);
+        }
 
-    /*!
-     * @class Registry
-     *
-     * @brief Creates, tracks and renders metrics
-     *
-     * You probably only need a single Registry object for your entire
-     * application. It serves as a factory and clearing house for metric
-     * objects, providing helper methods to create, look up and render metrics.
-     *
-     * @remarks thread-safe
-     */
-    class Registry
-    {
-    public:
         /*!
-         * @class RenderSchedule
+         * Finds a metric by its ID, without looking up its name or copying a
+         * handle. Takes constant time. The ID of a removed metric is never
+         * resolved, even if a new metric has been given its index.
          *
-         * @brief Schedules a regular render operation to be performed every @em n seconds
+         * @param[in]    id    ID of the metric, @see Metric::id()
+         *
+         * @return a reference to the metric
+         *
+         * @throws MetricNameError if no metric has the ID
+         * @throws MetricTypeError if the metric isn't of type T
          *
          * @remarks thread-safe
          */
-        class RenderSchedule
+        template<typename T = Metric>
+        MetricRef<T> resolve(const std::uint64_t id) const noexcept(false)
         {
-        public:
-            /*!
-             * Constructor.
-             *
-             * @param[in]    registry    Registry object containing the metrics to render
-             * @param[in]    renderer    The renderer to use in each render operation
-             * @param[in]    interval    Number of seconds between scheduled renders
-             */
-            RenderSchedule(Registry & registry, Renderer & renderer, const std::chrono::seconds interval) noexcept(false)
-            : m_registry(registry), m_renderer(renderer), m_stop(false), m_interval(interval), m_executor(std::bind(&RenderSchedule::executor_logic, this))
+            MetricIndex::Guard guard(m_index);
+
+            auto entry = m_index.at(id);
+            if (entry == nullptr)
             {
+                throw MetricNameError("No metric has the ID " + std::to_string(id));
             }
 
-            ~RenderSchedule() noexcept
+            T * metric = dynamic_cast<T *>(entry->metric.get());
+            if (metric == nullptr)
             {
-                try
-                {
-                    stop();
-                }
-                catch(...)
-                {
-                }
+                throw MetricTypeError("The metric with the ID " + std::to_string(id) + " (\"" + entry->name +
+                        "\") is of an unexpected kind: actual kind is " + entry->metric->kind_name());
             }
 
-            /*!
-             * Stops the scheduled render operation if it's active. Any thread
-             * spawned by the object is stopped.
-             */
-            void stop() noexcept(false)
+            return MetricRef<T>(metric);
+        }
+
+        /*!
+         * Finds a metric by its name, without copying a handle. If lookups are
+         * cached, a repeated lookup is served from the calling thread's cache
+         * and writes no memory shared with other threads. @see ::lookup_cache
+         *
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
+         *
+         * @return a reference to the metric
+         *
+         * @throws MetricNameError if no metric can be looked up with the name
+         * @throws MetricTypeError if the metric isn't of type T, or isn't of a kind that can be looked up
+         *
+         * @remarks thread-safe
+         */
+        template<typename T = Metric>
+        MetricRef<T> resolve(const MetricKey name) const noexcept(false)
+        {
+            Metric * found = nullptr;
+            if (m_lookup_cache.load(std::memory_order_relaxed))
             {
-                m_stop = true;
-                m_stop_cond.notify_one();
-                m_executor.join();
+                found = cached_lookup(name).metric;
+            }
+            else
+            {
+                MetricIndex::Guard guard(m_index);
+                found = lookup(name)->metric.get();
             }
 
-        private:
-            void executor_logic() noexcept(false)
+            T * metric = dynamic_cast<T *>(found);
+            if (metric == nullptr)
             {
-                do
-                {
-                    std::unique_lock<std::mutex> lock(m_cond_mutex);
+                throw MetricTypeError("The metric called \"" + name.str() + "\" is of an unexpected kind: actual kind is " + found->kind_name());
+            }
 
-                    auto timeout_when = std::chrono::steady_clock::now() + m_interval;
-                    m_stop_cond.wait_until(lock, timeout_when, [&timeout_when, this](){return ((std::chrono::steady_clock::now() >= timeout_when) || (m_stop));});
+            return MetricRef<T>(metric);
+        }
 
-                    if (m_stop)
-                    {
-                        break;
-                    }
+        /*!
+         * Checks that a reference's metric is still in the registry, so the
+         * reference can be used. Takes constant time. The check doesn't keep
+         * the metric in the registry, so it mustn't race with the metric's
+         * removal.
+         *
+         * @param[in]    reference    The reference
+         *
+         * @return @c true if the metric is in the registry, @c false if the reference is empty, or its metric has been removed or is in a different registry
+         *
+         * @remarks thread-safe
+         */
+        template<typename T>
+        bool valid(const MetricRef<T> & reference) const noexcept
+        {
+            MetricIndex::Guard guard(m_index);
 
-                    m_registry.render(m_renderer);
-                }
-                while(!m_stop);
-            }
+            auto entry = m_index.at(reference.id());
+            return (entry != nullptr) && (entry->metric.get() == reference.get());
+        }
 
-            Registry & m_registry; //!< The registry managing the metrics to be rendered
-            Renderer & m_renderer; //!< The renderer to be used after each interval
-            std::atomic<bool> m_stop; //!< Flag indicating whether or not the scheduler should terminate
-            const std::chrono::seconds m_interval; //!< Number of seconds between each render
-            std::thread m_executor; //!< Thread in which asynchronous render operations should be performed
-            mutable std::condition_variable m_stop_cond; //!< Condition variable used to notify the scheduler of a stop command
-            mutable std::mutex m_cond_mutex; //!< Condition variable mutex
+        /*!
+         * Looks up an unsigned metric by name. Avoid performing lookups in
+         * performance-critical code. Instead, keep the metric handle returned
+         * on creation and manipulate that directly.
+         *
+         * @param[in]    k       Must be UINT::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
+         *
+         * @return a handle to the found metric
+         *
+         * @throws MetricNameError
+         * @throws MetricTypeError
+         *
+         * @remarks thread-safe
+         */
+        UintHandle operator()(const UINT k, const MetricKey name) const noexcept(false)
+        {
+            (void)(k);
 
-        };
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::UINT);
+            return std::static_pointer_cast<UintHandle::element_type>(entry->metric);
+        }
 
         /*!
-         * Constructor.
+         * Looks up an signed metric by name. Avoid performing lookups in
+         * performance-critical code. Instead, keep the metric handle returned
+         * on creation and manipulate that directly.
          *
-         * @param[in]    time_function    Function used to determine the time. Used for testing - in production, use the default value
+         * @param[in]    k       Must be INT::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
+         *
+         * @return a handle to the found metric
+         *
+         * @throws MetricNameError
+         * @throws MetricTypeError
+         *
+         * @remarks thread-safe
          */
-        Registry(std::function<std::chrono::steady_clock::time_point ()> time_function = []{return std::chrono::steady_clock::now();}) noexcept
-        : m_time_function(time_function)
+        IntHandle operator()(const INT k, const MetricKey name) const noexcept(false)
         {
+            (void)(k);
+
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::INT);
+            return std::static_pointer_cast<IntHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates an unsigned integer metric.
+         * Looks up an float metric by name. Avoid performing lookups in
+         * performance-critical code. Instead, keep the metric handle returned
+         * on creation and manipulate that directly.
          *
-         * @param[in]    k                     Must be UINT::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric
-         * @param[in]    description           Description of the metric
-         * @param[in]    initial_value         Value with which to initialise the metric
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    k       Must be FLOAT::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return a handle to the found metric
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        UintHandle create_metric(const UINT k, const std::string name, const std::string unit, const std::string description,
-                const std::uint64_t initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        FloatHandle operator()(const FLOAT k, const MetricKey name) const noexcept(false)
+        {
+            (void)(k);
+
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::FLOAT);
+            return std::static_pointer_cast<FloatHandle::element_type>(entry->metric);
+        }
+
+        /*!
+         * Looks up a string metric by name. Avoid performing lookups in
+         * performance-critical code. Instead, keep the metric handle returned
+         * on creation and manipulate that directly.
+         *
+         * @param[in]    k       Must be STR::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
+         *
+         * @return a handle to the found metric
+         *
+         * @throws MetricNameError
+         * @throws MetricTypeError
+         *
+         * @remarks thread-safe
+         */
+        StringHandle operator()(const STR k, const MetricKey name) const noexcept(false)
         {
             (void)(k);
 
-            auto metric = std::make_shared<NumberMetric<Metric::Kind::UINT, std::uint64_t> >(name, unit, description, m_time_function, initial_value, hook_rate_limit);
-            register_metric<NumberMetric<Metric::Kind::UINT, std::uint64_t> >(name, metric, m_uint_metrics);
-            return metric;
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::STR);
+            return std::static_pointer_cast<StringHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates a signed integer metric.
+         * Looks up a bool metric by name. Avoid performing lookups in
+         * performance-critical code. Instead, keep the metric handle returned
+         * on creation and manipulate that directly.
          *
-         * @param[in]    k                     Must be INT::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric
-         * @param[in]    description           Description of the metric
-         * @param[in]    initial_value         Value with which to initialise the metric
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    k       Must be BOOL::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return a handle to the found metric
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        IntHandle create_metric(const INT k, const std::string name, const std::string unit, const std::string description,
-                const std::uint64_t initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        BoolHandle operator()(const BOOL k, const MetricKey name) const noexcept(false)
         {
             (void)(k);
 
-            auto metric = std::make_shared<NumberMetric<Metric::Kind::INT, std::int64_t> >(name, unit, description, m_time_function, initial_value, hook_rate_limit);
-            register_metric<NumberMetric<Metric::Kind::INT, std::int64_t> >(name, metric, m_int_metrics);
-            return metric;
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::BOOL);
+            return std::static_pointer_cast<BoolHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates a float metric.
+         * Looks up a mean metric by name. Avoid performing lookups in
+         * performance-critical code. Instead, keep the metric handle returned
+         * on creation and manipulate that directly.
          *
-         * @param[in]    k                     Must be FLOAT::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric
-         * @param[in]    description           Description of the metric
-         * @param[in]    initial_value         Value with which to initialise the metric
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    k       Must be MEAN::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return a handle to the found metric
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        FloatHandle create_metric(const FLOAT k, const std::string name, const std::string unit, const std::string description,
-                const float initial_value = 0, const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        MeanHandle operator()(const MEAN k, const MetricKey name) const noexcept(false)
         {
             (void)(k);
 
-            auto metric = std::make_shared<NumberMetric<Metric::Kind::FLOAT, float> >(name, unit, description, m_time_function, initial_value, hook_rate_limit);
-            register_metric<NumberMetric<Metric::Kind::FLOAT, float> >(name, metric, m_float_metrics);
-            return metric;
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::MEAN);
+            return std::static_pointer_cast<MeanHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates a metric that tracks the rate of change of an unsigned metric.
+         * Looks up a derived metric by name. Avoid performing lookups in
+         * performance-critical code. Instead, keep the metric handle returned
+         * on creation and manipulate that directly.
          *
-         * @param[in]    k1                    Must be RATE::KIND
-         * @param[in]    k2                    Must be UINT::KIND
-         * @param[in]    distance              The metric whose rate of change is to be tracked
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
-         * @param[in]    description           Description of the metric
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
-         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         * @param[in]    k       Must be DERIVED::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return a handle to the found metric
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        RateOfUintHandle create_metric(const RATE k1, const UINT k2,
-                UintHandle & distance, const std::string name, const std::string unit, const std::string description,
-                std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        DerivedHandle operator()(const DERIVED k, const MetricKey name) const noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
+            (void)(k);
 
-            auto metric = std::make_shared<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
-            register_metric<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >(name, metric);
-            return metric;
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::DERIVED);
+            return std::static_pointer_cast<DerivedHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates a metric that tracks the rate of change of an signed metric.
+         * Looks up a windowed counter metric by name. Avoid performing
+         * lookups in performance-critical code. Instead, keep the metric
+         * handle returned on creation and manipulate that directly.
          *
-         * @param[in]    k1                    Must be RATE::KIND
-         * @param[in]    k2                    Must be INT::KIND
-         * @param[in]    distance              The metric whose rate of change is to be tracked
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
-         * @param[in]    description           Description of the metric
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
-         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         * @param[in]    k       Must be WINDOWED::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return a handle to the found metric
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        RateOfIntHandle create_metric(const RATE k1, const INT k2,
-                IntHandle & distance, const std::string name, const std::string unit, const std::string description,
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        WindowedHandle operator()(const WINDOWED k, const MetricKey name) const noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
+            (void)(k);
 
-            auto metric = std::make_shared<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
-            register_metric<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >(name, metric);
-            return metric;
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::WINDOWED);
+            return std::static_pointer_cast<WindowedHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates a metric that tracks the rate of change of an float metric.
+         * Looks up an EWMA metric by name. Avoid performing lookups in
+         * performance-critical code. Instead, keep the metric handle returned
+         * on creation and manipulate that directly.
          *
-         * @param[in]    k1                    Must be RATE::KIND
-         * @param[in]    k2                    Must be FLOAT::KIND
-         * @param[in]    distance              The metric whose rate of change is to be tracked
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
-         * @param[in]    description           Description of the metric
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
-         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         * @param[in]    k       Must be EWMA::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return a handle to the found metric
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        RateOfFloatHandle create_metric(const RATE k1, const FLOAT k2,
-                FloatHandle & distance, const std::string name, const std::string unit, const std::string description,
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        EwmaHandle operator()(const EWMA k, const MetricKey name) const noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
+            (void)(k);
 
-            auto metric = std::make_shared<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
-            register_metric<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > >(name, metric);
-            return metric;
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::EWMA);
+            return std::static_pointer_cast<EwmaHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates a metric that tracks the rate of change of a sum of unsigned
-         * metrics.
+         * Looks up a category counter metric by name. Avoid performing
+         * lookups in performance-critical code. Instead, keep the metric
+         * handle returned on creation and manipulate that directly.
          *
-         * @param[in]    k1                    Must be RATE::KIND
-         * @param[in]    k2                    Must be SUM::KIND
-         * @param[in]    k3                    Must be UINT::KIND
-         * @param[in]    distance              The metric whose rate of change is to be tracked
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
-         * @param[in]    description           Description of the metric
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
-         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         * @param[in]    k       Must be CATEGORY::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return a handle to the found metric
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        RateOfSumOfUintHandle create_metric(const RATE k1, const SUM k2, const UINT k3,
-                SumOfUintHandle & distance, const std::string name, const std::string unit, const std::string description,
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        CategoryHandle operator()(const CATEGORY k, const MetricKey name) const noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
-            (void)(k3);
+            (void)(k);
 
-            auto metric = std::make_shared<RateMetric<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
-            register_metric<RateMetric<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >(name, metric);
-            return metric;
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::CATEGORY);
+            return std::static_pointer_cast<CategoryHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates a metric that tracks the rate of change of a sum of signed
-         * metrics.
+         * Looks up a state machine metric by name. Avoid performing
+         * lookups in performance-critical code. Instead, keep the metric
+         * handle returned on creation and manipulate that directly.
          *
-         * @param[in]    k1                    Must be RATE::KIND
-         * @param[in]    k2                    Must be SUM::KIND
-         * @param[in]    k3                    Must be INT::KIND
-         * @param[in]    distance              The metric whose rate of change is to be tracked
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
-         * @param[in]    description           Description of the metric
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
-         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         * @param[in]    k       Must be STATE::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return a handle to the found metric
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        RateOfSumOfIntHandle create_metric(const RATE k1, const SUM k2, const INT k3,
-                SumOfIntHandle & distance, const std::string name, const std::string unit, const std::string description,
-                std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        StateHandle operator()(const STATE k, const MetricKey name) const noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
-            (void)(k3);
+            (void)(k);
 
-            auto metric = std::make_shared<RateMetric<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
-            register_metric<RateMetric<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >(name, metric);
-            return metric;
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::STATE);
+            return std::static_pointer_cast<StateHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates a metric that tracks the rate of change of a sum of float
-         * metrics.
+         * Looks up a callback gauge metric by name. Avoid performing
+         * lookups in performance-critical code. Instead, keep the metric
+         * handle returned on creation and manipulate that directly.
          *
-         * @param[in]    k1                    Must be RATE::KIND
-         * @param[in]    k2                    Must be SUM::KIND
-         * @param[in]    k3                    Must be FLOAT::KIND
-         * @param[in]    distance              The metric whose rate of change is to be tracked
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric, e.g. bytes/sec
-         * @param[in]    description           Description of the metric
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
-         * @param[in]    result_proxy          A function given the opportunity to modify a calculated rate before being recorded against the metric. Particularly useful for unit conversion, e.g. converting bytes per second to mebibytes per second
+         * @param[in]    k       Must be CALLBACK::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return a handle to the found metric
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        RateOfSumOfFloatHandle create_metric(const RATE k1, const SUM k2, const FLOAT k3,
-                SumOfFloatHandle & distance, const std::string name, const std::string unit, const std::string description,
-                std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000), std::function<float (float)> result_proxy = nullptr) noexcept(false)
+        CallbackHandle operator()(const CALLBACK k, const MetricKey name) const noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
-            (void)(k3);
+            (void)(k);
 
-            auto metric = std::make_shared<RateMetric<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >(distance, result_proxy, name, unit, description, m_time_function, hook_rate_limit);
-            register_metric<RateMetric<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >(name, metric);
-            return metric;
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::CALLBACK);
+            return std::static_pointer_cast<CallbackHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates a metric that sums unsigned metrics.
+         * Looks up a block counter metric by name. Avoid performing
+         * lookups in performance-critical code. Instead, keep the metric
+         * handle returned on creation and manipulate that directly.
          *
-         * @param[in]    k1                    Must be SUM::KIND
-         * @param[in]    k2                    Must be UINT::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric
-         * @param[in]    description           Description of the metric
-         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    k       Must be BLOCK::KIND
+         * @param[in]    name    Name of the metric to look up. A MetricKey
+         *                       constructed in advance saves hashing the name
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return a handle to the found metric
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        SumOfUintHandle create_metric(const SUM k1, const UINT k2,
-                const std::string name, const std::string unit, const std::string description,
-                const std::initializer_list<UintHandle > targets = {},
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        BlockCounterHandle operator()(const BLOCK k, const MetricKey name) const noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
-
-            auto metric = std::make_shared<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >(name, unit, description, m_time_function, hook_rate_limit);
-
-            initialise_sum_with_targets(metric, targets);
+            (void)(k);
 
-            register_metric<SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > >(name, metric);
-            return metric;
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name, Metric::Kind::BLOCK);
+            return std::static_pointer_cast<BlockCounterHandle::element_type>(entry->metric);
         }
 
         /*!
-         * Creates a metric that sums signed metrics.
+         * Looks up many unsigned metrics by name at once.
          *
-         * @param[in]    k1                    Must be SUM::KIND
-         * @param[in]    k2                    Must be INT::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric
-         * @param[in]    description           Description of the metric
-         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @param[in]    k        Must be UINT::KIND
+         * @param[in]    names    Names of the metrics to look up
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @return handles to the found metrics, in the same order as names
          *
          * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        SumOfIntHandle create_metric(const SUM k1, const INT k2,
-                const std::string name, const std::string unit, const std::string description,
-                const std::initializer_list<IntHandle > targets = {},
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        std::vector<UintHandle> operator()(const UINT k, const std::vector<MetricKey> & names) const noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
-
-            auto metric = std::make_shared<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >(name, unit, description, m_time_function, hook_rate_limit);
-
-            initialise_sum_with_targets(metric, targets);
+            (void)(k);
 
-            register_metric<SumMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > >(name, metric);
-            return metric;
+            return lookup_all<UintHandle::element_type>(names, Metric::Kind::UINT);
         }
 
         /*!
-         * Creates a metric that sums float metrics.
-         *
-         * @param[in]    k1                    Must be SUM::KIND
-         * @param[in]    k2                    Must be FLOAT::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric
-         * @param[in]    description           Description of the metric
-         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
-         *
-         * @return a handle to the created metric, which must be de-referenced before use
-         *
-         * @throws MetricNameError
+         * Looks up many signed metrics by name at once.
          *
-         * @remarks thread-safe
+         * @see Registry::operator()(const UINT, const std::vector<MetricKey> &)
          */
-        SumOfFloatHandle create_metric(const SUM k1, const FLOAT k2,
-                const std::string name, const std::string unit, const std::string description,
-                const std::initializer_list<FloatHandle > targets = {},
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        std::vector<IntHandle> operator()(const INT k, const std::vector<MetricKey> & names) const noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
-
-            auto metric = std::make_shared<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > >(name, unit, description, m_time_function, hook_rate_limit);
+            (void)(k);
 
-            initialise_sum_with_targets(metric, targets);
+            return lookup_all<IntHandle::element_type>(names, Metric::Kind::INT);
+        }
 
-            register_metric<SumMetric<NumberMetric<Metric::Kind::FLOAT, float> > >(name, metric);
-            return metric;
+        /*!
+         * Looks up many float metrics by name at once.
+         *
+         * @see Registry::operator()(const UINT, const std::vector<MetricKey> &)
+         */
+        std::vector<FloatHandle> operator()(const FLOAT k, const std::vector<MetricKey> & names) const noexcept(false)
+        {
+            (void)(k);
+
+            return lookup_all<FloatHandle::element_type>(names, Metric::Kind::FLOAT);
         }
 
         /*!
-         * Creates a metric that sums rate of unsigned metrics.
+         * Removes a metric from the registry, so that it's no longer
+         * rendered and can't be looked up. Handles to the metric remain
+         * usable, but references and IDs become invalid. The name can be
+         * reused.
          *
-         * @param[in]    k1                    Must be SUM::KIND
-         * @param[in]    k2                    Must be RATE::KIND
-         * @param[in]    k3                    Must be UINT::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric
-         * @param[in]    description           Description of the metric
-         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * Metrics that depend on the removed metric are updated: it's dropped
+         * from the targets of sums, and rates and derived metrics of it are
+         * removed too. Updates to the metric queued by the ingestion pipeline
+         * are applied before the call returns, so no more should be queued
+         * once it's been removed.
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * The registry frees its share of the metric once no lookup can still
+         * be reading it. Lookups never wait for a removal, but the removal
+         * waits for lookups already in progress to finish.
          *
-         * @throws MetricNameError
+         * @param[in]    name    Name of the metric
+         *
+         * @return the number of metrics removed, including dependent metrics: 0 if there's no metric with the name
          *
          * @remarks thread-safe
          */
-        SumOfRateOfUintHandle create_metric(const SUM k1, const RATE k2, const UINT k3,
-                const std::string name, const std::string unit, const std::string description,
-                const std::initializer_list<RateOfUintHandle > targets = {},
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        std::size_t remove(const MetricKey name) noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
-            (void)(k3);
+            std::vector<std::string> names;
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_registry_mutex);
 
-            auto metric = std::make_shared<SumMetric<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >(name, unit, description, m_time_function, hook_rate_limit);
+                auto entry = m_index.find(name);
+                if (entry != nullptr)
+                {
+                    names.push_back(entry->name);
+                    unregister(names);
+                }
+            }
 
-            initialise_sum_with_targets(metric, targets);
+            m_ingestion->flush();
+            m_index.reclaim();
 
-            register_metric<SumMetric<RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > > >(name, metric);
-            return metric;
+            return names.size();
         }
 
         /*!
-         * Creates a metric that sums rate of signed metrics.
+         * Removes every metric whose name starts with a prefix.
          *
-         * @param[in]    k1                    Must be SUM::KIND
-         * @param[in]    k2                    Must be RATE::KIND
-         * @param[in]    k3                    Must be INT::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric
-         * @param[in]    description           Description of the metric
-         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * @see Registry::remove(const MetricKey)
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @param[in]    name_prefix    Prefix of the names of the metrics to remove
          *
-         * @throws MetricNameError
+         * @return the number of metrics removed, including dependent metrics
          *
          * @remarks thread-safe
          */
-        SumOfRateOfIntHandle create_metric(const SUM k1, const RATE k2, const INT k3,
-                const std::string name, const std::string unit, const std::string description,
-                const std::initializer_list<RateOfIntHandle > targets = {},
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        std::size_t remove_prefix(const std::string & name_prefix) noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
-            (void)(k3);
+            std::vector<std::string> names;
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_registry_mutex);
 
-            auto metric = std::make_shared<SumMetric<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >(name, unit, description, m_time_function, hook_rate_limit);
+                auto catalogue = current_catalogue();
+                for (auto metric = first_from(*catalogue, name_prefix);
+                        (metric != catalogue->metrics.end()) && (RenderFilter::starts_with((*metric)->m_name, name_prefix)); ++metric)
+                {
+                    names.push_back((*metric)->m_name);
+                }
 
-            initialise_sum_with_targets(metric, targets);
+                unregister(names);
+            }
 
-            register_metric<SumMetric<RateMetric<NumberMetric<Metric::Kind::INT, std::int64_t> > > >(name, metric);
-            return metric;
+            m_ingestion->flush();
+            m_index.reclaim();
+
+            return names.size();
         }
 
         /*!
-         * Creates a metric that sums rate of float metrics.
-         *
-         * @param[in]    k1                    Must be SUM::KIND
-         * @param[in]    k2                    Must be RATE::KIND
-         * @param[in]    k3                    Must be FLOAT::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    unit                  Unit string to associate with the metric
-         * @param[in]    description           Description of the metric
-         * @param[in]    targets               List of metric handles to sum together. More can be added after creation by calling SumMetric::add_target
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
-         *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * Renders any metric in the registry whose name begins with
+         * @c name_prefix using the provided Renderer object. Metrics'
+         * @c calculate() methods are called automatically prior to rendering.
          *
-         * @throws MetricNameError
+         * @param[in]    renderer       Renderer to use for rendering the metrics
+         * @param[in]    name_prefix    Prefix of the metric names to be rendered
          *
          * @remarks thread-safe
          */
-        SumOfRateOfFloatHandle create_metric(const SUM k1, const RATE k2, const FLOAT k3,
-                const std::string name, const std::string unit, const std::string description,
-                const std::initializer_list<RateOfFloatHandle > targets = {},
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        void render(Renderer & renderer, const std::string & name_prefix) const noexcept(false)
         {
-            (void)(k1);
-            (void)(k2);
-            (void)(k3);
-
-            auto metric = std::make_shared<SumMetric<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >(name, unit, description, m_time_function, hook_rate_limit);
+            render_filtered(renderer, renderer.filter().intersect(RenderFilter({name_prefix})));
+        }
 
-            initialise_sum_with_targets(metric, targets);
+        /*!
+         * @see Registry::render(Renderer &, const std::string &)
+         */
+        void render(Renderer & renderer, const char * name_prefix) const noexcept(false)
+        {
+            render(renderer, std::string(name_prefix));
+        }
 
-            register_metric<SumMetric<RateMetric<NumberMetric<Metric::Kind::FLOAT, float> > > >(name, metric);
-            return metric;
+        /*!
+         * Renders any metric in the registry that matches a filter, and the
+         * renderer's own filter. Only the matching metrics are visited, so
+         * a render of a small part of a large registry is cheap.
+         *
+         * @param[in]    renderer    Renderer to use for rendering the metrics
+         * @param[in]    filter      Selects the metrics to render
+         *
+         * @see Renderer::filter
+         *
+         * @remarks thread-safe
+         */
+        void render(Renderer & renderer, const RenderFilter & filter) const noexcept(false)
+        {
+            render_filtered(renderer, renderer.filter().intersect(filter));
         }
 
         /*!
-         * Creates a metric whose value is a string.
+         * Renders all metrics in the registry that match the renderer's
+         * filter: by default, all of them.
          *
-         * @param[in]    k                     Must be STR::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    description           Description of the metric
-         * @param[in]    initial_value         Value with which to initialise the metric
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * Renders don't hold the registry lock while metrics are calculated
+         * and rendered, so metrics may be created and looked up, even by the
+         * renderer, while a render is in progress. Metrics created after a
+         * render starts are rendered by the next. Renders wait for each other.
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @param[in]    renderer    Renderer to use for rendering the metrics
          *
-         * @throws MetricNameError
+         * @see Renderer::filter
          *
          * @remarks thread-safe
          */
-        StringHandle create_metric(const STR k, const std::string name, const std::string description,
-                const std::string initial_value = "", const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        void render(Renderer & renderer) const noexcept(false)
         {
-            (void)(k);
-
-            auto metric = std::make_shared<StringMetric>(name, description, m_time_function, initial_value, hook_rate_limit);
-            register_metric<StringMetric>(name, metric, m_str_metrics);
-            return metric;
+            render_filtered(renderer, renderer.filter());
         }
 
         /*!
-         * Creates a metric whose value is either @c true or @c false.
-         *
-         * @param[in]    k                     Must be BOOL::KIND
-         * @param[in]    name                  Name of the metric. This must be unique with respect to all metrics in the registry
-         * @param[in]    description           Description of the metric
-         * @param[in]    initial_value         Value with which to initialise the metric
-         * @param[in]    true_rep              String representation of the metric when its value is @c true
-         * @param[in]    false_rep             String representation of the metric when its value is @c false
-         * @param[in]    hook_rate_limit       Minimum number of milliseconds between hook operations triggered by changes to the metric. Specify std::chrono::milliseconds::zero() to disable rate limiting
+         * Schedules a regular render operation. The render operations will be
+         * performed in a different thread. Returns immediately.
          *
-         * @return a handle to the created metric, which must be de-referenced before use
+         * @param[in]    renderer    Renderer to use for rendering the metrics
+         * @param[in]    interval    Interval, in seconds, between each render operation
          *
-         * @throws MetricNameError
+         * @remarks thread-safe
+         */
+        void render_schedule(Renderer & renderer, const std::chrono::seconds interval) noexcept(false)
+        {
+            std::shared_ptr<RenderSchedule> previous;
+            {
+                std::lock_guard<std::mutex> lock(m_registry_mutex);
+                previous.swap(m_sched);
+                m_sched = std::make_shared<RenderSchedule>((*this), renderer, interval);
+            }
+
+            // Stopped without the lock held, as a render in progress needs it
+            previous = nullptr;
+        }
+
+        /*!
+         * Cancels a previously-scheduled render operation.
          *
          * @remarks thread-safe
          */
-        BoolHandle create_metric(const BOOL k, const std::string name, const std::string description,
-                const bool initial_value = false, const std::string true_rep = "TRUE", const std::string false_rep = "FALSE",
-                const std::chrono::milliseconds hook_rate_limit = std::chrono::milliseconds(1000)) noexcept(false)
+        void cancel_render_schedule() noexcept(false)
         {
-            (void)(k);
+            std::shared_ptr<RenderSchedule> sched;
+            {
+                std::lock_guard<std::mutex> lock(m_registry_mutex);
+                sched.swap(m_sched);
+            }
 
-            auto metric = std::make_shared<BoolMetric>(name, description, m_time_function, initial_value, true_rep, false_rep, hook_rate_limit);
-            register_metric<BoolMetric>(name, metric, m_bool_metrics);
-            return metric;
+            // Stopped without the lock held, as a render in progress needs it
+            sched = nullptr;
         }
 
+    private:
         /*!
-         * Creates a Throttle object for use with an unsigned metric. Throttle
-         * objects impose limits on the rate of operations performed on a
-         * metric.
+         * @class RendererContext
          *
-         * @param[in]    metric        The metric to throttle
-         * @param[in]    time_limit    The minimum number of milliseconds between updates of the metric
-         * @param[in]    op_limit      The number of attempted update operations between each actual update of the metric
+         * @brief Provides a runtime context for Renderer objects
          *
-         * @return the created Throttle object
+         * Uses RAII to ensure that a renderer object's @c before() and
+         * @c after() methods are called at the appropriate times.
          *
-         * @throws MetricNameError
+         * @remarks thread-hostile
+         */
+        class RendererContext
+        {
+        public:
+            /*!
+             * Constructor.
+             *
+             * @param[in]    renderer    The renderer to contextualise
+             */
+            RendererContext(Renderer & renderer) noexcept(false) : m_renderer(renderer)
+            {
+                m_renderer.suppressed_exception(false);
+                m_renderer.before();
+            }
+
+            /*!
+             * Destructor. Renderer exceptions are suppressed to prevent them
+             * propagating out of the destructor. This can be detected by
+             * calling Renderer::suppressed_exception()
+             */
+            ~RendererContext() noexcept
+            {
+                // Prevent exceptions in Renderer::after() from leaving the destructor
+                try
+                {
+                    m_renderer.after();
+                }
+                catch (...)
+                {
+                    m_renderer.suppressed_exception(true);
+                    return;
+                }
+            }
+
+        private:
+            Renderer & m_renderer; //!< Renderer being contextualised
+        };
+
+        /*!
+         * Adds a set of target metrics to a given SumMetric.
+         *
+         * @param[in]    metric     The SumMetric to which @c targets should be added
+         * @param[in]    targets    Metrics to be summed by @c metric
+         *
+         * @par Template arguments
+         *
+         * @par
+         * M - the SumMetric handle type
+         *
+         * @par
+         * T - the target metric handle type
          *
          * @remarks thread-safe
          */
-        UintThrottle create_throttle(UintHandle & metric, const std::chrono::milliseconds time_limit, std::uint64_t op_limit = 1)
+        template<typename M, typename T>
+        void initialise_sum_with_targets(M metric, const std::initializer_list<T> targets) const noexcept(false)
         {
-            return UintThrottle(metric, time_limit, op_limit, m_time_function);
+            for (auto target : targets)
+            {
+                metric->add_target(target);
+            }
+        }
+
+        /*!
+         * Get a new serial number, unique to a registry in the process.
+         *
+         * @return serial number
+         */
+        static std::uint64_t next_serial() noexcept
+        {
+            static std::atomic<std::uint64_t> next(0);
+
+            return next.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /*!
+         * @see Registry::render(Renderer &, const RenderFilter &)
+         */
+        void render_filtered(Renderer & renderer, const RenderFilter & filter) const noexcept(false)
+        {
+            m_ingestion->flush();
+
+            // Renders wait for each other, but the registry is locked only while the catalogue is fetched
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> render_lock(m_render_mutex);
+
+            auto catalogue = published_catalogue();
+
+            RendererContext render_ctx(renderer);
+            renderer.m_render_time = m_time_function();
+            renderer.select_registry(m_serial);
+
+            std::vector<std::shared_ptr<Metric> > selected;
+            const auto & metrics = catalogue->metrics;
+            for (const auto & prefix : filter.include())
+            {
+                auto metric = first_from(*catalogue, prefix);
+                while ((metric != metrics.end()) && (RenderFilter::starts_with((*metric)->m_name, prefix)))
+                {
+                    auto excluded = filter.excluded_by((*metric)->m_name);
+                    if (excluded != nullptr)
+                    {
+                        // The names beginning with the exclude prefix are contiguous, so skip them all
+                        metric = std::partition_point(metric, metrics.end(), [excluded](const std::shared_ptr<Metric> & candidate)
+                        {
+                            return RenderFilter::starts_with(candidate->m_name, *excluded);
+                        });
+                        continue;
+                    }
+
+                    selected.push_back(*metric);
+                    ++metric;
+                }
+            }
+
+            calculate_all(selected);
+
+            if (roll_up())
+            {
+                selected = with_roll_ups(*catalogue, selected, filter);
+            }
+
+            for (const auto & metric : selected)
+            {
+                renderer.render(metric);
+            }
         }
 
         /*!
-         * Creates a Throttle object for use with an signed metric. Throttle
-         * objects impose limits on the rate of operations performed on a
-         * metric.
-         *
-         * @param[in]    metric        The metric to throttle
-         * @param[in]    time_limit    The minimum number of milliseconds between updates of the metric
-         * @param[in]    op_limit      The number of attempted update operations between each actual update of the metric
-         *
-         * @return the created Throttle object
-         *
-         * @throws MetricNameError
-         *
-         * @remarks thread-safe
+         * An immutable list of the registry's metrics, sorted by name.
+         * Renders work from the catalogue current when they start, so the
+         * registry is locked only while they fetch it, not while metrics are
+         * calculated and rendered. Adding or removing metrics doesn't change
+         * a catalogue: the next render builds a new one instead.
          */
-        IntThrottle create_throttle(IntHandle & metric, const std::chrono::milliseconds time_limit, std::uint64_t op_limit = 1)
+        struct Catalogue
         {
-            return IntThrottle(metric, time_limit, op_limit, m_time_function);
-        }
+            std::uint64_t version; //!< Version of the index from which the catalogue was built, @see MetricIndex::version()
+            std::vector<std::shared_ptr<Metric> > metrics; //!< Every metric, in name order
+        };
 
         /*!
-         * Creates a Throttle object for use with a float metric. Throttle
-         * objects impose limits on the rate of operations performed on a
-         * metric.
-         *
-         * @param[in]    metric        The metric to throttle
-         * @param[in]    time_limit    The minimum number of milliseconds between updates of the metric
-         * @param[in]    op_limit      The number of attempted update operations between each actual update of the metric
-         *
-         * @return the created Throttle object
-         *
-         * @throws MetricNameError
-         *
-         * @remarks thread-safe
+         * An interior node of the name tree used in roll-up mode.
          */
-        FloatThrottle create_throttle(FloatHandle & metric, const std::chrono::milliseconds time_limit, std::uint64_t op_limit = 1)
+        struct RollUpNode
         {
-            return FloatThrottle(metric, time_limit, op_limit, m_time_function);
-        }
+            std::shared_ptr<RollUpMetric> metric; //!< Holds the node's aggregate value
+            std::size_t parent; //!< Index of the parent node, or the maximum std::size_t value if there is none
+            double total; //!< Sum of the metrics beneath the node, during a roll-up pass
+            bool integral; //!< Is every metric beneath the node an unsigned or signed metric?
+        };
 
         /*!
-         * Creates a Throttle object for use with an string metric. Throttle
-         * objects impose limits on the rate of operations performed on a
-         * metric.
-         *
-         * @param[in]    metric        The metric to throttle
-         * @param[in]    time_limit    The minimum number of milliseconds between updates of the metric
-         * @param[in]    op_limit      The number of attempted update operations between each actual update of the metric
-         *
-         * @return the created Throttle object
+         * Rebuilds the name tree used in roll-up mode. Nodes are stored
+         * parents first, so that a reverse traversal visits every node before
+         * its parent. The RollUpMetric of a node that survives a rebuild is
+         * kept, so that renderers' delta and rate state for it are kept too.
+         * Must be called during a render.
          *
-         * @throws MetricNameError
-         *
-         * @remarks thread-safe
+         * @param[in]    catalogue    The metrics to roll up
          */
-        StringThrottle create_throttle(StringHandle & metric, const std::chrono::milliseconds time_limit, std::uint64_t op_limit = 1)
+        void build_roll_up_tree(const Catalogue & catalogue) const noexcept(false)
         {
-            return StringThrottle(metric, time_limit, op_limit, m_time_function);
+            std::map<std::string, std::shared_ptr<RollUpMetric> > previous;
+            for (const auto & node : m_roll_up_nodes)
+            {
+                previous[node.metric->name()] = node.metric;
+            }
+
+            m_roll_up_nodes.clear();
+            m_roll_up_leaves.clear();
+
+            std::map<std::string, std::size_t> node_index;
+            for (const auto & metric : catalogue.metrics)
+            {
+                auto kind = metric->kind();
+                if ((kind != Metric::Kind::UINT) && (kind != Metric::Kind::INT) && (kind != Metric::Kind::FLOAT) &&
+                        (kind != Metric::Kind::RATE) && (kind != Metric::Kind::SUM) && (kind != Metric::Kind::BLOCK))
+                {
+                    continue;
+                }
+
+                // A callback batch is a float metric, but its value is a duration, not a count
+                if (dynamic_cast<const CallbackBatch *>(metric.get()) != nullptr)
+                {
+                    continue;
+                }
+
+                std::size_t parent = std::numeric_limits<std::size_t>::max();
+                std::size_t separator = metric->m_name.find('.');
+                while (separator != std::string::npos)
+                {
+                    std::string prefix = metric->m_name.substr(0, separator);
+                    auto named = first_from(catalogue, prefix);
+                    if ((named == catalogue.metrics.end()) || ((*named)->m_name != prefix))
+                    {
+                        auto found = node_index.find(prefix);
+                        if (found == node_index.end())
+                        {
+                            std::shared_ptr<RollUpMetric> node_metric;
+                            node_metric.swap(previous[prefix]);
+                            if (!node_metric)
+                            {
+                                node_metric = std::make_shared<RollUpMetric>(prefix, m_time_function);
+                                node_metric->m_id = m_index.reserve_id();
+                            }
+
+                            RollUpNode node = {node_metric, parent, 0.0, true};
+                            m_roll_up_nodes.push_back(node);
+                            found = node_index.insert(std::make_pair(prefix, m_roll_up_nodes.size() - 1)).first;
+                        }
+
+                        parent = found->second;
+                    }
+
+                    separator = metric->m_name.find('.', separator + 1);
+                }
+
+                if (parent != std::numeric_limits<std::size_t>::max())
+                {
+                    m_roll_up_leaves.push_back(std::make_pair(metric, parent));
+                }
+            }
+
+            // Free the IDs of the nodes that didn't survive, so that tables indexed by them don't grow
+            for (const auto & node : previous)
+            {
+                if (node.second)
+                {
+                    m_index.release_id(node.second->m_id);
+                }
+            }
+
+            m_roll_up_version = catalogue.version;
         }
 
         /*!
-         * Creates a Throttle object for use with an bool metric. Throttle
-         * objects impose limits on the rate of operations performed on a
-         * metric.
-         *
-         * @param[in]    metric        The metric to throttle
-         * @param[in]    time_limit    The minimum number of milliseconds between updates of the metric
-         * @param[in]    op_limit      The number of attempted update operations between each actual update of the metric
-         *
-         * @return the created Throttle object
+         * Works out the aggregate value of every node of the name tree in a
+         * single bottom-up pass, and merges the nodes matching a name prefix
+         * into a list of metrics to render. Must be called during a render.
          *
-         * @throws MetricNameError
+         * @param[in]    catalogue    The metrics to roll up
+         * @param[in]    selected     The metrics to render, in name order
+         * @param[in]    filter       Selects the metrics to render
          *
-         * @remarks thread-safe
+         * @return the metrics and matching nodes to render, in name order
          */
-        BoolThrottle create_throttle(BoolHandle & metric, const std::chrono::milliseconds time_limit, std::uint64_t op_limit = 1)
+        std::vector<std::shared_ptr<Metric> > with_roll_ups(const Catalogue & catalogue, const std::vector<std::shared_ptr<Metric> > & selected,
+                const RenderFilter & filter) const noexcept(false)
         {
-            return BoolThrottle(metric, time_limit, op_limit, m_time_function);
+            if (m_roll_up_version != catalogue.version)
+            {
+                build_roll_up_tree(catalogue);
+            }
+
+            for (auto & node : m_roll_up_nodes)
+            {
+                node.total = 0.0;
+                node.integral = true;
+            }
+
+            for (const auto & leaf : m_roll_up_leaves)
+            {
+                auto & parent = m_roll_up_nodes[leaf.second];
+                parent.total += leaf.first->numeric_value();
+                parent.integral = (parent.integral) && ((leaf.first->kind() == Metric::Kind::UINT) || (leaf.first->kind() == Metric::Kind::INT) ||
+                        (leaf.first->kind() == Metric::Kind::BLOCK));
+            }
+
+            std::vector<std::pair<std::string, std::shared_ptr<Metric> > > nodes;
+            for (std::size_t index = m_roll_up_nodes.size(); index > 0; --index)
+            {
+                auto & node = m_roll_up_nodes[index - 1];
+                if (node.parent != std::numeric_limits<std::size_t>::max())
+                {
+                    auto & parent = m_roll_up_nodes[node.parent];
+                    parent.total += node.total;
+                    parent.integral = (parent.integral) && (node.integral);
+                }
+
+                node.metric->set(node.total, node.integral);
+
+                std::string name = node.metric->name();
+                if (filter.matches(name))
+                {
+                    nodes.push_back(std::make_pair(name, node.metric));
+                }
+            }
+
+            std::sort(nodes.begin(), nodes.end(), [](const std::pair<std::string, std::shared_ptr<Metric> > & lhs,
+                    const std::pair<std::string, std::shared_ptr<Metric> > & rhs)
+            {
+                return lhs.first < rhs.first;
+            });
+
+            // Both lists are in name order, so merge them
+            std::vector<std::shared_ptr<Metric> > result;
+            result.reserve(selected.size() + nodes.size());
+
+            auto node = nodes.begin();
+            for (const auto & metric : selected)
+            {
+                std::string name = metric->name();
+                while ((node != nodes.end()) && (node->first < name))
+                {
+                    result.push_back(node->second);
+                    ++node;
+                }
+
+                result.push_back(metric);
+            }
+
+            for (;node != nodes.end();++node)
+            {
+                result.push_back(node->second);
+            }
+
+            return result;
         }
 
         /*!
-         * Looks up an unsigned metric by name. Avoid performing lookups in
-         * performance-critical code. Instead, keep the metric handle returned
-         * on creation and manipulate that directly.
-         *
-         * @param[in]    k       Must be UINT::KIND
-         * @param[in]    name    Name of the metric to look up
+         * Calculates a set of metrics, and any metrics they depend on, in
+         * dependency order. Each metric is calculated exactly once, even if
+         * several metrics depend on it. Large sets are split into chunks
+         * calculated in parallel, in which case a metric shared between
+         * chunks is calculated by whichever thread reaches it first.
          *
-         * @return a handle to the found metric
-         *
-         * @throws MetricNameError
-         * @throws MetricTypeError
+         * @param[in]    metrics    The metrics to calculate
          *
          * @remarks thread-safe
          */
-        UintHandle operator()(const UINT k, const std::string name) const noexcept(false)
+        void calculate_all(const std::vector<std::shared_ptr<Metric> > & metrics) const noexcept(false)
         {
-            // TODO: Replace with std::scoped_lock on migration to C++17
-            std::lock_guard<std::mutex> lock(m_registry_mutex);
+            const std::uint64_t pass = Metric::next_calculation_pass();
 
-            auto entry = lookup(name, Metric::Kind::UINT);
-            return m_uint_metrics[entry->second.second];
+            std::size_t thread_count = 1;
+            if ((metrics.size() >= m_parallel_min_metrics) && (m_parallel_max_threads > 1))
+            {
+                thread_count = std::min(m_parallel_max_threads, metrics.size());
+            }
+
+            const std::size_t chunk_size = (metrics.size() + thread_count - 1) / thread_count;
+            std::vector<std::exception_ptr> errors(thread_count);
+
+            auto calculate_chunk = [&metrics, &errors, chunk_size, pass](std::size_t chunk)
+            {
+                try
+                {
+                    const std::size_t chunk_end = std::min(metrics.size(), (chunk + 1) * chunk_size);
+                    for (std::size_t index=chunk*chunk_size;index<chunk_end;++index)
+                    {
+                        calculate_in_order(metrics[index], pass);
+                    }
+                }
+                catch (...)
+                {
+                    errors[chunk] = std::current_exception();
+                }
+            };
+
+            m_expressions->begin_pass();
+
+            std::vector<std::thread> workers;
+            for (std::size_t chunk=1;chunk<thread_count;++chunk)
+            {
+                workers.push_back(std::thread(calculate_chunk, chunk));
+            }
+
+            calculate_chunk(0);
+
+            for (auto & worker : workers)
+            {
+                worker.join();
+            }
+
+            m_expressions->end_pass();
+
+            for (auto & error : errors)
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
         }
 
         /*!
-         * Looks up an signed metric by name. Avoid performing lookups in
-         * performance-critical code. Instead, keep the metric handle returned
-         * on creation and manipulate that directly.
-         *
-         * @param[in]    k       Must be INT::KIND
-         * @param[in]    name    Name of the metric to look up
-         *
-         * @return a handle to the found metric
+         * Calculates a metric after first calculating the metrics it depends
+         * on, unless it has already been calculated in the specified pass.
          *
-         * @throws MetricNameError
-         * @throws MetricTypeError
+         * @param[in]    metric    The metric to calculate
+         * @param[in]    pass      The calculation pass
          *
          * @remarks thread-safe
          */
-        IntHandle operator()(const INT k, const std::string name) const noexcept(false)
+        static void calculate_in_order(const std::shared_ptr<Metric> & metric, const std::uint64_t pass) noexcept(false)
         {
-            // TODO: Replace with std::scoped_lock on migration to C++17
-            std::lock_guard<std::mutex> lock(m_registry_mutex);
+            if (!metric->claim_calculation(pass))
+            {
+                metric->await_calculation(pass);
+                return;
+            }
 
-            auto entry = lookup(name, Metric::Kind::INT);
-            return m_int_metrics[entry->second.second];
+            try
+            {
+                for (const auto & dependency : metric->dependencies())
+                {
+                    calculate_in_order(dependency, pass);
+                }
+
+                metric->calculate();
+            }
+            catch (...)
+            {
+                // Don't leave other threads waiting for a calculation that will never complete
+                metric->complete_calculation(pass);
+                throw;
+            }
+
+            metric->complete_calculation(pass);
         }
 
         /*!
-         * Looks up an float metric by name. Avoid performing lookups in
-         * performance-critical code. Instead, keep the metric handle returned
-         * on creation and manipulate that directly.
-         *
-         * @param[in]    k       Must be FLOAT::KIND
-         * @param[in]    name    Name of the metric to look up
-         *
-         * @return a handle to the found metric
-         *
-         * @throws MetricNameError
-         * @throws MetricTypeError
-         *
-         * @remarks thread-safe
+         * The metrics a thread has looked up in a registry, held in an
+         * open-addressing hash table that's probed linearly for a few slots
+         * from a name's hash. When the probed slots are full, the first is
+         * overwritten.
          */
-        FloatHandle operator()(const FLOAT k, const std::string name) const noexcept(false)
+        struct LookupCache
         {
-            // TODO: Replace with std::scoped_lock on migration to C++17
-            std::lock_guard<std::mutex> lock(m_registry_mutex);
+            static const std::size_t SLOTS = 1024; //!< Number of slots. Must be a power of 2
+            static const std::size_t PROBES = 4; //!< Number of slots in which a name may be cached
 
-            auto entry = lookup(name, Metric::Kind::FLOAT);
-            return m_float_metrics[entry->second.second];
-        }
+            /*!
+             * A cached metric. The slot doesn't own the metric: every slot is
+             * emptied when the registry's generation counter changes, i.e.
+             * whenever a metric is removed.
+             */
+            struct Slot
+            {
+                Slot() noexcept : hash(0), metric(nullptr)
+                {
+                }
+
+                std::uint64_t hash; //!< Hash of the metric's name
+                std::string name; //!< Name of the metric
+                Metric * metric; //!< The metric, or @c nullptr if the slot is empty
+            };
+
+            /*!
+             * Constructor.
+             *
+             * @param[in]    registry_generation    Generation counter of the registry whose metrics are cached
+             */
+            LookupCache(const std::shared_ptr<std::atomic<std::uint64_t> > & registry_generation) noexcept(false)
+            : source(registry_generation), generation(registry_generation->load()), slots(new Slot[SLOTS])
+            {
+            }
+
+            std::shared_ptr<std::atomic<std::uint64_t> > source; //!< Generation counter of the registry whose metrics are cached
+            std::uint64_t generation; //!< Value of the generation counter when the cache was last cleared
+            std::unique_ptr<Slot[]> slots; //!< The slots
+        };
 
         /*!
-         * Looks up a string metric by name. Avoid performing lookups in
-         * performance-critical code. Instead, keep the metric handle returned
-         * on creation and manipulate that directly.
-         *
-         * @param[in]    k       Must be STR::KIND
-         * @param[in]    name    Name of the metric to look up
-         *
-         * @return a handle to the found metric
+         * Looks a metric up by its name in the calling thread's cache,
+         * filling the cache from the index on a miss.
          *
-         * @throws MetricNameError
-         * @throws MetricTypeError
+         * @see Registry::lookup(const MetricKey &)
          *
-         * @remarks thread-safe
+         * @return the cache slot holding the found metric, which remains valid until the calling thread's next lookup
          */
-        StringHandle operator()(const STR k, const std::string name) const noexcept(false)
+        const LookupCache::Slot & cached_lookup(const MetricKey & name) const noexcept(false)
         {
-            // TODO: Replace with std::scoped_lock on migration to C++17
-            std::lock_guard<std::mutex> lock(m_registry_mutex);
+            thread_local std::vector<std::unique_ptr<LookupCache> > caches;
 
-            auto entry = lookup(name, Metric::Kind::STR);
-            return m_str_metrics[entry->second.second];
+            LookupCache * cache = nullptr;
+            for (const auto & candidate : caches)
+            {
+                if (candidate->source == m_generation)
+                {
+                    cache = candidate.get();
+                    break;
+                }
+            }
+
+            if (cache == nullptr)
+            {
+                // Forget the caches of destroyed registries
+                caches.erase(std::remove_if(caches.begin(), caches.end(), [](const std::unique_ptr<LookupCache> & candidate)
+                {
+                    return candidate->source.use_count() == 1;
+                }), caches.end());
+
+                caches.emplace_back(new LookupCache(m_generation));
+                cache = caches.back().get();
+            }
+
+            const std::uint64_t generation = m_generation->load();
+            if (generation != cache->generation)
+            {
+                for (std::size_t index = 0; index < LookupCache::SLOTS; ++index)
+                {
+                    cache->slots[index].metric = nullptr;
+                }
+
+                cache->generation = generation;
+            }
+
+            const std::size_t home = std::size_t(name.hash()) & (LookupCache::SLOTS - 1);
+            std::size_t vacant = home;
+            for (std::size_t probe = 0; probe < LookupCache::PROBES; ++probe)
+            {
+                auto & slot = cache->slots[(home + probe) & (LookupCache::SLOTS - 1)];
+                if (slot.metric == nullptr)
+                {
+                    vacant = (home + probe) & (LookupCache::SLOTS - 1);
+                    break;
+                }
+
+                if (name.matches(slot.name, slot.hash))
+                {
+                    return slot;
+                }
+            }
+
+            MetricIndex::Guard guard(m_index);
+            auto entry = lookup(name);
+            auto & slot = cache->slots[vacant];
+            slot.metric = nullptr;
+            slot.name.assign(name.data(), name.length());
+            slot.hash = name.hash();
+            slot.metric = entry->metric.get();
+
+            return slot;
         }
 
         /*!
-         * Looks up a bool metric by name. Avoid performing lookups in
-         * performance-critical code. Instead, keep the metric handle returned
-         * on creation and manipulate that directly.
+         * Looks a metric up by its name, whatever its kind.
          *
-         * @param[in]    k       Must be BOOL::KIND
-         * @param[in]    name    Name of the metric to look up
+         * @param[in]    name    Name of the metric to lookup
          *
-         * @return a handle to the found metric
+         * @return the found metric's index entry
          *
          * @throws MetricNameError
-         * @throws MetricTypeError
+         * @throws MetricTypeError if the metric isn't of a kind that can be looked up
          *
          * @remarks thread-safe
          */
-        BoolHandle operator()(const BOOL k, const std::string name) const noexcept(false)
+        const MetricIndex::Entry * lookup(const MetricKey & name) const noexcept(false)
         {
-            // TODO: Replace with std::scoped_lock on migration to C++17
-            std::lock_guard<std::mutex> lock(m_registry_mutex);
+            auto entry = m_index.find(name);
+            if (entry == nullptr)
+            {
+                throw MetricNameError("No metric exists called \"" + name.str() + "\"");
+            }
+            else if (!entry->lookup)
+            {
+                throw MetricTypeError("The metric called \"" + entry->name + "\" is not of a kind that can be looked up");
+            }
 
-            auto entry = lookup(name, Metric::Kind::BOOL);
-            return m_bool_metrics[entry->second.second];
+            return entry;
         }
 
         /*!
-         * Renders any metric in the registry whose name begins with
-         * @c name_prefix using the provided Renderer object. Metrics'
-         * @c calculate() methods are called automatically prior to rendering.
+         * Looks a metric up by its name and kind.
          *
-         * @param[in]    renderer       Renderer to use for rendering the metrics
-         * @param[in]    name_prefix    Prefix of the metric names to be rendered
+         * @param[in]    name             Name of the metric to lookup
+         * @param[in]    expected_kind    Kind of the metric to lookup
          *
-         * @remarks thread-safe
-         */
-        void render(Renderer & renderer, const std::string & name_prefix) const noexcept(false)
-        {
-            render_with_prefix(renderer, name_prefix);
-        }
-
-        /*!
-         * @see Registry::render(Renderer &, const std::string &)
-         */
-        void render(Renderer & renderer, const char * name_prefix) const noexcept(false)
-        {
-            std::string str_prefix(name_prefix);
-            render_with_prefix(renderer, str_prefix);
-        }
-
-        /*!
-         * Renders all metrics in the registry.
+         * @return the found metric's index entry
          *
-         * @param[in]    renderer    Renderer to use for rendering the metrics
+         * @throws MetricNameError
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        void render(Renderer & renderer) const noexcept(false)
+        const MetricIndex::Entry * lookup(const MetricKey & name, const Metric::Kind expected_kind) const noexcept(false)
         {
-            std::string dummy_prefix;
-            render_with_prefix(renderer, dummy_prefix);
+            auto entry = find_as(name, expected_kind);
+            if (entry == nullptr)
+            {
+                throw MetricNameError("No metric exists called \"" + name.str() + "\"");
+            }
+
+            return entry;
         }
 
         /*!
-         * Schedules a regular render operation. The render operations will be
-         * performed in a different thread. Returns immediately.
+         * Looks a metric up by its name and kind, if it exists.
          *
-         * @param[in]    renderer    Renderer to use for rendering the metrics
-         * @param[in]    interval    Interval, in seconds, between each render operation
+         * @param[in]    name             Name of the metric to lookup
+         * @param[in]    expected_kind    Kind of the metric to lookup
          *
-         * @remarks thread-safe
-         */
-        void render_schedule(Renderer & renderer, const std::chrono::seconds interval) noexcept(false)
-        {
-            std::lock_guard<std::mutex> lock(m_registry_mutex);
-
-            m_sched = std::make_shared<RenderSchedule>((*this), renderer, interval);
-        }
-
-        /*!
-         * Cancels a previously-scheduled render operation.
+         * @return the found metric's index entry, or @c nullptr if there's no metric with the name
+         *
+         * @throws MetricTypeError
          *
          * @remarks thread-safe
          */
-        void cancel_render_schedule() noexcept(false)
+        const MetricIndex::Entry * find_as(const MetricKey & name, const Metric::Kind expected_kind) const noexcept(false)
         {
-            std::lock_guard<std::mutex> lock(m_registry_mutex);
+            auto entry = m_index.find(name);
+            if (entry == nullptr)
+            {
+                return nullptr;
+            }
+            else if (entry->metric->kind() != expected_kind)
+            {
+                throw MetricTypeError("The metric called \"" + entry->name + "\" is of an unexpected kind: actual kind is " +
+                        entry->metric->kind_name() + "; expected kind is " + entry->metric->kind_name(expected_kind));
+            }
+            else if (!entry->lookup)
+            {
+                throw MetricTypeError("The metric called \"" + entry->name + "\" is not of a kind that can be looked up");
+            }
 
-            m_sched = nullptr;
+            return entry;
         }
 
-    private:
         /*!
-         * @class RendererContext
-         *
-         * @brief Provides a runtime context for Renderer objects
-         *
-         * Uses RAII to ensure that a renderer object's @c before() and
-         * @c after() methods are called at the appropriate times.
-         *
-         * @remarks thread-hostile
+         * Storage for metrics created in bulk. The metrics are constructed
+         * in place, in one allocation, and destroyed with the arena.
          */
-        class RendererContext
+        template<typename T>
+        class MetricArena
         {
         public:
             /*!
              * Constructor.
              *
-             * @param[in]    renderer    The renderer to contextualise
+             * @param[in]    capacity    Number of metrics the arena can hold
              */
-            RendererContext(Renderer & renderer) noexcept(false) : m_renderer(renderer)
+            MetricArena(const std::size_t capacity) noexcept(false)
+            : m_storage(new char[(capacity * sizeof(T)) + alignof(T)]), m_first(nullptr), m_constructed(0)
             {
-                m_renderer.suppressed_exception(false);
-                m_renderer.before();
+                const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(m_storage.get());
+                m_first = reinterpret_cast<T *>((address + alignof(T) - 1) & ~std::uintptr_t(alignof(T) - 1));
             }
 
+            MetricArena(const MetricArena &) = delete;
+            MetricArena(MetricArena &&) = delete;
+            MetricArena & operator=(const MetricArena &) = delete;
+            MetricArena & operator=(MetricArena &&) = delete;
+
             /*!
-             * Destructor. Renderer exceptions are suppressed to prevent them
-             * propagating out of the destructor. This can be detected by
-             * calling Renderer::suppressed_exception()
+             * Destructor. Destroys the metrics.
              */
-            ~RendererContext() noexcept
+            ~MetricArena() noexcept
             {
-                // Prevent exceptions in Renderer::after() from leaving the destructor
-                try
-                {
-                    m_renderer.after();
-                }
-                catch (...)
+                while (m_constructed > 0)
                 {
-                    m_renderer.suppressed_exception(true);
-                    return;
+                    m_first[--m_constructed].~T();
                 }
             }
 
+            /*!
+             * Constructs the next metric. There must be room for it.
+             *
+             * @return the metric
+             */
+            template<typename... Args>
+            T * construct(Args &&... args) noexcept(false)
+            {
+                T * metric = new (m_first + m_constructed) T(std::forward<Args>(args)...);
+                ++m_constructed;
+                return metric;
+            }
+
         private:
-            Renderer & m_renderer; //!< Renderer being contextualised
+            std::unique_ptr<char[]> m_storage; //!< The allocation
+            T * m_first; //!< First metric in the allocation, suitably aligned
+            std::size_t m_constructed; //!< Number of metrics constructed
+
         };
 
         /*!
-         * Adds a set of target metrics to a given SumMetric.
-         *
-         * @param[in]    metric     The SumMetric to which @c targets should be added
-         * @param[in]    targets    Metrics to be summed by @c metric
-         *
-         * @par Template arguments
-         *
-         * @par
-         * M - the SumMetric handle type
+         * @see Registry::create_metrics(const UINT, const std::vector<MetricSpec> &, const std::chrono::milliseconds)
          *
-         * @par
-         * T - the target metric handle type
-         *
-         * @remarks thread-safe
+         * @param[in]    configure    Called for each metric, with the registry locked, before the metric is published
          */
-        template<typename M, typename T>
-        void initialise_sum_with_targets(M metric, const std::initializer_list<T> targets) const noexcept(false)
+        template<typename T>
+        std::vector<std::shared_ptr<T> > create_bulk(const std::vector<MetricSpec> & specs, const std::chrono::milliseconds hook_rate_limit,
+                std::vector<std::shared_ptr<T> > & metric_registry, const std::function<void (T &)> & configure) noexcept(false)
         {
-            for (auto target : targets)
+            std::vector<const std::string *> names;
+            names.reserve(specs.size());
+            for (const auto & spec : specs)
             {
-                metric->add_target(target);
+                names.push_back(&spec.name);
+            }
+
+            std::sort(names.begin(), names.end(), [](const std::string * lhs, const std::string * rhs)
+            {
+                return *lhs < *rhs;
+            });
+
+            for (std::size_t index = 1; index < names.size(); ++index)
+            {
+                if (*names[index] == *names[index - 1])
+                {
+                    throw MetricNameError("The name \"" + *names[index] + "\" is used more than once");
+                }
+            }
+
+            auto arena = std::make_shared<MetricArena<T> >(specs.size());
+            std::vector<std::shared_ptr<T> > metrics;
+            metrics.reserve(specs.size());
+            for (const auto & spec : specs)
+            {
+                metrics.push_back(std::shared_ptr<T>(arena, arena->construct(spec.name, spec.unit, spec.description, m_time_function, 0, hook_rate_limit)));
+            }
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_registry_mutex);
+
+            for (const auto & spec : specs)
+            {
+                if (m_index.find(spec.name) != nullptr)
+                {
+                    throw MetricNameError("A metric already exists with the name \"" + spec.name + "\"");
+                }
             }
+
+            m_index.reserve(specs.size());
+            metric_registry.reserve(metric_registry.size() + specs.size());
+
+            for (std::size_t index = 0; index < specs.size(); ++index)
+            {
+                auto & metric = metrics[index];
+                configure(*metric);
+                m_index.insert(specs[index].name, metric, true);
+                metric_registry.push_back(metric);
+            }
+
+            return metrics;
         }
 
         /*!
-         * @see Registry::render(Renderer &, const std::string &)
+         * @see Registry::operator()(const UINT, const std::vector<MetricKey> &)
          */
-        void render_with_prefix(Renderer & renderer, const std::string & name_prefix) const noexcept(false)
+        template<typename T>
+        std::vector<std::shared_ptr<T> > lookup_all(const std::vector<MetricKey> & names, const Metric::Kind expected_kind) const noexcept(false)
         {
-            // TODO: Replace with std::scoped_lock on migration to C++17
-            std::lock_guard<std::mutex> lock(m_registry_mutex);
+            MetricIndex::Guard guard(m_index);
 
-            RendererContext render_ctx(renderer);
+            std::vector<std::shared_ptr<T> > metrics;
+            metrics.reserve(names.size());
+            for (const auto & name : names)
+            {
+                metrics.push_back(std::static_pointer_cast<T>(lookup(name, expected_kind)->metric));
+            }
+
+            return metrics;
+        }
+
+        /*!
+         * Removes metrics from the index and the kind-specific stores, along
+         * with the metrics that can't do without them. Must be called with
+         * the registry locked.
+         *
+         * @param[in,out]    names    Names of the metrics to remove. The names of dependent metrics that are removed too are appended
+         */
+        void unregister(std::vector<std::string> & names) noexcept(false)
+        {
+            if (names.empty())
+            {
+                return;
+            }
+
+            std::set<const Metric *> removed;
+            for (const auto & name : names)
+            {
+                removed.insert(m_index.find(name)->metric.get());
+            }
 
-            for (auto metric : m_metrics)
+            auto catalogue = current_catalogue();
+            bool cascaded = true;
+            while (cascaded)
             {
-                if ((name_prefix.length() == 0) || (metric.first.find(name_prefix) == 0))
+                cascaded = false;
+                for (const auto & metric : catalogue->metrics)
                 {
-                    metric.second.first->calculate();
-                    renderer.render(metric.second.first);
+                    if (removed.count(metric.get()) != 0)
+                    {
+                        continue;
+                    }
+
+                    for (const auto & dependency : metric->dependencies())
+                    {
+                        if ((removed.count(dependency.get()) != 0) && (!metric->drop_dependency(*dependency)))
+                        {
+                            removed.insert(metric.get());
+                            names.push_back(metric->m_name);
+                            cascaded = true;
+                            break;
+                        }
+                    }
                 }
             }
+
+            for (const auto & name : names)
+            {
+                m_index.remove(name);
+            }
+
+            // The catalogue is out of date, and mustn't keep the removed metrics alive until the next render
+            catalogue.reset();
+            m_catalogue.reset();
+
+            forget(m_uint_metrics, removed);
+            forget(m_int_metrics, removed);
+            forget(m_float_metrics, removed);
+            forget(m_str_metrics, removed);
+            forget(m_bool_metrics, removed);
+            forget(m_mean_metrics, removed);
+            forget(m_derived_metrics, removed);
+            forget(m_windowed_metrics, removed);
+            forget(m_ewma_metrics, removed);
+            forget(m_category_metrics, removed);
+            forget(m_state_metrics, removed);
+            forget(m_callback_metrics, removed);
+            forget(m_block_metrics, removed);
+
+            m_generation->fetch_add(1);
         }
 
         /*!
-         * Looks a metric up by its name and kind.
+         * Removes metrics from a kind-specific store.
+         */
+        template<typename T>
+        static void forget(std::vector<std::shared_ptr<T> > & metric_registry, const std::set<const Metric *> & removed) noexcept
+        {
+            metric_registry.erase(std::remove_if(metric_registry.begin(), metric_registry.end(), [&removed](const std::shared_ptr<T> & metric)
+            {
+                return removed.count(metric.get()) != 0;
+            }), metric_registry.end());
+        }
+
+        /*!
+         * Registers a metric that can be looked up by name with the registry,
+         * unless another thread has registered a metric of the same kind
+         * under its name first.
          *
-         * @param[in]    name             Name of the metric to lookup
-         * @param[in]    expected_kind    Kind of the metric to lookup
+         * @param[in]    name               Name of the metric
+         * @param[in]    metric             Metric object
+         * @param[in]    metric_registry    Kind-specific registry in which to store the metric
+         * @param[in]    configure          Called with the registry locked, before the metric is registered
          *
-         * @return iterator to a pair describing the found metric and its index in the kind-specific vector
+         * @return the registered metric: either @c metric or the metric registered first
          *
-         * @throws MetricNameError
-         * @throws MetricTypeError
+         * @throws MetricTypeError if a metric of another kind has the name
          *
          * @remarks thread-safe
          */
-        std::map<std::string, std::pair<std::shared_ptr<Metric>, std::uint64_t> >::const_iterator
-        lookup(const std::string & name, const Metric::Kind expected_kind) const noexcept(false)
+        template<typename T>
+        std::shared_ptr<T> register_or_adopt(const MetricKey & name, std::shared_ptr<T> & metric, std::vector<std::shared_ptr<T> > & metric_registry,
+                const std::function<void (T &)> & configure) noexcept(false)
         {
-            auto entry = m_metrics.find(name);
-            if (entry == m_metrics.end())
-            {
-                throw MetricNameError("No metric exists called \"" + name + "\"");
-            }
-            else if (entry->second.first->kind() != expected_kind)
-            {
-                throw MetricTypeError("The metric called \"" + name + "\" is of an unexpected kind: actual kind is " +
-                        entry->second.first->kind_name() + "; expected kind is " + entry->second.first->kind_name(expected_kind));
-            }
-            else if (entry->second.second == std::numeric_limits<std::uint64_t>::max())
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_registry_mutex);
+
+            auto entry = find_as(name, metric->kind());
+            if (entry != nullptr)
             {
-                throw MetricTypeError("The metric called \"" + name + "\" is not of a kind that can be looked up");
+                return std::static_pointer_cast<T>(entry->metric);
             }
 
-            return entry;
+            configure(*metric);
+            m_index.insert(metric->name(), metric, true);
+            metric_registry.push_back(metric);
+
+            return metric;
         }
 
         /*!
@@ -3447,12 +12809,10 @@ namespace measuro
         {
             std::lock_guard<std::mutex> lock(m_registry_mutex);
 
-            if (m_metrics.find(metric_name) != m_metrics.end())
+            if (m_index.insert(metric_name, metric, false) == nullptr)
             {
                 throw MetricNameError("A metric already exists with the name \"" + metric_name + "\"");
             }
-
-            m_metrics[metric_name] = std::pair<std::shared_ptr<Metric>, std::uint64_t>(metric, std::numeric_limits<std::uint64_t>::max());
         }
 
         /*!
@@ -3472,24 +12832,143 @@ namespace measuro
         {
             std::lock_guard<std::mutex> lock(m_registry_mutex);
 
-            if (m_metrics.find(metric_name) != m_metrics.end())
+            if (m_index.insert(metric_name, metric, true) == nullptr)
             {
                 throw MetricNameError("A metric already exists with the name \"" + metric_name + "\"");
             }
 
             metric_registry.push_back(metric);
-            m_metrics[metric_name] = std::pair<std::shared_ptr<Metric>, std::uint64_t>(metric, metric_registry.size() - 1);
+        }
+
+        /*!
+         * Get the current catalogue. A new catalogue is built only when
+         * metrics have been added or removed since the last was built. Must
+         * be called with the registry locked.
+         *
+         * @return the catalogue
+         */
+        std::shared_ptr<const Catalogue> current_catalogue() const noexcept(false)
+        {
+            if ((!m_catalogue) || (m_catalogue->version != m_index.version()))
+            {
+                m_catalogue = build_catalogue();
+            }
+
+            return m_catalogue;
+        }
+
+        /*!
+         * Get the current catalogue, for a render. The registry is locked only
+         * to fetch and publish catalogues, so when one must be built, metrics
+         * can still be created while it's sorted.
+         *
+         * @return the catalogue
+         */
+        std::shared_ptr<const Catalogue> published_catalogue() const noexcept(false)
+        {
+            {
+                // TODO: Replace with std::scoped_lock on migration to C++17
+                std::lock_guard<std::mutex> lock(m_registry_mutex);
+
+                if ((m_catalogue) && (m_catalogue->version == m_index.version()))
+                {
+                    return m_catalogue;
+                }
+            }
+
+            auto catalogue = build_catalogue();
+
+            // TODO: Replace with std::scoped_lock on migration to C++17
+            std::lock_guard<std::mutex> lock(m_registry_mutex);
+
+            // Another thread may have published a newer catalogue while this one was built
+            if ((!m_catalogue) || (m_catalogue->version < catalogue->version))
+            {
+                m_catalogue = catalogue;
+            }
+
+            return catalogue;
+        }
+
+        /*!
+         * Builds a catalogue of the metrics in the index. The catalogue's
+         * version is read first, so the catalogue holds at least the metrics
+         * of that version: if it holds later ones, it's only rebuilt sooner.
+         *
+         * @return the catalogue
+         */
+        std::shared_ptr<const Catalogue> build_catalogue() const noexcept(false)
+        {
+            std::shared_ptr<Catalogue> catalogue = std::make_shared<Catalogue>();
+            catalogue->version = m_index.version();
+
+            MetricIndex::Guard guard(m_index);
+            auto entries = m_index.sorted();
+
+            catalogue->metrics.reserve(entries.size());
+            for (const auto entry : entries)
+            {
+                catalogue->metrics.push_back(entry->metric);
+            }
+
+            return catalogue;
+        }
+
+        /*!
+         * Finds the first metric in a catalogue whose name doesn't sort
+         * before a name.
+         *
+         * @param[in]    catalogue    The catalogue
+         * @param[in]    name         The name
+         *
+         * @return the metric, or the end of the catalogue if every metric's name sorts before @c name
+         */
+        static std::vector<std::shared_ptr<Metric> >::const_iterator first_from(const Catalogue & catalogue, const std::string & name) noexcept
+        {
+            return std::lower_bound(catalogue.metrics.begin(), catalogue.metrics.end(), name, [](const std::shared_ptr<Metric> & metric, const std::string & value)
+            {
+                return metric->m_name < value;
+            });
         }
 
         mutable std::mutex m_registry_mutex; //!< Mutex for the registry
         std::function<std::chrono::steady_clock::time_point ()> m_time_function; //!< Function used to determine the time
-        std::map<std::string, std::pair<std::shared_ptr<Metric>, std::uint64_t> > m_metrics; //!< Generic metric store
+        mutable MetricIndex m_index; //!< Generic metric store, keyed by name. Mutable so that renders can reserve IDs for roll-up nodes
+        const std::uint64_t m_serial; //!< Number unique to the registry in the process, by which renderers tell registries apart
+        mutable std::shared_ptr<const Catalogue> m_catalogue; //!< The current catalogue, or @c nullptr if none has been built
+        mutable std::mutex m_render_mutex; //!< Serialises renders, and guards the state they share: the parallel calculation settings and the roll-up name tree
+        std::size_t m_parallel_min_metrics; //!< Minimum number of metrics in a render operation for calculations to be performed in parallel
+        std::size_t m_parallel_max_threads; //!< Maximum number of threads between which calculations are split
 
         std::vector<UintHandle> m_uint_metrics; //!< Unsigned metric store
         std::vector<IntHandle> m_int_metrics; //!< Signed metric store
         std::vector<FloatHandle> m_float_metrics; //!< Float metric store
         std::vector<StringHandle> m_str_metrics; //!< String metric store
         std::vector<BoolHandle> m_bool_metrics; //!< Bool metric store
+        std::vector<MeanHandle> m_mean_metrics; //!< Mean metric store
+        std::vector<DerivedHandle> m_derived_metrics; //!< Derived metric store
+        std::vector<WindowedHandle> m_windowed_metrics; //!< Windowed counter metric store
+        std::vector<EwmaHandle> m_ewma_metrics; //!< EWMA metric store
+        std::vector<CategoryHandle> m_category_metrics; //!< Category counter metric store
+        std::vector<StateHandle> m_state_metrics; //!< State machine metric store
+        std::vector<CallbackHandle> m_callback_metrics; //!< Callback gauge metric store
+        std::vector<BlockCounterHandle> m_block_metrics; //!< Block counter metric store
+
+        std::shared_ptr<ExpressionPool> m_expressions; //!< Pool in which the expressions of derived metrics are compiled
+
+        bool m_roll_up; //!< Are metrics rolled up through their dotted names?
+        mutable std::uint64_t m_roll_up_version; //!< Version of the catalogue from which the roll-up name tree was built
+        mutable std::vector<RollUpNode> m_roll_up_nodes; //!< Interior nodes of the roll-up name tree, parents first
+        mutable std::vector<std::pair<std::shared_ptr<Metric>, std::size_t> > m_roll_up_leaves; //!< Metrics that are rolled up, with the index of the node each belongs to
+
+        bool m_adaptive_sharding; //!< Are contended unsigned and signed metrics promoted to a sharded representation?
+        std::uint64_t m_contention_threshold; //!< Failed updates of a metric between renders that trigger its promotion
+        ShardBy m_shard_by; //!< How promoted metrics' shards are chosen
+
+        std::atomic<bool> m_lookup_cache; //!< Are lookups by name served from per-thread caches?
+        std::shared_ptr<std::atomic<std::uint64_t> > m_generation; //!< Incremented whenever metrics are removed, invalidating the lookup caches. Shared with the caches so that those of a destroyed registry can be recognised
+
+        std::shared_ptr<Ingestion> m_ingestion; //!< Queues updates for the aggregator. Destroyed before the metrics it updates
 
         std::shared_ptr<RenderSchedule> m_sched; //!< Scheduler for scheduling regular render operations
     };
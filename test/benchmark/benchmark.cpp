@@ -34,11 +34,15 @@
  * hardware/OS/environment.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <chrono>
 #include <string>
 #include <vector>
 #include <iostream>
+#include <thread>
+#include <cmath>
 
 #include "measuro.hpp"
 
@@ -145,6 +149,237 @@ std::int64_t hard_work(bool use_metrics, bool use_throttle, Metrics & m)
     return candidate - 1;
 }
 
+/*
+ * Measures the cost of a hot counter under the given sampling configuration:
+ * the mean time per increment across the worker threads, and the error in the
+ * counter's final value.
+ */
+void sampled_work(Registry & reg, const std::string name, const Sampling sampling)
+{
+    const std::uint64_t increments_per_thread = 20000000;
+    const std::size_t thread_count = ThreadSlot::count(4);
+
+    auto counter = reg.create_metric(UINT::KIND, name, "increment(s)", "Increments of a hot counter", 0,
+            std::chrono::milliseconds(1000), sampling);
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        workers.emplace_back([&counter, increments_per_thread]
+        {
+            for (std::uint64_t j = 0; j < increments_per_thread; ++j)
+            {
+                ++(*counter);
+            }
+        });
+    }
+
+    for (auto & worker : workers)
+    {
+        worker.join();
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    double expected = double(increments_per_thread * thread_count);
+    double error = std::fabs(double(std::uint64_t(*counter)) - expected);
+
+    std::cout << name << ": " << (double(elapsed.count()) / double(increments_per_thread)) << " ns/increment, error = "
+            << (100.0 * error / expected) << "% (bound " << (100.0 * counter->error_bound() / expected) << "%)\n";
+}
+
+/*
+ * Increments a hot counter from many worker threads: either a plain atomic
+ * counter, or one promoted to per-thread or per-CPU shards. Prints the mean
+ * time per increment across the worker threads.
+ */
+void sharded_work(Registry & reg, const std::string name, const bool promote, const ShardBy by)
+{
+    const std::uint64_t increments_per_thread = 2000000;
+    const std::size_t thread_count = 64;
+
+    auto counter = reg.create_metric(UINT::KIND, name, "increment(s)", "Increments of a hot counter");
+    if (promote)
+    {
+        counter->promote(by);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        workers.emplace_back([&counter, increments_per_thread]
+        {
+            for (std::uint64_t j = 0; j < increments_per_thread; ++j)
+            {
+                ++(*counter);
+            }
+        });
+    }
+
+    for (auto & worker : workers)
+    {
+        worker.join();
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << name << ": " << (double(elapsed.count()) / double(increments_per_thread * thread_count)) << " ns/increment"
+            << (std::uint64_t(*counter) == increments_per_thread * thread_count ? "" : " (COUNT MISMATCH)") << "\n";
+}
+
+/*
+ * Looks up metrics by name from several worker threads, as a service that
+ * doesn't keep its metric handles would, getting either handles or
+ * references. Prints the number of lookups per second across the worker
+ * threads.
+ */
+void lookup_work(Registry & reg, const std::vector<std::string> & names, const std::size_t thread_count, const bool by_reference = false)
+{
+    const std::uint64_t lookups_per_thread = 1000000;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        workers.emplace_back([&reg, &names, lookups_per_thread, i, by_reference]
+        {
+            for (std::uint64_t j = 0; j < lookups_per_thread; ++j)
+            {
+                if (by_reference)
+                {
+                    ++(*reg.resolve<UintHandle::element_type>(names[(j + i) % names.size()]));
+                }
+                else
+                {
+                    ++(*reg(UINT::KIND, names[(j + i) % names.size()]));
+                }
+            }
+        });
+    }
+
+    for (auto & worker : workers)
+    {
+        worker.join();
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << thread_count << " thread(s): " << (double(lookups_per_thread * thread_count) * 1e9 / double(elapsed.count())) << " lookups/s\n";
+}
+
+/*
+ * Creates many unsigned metrics, either one at a time or in bulk. Prints the
+ * time taken.
+ */
+void creation_work(const std::string name, const bool bulk)
+{
+    const std::size_t metric_count = 200000;
+
+    std::vector<MetricSpec> specs;
+    for (std::size_t i = 0; i < metric_count; ++i)
+    {
+        specs.push_back({"created.metric_" + std::to_string(i), "unit", "A metric created on startup"});
+    }
+
+    Registry reg;
+    auto start = std::chrono::steady_clock::now();
+
+    if (bulk)
+    {
+        reg.create_metrics(UINT::KIND, specs);
+    }
+    else
+    {
+        for (const auto & spec : specs)
+        {
+            reg.create_metric(UINT::KIND, spec.name, spec.unit, spec.description);
+        }
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << name << ": " << elapsed.count() << " ms\n";
+}
+
+/*
+ * Renders a small part of a large registry, selected by a filter, with a
+ * renderer that discards its output. Prints the time taken per render.
+ */
+void filtered_render_work(Registry & reg, const std::string name, const RenderFilter & filter)
+{
+    const std::size_t render_count = 1000;
+    Renderer discard;
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < render_count; ++i)
+    {
+        reg.render(discard, filter);
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << name << ": " << (double(elapsed.count()) / render_count) << " us per render\n";
+}
+
+/*
+ * Renders a large registry repeatedly from one thread while another creates
+ * and looks up metrics, as a service naming metrics at runtime would. Prints
+ * the mean and worst latency of the worker's calls.
+ */
+void render_contention_work(Registry & reg, const std::size_t metric_count)
+{
+    const std::size_t call_count = 200000;
+
+    // Formats every metric, as a text renderer would
+    class FormattingRenderer : public Renderer
+    {
+    public:
+        void render(const std::shared_ptr<Metric> & metric) override final
+        {
+            m_length += std::string(*metric).size();
+        }
+
+        std::size_t m_length = 0;
+    };
+
+    std::atomic<bool> rendering(true);
+    std::atomic<std::size_t> render_count(0);
+    std::thread renderer_thread([&reg, &rendering, &render_count]
+    {
+        FormattingRenderer formatter;
+        while (rendering)
+        {
+            reg.render(formatter);
+            ++render_count;
+        }
+    });
+
+    // Names are built up front, so that only get_or_create() is timed
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < call_count / 2; ++i)
+    {
+        names.push_back("runtime.metric_" + std::to_string(i));
+    }
+
+    std::chrono::nanoseconds total(0);
+    std::chrono::nanoseconds worst(0);
+    for (std::size_t i = 0; i < call_count; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        ++(*reg.get_or_create(UINT::KIND, names[i % names.size()], "unit", "A metric named at runtime"));
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        total += elapsed;
+        worst = std::max(worst, elapsed);
+    }
+
+    rendering = false;
+    renderer_thread.join();
+
+    std::cout << metric_count << " metrics, " << render_count << " render(s): " << (double(total.count()) / call_count) << " ns mean, "
+            << worst.count() << " ns worst per create or lookup\n";
+}
+
 int main(int argc, char * argv[])
 {
     Metrics m;
@@ -224,6 +459,75 @@ int main(int argc, char * argv[])
     std::cout << "Score with hook (no throttle) = " << hook_score << "\n";
     std::cout << "                                ^ (closer to 1.0 is better)" << std::endl;
 
+    Registry sampling_reg;
+    std::cout << "Hot counter, " << ThreadSlot::count(4) << " thread(s):\n";
+    sampled_work(sampling_reg, "Exact", Sampling());
+    sampled_work(sampling_reg, "Random1in64", Sampling::random(64));
+    sampled_work(sampling_reg, "Every64th", Sampling::every_nth(64));
+    std::cout << std::flush;
+
+    Registry sharding_reg;
+    std::cout << "Hot counter, 64 thread(s), " << CpuSlot::count() << " CPU slot(s)"
+            << (CpuSlot::restartable() ? " (rseq)" : "") << ":\n";
+    sharded_work(sharding_reg, "Atomic", false, ShardBy::THREAD);
+    sharded_work(sharding_reg, "PerThread", true, ShardBy::THREAD);
+    sharded_work(sharding_reg, "PerCpu", true, ShardBy::CPU);
+    std::cout << std::flush;
+
+    Registry lookup_reg;
+    std::vector<std::string> lookup_names;
+    for (std::size_t i = 0; i < 1000; ++i)
+    {
+        lookup_names.push_back("lookup.metric_" + std::to_string(i));
+        lookup_reg.create_metric(UINT::KIND, lookup_names.back(), "unit", "A metric that's looked up");
+    }
+
+    std::cout << "Lookups by name:\n";
+    for (std::size_t thread_count = 1; thread_count <= 8; thread_count *= 2)
+    {
+        lookup_work(lookup_reg, lookup_names, thread_count);
+    }
+    std::cout << std::flush;
+
+    std::vector<std::string> hot_names(lookup_names.begin(), lookup_names.begin() + 250);
+    for (const bool cached : {false, true})
+    {
+        lookup_reg.lookup_cache(cached);
+        std::cout << "Lookups of 250 names by name, as references" << (cached ? ", cached" : "") << ":\n";
+        for (std::size_t thread_count = 1; thread_count <= 8; thread_count *= 2)
+        {
+            lookup_work(lookup_reg, hot_names, thread_count, true);
+        }
+        std::cout << std::flush;
+    }
+
+    std::cout << "Creating 200000 metrics:\n";
+    creation_work("OneByOne", false);
+    creation_work("Bulk", true);
+    std::cout << std::flush;
+
+    Registry filter_reg;
+    std::vector<MetricSpec> filter_specs;
+    for (std::size_t i = 0; i < 200000; ++i)
+    {
+        filter_specs.push_back({"shard_" + std::to_string(i % 1000) + ".metric_" + std::to_string(i), "unit", "A metric to filter"});
+    }
+    filter_reg.create_metrics(UINT::KIND, filter_specs);
+
+    std::cout << "Rendering part of 200000 metrics:\n";
+    filtered_render_work(filter_reg, "OnePrefix", RenderFilter({"shard_42."}));
+    filtered_render_work(filter_reg, "ThreePrefixes", RenderFilter({"shard_42.", "shard_7.", "shard_999."}));
+    filtered_render_work(filter_reg, "PrefixWithExclusion", RenderFilter({"shard_1"}, {"shard_10", "shard_11"}));
+    std::cout << std::flush;
+
+    Registry contention_reg;
+    std::vector<MetricSpec> contention_specs(filter_specs.begin(), filter_specs.begin() + 100000);
+    contention_reg.create_metrics(UINT::KIND, contention_specs);
+
+    std::cout << "Creating and looking up metrics during renders:\n";
+    render_contention_work(contention_reg, contention_specs.size());
+    std::cout << std::flush;
+
     return 0;
 }
 
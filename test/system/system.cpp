@@ -140,15 +140,19 @@ void work_thread(Metrics & m, std::size_t thread_index)
 
     std::this_thread::sleep_for (std::chrono::seconds(3 ));
 
+    static constexpr MetricKey test_num_1_key("TestNum1");
+    static constexpr MetricKey test_str_key("TestStr");
+    static constexpr MetricKey test_float_key("TestFloat");
+
     for (std::size_t i=0;i<1000000;++i)
     {
-        auto test_num_1 = m.reg(INT::KIND, "TestNum1");
+        auto test_num_1 = m.reg(INT::KIND, test_num_1_key);
         ++(*test_num_1);
 
-        auto test_str = m.reg(STR::KIND, "TestStr");
+        auto test_str = m.reg(STR::KIND, test_str_key);
         (*test_str) = thread_str.str();
 
-        auto test_float = m.reg(FLOAT::KIND, "TestFloat");
+        auto test_float = m.reg(FLOAT::KIND, test_float_key);
         (*test_float) = i;
 
         ++m.test_num_3_throt;
@@ -182,6 +186,9 @@ int main(int argc, char * argv[])
         thread->join();
     }
 
+    // The renderer is destroyed before the registry, so stop rendering to it
+    m.reg.cancel_render_schedule();
+
     assert(std::int64_t(*m.reg(INT::KIND, "TestNum1")) == NUM_THREADS * 1000000);
     assert(float(*m.reg(FLOAT::KIND, "TestFloat")) == 999999);
 
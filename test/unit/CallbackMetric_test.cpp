@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "measuro.hpp"
+#include "stubs.hpp"
+
+namespace measuro
+{
+
+    TEST(CallbackMetric, batch)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        std::size_t calls = 0;
+
+        auto batch = std::make_shared<CallbackBatch>("test_batch", "test desc", [&dummy_clock]{return dummy_clock;}, 2,
+                [&calls, &dummy_clock](std::vector<float> & values)
+                {
+                    ++calls;
+                    dummy_clock += std::chrono::milliseconds(3);
+                    values[0] = 10.0f * calls;
+                    values[1] = 0.5f;
+                });
+        EXPECT_EQ(batch->kind(), Metric::Kind::FLOAT);
+        EXPECT_EQ(batch->unit(), "ms");
+        EXPECT_EQ(batch->size(), 2);
+
+        CallbackMetric queue_size("queue_size", "item(s)", "test desc", [&dummy_clock]{return dummy_clock;}, batch, 0);
+        CallbackMetric occupancy("occupancy", "", "test desc", [&dummy_clock]{return dummy_clock;}, batch, 1);
+        EXPECT_EQ(queue_size.kind(), Metric::Kind::CALLBACK);
+        EXPECT_EQ(queue_size.batch(), batch);
+        ASSERT_EQ(queue_size.dependencies().size(), 1);
+        EXPECT_EQ(queue_size.dependencies()[0], batch);
+
+        // Nothing is called until the batch is calculated
+        EXPECT_EQ(calls, 0);
+        EXPECT_EQ(std::string(queue_size), "0.00");
+
+        batch->calculate();
+        queue_size.calculate();
+        occupancy.calculate();
+        EXPECT_EQ(calls, 1);
+        EXPECT_FLOAT_EQ(float(queue_size), 10.0f);
+        EXPECT_EQ(std::string(occupancy), "0.50");
+        EXPECT_DOUBLE_EQ(occupancy.numeric_value(), 0.5);
+        EXPECT_FLOAT_EQ(float(*batch), 3.0f);
+        EXPECT_EQ(std::string(*batch), "3.00");
+    }
+
+    TEST(CallbackMetric, time_limit)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        std::size_t calls = 0;
+        auto duration = std::chrono::milliseconds(50);
+
+        CallbackBatch subject("test_batch", "test desc", [&dummy_clock]{return dummy_clock;}, 1,
+                [&calls, &dummy_clock, &duration](std::vector<float> & values)
+                {
+                    ++calls;
+                    dummy_clock += duration;
+                    values[0] = float(calls);
+                }, std::chrono::milliseconds(10));
+        EXPECT_EQ(subject.time_limit(), std::chrono::milliseconds(10));
+
+        subject.calculate();
+        EXPECT_EQ(calls, 1);
+        EXPECT_EQ(subject.overruns(), 1);
+
+        // The call after an overrun is skipped and the values are kept
+        subject.calculate();
+        EXPECT_EQ(calls, 1);
+        EXPECT_FLOAT_EQ(subject.value(0), 1.0f);
+
+        duration = std::chrono::milliseconds(5);
+        subject.calculate();
+        subject.calculate();
+        EXPECT_EQ(calls, 3);
+        EXPECT_EQ(subject.overruns(), 1);
+
+        auto result = subject.series();
+        ASSERT_EQ(result.size(), 1);
+        EXPECT_EQ(result[0], std::make_pair(std::string("overruns"), std::string("1")));
+    }
+
+    TEST(CallbackMetric, bad_config)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        auto fill = [](std::vector<float> & values){values[0] = 1.0f;};
+
+        EXPECT_THROW(CallbackBatch("test_batch", "test desc", [&dummy_clock]{return dummy_clock;}, 0, fill), MetricConfigError);
+        EXPECT_THROW(CallbackBatch("test_batch", "test desc", [&dummy_clock]{return dummy_clock;}, 1, nullptr), MetricConfigError);
+
+        auto batch = std::make_shared<CallbackBatch>("test_batch", "test desc", [&dummy_clock]{return dummy_clock;}, 1, fill);
+        EXPECT_THROW(CallbackMetric("test_name", "", "test desc", [&dummy_clock]{return dummy_clock;}, batch, 1), MetricConfigError);
+        EXPECT_THROW(CallbackMetric("test_name", "", "test desc", [&dummy_clock]{return dummy_clock;}, nullptr, 0), MetricConfigError);
+    }
+
+}
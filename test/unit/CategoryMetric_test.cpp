@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "measuro.hpp"
+#include "stubs.hpp"
+
+namespace measuro
+{
+
+    enum class StatusClass { SUCCESS = 0, CLIENT_ERROR = 1, SERVER_ERROR = 2 };
+
+    TEST(CategoryMetric, add)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        CategoryMetric subject("test_name", "resp", "test desc", [&dummy_clock]{return dummy_clock;}, {"2xx", "4xx", "5xx"});
+        EXPECT_EQ(subject.kind(), Metric::Kind::CATEGORY);
+        EXPECT_EQ(subject.categories().size(), 3);
+        EXPECT_EQ(std::string(subject), "0");
+
+        subject.add(0);
+        subject.add(0);
+        subject.add(2, 5);
+        subject.add(StatusClass::CLIENT_ERROR);
+        subject.add(subject.index("5xx"));
+
+        EXPECT_EQ(subject.count(0), 2);
+        EXPECT_EQ(subject.count(1), 1);
+        EXPECT_EQ(subject.count(2), 6);
+        EXPECT_EQ(std::uint64_t(subject), 9);
+        EXPECT_EQ(std::string(subject), "9");
+        EXPECT_DOUBLE_EQ(subject.numeric_value(), 9.0);
+    }
+
+    TEST(CategoryMetric, series)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        CategoryMetric subject("test_name", "resp", "test desc", [&dummy_clock]{return dummy_clock;}, {"2xx", "4xx"});
+        subject.add(1, 3);
+
+        auto result = subject.series();
+        ASSERT_EQ(result.size(), 2);
+        EXPECT_EQ(result[0], std::make_pair(std::string("2xx"), std::string("0")));
+        EXPECT_EQ(result[1], std::make_pair(std::string("4xx"), std::string("3")));
+    }
+
+    TEST(CategoryMetric, bad_category)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        CategoryMetric subject("test_name", "resp", "test desc", [&dummy_clock]{return dummy_clock;}, {"2xx", "4xx"});
+
+        EXPECT_THROW(subject.add(2), CategoryError);
+        EXPECT_THROW(subject.count(2), CategoryError);
+        EXPECT_THROW(subject.index("5xx"), CategoryError);
+
+        EXPECT_THROW(CategoryMetric("test_name", "resp", "test desc", [&dummy_clock]{return dummy_clock;}, {}), MetricConfigError);
+        EXPECT_THROW(CategoryMetric("test_name", "resp", "test desc", [&dummy_clock]{return dummy_clock;}, {"2xx", "4xx", "2xx"}), MetricConfigError);
+    }
+
+    TEST(CategoryMetric, concurrent_add)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        CategoryMetric subject("test_name", "resp", "test desc", [&dummy_clock]{return dummy_clock;}, {"a", "b"});
+
+        std::vector<std::thread> threads;
+        for (std::size_t thread=0;thread<4;++thread)
+        {
+            threads.push_back(std::thread([&subject, thread]
+            {
+                for (int index=0;index<10000;++index)
+                {
+                    subject.add(thread % 2);
+                }
+            }));
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        EXPECT_EQ(subject.count(0), 20000);
+        EXPECT_EQ(subject.count(1), 20000);
+    }
+
+}
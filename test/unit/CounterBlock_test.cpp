@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "measuro.hpp"
+#include "stubs.hpp"
+
+namespace measuro
+{
+
+    TEST(CounterBlock, add)
+    {
+        CounterBlock subject({"requests", "bytes_in", "bytes_out"});
+        EXPECT_EQ(subject.size(), 3);
+        EXPECT_EQ(subject.name(1), "bytes_in");
+        EXPECT_FALSE(subject.per_thread());
+
+        subject.add(0);
+        subject.add(1, 100);
+        subject.add(1, 50);
+        EXPECT_EQ(subject.value(0), 1);
+        EXPECT_EQ(subject.value(1), 150);
+        EXPECT_EQ(subject.value(2), 0);
+
+        EXPECT_THROW(subject.add(3), std::out_of_range);
+        EXPECT_THROW(subject.value(3), std::out_of_range);
+        EXPECT_THROW(CounterBlock(std::vector<std::string>()), MetricConfigError);
+    }
+
+    TEST(CounterBlock, per_thread)
+    {
+        const std::size_t thread_count = 4;
+        const std::uint64_t increments = 10000;
+
+        CounterBlock subject({"first", "second"}, true);
+        EXPECT_TRUE(subject.per_thread());
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            threads.emplace_back([&subject, increments]
+            {
+                for (std::uint64_t j = 0; j < increments; ++j)
+                {
+                    subject.add(0);
+                    subject.add(1, 2);
+                }
+            });
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        // Per-thread copies aren't visible until folded
+        EXPECT_EQ(subject.value(0), 0);
+
+        subject.fold(0);
+        EXPECT_EQ(subject.value(0), thread_count * increments);
+        EXPECT_EQ(subject.value(1), 0);
+
+        subject.fold();
+        EXPECT_EQ(subject.value(1), thread_count * increments * 2);
+    }
+
+    TEST(BlockCounter, value)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        auto block = std::make_shared<CounterBlock>(std::vector<std::string>({"first", "second"}), true);
+        BlockCounter subject("second", "req", "test desc", [&dummy_clock]{return dummy_clock;}, block, 1);
+        EXPECT_EQ(subject.kind(), Metric::Kind::BLOCK);
+        EXPECT_EQ(subject.block(), block);
+        EXPECT_EQ(subject.index(), 1);
+
+        ++subject;
+        subject += 4;
+        block->add(0, 7);
+
+        subject.calculate();
+        EXPECT_EQ(std::uint64_t(subject), 5);
+        EXPECT_EQ(std::string(subject), "5");
+        EXPECT_DOUBLE_EQ(subject.numeric_value(), 5.0);
+        EXPECT_EQ(block->value(0), 0);
+
+        std::uint64_t checkpoint = 0;
+        std::string result;
+        EXPECT_TRUE(subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "5");
+
+        EXPECT_THROW(BlockCounter("third", "req", "test desc", [&dummy_clock]{return dummy_clock;}, block, 2), MetricConfigError);
+        EXPECT_THROW(BlockCounter("third", "req", "test desc", [&dummy_clock]{return dummy_clock;}, nullptr, 0), MetricConfigError);
+    }
+}
@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "measuro.hpp"
+#include "stubs.hpp"
+
+namespace measuro
+{
+
+    class DerivedMetricTest : public ::testing::Test
+    {
+    protected:
+        DerivedMetricTest()
+        : m_pool(std::make_shared<ExpressionPool>())
+        {
+            m_hits = std::make_shared<NumberMetric<Metric::Kind::UINT, std::uint64_t> >("cache.hits", "hits", "test desc", [this]{return m_clock;}, 0);
+            m_misses = std::make_shared<NumberMetric<Metric::Kind::UINT, std::uint64_t> >("cache.misses", "misses", "test desc", [this]{return m_clock;}, 0);
+            m_temperature = std::make_shared<NumberMetric<Metric::Kind::FLOAT, float> >("temp-c", "C", "test desc", [this]{return m_clock;}, 0.0f);
+
+            m_metrics[m_hits->name()] = m_hits;
+            m_metrics[m_misses->name()] = m_misses;
+            m_metrics[m_temperature->name()] = m_temperature;
+        }
+
+        ExpressionPool::Resolver resolver()
+        {
+            return [this](const std::string & name)
+            {
+                auto entry = m_metrics.find(name);
+                if (entry == m_metrics.end())
+                {
+                    throw MetricNameError("No metric exists called \"" + name + "\"");
+                }
+
+                return entry->second;
+            };
+        }
+
+        std::chrono::steady_clock::time_point m_clock;
+        std::shared_ptr<ExpressionPool> m_pool;
+        std::shared_ptr<NumberMetric<Metric::Kind::UINT, std::uint64_t> > m_hits;
+        std::shared_ptr<NumberMetric<Metric::Kind::UINT, std::uint64_t> > m_misses;
+        std::shared_ptr<NumberMetric<Metric::Kind::FLOAT, float> > m_temperature;
+        std::map<std::string, std::shared_ptr<Metric> > m_metrics;
+    };
+
+    TEST_F(DerivedMetricTest, ratio)
+    {
+        DerivedMetric subject(m_pool, "cache.hits / (cache.hits + cache.misses) * 100", resolver(), "hit_ratio", "%", "test desc", [this]{return m_clock;});
+        EXPECT_EQ(subject.kind(), Metric::Kind::DERIVED);
+        EXPECT_EQ(subject.expression(), "cache.hits / (cache.hits + cache.misses) * 100");
+        EXPECT_EQ(std::string(subject), "0.00");
+
+        (*m_hits) = 3;
+        (*m_misses) = 1;
+        EXPECT_FLOAT_EQ(float(subject), 0.0f);
+
+        subject.calculate();
+        EXPECT_FLOAT_EQ(float(subject), 75.0f);
+        EXPECT_EQ(std::string(subject), "75.00");
+    }
+
+    TEST_F(DerivedMetricTest, precedence)
+    {
+        (*m_hits) = 10;
+        (*m_misses) = 3;
+        m_temperature->operator=(1.5f);
+
+        DerivedMetric subject1(m_pool, "-cache.hits + 2 * (cache.misses - 1) / 4", resolver(), "test1", "unit", "test desc", [this]{return m_clock;});
+        subject1.calculate();
+        EXPECT_FLOAT_EQ(float(subject1), -9.0f);
+
+        DerivedMetric subject2(m_pool, "cache.hits - cache.misses - 1", resolver(), "test2", "unit", "test desc", [this]{return m_clock;});
+        subject2.calculate();
+        EXPECT_FLOAT_EQ(float(subject2), 6.0f);
+
+        DerivedMetric subject3(m_pool, "`temp-c` * 2 + .5e1", resolver(), "test3", "unit", "test desc", [this]{return m_clock;});
+        subject3.calculate();
+        EXPECT_FLOAT_EQ(float(subject3), 8.0f);
+    }
+
+    TEST_F(DerivedMetricTest, divide_by_zero)
+    {
+        DerivedMetric subject(m_pool, "cache.hits / cache.misses", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;});
+
+        (*m_hits) = 5;
+        subject.calculate();
+        EXPECT_FLOAT_EQ(float(subject), 0.0f);
+
+        (*m_misses) = 2;
+        subject.calculate();
+        EXPECT_FLOAT_EQ(float(subject), 2.5f);
+    }
+
+    TEST_F(DerivedMetricTest, shared_subexpressions)
+    {
+        DerivedMetric subject1(m_pool, "cache.hits + cache.misses", resolver(), "test1", "unit", "test desc", [this]{return m_clock;});
+        EXPECT_EQ(m_pool->size(), 3);
+
+        // Commutative operands are put in a canonical order, so no new nodes are needed
+        DerivedMetric subject2(m_pool, "(cache.misses + cache.hits)", resolver(), "test2", "unit", "test desc", [this]{return m_clock;});
+        EXPECT_EQ(m_pool->size(), 3);
+
+        // Only the constant and the multiplication are new
+        DerivedMetric subject3(m_pool, "(cache.hits + cache.misses) * 2", resolver(), "test3", "unit", "test desc", [this]{return m_clock;});
+        EXPECT_EQ(m_pool->size(), 5);
+
+        // Constants are folded
+        DerivedMetric subject4(m_pool, "2 * 3 + 4", resolver(), "test4", "unit", "test desc", [this]{return m_clock;});
+        EXPECT_EQ(m_pool->size(), 6);
+        subject4.calculate();
+        EXPECT_FLOAT_EQ(float(subject4), 10.0f);
+
+        (*m_hits) = 1;
+        (*m_misses) = 2;
+        subject1.calculate();
+        subject2.calculate();
+        subject3.calculate();
+        EXPECT_FLOAT_EQ(float(subject1), 3.0f);
+        EXPECT_FLOAT_EQ(float(subject2), 3.0f);
+        EXPECT_FLOAT_EQ(float(subject3), 6.0f);
+    }
+
+    TEST_F(DerivedMetricTest, pass)
+    {
+        DerivedMetric subject1(m_pool, "cache.hits + cache.misses", resolver(), "test1", "unit", "test desc", [this]{return m_clock;});
+        DerivedMetric subject2(m_pool, "(cache.hits + cache.misses) * 2", resolver(), "test2", "unit", "test desc", [this]{return m_clock;});
+
+        (*m_hits) = 1;
+        m_pool->begin_pass();
+        subject1.calculate();
+
+        // Within a pass, the shared node keeps the value it was first evaluated with
+        (*m_hits) = 2;
+        subject2.calculate();
+        m_pool->end_pass();
+        EXPECT_FLOAT_EQ(float(subject1), 1.0f);
+        EXPECT_FLOAT_EQ(float(subject2), 2.0f);
+
+        subject2.calculate();
+        EXPECT_FLOAT_EQ(float(subject2), 4.0f);
+    }
+
+    TEST_F(DerivedMetricTest, dependencies)
+    {
+        DerivedMetric subject(m_pool, "cache.hits / (cache.hits + cache.misses)", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;});
+
+        auto result = subject.dependencies();
+        ASSERT_EQ(result.size(), 2);
+        EXPECT_EQ(result[0], m_hits);
+        EXPECT_EQ(result[1], m_misses);
+    }
+
+    TEST_F(DerivedMetricTest, derived_of_derived)
+    {
+        auto total = std::make_shared<DerivedMetric>(m_pool, "cache.hits + cache.misses", resolver(), "cache.total", "unit", "test desc", [this]{return m_clock;});
+        m_metrics[total->name()] = total;
+        DerivedMetric subject(m_pool, "cache.total * 10", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;});
+
+        (*m_hits) = 4;
+        total->calculate();
+        subject.calculate();
+        EXPECT_FLOAT_EQ(float(subject), 40.0f);
+    }
+
+    TEST_F(DerivedMetricTest, malformed)
+    {
+        EXPECT_THROW(DerivedMetric(m_pool, "", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), ExpressionError);
+        EXPECT_THROW(DerivedMetric(m_pool, "cache.hits +", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), ExpressionError);
+        EXPECT_THROW(DerivedMetric(m_pool, "(cache.hits", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), ExpressionError);
+        EXPECT_THROW(DerivedMetric(m_pool, "cache.hits)", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), ExpressionError);
+        EXPECT_THROW(DerivedMetric(m_pool, "cache.hits cache.misses", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), ExpressionError);
+        EXPECT_THROW(DerivedMetric(m_pool, "cache.hits % 2", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), ExpressionError);
+        EXPECT_THROW(DerivedMetric(m_pool, "`temp-c * 2", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), ExpressionError);
+        EXPECT_THROW(DerivedMetric(m_pool, "cache.other", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), MetricNameError);
+    }
+
+    TEST_F(DerivedMetricTest, release)
+    {
+        DerivedMetric subject1(m_pool, "cache.hits + cache.misses", resolver(), "test1", "unit", "test desc", [this]{return m_clock;});
+        EXPECT_EQ(m_pool->size(), 3);
+        auto temperature_refs = m_temperature.use_count();
+
+        // A failed compilation leaves nothing behind
+        EXPECT_THROW(DerivedMetric(m_pool, "`temp-c` * 2 + cache.hits)", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), ExpressionError);
+        EXPECT_EQ(m_pool->size(), 3);
+        EXPECT_EQ(m_temperature.use_count(), temperature_refs);
+
+        // Nodes are freed once no expression uses them, releasing their metrics
+        {
+            DerivedMetric subject2(m_pool, "`temp-c` * 2 + cache.hits", resolver(), "test2", "unit", "test desc", [this]{return m_clock;});
+            EXPECT_EQ(m_pool->size(), 7);
+            EXPECT_GT(m_temperature.use_count(), temperature_refs);
+        }
+
+        EXPECT_EQ(m_pool->size(), 3);
+        EXPECT_EQ(m_temperature.use_count(), temperature_refs);
+
+        // Freed slots are reused, and nodes are still evaluated after their operands
+        DerivedMetric subject3(m_pool, "(cache.hits + cache.misses) * 2 - `temp-c`", resolver(), "test3", "unit", "test desc", [this]{return m_clock;});
+        EXPECT_EQ(m_pool->size(), 7);
+
+        (*m_hits) = 1;
+        (*m_misses) = 2;
+        (*m_temperature) = 0.5f;
+        subject1.calculate();
+        subject3.calculate();
+        EXPECT_FLOAT_EQ(float(subject1), 3.0f);
+        EXPECT_FLOAT_EQ(float(subject3), 5.5f);
+    }
+
+    TEST_F(DerivedMetricTest, nesting_limit)
+    {
+        auto nested = [](const std::size_t depth)
+        {
+            return std::string(depth, '(') + "cache.hits" + std::string(depth, ')');
+        };
+
+        DerivedMetric subject(m_pool, nested(ExpressionPool::NESTING_LIMIT), resolver(), "test_name", "unit", "test desc", [this]{return m_clock;});
+        (*m_hits) = 3;
+        subject.calculate();
+        EXPECT_FLOAT_EQ(float(subject), 3.0f);
+
+        auto size = m_pool->size();
+        EXPECT_THROW(DerivedMetric(m_pool, nested(ExpressionPool::NESTING_LIMIT + 1), resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), ExpressionError);
+        EXPECT_THROW(DerivedMetric(m_pool, std::string(100000, '-') + "cache.hits", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;}), ExpressionError);
+        EXPECT_EQ(m_pool->size(), size);
+    }
+
+    TEST_F(DerivedMetricTest, hook)
+    {
+        DerivedMetric subject(m_pool, "cache.hits * 2", resolver(), "test_name", "unit", "test desc", [this]{return m_clock;});
+
+        float hooked_value = 0.0f;
+        subject.register_hook([&hooked_value](const Metric & metric){hooked_value = float(metric);});
+
+        (*m_hits) = 21;
+        subject.calculate();
+        EXPECT_FLOAT_EQ(hooked_value, 42.0f);
+    }
+
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "measuro.hpp"
+#include "stubs.hpp"
+
+namespace measuro
+{
+
+    TEST(EwmaMetric, smoothing)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        EwmaMetric subject("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;}, std::chrono::seconds(10));
+        EXPECT_EQ(subject.kind(), Metric::Kind::EWMA);
+        EXPECT_EQ(subject.half_life(), std::chrono::seconds(10));
+        EXPECT_EQ(std::string(subject), "0.00");
+
+        // The first sample starts the average
+        subject = 10.0f;
+        EXPECT_FLOAT_EQ(float(subject), 10.0f);
+
+        // A new sample has no weight until time passes
+        subject = 20.0f;
+        EXPECT_FLOAT_EQ(float(subject), 10.0f);
+
+        // Decay is applied on read
+        dummy_clock += std::chrono::seconds(10);
+        EXPECT_FLOAT_EQ(float(subject), 15.0f);
+        EXPECT_EQ(std::string(subject), "15.00");
+        dummy_clock += std::chrono::seconds(10);
+        EXPECT_FLOAT_EQ(float(subject), 17.5f);
+
+        // The average so far is folded in when the next sample arrives
+        subject = 0.0f;
+        EXPECT_FLOAT_EQ(float(subject), 17.5f);
+        dummy_clock += std::chrono::seconds(20);
+        EXPECT_FLOAT_EQ(float(subject), 4.375f);
+        EXPECT_DOUBLE_EQ(subject.numeric_value(), 4.375);
+    }
+
+    TEST(EwmaMetric, idle)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        EwmaMetric subject("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;}, std::chrono::milliseconds(100));
+
+        subject = 50.0f;
+        dummy_clock += std::chrono::seconds(1);
+        subject = 100.0f;
+        dummy_clock += std::chrono::hours(24);
+        EXPECT_FLOAT_EQ(float(subject), 100.0f);
+    }
+
+    TEST(EwmaMetric, bad_half_life)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        EXPECT_THROW(EwmaMetric("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;}, std::chrono::milliseconds::zero()), MetricConfigError);
+    }
+
+    TEST(EwmaMetric, concurrent_assign)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        EwmaMetric subject("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;}, std::chrono::seconds(1));
+
+        std::vector<std::thread> threads;
+        for (int thread=0;thread<4;++thread)
+        {
+            threads.push_back(std::thread([&subject]
+            {
+                for (int index=0;index<10000;++index)
+                {
+                    subject = 42.0f;
+                }
+            }));
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        EXPECT_FLOAT_EQ(float(subject), 42.0f);
+    }
+
+    TEST(EwmaMetric, concurrent_assign_advancing_clock)
+    {
+        // Every read of the clock advances it, then yields so that other assignments overtake
+        std::atomic<std::int64_t> dummy_ms(0);
+        auto clock = [&dummy_ms]
+        {
+            std::chrono::steady_clock::time_point now(std::chrono::milliseconds(dummy_ms.fetch_add(10)));
+            std::this_thread::yield();
+            return now;
+        };
+        EwmaMetric subject("test_name", "ms", "test desc", clock, std::chrono::hours(1));
+
+        // With such a long half-life, later samples barely move the average from the first
+        subject = 0.0f;
+
+        std::vector<std::thread> threads;
+        for (int thread=0;thread<4;++thread)
+        {
+            threads.push_back(std::thread([&subject, thread]
+            {
+                for (int index=0;index<2000;++index)
+                {
+                    subject = float(90 + thread);
+                    float value = float(subject);
+                    EXPECT_GE(value, 0.0f);
+                    EXPECT_LT(value, 50.0f);
+                }
+            }));
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        EXPECT_GT(float(subject), 0.0f);
+        EXPECT_LT(float(subject), 50.0f);
+    }
+
+    TEST(EwmaMetric, hook)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        EwmaMetric subject("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;}, std::chrono::seconds(1));
+
+        float hooked_value = 0.0f;
+        subject.register_hook([&hooked_value](const Metric & metric){hooked_value = float(metric);});
+
+        subject = 3.0f;
+        EXPECT_FLOAT_EQ(hooked_value, 3.0f);
+    }
+
+}
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "measuro.hpp"
+#include "stubs.hpp"
+
+namespace measuro
+{
+
+    // Long enough that the aggregator never runs during a test
+    const std::chrono::milliseconds NEVER(3600000);
+
+    TEST(Ingestion, disabled)
+    {
+        Registry subject;
+        auto metric = subject.create_metric(UINT::KIND, "test_name", "test_unit", "test_description");
+        EXPECT_FALSE(subject.ingestion());
+
+        // Updates are applied directly
+        subject.ingest().add(metric, 5);
+        subject.ingest().set(metric, 7);
+        EXPECT_EQ(std::uint64_t(*metric), 7);
+    }
+
+    TEST(Ingestion, queued)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto uint_metric = subject.create_metric(UINT::KIND, "test_uint", "test_unit", "test_description");
+        auto int_metric = subject.create_metric(INT::KIND, "test_int", "test_unit", "test_description");
+        auto float_metric = subject.create_metric(FLOAT::KIND, "test_float", "test_unit", "test_description");
+        auto str_metric = subject.create_metric(STR::KIND, "test_str", "test_description");
+        auto bool_metric = subject.create_metric(BOOL::KIND, "test_bool", "test_unit", "test_description");
+        auto mean_metric = subject.create_metric(MEAN::KIND, "test_mean", "test_unit", "test_description");
+        auto windowed_metric = subject.create_metric(WINDOWED::KIND, "test_windowed", "test_unit", "test_description",
+                {std::chrono::seconds(10)}, std::chrono::seconds(1));
+        auto category_metric = subject.create_metric(CATEGORY::KIND, "test_category", "test_unit", "test_description", {"open", "closed"});
+        auto state_metric = subject.create_metric(STATE::KIND, "test_state", "test_unit", "test_description", {"up", "down"});
+
+        subject.ingestion(true, 16, Ingestion::Overflow::DROP, NEVER);
+        EXPECT_TRUE(subject.ingestion());
+
+        subject.ingest().add(uint_metric, 5);
+        subject.ingest().add(uint_metric, 2);
+        subject.ingest().set(int_metric, -3);
+        subject.ingest().add(int_metric, -4);
+        subject.ingest().set(float_metric, 1.5f);
+        subject.ingest().set(str_metric, "hello");
+        subject.ingest().set(bool_metric, true);
+        subject.ingest().add(mean_metric, 2.0);
+        subject.ingest().add(mean_metric, 4.0);
+        subject.ingest().add(windowed_metric, 3);
+        subject.ingest().add(category_metric, 1, 2);
+        subject.ingest().set(state_metric, 1);
+
+        EXPECT_THROW(subject.ingest().add(category_metric, 2), CategoryError);
+        EXPECT_THROW(subject.ingest().set(state_metric, 2), CategoryError);
+
+        // Nothing is applied until the rings are flushed
+        EXPECT_EQ(std::uint64_t(*uint_metric), 0);
+        EXPECT_EQ(std::string(*str_metric), "");
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_EQ(std::uint64_t(*uint_metric), 7);
+        EXPECT_EQ(std::int64_t(*int_metric), -7);
+        EXPECT_FLOAT_EQ(float(*float_metric), 1.5f);
+        EXPECT_EQ(std::string(*str_metric), "hello");
+        EXPECT_TRUE(bool(*bool_metric));
+        EXPECT_FLOAT_EQ(float(*mean_metric), 3.0f);
+        EXPECT_EQ(category_metric->count(1), 2);
+        EXPECT_EQ(std::string(*state_metric), "down");
+
+        // Records are timed as they're applied, and windows count completed buckets only
+        dummy_clock += std::chrono::seconds(1);
+        windowed_metric->calculate();
+        EXPECT_EQ(windowed_metric->windows()[0].sum, 3);
+
+        // Queued records are applied when ingestion is disabled
+        subject.ingest().add(uint_metric, 1);
+        subject.ingestion(false);
+        EXPECT_FALSE(subject.ingestion());
+        EXPECT_EQ(std::uint64_t(*uint_metric), 8);
+    }
+
+    TEST(Ingestion, overflow)
+    {
+        Registry subject;
+        auto metric = subject.create_metric(UINT::KIND, "test_name", "test_unit", "test_description");
+        auto str_metric = subject.create_metric(STR::KIND, "test_str", "test_description");
+
+        EXPECT_THROW(subject.ingestion(true, 3), MetricConfigError);
+        EXPECT_FALSE(subject.ingestion());
+
+        subject.ingestion(true, 4, Ingestion::Overflow::DROP, NEVER);
+        auto dropped = subject(UINT::KIND, "measuro.ingestion.dropped");
+        auto applied_inline = subject(UINT::KIND, "measuro.ingestion.inline");
+        for (int i = 0; i < 5; ++i)
+        {
+            subject.ingest().add(metric, 1);
+        }
+        subject.ingest().set(str_metric, "dropped");
+
+        EXPECT_EQ(std::uint64_t(*dropped), 2);
+        subject.ingest().flush();
+        EXPECT_EQ(std::uint64_t(*metric), 4);
+        EXPECT_EQ(std::string(*str_metric), "");
+
+        // Rings keep the capacity with which they were created
+        subject.ingestion(true, 4, Ingestion::Overflow::INLINE, NEVER);
+        for (int i = 0; i < 6; ++i)
+        {
+            subject.ingest().add(metric, 1);
+        }
+
+        EXPECT_EQ(std::uint64_t(*metric), 6);
+        EXPECT_EQ(std::uint64_t(*applied_inline), 2);
+        subject.ingest().flush();
+        EXPECT_EQ(std::uint64_t(*metric), 10);
+        EXPECT_EQ(std::uint64_t(*dropped), 2);
+    }
+
+    TEST(Ingestion, occupancy_and_lag)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto metric = subject.create_metric(UINT::KIND, "test_name", "test_unit", "test_description");
+
+        subject.ingestion(true, 16, Ingestion::Overflow::DROP, NEVER);
+        auto occupancy = subject(UINT::KIND, "measuro.ingestion.occupancy");
+        auto lag = subject(FLOAT::KIND, "measuro.ingestion.lag");
+
+        subject.ingest().add(metric, 1);
+        dummy_clock += std::chrono::seconds(5);
+        subject.ingest().add(metric, 1);
+        subject.ingest().add(metric, 1);
+        dummy_clock += std::chrono::seconds(1);
+
+        subject.ingest().flush();
+        EXPECT_EQ(std::uint64_t(*occupancy), 3);
+        EXPECT_FLOAT_EQ(float(*lag), 6000.0f);
+
+        subject.ingest().flush();
+        EXPECT_EQ(std::uint64_t(*occupancy), 0);
+        EXPECT_FLOAT_EQ(float(*lag), 0.0f);
+    }
+
+    TEST(Ingestion, threads)
+    {
+        const std::size_t thread_count = 4;
+        const std::uint64_t increments = 20000;
+
+        Registry subject;
+        auto metric = subject.create_metric(UINT::KIND, "test_name", "test_unit", "test_description");
+        subject.ingestion(true, 64, Ingestion::Overflow::INLINE, std::chrono::milliseconds(1));
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            threads.emplace_back([&subject, &metric, increments]
+            {
+                for (std::uint64_t j = 0; j < increments; ++j)
+                {
+                    subject.ingest().add(metric, 1);
+                }
+            });
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        // Rings of exited threads are adopted by new ones
+        std::thread([&subject, &metric]{subject.ingest().add(metric, 1);}).join();
+
+        subject.ingestion(false);
+        EXPECT_EQ(std::uint64_t(*metric), thread_count * increments + 1);
+    }
+}
@@ -169,4 +169,87 @@ namespace measuro
         EXPECT_EQ(output.str(), expected);
     }
 
+    TEST(JsonRenderer, render_mean)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        auto metric = std::make_shared<MeanMetric>("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;});
+        metric->add(3);
+        metric->add(4);
+        metric->calculate();
+
+        std::stringstream output;
+
+        JsonRenderer subject(output);
+        subject.before();
+        subject.render(metric);
+        subject.after();
+
+        std::string expected = "{\"test_name\":{\"value\":3.50,\"unit\":\"ms\",\"kind\":\"MEAN\",\"description\":\"test desc\"}}";
+
+        EXPECT_EQ(output.str(), expected);
+    }
+
+    TEST(JsonRenderer, render_series)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        auto metric = std::make_shared<MeanMetric>("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;}, true);
+        metric->add(3);
+        metric->add(4);
+        metric->calculate();
+
+        std::stringstream output;
+
+        JsonRenderer subject(output);
+        subject.before();
+        subject.render(metric);
+        subject.after();
+
+        std::string expected = "{\"test_name\":{\"value\":3.50,\"unit\":\"ms\",\"kind\":\"MEAN\",\"description\":\"test desc\",\"series\":{\"sum\":7.00,\"count\":2}}}";
+
+        EXPECT_EQ(output.str(), expected);
+    }
+
+
+    TEST(JsonRenderer, render_category)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        auto metric = std::make_shared<CategoryMetric>("test_name", "resp", "test desc", [&dummy_clock]{return dummy_clock;},
+                std::vector<std::string>{"2xx", "4xx", "5xx"});
+        metric->add(0, 10);
+        metric->add(2);
+
+        std::stringstream output;
+
+        JsonRenderer subject(output);
+        subject.before();
+        subject.render(metric);
+        subject.after();
+
+        std::string expected = "{\"test_name\":{\"value\":11,\"unit\":\"resp\",\"kind\":\"CATEGORY\",\"description\":\"test desc\",\"series\":{\"2xx\":10,\"4xx\":0,\"5xx\":1}}}";
+
+        EXPECT_EQ(output.str(), expected);
+    }
+
+    TEST(JsonRenderer, render_state)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        auto metric = std::make_shared<StateMetric>("test_name", "", "test desc", [&dummy_clock]{return dummy_clock;},
+                std::vector<std::string>{"up", "down"});
+        dummy_clock += std::chrono::milliseconds(100);
+        metric->transition(1);
+        dummy_clock += std::chrono::milliseconds(300);
+        metric->calculate();
+
+        std::stringstream output;
+
+        JsonRenderer subject(output);
+        subject.before();
+        subject.render(metric);
+        subject.after();
+
+        std::string expected = "{\"test_name\":{\"value\":\"down\",\"unit\":\"\",\"kind\":\"STATE\",\"description\":\"test desc\",\"series\":"
+                "{\"up.percent\":25.00,\"up.transitions\":0,\"down.percent\":75.00,\"down.transitions\":1}}}";
+
+        EXPECT_EQ(output.str(), expected);
+    }
 }
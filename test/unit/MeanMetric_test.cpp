@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "measuro.hpp"
+#include "stubs.hpp"
+
+namespace measuro
+{
+
+    TEST(MeanMetric, interval_mean)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        MeanMetric subject("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;});
+        EXPECT_EQ(subject.kind(), Metric::Kind::MEAN);
+        EXPECT_EQ(std::string(subject), "0.00");
+
+        subject.add(10);
+        subject.add(20);
+        subject.add(60);
+        subject.calculate();
+        EXPECT_EQ(std::string(subject), "30.00");
+        EXPECT_FLOAT_EQ(float(subject), 30.0);
+
+        subject.add(5);
+        subject.calculate();
+        EXPECT_FLOAT_EQ(float(subject), 5.0);
+
+        subject.calculate();
+        EXPECT_FLOAT_EQ(float(subject), 0.0);
+    }
+
+    TEST(MeanMetric, pre_aggregated)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        MeanMetric subject("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;});
+
+        subject.add(100, 4);
+        subject.add(5);
+        subject.calculate();
+        EXPECT_FLOAT_EQ(float(subject), 21.0);
+
+        double sum = 0;
+        std::uint64_t count = 0;
+        subject.totals(sum, count);
+        EXPECT_DOUBLE_EQ(sum, 105.0);
+        EXPECT_EQ(count, 5);
+    }
+
+    TEST(MeanMetric, series)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        MeanMetric without_totals("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;});
+        without_totals.add(1.5);
+        without_totals.calculate();
+        EXPECT_TRUE(without_totals.series().empty());
+
+        MeanMetric with_totals("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;}, true);
+        with_totals.add(1.5);
+        with_totals.add(2);
+        with_totals.calculate();
+        with_totals.add(1000);
+
+        auto series = with_totals.series();
+        ASSERT_EQ(series.size(), 2);
+        EXPECT_EQ(series[0].first, "sum");
+        EXPECT_EQ(series[0].second, "3.50");
+        EXPECT_EQ(series[1].first, "count");
+        EXPECT_EQ(series[1].second, "2");
+    }
+
+    TEST(MeanMetric, concurrent_add)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        MeanMetric subject("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;});
+
+        const std::size_t thread_count = 4;
+        const std::size_t add_count = 10000;
+        std::vector<std::thread> threads;
+        for (std::size_t thread=0;thread<thread_count;++thread)
+        {
+            threads.push_back(std::thread([&subject, add_count]()
+            {
+                for (std::size_t i=0;i<add_count;++i)
+                {
+                    subject.add(2);
+                }
+            }));
+        }
+
+        for (std::size_t i=0;i<add_count;++i)
+        {
+            double sum = 0;
+            std::uint64_t count = 0;
+            subject.totals(sum, count);
+            ASSERT_DOUBLE_EQ(sum, double(count * 2));
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        subject.calculate();
+        EXPECT_FLOAT_EQ(float(subject), 2.0);
+
+        double sum = 0;
+        std::uint64_t count = 0;
+        subject.totals(sum, count);
+        EXPECT_EQ(count, thread_count * add_count);
+    }
+
+    TEST(MeanMetric, hook)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        MeanMetric subject("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;});
+
+        std::size_t hook_calls = 0;
+        subject.register_hook([&hook_calls](const Metric & metric){(void)(metric); ++hook_calls;});
+
+        subject.add(1);
+        subject.calculate();
+        EXPECT_EQ(hook_calls, 2);
+    }
+
+}
@@ -0,0 +1,259 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "measuro.hpp"
+
+namespace measuro
+{
+
+    TEST(MetricIndex, find_and_insert)
+    {
+        MetricIndex subject;
+        auto metric = std::make_shared<UintHandle::element_type>("test_name", "test_unit", "test_description", []{return std::chrono::steady_clock::now();});
+
+        EXPECT_EQ(subject.find("test_name"), nullptr);
+        EXPECT_EQ(subject.version(), 0);
+
+        auto entry = subject.insert("test_name", metric, true);
+        ASSERT_NE(entry, nullptr);
+        EXPECT_EQ(entry->name, "test_name");
+        EXPECT_EQ(entry->metric, metric);
+        EXPECT_TRUE(entry->lookup);
+        EXPECT_EQ(subject.find("test_name"), entry);
+        EXPECT_EQ(subject.version(), 1);
+
+        // Names are unique
+        EXPECT_EQ(subject.insert("test_name", metric, false), nullptr);
+        EXPECT_TRUE(subject.find("test_name")->lookup);
+        EXPECT_EQ(subject.version(), 1);
+    }
+
+
+    TEST(MetricIndex, ids)
+    {
+        MetricIndex subject;
+        auto metric_1 = std::make_shared<UintHandle::element_type>("test_name_1", "test_unit", "test_description", []{return std::chrono::steady_clock::now();});
+        auto metric_2 = std::make_shared<UintHandle::element_type>("test_name_2", "test_unit", "test_description", []{return std::chrono::steady_clock::now();});
+
+        EXPECT_EQ(subject.at(0), nullptr);
+
+        auto entry_1 = subject.insert("test_name_1", metric_1, true);
+        EXPECT_EQ(subject.insert("test_name_1", metric_2, true), nullptr);
+        auto entry_2 = subject.insert("test_name_2", metric_2, false);
+
+        EXPECT_EQ(entry_1->id, 0);
+        EXPECT_EQ(metric_1->id(), 0);
+        EXPECT_EQ(entry_2->id, 1);
+        EXPECT_EQ(metric_2->id(), 1);
+
+        EXPECT_EQ(subject.at(0), entry_1);
+        EXPECT_EQ(subject.at(1), entry_2);
+        EXPECT_EQ(subject.at(2), nullptr);
+    }
+
+    TEST(MetricIndex, growth_and_order)
+    {
+        MetricIndex subject;
+        auto metric = std::make_shared<UintHandle::element_type>("test_name", "test_unit", "test_description", []{return std::chrono::steady_clock::now();});
+
+        const std::uint64_t count = 5000;
+        for (std::uint64_t i = count; i > 0; --i)
+        {
+            ASSERT_NE(subject.insert("test_" + std::to_string(i), metric, (i % 2) == 0), nullptr);
+        }
+
+        for (std::uint64_t i = 1; i <= count; ++i)
+        {
+            auto entry = subject.find("test_" + std::to_string(i));
+            ASSERT_NE(entry, nullptr);
+            EXPECT_EQ(entry->lookup, (i % 2) == 0);
+            EXPECT_EQ(subject.at(count - i), entry);
+        }
+
+        EXPECT_EQ(subject.find("test_0"), nullptr);
+
+        auto sorted = subject.sorted();
+        ASSERT_EQ(sorted.size(), count);
+        for (std::size_t i = 1; i < sorted.size(); ++i)
+        {
+            EXPECT_LT(sorted[i - 1]->name, sorted[i]->name);
+        }
+    }
+
+    TEST(MetricIndex, concurrent)
+    {
+        const std::size_t thread_count = 4;
+        const std::uint64_t count = 2000;
+
+        MetricIndex subject;
+        auto metric = std::make_shared<UintHandle::element_type>("test_name", "test_unit", "test_description", []{return std::chrono::steady_clock::now();});
+        subject.insert("test_fixed", metric, true);
+
+        // Readers look up an existing name while writers grow every shard
+        std::atomic<bool> stop(false);
+        std::atomic<std::uint64_t> misses(0);
+        std::vector<std::thread> readers;
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            readers.emplace_back([&subject, &stop, &misses]
+            {
+                while (!stop)
+                {
+                    if (subject.find("test_fixed") == nullptr)
+                    {
+                        ++misses;
+                    }
+                }
+            });
+        }
+
+        // Writers race to insert the same names
+        std::atomic<std::uint64_t> inserted(0);
+        std::vector<std::thread> writers;
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            writers.emplace_back([&subject, &metric, &inserted, count]
+            {
+                for (std::uint64_t j = 0; j < count; ++j)
+                {
+                    if (subject.insert("test_" + std::to_string(j), metric, true) != nullptr)
+                    {
+                        ++inserted;
+                    }
+                }
+            });
+        }
+
+        for (auto & writer : writers)
+        {
+            writer.join();
+        }
+
+        stop = true;
+        for (auto & reader : readers)
+        {
+            reader.join();
+        }
+
+        EXPECT_EQ(misses, 0);
+        EXPECT_EQ(inserted, count);
+        EXPECT_EQ(subject.sorted().size(), count + 1);
+    }
+
+    TEST(MetricIndex, remove)
+    {
+        MetricIndex subject;
+        auto metric_1 = std::make_shared<UintHandle::element_type>("test_name_1", "test_unit", "test_description", []{return std::chrono::steady_clock::now();});
+        auto metric_2 = std::make_shared<UintHandle::element_type>("test_name_2", "test_unit", "test_description", []{return std::chrono::steady_clock::now();});
+        auto metric_3 = std::make_shared<UintHandle::element_type>("test_name_3", "test_unit", "test_description", []{return std::chrono::steady_clock::now();});
+
+        subject.insert("test_name_1", metric_1, true);
+        subject.insert("test_name_2", metric_2, true);
+        auto version = subject.version();
+
+        EXPECT_EQ(subject.remove("test_missing"), nullptr);
+        EXPECT_EQ(subject.version(), version);
+
+        EXPECT_EQ(subject.remove("test_name_1"), metric_1);
+        EXPECT_NE(subject.version(), version);
+        EXPECT_EQ(subject.find("test_name_1"), nullptr);
+        EXPECT_EQ(subject.at(0), nullptr);
+        EXPECT_EQ(subject.find("test_name_2")->metric, metric_2);
+        EXPECT_EQ(subject.sorted().size(), 1);
+
+        // The entry holds its metric until it's reclaimed
+        EXPECT_EQ(metric_1.use_count(), 2);
+        subject.reclaim();
+        EXPECT_EQ(metric_1.use_count(), 1);
+
+        // Reclaimed indexes are reused, lowest first, with a new generation, and names can be reused
+        const std::uint64_t generation = std::uint64_t(1) << 32;
+        subject.insert("test_name_3", metric_3, true);
+        EXPECT_EQ(metric_3->id(), generation);
+        EXPECT_EQ(MetricIndex::index_of(metric_3->id()), 0);
+        EXPECT_EQ(subject.at(generation)->metric, metric_3);
+        EXPECT_EQ(subject.at(0), nullptr);
+        EXPECT_NE(subject.insert("test_name_1", metric_1, true), nullptr);
+        EXPECT_EQ(metric_1->id(), 2);
+
+        subject.remove("test_name_3");
+        subject.reclaim();
+        subject.insert("test_name_4", metric_3, true);
+        EXPECT_EQ(metric_3->id(), generation * 2);
+        EXPECT_EQ(subject.at(generation), nullptr);
+
+        // Reserved IDs take indexes too, but don't resolve
+        auto reserved = subject.reserve_id();
+        EXPECT_EQ(MetricIndex::index_of(reserved), 3);
+        EXPECT_EQ(subject.at(reserved), nullptr);
+        EXPECT_EQ(subject.index_count(), 4);
+        subject.release_id(reserved);
+        EXPECT_EQ(MetricIndex::index_of(subject.reserve_id()), 3);
+        EXPECT_EQ(subject.index_count(), 4);
+    }
+
+    TEST(MetricIndex, remove_concurrent)
+    {
+        const std::size_t thread_count = 4;
+        const std::uint64_t count = 500;
+
+        MetricIndex subject;
+        auto metric = std::make_shared<UintHandle::element_type>("test_name", "test_unit", "test_description", []{return std::chrono::steady_clock::now();});
+        subject.insert("test_fixed", metric, true);
+
+        // Readers keep finding entries while others are removed and reclaimed
+        std::atomic<bool> stop(false);
+        std::atomic<std::uint64_t> misses(0);
+        std::vector<std::thread> readers;
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            readers.emplace_back([&subject, &stop, &misses, count]
+            {
+                for (std::uint64_t j = 0; !stop; ++j)
+                {
+                    MetricIndex::Guard guard(subject);
+                    if (subject.find("test_fixed") == nullptr)
+                    {
+                        ++misses;
+                    }
+
+                    auto entry = subject.find("test_" + std::to_string(j % count));
+                    if ((entry != nullptr) && (entry->metric->name() != "test_name"))
+                    {
+                        ++misses;
+                    }
+                }
+            });
+        }
+
+        for (int round = 0; round < 5; ++round)
+        {
+            for (std::uint64_t j = 0; j < count; ++j)
+            {
+                subject.insert("test_" + std::to_string(j), metric, true);
+            }
+
+            for (std::uint64_t j = 0; j < count; ++j)
+            {
+                EXPECT_EQ(subject.remove("test_" + std::to_string(j)), metric);
+            }
+
+            subject.reclaim();
+        }
+
+        stop = true;
+        for (auto & reader : readers)
+        {
+            reader.join();
+        }
+
+        EXPECT_EQ(misses, 0);
+        EXPECT_EQ(subject.sorted().size(), 1);
+        EXPECT_EQ(metric.use_count(), 2);
+    }
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+
+#include "measuro.hpp"
+
+namespace measuro
+{
+
+    TEST(MetricKey, construction)
+    {
+        static constexpr MetricKey literal_key("test_name");
+        static_assert(literal_key.length() == 9, "MetricKey length must be computed at compile time");
+        static_assert(literal_key.hash() == MetricKey("test_name_and_more", 9).hash(), "MetricKey hash must be computed at compile time");
+
+        std::string name("test_name");
+        MetricKey string_key(name);
+        EXPECT_EQ(string_key.data(), name.data());
+        EXPECT_EQ(string_key.length(), 9);
+        EXPECT_EQ(string_key.hash(), literal_key.hash());
+        EXPECT_EQ(string_key.str(), "test_name");
+
+        EXPECT_NE(MetricKey("test_nam").hash(), literal_key.hash());
+        EXPECT_NE(MetricKey("").hash(), literal_key.hash());
+        EXPECT_TRUE(literal_key.matches(name, string_key.hash()));
+        EXPECT_FALSE(literal_key.matches("test_namf", string_key.hash()));
+
+#if __cplusplus >= 201703L
+        static constexpr MetricKey view_key(std::string_view("test_name"));
+        static_assert(view_key.hash() == literal_key.hash(), "MetricKey hash must be computed at compile time");
+#endif
+    }
+
+    TEST(MetricKey, lookup)
+    {
+        static constexpr MetricKey uint_key("test_uint");
+        static constexpr MetricKey missing_key("test_missing");
+
+        Registry subject;
+        auto uint_metric = subject.create_metric(UINT::KIND, "test_uint", "test_unit", "test_description");
+        auto str_metric = subject.create_metric(STR::KIND, "test_str", "test_description");
+
+        EXPECT_EQ(subject(UINT::KIND, uint_key), uint_metric);
+        EXPECT_EQ(subject(UINT::KIND, std::string("test_uint")), uint_metric);
+        EXPECT_EQ(subject(STR::KIND, "test_str"), str_metric);
+
+        const char runtime_name[] = {'t', 'e', 's', 't', '_', 's', 't', 'r', 'x'};
+        EXPECT_EQ(subject(STR::KIND, MetricKey(runtime_name, 8)), str_metric);
+
+        EXPECT_THROW(subject(UINT::KIND, missing_key), MetricNameError);
+        EXPECT_THROW(subject(STR::KIND, uint_key), MetricTypeError);
+    }
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "measuro.hpp"
+
+namespace measuro
+{
+
+    TEST(MetricRef, ids)
+    {
+        Registry subject;
+        auto uint_metric = subject.create_metric(UINT::KIND, "test_uint", "test_unit", "test_description");
+        auto str_metric = subject.create_metric(STR::KIND, "test_str", "test_description");
+        auto sum_metric = subject.create_metric(SUM::KIND, UINT::KIND, "test_sum", "test_unit", "test_description", {uint_metric});
+
+        EXPECT_EQ(uint_metric->id(), 0);
+        EXPECT_EQ(str_metric->id(), 1);
+        EXPECT_EQ(sum_metric->id(), 2);
+
+        // A name clash doesn't use up an ID
+        EXPECT_THROW(subject.create_metric(UINT::KIND, "test_uint", "test_unit", "test_description"), MetricNameError);
+        EXPECT_EQ(subject.create_metric(BOOL::KIND, "test_bool", "test_description")->id(), 3);
+
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> unregistered("test_name", "test_unit", "test_description", []{return std::chrono::steady_clock::now();});
+        EXPECT_EQ(unregistered.id(), std::numeric_limits<std::uint64_t>::max());
+    }
+
+    TEST(MetricRef, resolve)
+    {
+        static_assert(std::is_trivially_copyable<UintRef>::value, "MetricRef must be trivially copyable");
+
+        Registry subject;
+        auto uint_metric = subject.create_metric(UINT::KIND, "test_uint", "test_unit", "test_description");
+        auto str_metric = subject.create_metric(STR::KIND, "test_str", "test_description");
+
+        // References don't share ownership
+        auto use_count = uint_metric.use_count();
+        UintRef from_handle = uint_metric;
+        UintRef copy = from_handle;
+        EXPECT_EQ(copy.get(), uint_metric.get());
+        EXPECT_EQ(uint_metric.use_count(), use_count);
+
+        auto from_id = subject.resolve<UintRef::element_type>(uint_metric->id());
+        EXPECT_EQ(from_id, from_handle);
+        ++(*from_id);
+        from_id->operator+=(2);
+        EXPECT_EQ(std::uint64_t(*uint_metric), 3);
+
+        auto generic = subject.resolve(str_metric->id());
+        EXPECT_EQ(generic->name(), "test_str");
+
+        EXPECT_FALSE(UintRef());
+        EXPECT_TRUE(from_id);
+
+        EXPECT_THROW(subject.resolve(2), MetricNameError);
+        EXPECT_THROW(subject.resolve<UintRef::element_type>(str_metric->id()), MetricTypeError);
+    }
+
+    TEST(MetricRef, removed)
+    {
+        Registry subject;
+        auto removed = subject.create_metric(UINT::KIND, "test_removed", "test_unit", "test_description");
+        const std::uint64_t removed_id = removed->id();
+        UintRef removed_ref = removed;
+        EXPECT_EQ(removed_ref.id(), removed_id);
+        EXPECT_TRUE(subject.valid(removed_ref));
+
+        EXPECT_EQ(subject.remove("test_removed"), 1);
+        EXPECT_FALSE(subject.valid(removed_ref));
+        EXPECT_THROW(subject.resolve(removed_id), MetricNameError);
+
+        // A new metric given the removed metric's index doesn't get its ID
+        auto replacement = subject.create_metric(UINT::KIND, "test_replacement", "test_unit", "test_description");
+        EXPECT_NE(replacement->id(), removed_id);
+        EXPECT_EQ(replacement->id() & 0xffffffff, removed_id);
+        EXPECT_THROW(subject.resolve(removed_id), MetricNameError);
+        EXPECT_FALSE(subject.valid(removed_ref));
+        EXPECT_TRUE(subject.valid(UintRef(replacement)));
+        EXPECT_EQ(subject.resolve<UintRef::element_type>(replacement->id()).get(), replacement.get());
+
+        EXPECT_FALSE(subject.valid(UintRef()));
+    }
+}
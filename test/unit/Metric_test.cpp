@@ -96,6 +96,28 @@ namespace measuro
         EXPECT_EQ(subject.kind_name(), "SUM");
     }
 
+
+    TEST(Metric, kind_name_derived)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        NumberMetric<Metric::Kind::DERIVED, std::uint64_t> subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;});
+
+        EXPECT_EQ(subject.kind(), Metric::Kind::DERIVED);
+        EXPECT_EQ(subject.kind_name(), "DERIVED");
+    }
+
+    TEST(Metric, numeric_value)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        NumberMetric<Metric::Kind::INT, std::int64_t> number("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, -5);
+        StringMetric str("test_name", "test desc", [&dummy_clock]{return dummy_clock;}, "text");
+
+        EXPECT_DOUBLE_EQ(number.numeric_value(), -5.0);
+        EXPECT_THROW(str.numeric_value(), MetricCastError);
+    }
+
     TEST(Metric, rate_limit_disabled_explicit)
     {
 
@@ -1,4 +1,7 @@
 #include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #include "measuro.hpp"
 #include "stubs.hpp"
@@ -161,4 +164,377 @@ namespace measuro
         EXPECT_EQ(std::uint64_t(subject), 101);
     }
 
+
+    TEST(NumberMetric, exchange)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 100);
+
+        EXPECT_EQ(subject.exchange(), 100);
+        EXPECT_EQ(std::uint64_t(subject), 0);
+        EXPECT_EQ(subject.exchange(5), 0);
+        EXPECT_EQ(std::uint64_t(subject), 5);
+    }
+
+    TEST(NumberMetric, reset_on_render)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 0);
+        EXPECT_FALSE(subject.reset_on_render());
+        subject.reset_on_render(true);
+        EXPECT_TRUE(subject.reset_on_render());
+
+        subject += 10;
+        EXPECT_EQ(std::uint64_t(subject), 0);
+        subject.calculate();
+        EXPECT_EQ(std::uint64_t(subject), 10);
+        EXPECT_EQ(std::string(subject), "10");
+
+        ++subject;
+        subject.calculate();
+        EXPECT_EQ(std::uint64_t(subject), 1);
+
+        subject.calculate();
+        EXPECT_EQ(std::uint64_t(subject), 0);
+
+        std::uint64_t checkpoint = 0;
+        std::string result;
+        EXPECT_FALSE(subject.delta(checkpoint, result));
+    }
+
+    TEST(NumberMetric, delta)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> uint_subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 100);
+        std::uint64_t checkpoint = 0;
+        std::string result;
+        EXPECT_TRUE(uint_subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "100");
+        uint_subject += 5;
+        EXPECT_TRUE(uint_subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "5");
+        uint_subject = 3; // Counter reset
+        EXPECT_TRUE(uint_subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "3");
+
+        NumberMetric<Metric::Kind::INT, std::int64_t> int_subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 10);
+        checkpoint = 0;
+        EXPECT_TRUE(int_subject.delta(checkpoint, result));
+        int_subject -= 15;
+        EXPECT_TRUE(int_subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "-15");
+
+        NumberMetric<Metric::Kind::FLOAT, float> float_subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 1.5);
+        checkpoint = 0;
+        EXPECT_TRUE(float_subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "1.50");
+        float_subject = 4.0f;
+        EXPECT_TRUE(float_subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "2.50");
+
+        StringMetric str_subject("test_name", "test desc", [&dummy_clock]{return dummy_clock;}, "text");
+        checkpoint = 0;
+        EXPECT_FALSE(str_subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "2.50");
+    }
+
+    TEST(NumberMetric, sampling_config)
+    {
+        Sampling none;
+        EXPECT_EQ(none.mode(), Sampling::Mode::NONE);
+        EXPECT_EQ(none.interval(), 1);
+        EXPECT_FALSE(none.sampled());
+
+        EXPECT_EQ(Sampling::random(8).mode(), Sampling::Mode::RANDOM);
+        EXPECT_EQ(Sampling::random(8).interval(), 8);
+        EXPECT_TRUE(Sampling::random(8).sampled());
+        EXPECT_EQ(Sampling::every_nth(8).mode(), Sampling::Mode::EVERY_NTH);
+        EXPECT_TRUE(Sampling::every_nth(8).sampled());
+        EXPECT_FALSE(Sampling::every_nth(1).sampled());
+
+        EXPECT_THROW(Sampling::random(0), MetricConfigError);
+        EXPECT_THROW(Sampling::every_nth(0), MetricConfigError);
+    }
+
+    TEST(NumberMetric, sampled_every_nth)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 0,
+                std::chrono::milliseconds::zero(), Sampling::every_nth(4));
+        EXPECT_EQ(subject.sampling().interval(), 4);
+
+        EXPECT_EQ(++subject, 0);
+        EXPECT_EQ(subject++, 0);
+        EXPECT_EQ(++subject, 0);
+        EXPECT_EQ(++subject, 4);
+        for (auto i = 0; i < 6; ++i)
+        {
+            subject++;
+        }
+        EXPECT_EQ(std::uint64_t(subject), 8);
+
+        // Other operations are exact
+        subject += 5;
+        EXPECT_EQ(std::uint64_t(subject), 13);
+        --subject;
+        EXPECT_EQ(std::uint64_t(subject), 12);
+
+        EXPECT_DOUBLE_EQ(subject.error_bound(), 3.0);
+        auto series = subject.series();
+        ASSERT_EQ(series.size(), 1);
+        EXPECT_EQ(series[0].first, "error");
+    }
+
+    TEST(NumberMetric, sampled_every_nth_per_thread)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 0,
+                std::chrono::milliseconds::zero(), Sampling::every_nth(4));
+
+        // Each thread's countdown is its own, so 7 increments per thread record 1 each
+        std::vector<std::thread> threads;
+        for (auto t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&subject]
+            {
+                for (auto i = 0; i < 7; ++i)
+                {
+                    ++subject;
+                    std::this_thread::yield();
+                }
+            });
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        EXPECT_EQ(std::uint64_t(subject), 16);
+        EXPECT_DOUBLE_EQ(subject.error_bound(), 12.0);
+
+        // A new counter does not inherit the counts of a destroyed one
+        {
+            NumberMetric<Metric::Kind::UINT, std::uint64_t> other("other", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 0,
+                    std::chrono::milliseconds::zero(), Sampling::every_nth(2));
+            ++other;
+        }
+
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> replacement("replacement", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 0,
+                std::chrono::milliseconds::zero(), Sampling::every_nth(2));
+        EXPECT_EQ(++replacement, 0);
+        EXPECT_EQ(++replacement, 2);
+    }
+
+    TEST(NumberMetric, sampled_random)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        const std::uint64_t increments = 1000000;
+
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 0,
+                std::chrono::milliseconds::zero(), Sampling::random(16));
+        for (std::uint64_t i = 0; i < increments; ++i)
+        {
+            ++subject;
+        }
+
+        std::uint64_t value = std::uint64_t(subject);
+        EXPECT_EQ(value % 16, 0);
+        EXPECT_GT(subject.error_bound(), 0.0);
+
+        // Allow three times the 95% bound so that the test does not fail spuriously
+        double error = std::fabs(double(value) - double(increments));
+        EXPECT_LT(error, 3 * subject.error_bound());
+    }
+
+    TEST(NumberMetric, unsampled_error_bound)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        NumberMetric<Metric::Kind::INT, std::int64_t> subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 0);
+        ++subject;
+        EXPECT_EQ(std::int64_t(subject), 1);
+        EXPECT_DOUBLE_EQ(subject.error_bound(), 0.0);
+        EXPECT_TRUE(subject.series().empty());
+    }
+
+    TEST(NumberMetric, promote)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 10);
+        EXPECT_FALSE(subject.promoted());
+
+        dummy_clock += std::chrono::seconds(5);
+        subject.promote();
+        EXPECT_TRUE(subject.promoted());
+        EXPECT_EQ(subject.promoted_at(), dummy_clock);
+
+        // Promoting again has no effect
+        dummy_clock += std::chrono::seconds(5);
+        subject.promote();
+        EXPECT_EQ(subject.promoted_at(), dummy_clock - std::chrono::seconds(5));
+
+        ++subject;
+        subject++;
+        subject += 5;
+        --subject;
+        subject -= 2;
+        EXPECT_EQ(std::uint64_t(subject), 14);
+        EXPECT_EQ(std::string(subject), "14");
+
+        EXPECT_EQ(subject.exchange(3), 14);
+        ++subject;
+        EXPECT_EQ(std::uint64_t(subject), 4);
+
+        subject = 100;
+        EXPECT_EQ(std::uint64_t(subject), 100);
+
+        std::uint64_t checkpoint = 0;
+        std::string result;
+        EXPECT_TRUE(subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "100");
+
+        subject.reset_on_render(true);
+        subject += 7;
+        subject.calculate();
+        EXPECT_EQ(std::uint64_t(subject), 107);
+        subject.calculate();
+        EXPECT_EQ(std::uint64_t(subject), 0);
+    }
+
+    TEST(NumberMetric, promote_concurrent_observer)
+    {
+        const std::chrono::steady_clock::time_point promotion_time = std::chrono::steady_clock::time_point() + std::chrono::seconds(5);
+
+        // Yields while the time is read, giving the observer a chance to run
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> subject("test_name", "bps", "test desc", [&promotion_time]
+        {
+            std::this_thread::yield();
+            return promotion_time;
+        }, 0);
+
+        std::atomic<bool> started(false);
+        std::thread observer([&subject, &started, &promotion_time]
+        {
+            started = true;
+            while (!subject.promoted())
+            {
+                std::this_thread::yield();
+            }
+
+            // A promoted metric always has its promotion time
+            EXPECT_EQ(subject.promoted_at(), promotion_time);
+        });
+
+        while (!started)
+        {
+            std::this_thread::yield();
+        }
+
+        subject.promote();
+        observer.join();
+    }
+
+    TEST(NumberMetric, adaptive)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        const std::size_t thread_count = 4;
+        const std::int64_t increments = 100000;
+
+        NumberMetric<Metric::Kind::INT, std::int64_t> subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 0);
+        EXPECT_FALSE(subject.adaptive());
+        subject.adaptive(true, 1);
+        EXPECT_TRUE(subject.adaptive());
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            threads.emplace_back([&subject, increments]
+            {
+                for (std::int64_t j = 0; j < increments; ++j)
+                {
+                    ++subject;
+                    subject += 2;
+                    --subject;
+                }
+            });
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        // Whether or not the metric was promoted part way through, no updates are lost
+        EXPECT_EQ(std::int64_t(subject), std::int64_t(thread_count) * increments * 2);
+    }
+
+
+    TEST(NumberMetric, cpu_slot)
+    {
+        const std::size_t count = CpuSlot::count();
+        EXPECT_GE(count, 1);
+        EXPECT_EQ(count & (count - 1), 0);
+        EXPECT_LT(CpuSlot::index(), count);
+
+        // The groups cover every slot, in order, without gaps
+        const std::size_t groups = CpuSlot::group_count();
+        EXPECT_GE(groups, 1);
+        EXPECT_EQ(CpuSlot::group_start(0), 0);
+        EXPECT_EQ(CpuSlot::group_start(groups), count);
+        for (std::size_t group = 0; group < groups; ++group)
+        {
+            EXPECT_LT(CpuSlot::group_start(group), CpuSlot::group_start(group + 1));
+            for (std::size_t slot = CpuSlot::group_start(group); slot < CpuSlot::group_start(group + 1); ++slot)
+            {
+                EXPECT_EQ(CpuSlot::group_of(slot), group);
+            }
+        }
+    }
+
+    TEST(NumberMetric, promote_cpu)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        const std::size_t thread_count = 8;
+        const std::uint64_t increments = 50000;
+
+        NumberMetric<Metric::Kind::UINT, std::uint64_t> subject("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 10);
+        EXPECT_EQ(subject.shard_by(), ShardBy::THREAD);
+        subject.promote(ShardBy::CPU);
+        EXPECT_TRUE(subject.promoted());
+        EXPECT_EQ(subject.shard_by(), ShardBy::CPU);
+
+        // Promoting again doesn't change how shards are chosen
+        subject.promote(ShardBy::THREAD);
+        EXPECT_EQ(subject.shard_by(), ShardBy::CPU);
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            threads.emplace_back([&subject, increments]
+            {
+                for (std::uint64_t j = 0; j < increments; ++j)
+                {
+                    ++subject;
+                    subject += 2;
+                    --subject;
+                }
+            });
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        EXPECT_EQ(std::uint64_t(subject), 10 + thread_count * increments * 2);
+        EXPECT_EQ(subject.exchange(0), 10 + thread_count * increments * 2);
+        EXPECT_EQ(std::uint64_t(subject), 0);
+    }
 }
@@ -61,4 +61,253 @@ namespace measuro
         EXPECT_EQ(output.str(), expected);
     }
 
+    TEST(PlainRenderer, render_series)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        auto metric = std::make_shared<MeanMetric>("test_name", "ms", "test desc", [&dummy_clock]{return dummy_clock;}, true);
+        metric->add(3);
+        metric->add(4);
+        metric->calculate();
+
+        std::stringstream output;
+
+        PlainRenderer subject(output);
+        subject.render(metric);
+        subject.after();
+
+        std::string expected = "test_name = 3.50 ms\ntest_name.sum = 7.00\ntest_name.count = 2\n\n";
+
+        EXPECT_EQ(output.str(), expected);
+    }
+
+
+    TEST(PlainRenderer, render_delta)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry registry([&dummy_clock]{return dummy_clock;});
+        auto counter = registry.create_metric(UINT::KIND, "test_counter", "", "test desc");
+        auto gauge = registry.create_metric(FLOAT::KIND, "test_gauge", "", "test desc");
+        auto str = registry.create_metric(STR::KIND, "test_str", "test desc", "text");
+
+        std::stringstream output;
+        PlainRenderer subject(output);
+        EXPECT_FALSE(subject.delta());
+        subject.delta(true);
+        EXPECT_TRUE(subject.delta());
+
+        (*counter) += 7;
+        (*gauge) = 2.0f;
+        registry.render(subject);
+        EXPECT_EQ(output.str(), "test_counter = 7\ntest_gauge = 2.00\ntest_str = text\n\n");
+
+        output.str("");
+        (*counter) += 3;
+        (*gauge) = 1.5f;
+        registry.render(subject);
+        EXPECT_EQ(output.str(), "test_counter = 3\ntest_gauge = -0.50\ntest_str = text\n\n");
+
+        // Another renderer keeps its own previous values
+        std::stringstream other_output;
+        PlainRenderer other(other_output);
+        other.delta(true);
+        registry.render(other);
+        EXPECT_EQ(other_output.str(), "test_counter = 10\ntest_gauge = 1.50\ntest_str = text\n\n");
+    }
+
+    TEST(PlainRenderer, render_delta_reused_index)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry registry([&dummy_clock]{return dummy_clock;});
+        Registry other_registry([&dummy_clock]{return dummy_clock;});
+
+        std::stringstream output;
+        PlainRenderer subject(output);
+        subject.delta(true);
+
+        // Metrics of different registries have the same IDs, but their previous values are kept apart
+        auto counter = registry.create_metric(UINT::KIND, "test_counter", "", "test desc");
+        auto other_counter = other_registry.create_metric(UINT::KIND, "test_other", "", "test desc");
+        EXPECT_EQ(counter->id(), other_counter->id());
+        (*counter) += 7;
+        (*other_counter) += 100;
+        registry.render(subject);
+        other_registry.render(subject);
+        output.str("");
+
+        (*counter) += 1;
+        (*other_counter) += 1;
+        registry.render(subject);
+        other_registry.render(subject);
+        EXPECT_EQ(output.str(), "test_counter = 1\n\ntest_other = 1\n\n");
+
+        // A new metric given a removed metric's index starts from zero
+        output.str("");
+        registry.remove("test_counter");
+        auto replacement = registry.create_metric(UINT::KIND, "test_replacement", "", "test desc");
+        EXPECT_EQ(replacement->id() & 0xffffffff, counter->id());
+        (*replacement) += 3;
+        registry.render(subject);
+        EXPECT_EQ(output.str(), "test_replacement = 3\n\n");
+    }
+
+    TEST(PlainRenderer, render_metric_delta)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry registry([&dummy_clock]{return dummy_clock;});
+        auto counter1 = registry.create_metric(UINT::KIND, "test_counter1", "", "test desc");
+        auto counter2 = registry.create_metric(UINT::KIND, "test_counter2", "", "test desc");
+        auto counter3 = registry.create_metric(UINT::KIND, "test_counter3", "", "test desc");
+        counter1->render_delta(true);
+        EXPECT_TRUE(counter1->render_delta());
+        EXPECT_FALSE(counter2->render_delta());
+        counter3->reset_on_render(true);
+
+        std::stringstream output;
+        PlainRenderer subject(output);
+
+        (*counter1) += 5;
+        (*counter2) += 5;
+        (*counter3) += 5;
+        registry.render(subject);
+        output.str("");
+
+        (*counter1) += 2;
+        (*counter2) += 2;
+        (*counter3) += 2;
+        registry.render(subject);
+        EXPECT_EQ(output.str(), "test_counter1 = 2\ntest_counter2 = 7\ntest_counter3 = 2\n\n");
+    }
+
+    TEST(PlainRenderer, render_rates)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry registry([&dummy_clock]{return dummy_clock;});
+        auto counter = registry.create_metric(UINT::KIND, "net.rx", "", "test desc");
+        auto level = registry.create_metric(INT::KIND, "net.level", "", "test desc");
+        auto gauge = registry.create_metric(FLOAT::KIND, "net.gauge", "", "test desc");
+        auto other = registry.create_metric(UINT::KIND, "disk.reads", "", "test desc");
+
+        std::stringstream output;
+        PlainRenderer subject(output);
+        EXPECT_FALSE(subject.rates());
+        subject.rates(true, "net.");
+        EXPECT_TRUE(subject.rates());
+
+        (*counter) += 100;
+        (*level) = 10;
+        registry.render(subject);
+        EXPECT_EQ(output.str(), "disk.reads = 0\nnet.gauge = 0.00\nnet.level = 10\nnet.level.rate = 0.00\nnet.rx = 100\nnet.rx.rate = 0.00\n\n");
+
+        output.str("");
+        dummy_clock += std::chrono::seconds(2);
+        (*counter) += 50;
+        (*level) = 4;
+        (*other) += 10;
+        registry.render(subject);
+        EXPECT_EQ(output.str(), "disk.reads = 10\nnet.gauge = 0.00\nnet.level = 4\nnet.level.rate = -3.00\nnet.rx = 150\nnet.rx.rate = 25.00\n\n");
+
+        // A counter that falls is assumed to have been reset
+        output.str("");
+        dummy_clock += std::chrono::seconds(2);
+        (*counter) = 20;
+        registry.render(subject);
+        EXPECT_EQ(output.str(), "disk.reads = 10\nnet.gauge = 0.00\nnet.level = 4\nnet.level.rate = 0.00\nnet.rx = 20\nnet.rx.rate = 10.00\n\n");
+    }
+
+    TEST(PlainRenderer, render_rates_reset_on_render)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry registry([&dummy_clock]{return dummy_clock;});
+        auto counter = registry.create_metric(UINT::KIND, "test_counter", "", "test desc");
+        counter->reset_on_render(true);
+
+        std::stringstream output;
+        PlainRenderer subject(output);
+        subject.rates(true);
+
+        registry.render(subject);
+        output.str("");
+        dummy_clock += std::chrono::seconds(4);
+        (*counter) += 8;
+        registry.render(subject);
+        EXPECT_EQ(output.str(), "test_counter = 8\ntest_counter.rate = 2.00\n\n");
+    }
+
+    TEST(PlainRenderer, render_roll_up)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry registry([&dummy_clock]{return dummy_clock;});
+        auto eth0_rx = registry.create_metric(UINT::KIND, "net.eth0.rx_bytes", "", "test desc");
+        auto eth0_tx = registry.create_metric(UINT::KIND, "net.eth0.tx_bytes", "", "test desc");
+        auto eth1_rx = registry.create_metric(UINT::KIND, "net.eth1.rx_bytes", "", "test desc");
+        auto disk_util = registry.create_metric(FLOAT::KIND, "disk.sda.util", "", "test desc");
+        auto disk_label = registry.create_metric(STR::KIND, "disk.sda.label", "test desc", "root");
+
+        EXPECT_FALSE(registry.roll_up());
+        registry.roll_up(true);
+        EXPECT_TRUE(registry.roll_up());
+
+        (*eth0_rx) += 100;
+        (*eth0_tx) += 20;
+        (*eth1_rx) += 5;
+        (*disk_util) = 0.25f;
+
+        std::stringstream output;
+        PlainRenderer subject(output);
+        registry.render(subject);
+        EXPECT_EQ(output.str(), "disk = 0.25\ndisk.sda = 0.25\ndisk.sda.label = root\ndisk.sda.util = 0.25\n"
+                "net = 125\nnet.eth0 = 120\nnet.eth0.rx_bytes = 100\nnet.eth0.tx_bytes = 20\nnet.eth1 = 5\nnet.eth1.rx_bytes = 5\n\n");
+
+        // New metrics join the tree; a prefix that is a metric's name isn't rolled up
+        auto eth1_tx = registry.create_metric(UINT::KIND, "net.eth1.tx_bytes", "", "test desc");
+        auto eth1 = registry.create_metric(INT::KIND, "net.eth1", "", "test desc");
+        (*eth1_tx) += 10;
+        (*eth1) = -1;
+
+        output.str("");
+        registry.render(subject, "net.eth1");
+        EXPECT_EQ(output.str(), "net.eth1 = -1\nnet.eth1.rx_bytes = 5\nnet.eth1.tx_bytes = 10\n\n");
+
+        output.str("");
+        registry.render(subject, "net");
+        EXPECT_EQ(output.str(), "net = 134\nnet.eth0 = 120\nnet.eth0.rx_bytes = 100\nnet.eth0.tx_bytes = 20\nnet.eth1 = -1\n"
+                "net.eth1.rx_bytes = 5\nnet.eth1.tx_bytes = 10\n\n");
+    }
+
+    TEST(PlainRenderer, render_roll_up_callback)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry registry([&dummy_clock]{return dummy_clock;});
+        auto free_slots = registry.create_metric(UINT::KIND, "pool.free", "", "test desc");
+        auto size = registry.create_metric(CALLBACK::KIND, "pool.size", "", "test desc",
+                [&dummy_clock]{dummy_clock += std::chrono::milliseconds(5); return 7.0f;});
+        registry.roll_up(true);
+        (*free_slots) += 3;
+
+        // The callback's duration isn't summed with the metrics under the prefix
+        std::stringstream output;
+        PlainRenderer subject(output);
+        registry.render(subject, "pool");
+        EXPECT_EQ(output.str(), "pool = 3\npool.free = 3\npool.size = 7.00\npool.size.duration = 5.00 ms\npool.size.duration.overruns = 0\n\n");
+        EXPECT_FLOAT_EQ(float(*size), 7.0f);
+    }
+
+    TEST(PlainRenderer, render_roll_up_delta)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry registry([&dummy_clock]{return dummy_clock;});
+        auto rx = registry.create_metric(UINT::KIND, "net.rx", "", "test desc");
+        registry.roll_up(true);
+
+        std::stringstream output;
+        PlainRenderer subject(output);
+        subject.delta(true);
+
+        (*rx) += 10;
+        registry.render(subject);
+        output.str("");
+        (*rx) += 5;
+        registry.render(subject);
+        EXPECT_EQ(output.str(), "net = 5\nnet.rx = 5\n\n");
+    }
 }
@@ -209,4 +209,41 @@ namespace measuro
         std::stringstream test_output;
         EXPECT_THROW(PrometheusRenderer subject = PrometheusRenderer(test_output, [](){return 1234567;}, "invalid¬name"), RenderError);
     }
+
+    TEST(PrometheusRenderer, series)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        auto metric = std::make_shared<MeanMetric>("example_latency", "ms", "An example mean metric", [&dummy_clock]{return dummy_clock;}, true);
+        metric->add(3);
+        metric->add(4);
+        metric->calculate();
+
+        std::stringstream test_output;
+        PrometheusRenderer subject(test_output, [](){return 1234567;}, "testapp");
+        subject.before();
+        subject.render(metric);
+        subject.after();
+
+        EXPECT_EQ(test_output.str(), "# HELP testapp::example_latency_ms An example mean metric\ntestapp::example_latency_ms 3.50 1234567\ntestapp::example_latency_ms{series=\"sum\"} 7.00 1234567\ntestapp::example_latency_ms{series=\"count\"} 2 1234567\n");
+    }
+
+    TEST(PrometheusRenderer, render_state)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+
+        auto metric = std::make_shared<StateMetric>("example_link", "", "An example state metric", [&dummy_clock]{return dummy_clock;},
+                std::vector<std::string>{"up", "down"});
+        metric->transition(1);
+
+        std::stringstream test_output;
+        PrometheusRenderer subject(test_output, [](){return 1234567;}, "testapp");
+        subject.before();
+        subject.render(metric);
+        subject.after();
+
+        EXPECT_EQ(test_output.str(), "# HELP testapp::example_link An example state metric\ntestapp::example_link 1 1234567\n"
+                "testapp::example_link{series=\"up.percent\"} 0.00 1234567\ntestapp::example_link{series=\"up.transitions\"} 0 1234567\n"
+                "testapp::example_link{series=\"down.percent\"} 0.00 1234567\ntestapp::example_link{series=\"down.transitions\"} 0 1234567\n");
+    }
 }
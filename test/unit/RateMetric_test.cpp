@@ -43,6 +43,18 @@ namespace measuro
         EXPECT_EQ(std::string(subject), "12.00");
     }
 
+
+    TEST(RateMetric, dependencies)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        auto target = std::make_shared<NumberMetric<Metric::Kind::UINT, std::uint64_t> >("test_name", "bps", "test desc", [&dummy_clock]{return dummy_clock;}, 1);
+        RateMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > subject(target, "test_rate", "test_unit", "test desc", [&dummy_clock]{return dummy_clock;});
+
+        auto result = subject.dependencies();
+        ASSERT_EQ(result.size(), 1);
+        EXPECT_EQ(result[0], target);
+    }
+
     TEST(RateMetric, rate_of_sum_calc)
     {
         std::chrono::steady_clock::time_point dummy_clock;
@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
 #include <cstdint>
+#include <future>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "measuro.hpp"
 #include "stubs.hpp"
@@ -349,6 +351,558 @@ namespace measuro
         EXPECT_TRUE(rndr.check_log({"before()", "render(test_name)", "after()"}));
     }
 
+    TEST(Registry, create_mean)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto metric = subject.create_metric(MEAN::KIND, "test_name", "test_unit", "test_description", true, std::chrono::milliseconds(2000));
+
+        EXPECT_EQ(metric->kind(), Metric::Kind::MEAN);
+        EXPECT_EQ(metric->name(), "test_name");
+        EXPECT_EQ(metric->unit(), "test_unit");
+        EXPECT_EQ(metric->description(), "test_description");
+        EXPECT_EQ(metric->hook_rate_limit(), std::chrono::milliseconds(2000));
+
+        metric->add(4);
+        metric->add(8);
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(test_name)", "after()"}));
+        EXPECT_FLOAT_EQ(float((*metric)), 6.0);
+        EXPECT_EQ(metric->series().size(), 2);
+    }
+
+
+    TEST(Registry, create_derived)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto hits = subject.create_metric(UINT::KIND, "z.hits", "test_unit", "test_description", 0, std::chrono::milliseconds(2000));
+        auto misses = subject.create_metric(UINT::KIND, "z.misses", "test_unit", "test_description", 0, std::chrono::milliseconds(2000));
+        auto metric = subject.create_metric(DERIVED::KIND, "test_name", "test_unit", "test_description", "z.hits / (z.hits + z.misses) * 100", std::chrono::milliseconds(2000));
+
+        EXPECT_EQ(metric->kind(), Metric::Kind::DERIVED);
+        EXPECT_EQ(metric->name(), "test_name");
+        EXPECT_EQ(metric->unit(), "test_unit");
+        EXPECT_EQ(metric->description(), "test_description");
+        EXPECT_EQ(metric->hook_rate_limit(), std::chrono::milliseconds(2000));
+
+        (*hits) = 1;
+        (*misses) = 3;
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(test_name)", "render(z.hits)", "render(z.misses)", "after()"}));
+        EXPECT_FLOAT_EQ(float((*metric)), 25.0);
+    }
+
+    TEST(Registry, create_derived_bad_expression)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto str = subject.create_metric(STR::KIND, "test_str", "test_description");
+
+        EXPECT_THROW(subject.create_metric(DERIVED::KIND, "test_name", "test_unit", "test_description", "unknown * 2"), MetricNameError);
+        EXPECT_THROW(subject.create_metric(DERIVED::KIND, "test_name", "test_unit", "test_description", "test_str * 2"), MetricTypeError);
+        EXPECT_THROW(subject.create_metric(DERIVED::KIND, "test_name", "test_unit", "test_description", "2 *"), ExpressionError);
+        EXPECT_THROW(subject(DERIVED::KIND, "test_name"), MetricNameError);
+    }
+
+    TEST(Registry, render_derived_of_rate)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto target = subject.create_metric(UINT::KIND, "c_test_name", "test_unit", "test_description", 0, std::chrono::milliseconds(0));
+        auto rate = subject.create_metric(RATE::KIND, UINT::KIND, target, "b_test_name", "test_unit", "test_description", std::chrono::milliseconds(0));
+        auto metric = subject.create_metric(DERIVED::KIND, "a_test_name", "test_unit", "test_description", "b_test_name * 8", std::chrono::milliseconds(0));
+
+        dummy_clock += std::chrono::seconds(1);
+        (*target) = 10;
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_FLOAT_EQ(float((*rate)), 10.0);
+        EXPECT_FLOAT_EQ(float((*metric)), 80.0);
+    }
+
+
+    TEST(Registry, create_windowed)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto metric = subject.create_metric(WINDOWED::KIND, "test_name", "test_unit", "test_description",
+                {std::chrono::seconds(10)}, std::chrono::seconds(1), std::chrono::milliseconds(2000));
+
+        EXPECT_EQ(metric->kind(), Metric::Kind::WINDOWED);
+        EXPECT_EQ(metric->name(), "test_name");
+        EXPECT_EQ(metric->unit(), "test_unit");
+        EXPECT_EQ(metric->description(), "test_description");
+        EXPECT_EQ(metric->hook_rate_limit(), std::chrono::milliseconds(2000));
+
+        metric->add(5);
+        dummy_clock += std::chrono::seconds(1);
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(test_name)", "after()"}));
+        EXPECT_EQ(std::uint64_t(*metric), 5);
+        EXPECT_EQ(subject(WINDOWED::KIND, "test_name"), metric);
+        EXPECT_THROW(subject(UINT::KIND, "test_name"), MetricTypeError);
+    }
+
+
+    TEST(Registry, create_ewma)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto metric = subject.create_metric(EWMA::KIND, "test_name", "test_unit", "test_description", std::chrono::seconds(5), std::chrono::milliseconds(2000));
+
+        EXPECT_EQ(metric->kind(), Metric::Kind::EWMA);
+        EXPECT_EQ(metric->name(), "test_name");
+        EXPECT_EQ(metric->unit(), "test_unit");
+        EXPECT_EQ(metric->description(), "test_description");
+        EXPECT_EQ(metric->hook_rate_limit(), std::chrono::milliseconds(2000));
+        EXPECT_EQ(metric->half_life(), std::chrono::seconds(5));
+
+        (*metric) = 8.0f;
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(test_name)", "after()"}));
+        EXPECT_FLOAT_EQ(float(*metric), 8.0f);
+        EXPECT_EQ(subject(EWMA::KIND, "test_name"), metric);
+        EXPECT_THROW(subject(UINT::KIND, "test_name"), MetricTypeError);
+    }
+
+
+    TEST(Registry, create_category)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto metric = subject.create_metric(CATEGORY::KIND, "test_name", "test_unit", "test_description", {"open", "closed"}, std::chrono::milliseconds(2000));
+
+        EXPECT_EQ(metric->kind(), Metric::Kind::CATEGORY);
+        EXPECT_EQ(metric->name(), "test_name");
+        EXPECT_EQ(metric->unit(), "test_unit");
+        EXPECT_EQ(metric->description(), "test_description");
+        EXPECT_EQ(metric->hook_rate_limit(), std::chrono::milliseconds(2000));
+
+        metric->add(1);
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(test_name)", "after()"}));
+        EXPECT_EQ(subject(CATEGORY::KIND, "test_name"), metric);
+        EXPECT_THROW(subject(UINT::KIND, "test_name"), MetricTypeError);
+    }
+
+    TEST(Registry, create_sampled)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto metric = subject.create_metric(UINT::KIND, "test_name", "test_unit", "test_description", 0, std::chrono::milliseconds(2000),
+                Sampling::every_nth(2));
+
+        EXPECT_EQ(metric->sampling().mode(), Sampling::Mode::EVERY_NTH);
+        ++(*metric);
+        ++(*metric);
+        EXPECT_EQ(std::uint64_t(*metric), 2);
+
+        auto signed_metric = subject.create_metric(INT::KIND, "test_name_2", "test_unit", "test_description", 0, std::chrono::milliseconds(2000),
+                Sampling::random(4));
+        EXPECT_EQ(signed_metric->sampling().mode(), Sampling::Mode::RANDOM);
+    }
+
+    TEST(Registry, create_state)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto metric = subject.create_metric(STATE::KIND, "test_name", "test_unit", "test_description", {"up", "down"}, std::chrono::milliseconds(2000));
+
+        EXPECT_EQ(metric->kind(), Metric::Kind::STATE);
+        EXPECT_EQ(metric->name(), "test_name");
+        EXPECT_EQ(metric->unit(), "test_unit");
+        EXPECT_EQ(metric->description(), "test_description");
+        EXPECT_EQ(metric->hook_rate_limit(), std::chrono::milliseconds(2000));
+
+        metric->transition(1);
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(test_name)", "after()"}));
+        EXPECT_EQ(subject(STATE::KIND, "test_name"), metric);
+        EXPECT_THROW(subject(CATEGORY::KIND, "test_name"), MetricTypeError);
+    }
+
+    TEST(Registry, create_callback)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        std::size_t calls = 0;
+        auto metric = subject.create_metric(CALLBACK::KIND, "test_name", "test_unit", "test_description",
+                [&calls]{return float(++calls);}, std::chrono::milliseconds(100), std::chrono::milliseconds(2000));
+
+        EXPECT_EQ(metric->kind(), Metric::Kind::CALLBACK);
+        EXPECT_EQ(metric->name(), "test_name");
+        EXPECT_EQ(metric->unit(), "test_unit");
+        EXPECT_EQ(metric->description(), "test_description");
+        EXPECT_EQ(metric->hook_rate_limit(), std::chrono::milliseconds(2000));
+        EXPECT_EQ(metric->batch()->name(), "test_name.duration");
+        EXPECT_EQ(metric->batch()->time_limit(), std::chrono::milliseconds(100));
+        EXPECT_EQ(calls, 0);
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(test_name)", "render(test_name.duration)", "after()"}));
+        EXPECT_EQ(calls, 1);
+        EXPECT_FLOAT_EQ(float(*metric), 1.0f);
+        EXPECT_EQ(subject(CALLBACK::KIND, "test_name"), metric);
+        EXPECT_THROW(subject(FLOAT::KIND, "test_name.duration"), MetricTypeError);
+    }
+
+    TEST(Registry, create_callback_duplicate)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        subject.create_metric(UINT::KIND, "taken", "test_unit", "test_description");
+        subject.create_metric(UINT::KIND, "other.duration", "test_unit", "test_description");
+
+        // Neither the gauge nor its batch is registered if either name is in use
+        EXPECT_THROW(subject.create_metric(CALLBACK::KIND, "taken", "test_unit", "test_description", []{return 1.0f;}), MetricNameError);
+        EXPECT_THROW(subject.create_metric(CALLBACK::KIND, "other", "test_unit", "test_description", []{return 1.0f;}), MetricNameError);
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(other.duration)", "render(taken)", "after()"}));
+
+        auto metric = subject.create_metric(CALLBACK::KIND, "taken.gauge", "test_unit", "test_description", []{return 1.0f;});
+        EXPECT_EQ(metric->batch()->name(), "taken.gauge.duration");
+    }
+
+    TEST(Registry, create_callback_batch)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        std::size_t calls = 0;
+        auto batch = subject.create_callback_batch("pool_stats", "Time taken to gather pool statistics", 3,
+                [&calls](std::vector<float> & values)
+                {
+                    ++calls;
+                    values[0] = 1.0f;
+                    values[1] = 2.0f;
+                    values[2] = 3.0f;
+                });
+
+        auto first = subject.create_metric(CALLBACK::KIND, batch, 0, "pool.first", "", "test_description");
+        auto second = subject.create_metric(CALLBACK::KIND, batch, 1, "pool.second", "", "test_description");
+        auto third = subject.create_metric(CALLBACK::KIND, batch, 2, "pool.third", "", "test_description");
+        EXPECT_THROW(subject.create_metric(CALLBACK::KIND, batch, 3, "pool.fourth", "", "test_description"), MetricConfigError);
+
+        // One call per render fills every gauge
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_EQ(calls, 1);
+        EXPECT_FLOAT_EQ(float(*first), 1.0f);
+        EXPECT_FLOAT_EQ(float(*second), 2.0f);
+        EXPECT_FLOAT_EQ(float(*third), 3.0f);
+
+        // Rendering only some of the gauges still calls the batch
+        subject.render(rndr, "pool.");
+        EXPECT_EQ(calls, 2);
+    }
+
+
+    TEST(Registry, create_counter_block)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto block = subject.create_counter_block({"http.requests", "http.bytes_in"}, "test_unit", "test_description", true);
+        EXPECT_TRUE(block->per_thread());
+
+        auto requests = subject(BLOCK::KIND, "http.requests");
+        EXPECT_EQ(requests->kind(), Metric::Kind::BLOCK);
+        EXPECT_EQ(requests->unit(), "test_unit");
+        EXPECT_EQ(requests->description(), "test_description");
+        EXPECT_EQ(requests->block(), block);
+        EXPECT_EQ(subject(BLOCK::KIND, "http.bytes_in")->index(), 1);
+
+        // Per-thread copies are folded in before rendering
+        block->add(0, 3);
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_EQ(std::uint64_t(*requests), 3);
+
+        // A clash registers none of the counters
+        EXPECT_THROW(subject.create_counter_block({"other", "http.requests"}, "", ""), MetricNameError);
+        EXPECT_THROW(subject.create_counter_block({"twice", "twice"}, "", ""), MetricNameError);
+        EXPECT_THROW(subject(BLOCK::KIND, "other"), MetricNameError);
+        EXPECT_THROW(subject(BLOCK::KIND, "twice"), MetricNameError);
+    }
+
+
+    TEST(Registry, create_metrics)
+    {
+        Registry subject;
+        subject.create_metric(UINT::KIND, "test_taken", "test_unit", "test_description");
+
+        std::vector<MetricSpec> specs;
+        for (int i = 0; i < 1000; ++i)
+        {
+            specs.push_back({"test_uint_" + std::to_string(i), "test_unit", "test_description"});
+        }
+
+        auto metrics = subject.create_metrics(UINT::KIND, specs);
+        ASSERT_EQ(metrics.size(), 1000);
+        EXPECT_EQ(metrics[7]->name(), "test_uint_7");
+        EXPECT_EQ(metrics[7]->unit(), "test_unit");
+        EXPECT_EQ(metrics[7]->id(), 8);
+        EXPECT_EQ(subject(UINT::KIND, "test_uint_999"), metrics[999]);
+        ++(*metrics[3]);
+        EXPECT_EQ(std::uint64_t(*subject(UINT::KIND, "test_uint_3")), 1);
+
+        // Name clashes, within the specs or with the registry, create nothing
+        EXPECT_THROW(subject.create_metrics(INT::KIND, {{"test_int_1", "", ""}, {"test_int_2", "", ""}, {"test_int_1", "", ""}}), MetricNameError);
+        EXPECT_THROW(subject.create_metrics(INT::KIND, {{"test_int_1", "", ""}, {"test_taken", "", ""}}), MetricNameError);
+        EXPECT_THROW(subject(INT::KIND, "test_int_1"), MetricNameError);
+
+        auto floats = subject.create_metrics(FLOAT::KIND, {{"test_float_1", "", ""}, {"test_float_2", "", ""}});
+        auto ints = subject.create_metrics(INT::KIND, {{"test_int_1", "", ""}});
+        EXPECT_EQ(subject(FLOAT::KIND, {"test_float_2", "test_float_1"}), std::vector<FloatHandle>({floats[1], floats[0]}));
+        EXPECT_EQ(subject(INT::KIND, std::vector<MetricKey>{"test_int_1"}).at(0), ints[0]);
+        EXPECT_EQ(subject(UINT::KIND, {"test_uint_1", "test_taken"}).size(), 2);
+        EXPECT_THROW(subject(UINT::KIND, {"test_uint_1", "test_float_1"}), MetricTypeError);
+
+        // The metrics outlive the registry
+        std::shared_ptr<Registry> owner = std::make_shared<Registry>();
+        auto outliving = owner->create_metrics(UINT::KIND, {{"test_a", "", ""}, {"test_b", "", ""}});
+        owner.reset();
+        ++(*outliving[1]);
+        EXPECT_EQ(std::uint64_t(*outliving[1]), 1);
+    }
+
+    TEST(Registry, remove)
+    {
+        Registry subject;
+        auto uint_metric = subject.create_metric(UINT::KIND, "test.uint", "test_unit", "test_description");
+        auto int_metric = subject.create_metric(INT::KIND, "test.int", "test_unit", "test_description");
+        auto sum_metric = subject.create_metric(SUM::KIND, UINT::KIND, "test_sum", "test_unit", "test_description", {uint_metric});
+        auto rate_metric = subject.create_metric(RATE::KIND, UINT::KIND, uint_metric, "test_rate", "test_unit", "test_description");
+        auto rate_of_sum_metric = subject.create_metric(RATE::KIND, SUM::KIND, UINT::KIND, sum_metric, "test_rate_of_sum", "test_unit", "test_description");
+        auto derived_metric = subject.create_metric(DERIVED::KIND, "test_derived", "test_unit", "test_description", "test.int * 2");
+        auto kept_metric = subject.create_metric(UINT::KIND, "test_kept", "test_unit", "test_description");
+
+        EXPECT_EQ(subject.remove("test_missing"), 0);
+
+        // Rates of the metric are removed with it, and it's dropped from sums
+        EXPECT_EQ(subject.remove("test.uint"), 2);
+        EXPECT_THROW(subject(UINT::KIND, "test.uint"), MetricNameError);
+        EXPECT_EQ(sum_metric->target_count(), 0);
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(test.int)", "render(test_derived)", "render(test_kept)", "render(test_rate_of_sum)", "render(test_sum)", "after()"}));
+
+        // The handle remains usable, and the name can be reused
+        ++(*uint_metric);
+        EXPECT_EQ(std::uint64_t(*uint_metric), 1);
+        auto replacement = subject.create_metric(UINT::KIND, "test.uint", "test_unit", "test_description");
+        EXPECT_EQ(subject(UINT::KIND, "test.uint"), replacement);
+
+        // Derived metrics of removed metrics are removed too
+        EXPECT_EQ(subject.remove_prefix("test."), 3);
+        EXPECT_THROW(subject(DERIVED::KIND, "test_derived"), MetricNameError);
+        EXPECT_EQ(subject(UINT::KIND, "test_kept"), kept_metric);
+        EXPECT_EQ(subject.remove_prefix("test."), 0);
+    }
+
+    TEST(Registry, remove_releases_expression)
+    {
+        Registry subject;
+        auto int_metric = subject.create_metric(INT::KIND, "test.int", "test_unit", "test_description");
+        auto derived_metric = subject.create_metric(DERIVED::KIND, "test_derived", "test_unit", "test_description", "test.int * 2");
+        EXPECT_THROW(subject.create_metric(DERIVED::KIND, "test_derived", "test_unit", "test_description", "test.int * 3"), MetricNameError);
+
+        std::weak_ptr<Metric> int_observer(int_metric);
+        std::weak_ptr<Metric> derived_observer(derived_metric);
+        int_metric.reset();
+        derived_metric.reset();
+
+        // Neither the registry nor its expressions keep removed metrics alive
+        EXPECT_EQ(subject.remove("test.int"), 2);
+        EXPECT_TRUE(derived_observer.expired());
+        EXPECT_TRUE(int_observer.expired());
+    }
+
+
+    TEST(Registry, get_or_create)
+    {
+        Registry subject;
+        auto created = subject.get_or_create(UINT::KIND, "test_uint", "test_unit", "test_description");
+        EXPECT_EQ(created->name(), "test_uint");
+        EXPECT_EQ(created->unit(), "test_unit");
+        EXPECT_EQ(subject(UINT::KIND, "test_uint"), created);
+        EXPECT_EQ(subject.get_or_create(UINT::KIND, "test_uint", "other_unit", "other_description"), created);
+        EXPECT_EQ(created->unit(), "test_unit");
+
+        auto int_metric = subject.create_metric(INT::KIND, "test_int", "test_unit", "test_description");
+        EXPECT_EQ(subject.get_or_create(INT::KIND, "test_int", "test_unit", "test_description"), int_metric);
+        EXPECT_THROW(subject.get_or_create(FLOAT::KIND, "test_int", "test_unit", "test_description"), MetricTypeError);
+        subject.create_metric(RATE::KIND, UINT::KIND, created, "test_rate", "test_unit", "test_description");
+        EXPECT_THROW(subject.get_or_create(UINT::KIND, "test_rate", "test_unit", "test_description"), MetricTypeError);
+
+        // Racing creators all get the winner's metric
+        const std::size_t thread_count = 8;
+        std::vector<FloatHandle> results(thread_count);
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < thread_count; ++i)
+        {
+            threads.emplace_back([&subject, &results, i]
+            {
+                results[i] = subject.get_or_create(FLOAT::KIND, "test_float", "test_unit", "test_description");
+            });
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        for (const auto & result : results)
+        {
+            EXPECT_EQ(result, results[0]);
+        }
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(test_float)", "render(test_int)", "render(test_rate)", "render(test_uint)", "after()"}));
+    }
+
+
+    TEST(Registry, lookup_cache)
+    {
+        Registry subject;
+        EXPECT_FALSE(subject.lookup_cache());
+        subject.lookup_cache(true);
+        EXPECT_TRUE(subject.lookup_cache());
+
+        // Enough metrics to overwrite cached ones
+        std::vector<UintHandle> metrics;
+        for (std::size_t i = 0; i < 2000; ++i)
+        {
+            metrics.push_back(subject.create_metric(UINT::KIND, "test_uint_" + std::to_string(i), "test_unit", "test_description"));
+        }
+
+        for (std::size_t pass = 0; pass < 2; ++pass)
+        {
+            for (std::size_t i = 0; i < metrics.size(); ++i)
+            {
+                EXPECT_EQ(subject.resolve<UintHandle::element_type>("test_uint_" + std::to_string(i)).get(), metrics[i].get());
+            }
+        }
+
+        EXPECT_THROW(subject.resolve<IntHandle::element_type>("test_uint_0"), MetricTypeError);
+        EXPECT_THROW(subject.resolve("test_missing"), MetricNameError);
+
+        // Removal invalidates the cache, in every thread
+        EXPECT_EQ(subject.resolve<UintHandle::element_type>("test_uint_1").get(), metrics[1].get());
+        std::thread([&subject, &metrics]{EXPECT_EQ(subject.resolve<UintHandle::element_type>("test_uint_1").get(), metrics[1].get());}).join();
+        subject.remove("test_uint_1");
+        EXPECT_THROW(subject.resolve("test_uint_1"), MetricNameError);
+        auto replacement = subject.create_metric(UINT::KIND, "test_uint_1", "test_unit", "test_description");
+        EXPECT_EQ(subject.resolve<UintHandle::element_type>("test_uint_1").get(), replacement.get());
+        std::thread([&subject, &replacement]{EXPECT_EQ(subject.resolve<UintHandle::element_type>("test_uint_1").get(), replacement.get());}).join();
+
+        // Each registry has its own cache
+        std::unique_ptr<Registry> other(new Registry());
+        other->lookup_cache(true);
+        auto other_metric = other->create_metric(UINT::KIND, "test_uint_0", "test_unit", "test_description");
+        EXPECT_EQ(other->resolve<UintHandle::element_type>("test_uint_0").get(), other_metric.get());
+        EXPECT_EQ(subject.resolve<UintHandle::element_type>("test_uint_0").get(), metrics[0].get());
+        other.reset();
+        other.reset(new Registry());
+        other->lookup_cache(true);
+        EXPECT_THROW(other->resolve("test_uint_0"), MetricNameError);
+
+        subject.lookup_cache(false);
+        EXPECT_EQ(subject.resolve<UintHandle::element_type>("test_uint_1").get(), replacement.get());
+    }
+
+    TEST(Registry, lookup_cache_references)
+    {
+        Registry subject;
+        auto metric = subject.create_metric(UINT::KIND, "test_uint", "test_unit", "test_description");
+        auto batch = subject.create_callback_batch("test_batch", "test_description", 1, [](std::vector<float> & values){values[0] = 1.0f;});
+
+        for (const bool cached : {false, true})
+        {
+            subject.lookup_cache(cached);
+
+            auto reference = subject.resolve<UintHandle::element_type>("test_uint");
+            EXPECT_EQ(reference.get(), metric.get());
+            EXPECT_EQ(reference.id(), metric->id());
+            EXPECT_EQ(subject.resolve<UintHandle::element_type>("test_uint"), reference);
+            EXPECT_EQ(subject.resolve("test_uint").get(), metric.get());
+            EXPECT_THROW(subject.resolve<IntHandle::element_type>("test_uint"), MetricTypeError);
+            EXPECT_THROW(subject.resolve("test_missing"), MetricNameError);
+            EXPECT_THROW(subject.resolve("test_batch"), MetricTypeError);
+        }
+
+        // The cache doesn't keep removed metrics alive
+        std::weak_ptr<Metric> observer(metric);
+        EXPECT_EQ(subject(UINT::KIND, "test_uint"), metric);
+        metric.reset();
+        EXPECT_EQ(subject.remove("test_uint"), 1);
+        EXPECT_TRUE(observer.expired());
+        EXPECT_THROW(subject.resolve("test_uint"), MetricNameError);
+        EXPECT_THROW(subject(UINT::KIND, "test_uint"), MetricNameError);
+
+        auto replacement = subject.create_metric(UINT::KIND, "test_uint", "test_unit", "test_description");
+        EXPECT_EQ(subject.resolve<UintHandle::element_type>("test_uint").get(), replacement.get());
+        EXPECT_EQ(subject(UINT::KIND, "test_uint"), replacement);
+    }
+
+    TEST(Registry, adaptive_sharding)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto before = subject.create_metric(UINT::KIND, "test_before", "test_unit", "test_description");
+        EXPECT_FALSE(before->adaptive());
+
+        subject.adaptive_sharding(true, 50);
+        auto after = subject.create_metric(INT::KIND, "test_after", "test_unit", "test_description");
+        auto untouched = subject.create_metric(UINT::KIND, "test_untouched", "test_unit", "test_description");
+        EXPECT_TRUE(before->adaptive());
+        EXPECT_TRUE(after->adaptive());
+        EXPECT_TRUE(subject.promotions().empty());
+
+        dummy_clock += std::chrono::seconds(2);
+        after->promote();
+        dummy_clock += std::chrono::seconds(2);
+        before->promote();
+
+        auto promotions = subject.promotions();
+        ASSERT_EQ(promotions.size(), 2);
+        EXPECT_EQ(promotions[0].name, "test_after");
+        EXPECT_EQ(promotions[0].time, dummy_clock - std::chrono::seconds(2));
+        EXPECT_EQ(promotions[1].name, "test_before");
+        EXPECT_EQ(promotions[1].time, dummy_clock);
+        EXPECT_FALSE(untouched->promoted());
+
+        subject.adaptive_sharding(false);
+        EXPECT_FALSE(before->adaptive());
+        EXPECT_TRUE(before->promoted());
+
+        subject.adaptive_sharding(true, 50, ShardBy::CPU);
+        EXPECT_EQ(untouched->shard_by(), ShardBy::CPU);
+        untouched->promote(untouched->shard_by());
+        promotions = subject.promotions();
+        ASSERT_EQ(promotions.size(), 3);
+        EXPECT_EQ(promotions[0].by, ShardBy::THREAD);
+        EXPECT_EQ(promotions[2].name, "test_untouched");
+        EXPECT_EQ(promotions[2].by, ShardBy::CPU);
+    }
+
     TEST(Registry, duplicate_metric)
     {
         std::chrono::steady_clock::time_point dummy_clock;
@@ -412,6 +966,31 @@ namespace measuro
         EXPECT_EQ(subject(BOOL::KIND, "test_name2"), metric2);
     }
 
+    TEST(Registry, lookup_mean)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto metric1 = subject.create_metric(MEAN::KIND, "test_name", "test_unit", "test_description");
+        auto metric2 = subject.create_metric(MEAN::KIND, "test_name2", "test_unit", "test_description");
+
+        EXPECT_EQ(subject(MEAN::KIND, "test_name"), metric1);
+        EXPECT_EQ(subject(MEAN::KIND, "test_name2"), metric2);
+        EXPECT_THROW(subject(UINT::KIND, "test_name"), MetricTypeError);
+    }
+
+
+    TEST(Registry, lookup_derived)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto metric1 = subject.create_metric(DERIVED::KIND, "test_name", "test_unit", "test_description", "1 + 1");
+        auto metric2 = subject.create_metric(DERIVED::KIND, "test_name2", "test_unit", "test_description", "test_name * 2");
+
+        EXPECT_EQ(subject(DERIVED::KIND, "test_name"), metric1);
+        EXPECT_EQ(subject(DERIVED::KIND, "test_name2"), metric2);
+        EXPECT_THROW(subject(UINT::KIND, "test_name"), MetricTypeError);
+    }
+
     TEST(Registry, lookup_bad_type)
     {
         std::chrono::steady_clock::time_point dummy_clock;
@@ -454,6 +1033,165 @@ namespace measuro
         EXPECT_TRUE(rndr.check_log({"before()", "render(module1.test_a)", "render(module1.test_b)", "after()"}));
     }
 
+
+
+    TEST(Registry, render_filter)
+    {
+        Registry subject;
+        subject.create_metric(UINT::KIND, "cpu.user", "test_unit", "test_description");
+        subject.create_metric(UINT::KIND, "disk.sda.reads", "test_unit", "test_description");
+        subject.create_metric(UINT::KIND, "disk.sdb.reads", "test_unit", "test_description");
+        subject.create_metric(UINT::KIND, "net.eth0.rx", "test_unit", "test_description");
+        subject.create_metric(UINT::KIND, "net.lo.rx", "test_unit", "test_description");
+        subject.create_metric(UINT::KIND, "net.lo.tx", "test_unit", "test_description");
+        subject.create_metric(UINT::KIND, "net.lo0.rx", "test_unit", "test_description");
+
+        StubRenderer rndr;
+        subject.render(rndr, RenderFilter({"net.", "disk."}, {"net.lo.", "disk.sda"}));
+        EXPECT_TRUE(rndr.check_log({"before()", "render(disk.sdb.reads)", "render(net.eth0.rx)", "render(net.lo0.rx)", "after()"}));
+
+        // The renderer's filter applies to every render by it
+        rndr.filter(RenderFilter({"net."}, {"net.lo"}));
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(net.eth0.rx)", "after()"}));
+
+        subject.render(rndr, "disk.");
+        EXPECT_TRUE(rndr.check_log({"before()", "after()"}));
+
+        subject.render(rndr, RenderFilter({"net.eth", "cpu."}));
+        EXPECT_TRUE(rndr.check_log({"before()", "render(net.eth0.rx)", "after()"}));
+
+        // Roll-up sums are filtered too
+        rndr.filter(RenderFilter({}, {"disk", "net"}));
+        subject.roll_up(true);
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(cpu)", "render(cpu.user)", "after()"}));
+    }
+
+
+    TEST(Registry, render_unlocked)
+    {
+        // Creates and looks up metrics as it renders, which needs the registry lock
+        class CreatingRenderer : public Renderer
+        {
+        public:
+            CreatingRenderer(Registry & registry) : Renderer(), m_registry(registry)
+            {
+            }
+
+            void before() override final
+            {
+                m_rendered.clear();
+            }
+
+            void render(const std::shared_ptr<Metric> & metric) override final
+            {
+                m_rendered.push_back(metric->name());
+                m_registry.create_metric(UINT::KIND, metric->name() + ".seen", "test_unit", "test_description");
+                m_registry(UINT::KIND, metric->name() + ".seen");
+            }
+
+            std::vector<std::string> m_rendered;
+
+        private:
+            Registry & m_registry;
+        };
+
+        Registry subject;
+        subject.create_metric(UINT::KIND, "a", "test_unit", "test_description");
+        subject.create_metric(UINT::KIND, "b", "test_unit", "test_description");
+
+        // Metrics created during a render are rendered by the next
+        CreatingRenderer rndr(subject);
+        subject.render(rndr);
+        EXPECT_EQ(rndr.m_rendered, std::vector<std::string>({"a", "b"}));
+
+        rndr.filter(RenderFilter({"a"}));
+        EXPECT_THROW(subject.render(rndr), MetricNameError);
+        EXPECT_EQ(rndr.m_rendered, std::vector<std::string>({"a"}));
+
+        rndr.filter(RenderFilter({"a.seen"}));
+        subject.render(rndr);
+        EXPECT_EQ(rndr.m_rendered, std::vector<std::string>({"a.seen"}));
+        EXPECT_NO_THROW(subject(UINT::KIND, "a.seen.seen"));
+    }
+
+    TEST(Registry, render_dependency_order)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto target = subject.create_metric(UINT::KIND, "c_test_name", "test_unit", "test_description", 0, std::chrono::milliseconds(0));
+        auto sum = subject.create_metric(SUM::KIND, UINT::KIND, "b_test_name", "test_unit", "test_description", {target}, std::chrono::milliseconds(0));
+        auto rate = subject.create_metric(RATE::KIND, SUM::KIND, UINT::KIND, sum, "a_test_name", "test_unit", "test_description", std::chrono::milliseconds(0));
+
+        StubRenderer rndr;
+
+        dummy_clock += std::chrono::seconds(1);
+        (*target) = 10;
+
+        // The rate is rendered first, but the sum it depends on must be calculated before it
+        subject.render(rndr);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(a_test_name)", "render(b_test_name)", "render(c_test_name)", "after()"}));
+        EXPECT_EQ(std::uint64_t(*sum), 10);
+        EXPECT_FLOAT_EQ(float(*rate), 10.0f);
+    }
+
+    TEST(Registry, render_calculates_once)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        auto target = subject.create_metric(UINT::KIND, "test_target", "test_unit", "test_description", 0, std::chrono::milliseconds(0));
+        auto sum = subject.create_metric(SUM::KIND, UINT::KIND, "test_sum", "test_unit", "test_description", {target}, std::chrono::milliseconds(0));
+        auto rate1 = subject.create_metric(RATE::KIND, SUM::KIND, UINT::KIND, sum, "test_rate1", "test_unit", "test_description", std::chrono::milliseconds(0));
+        auto rate2 = subject.create_metric(RATE::KIND, SUM::KIND, UINT::KIND, sum, "test_rate2", "test_unit", "test_description", std::chrono::milliseconds(0));
+
+        std::size_t calculations = 0;
+        sum->register_hook([&calculations](const Metric &){++calculations;});
+
+        StubRenderer rndr;
+
+        subject.render(rndr);
+        EXPECT_EQ(calculations, 1);
+
+        subject.render(rndr, "test_rate");
+        EXPECT_EQ(calculations, 2);
+        EXPECT_TRUE(rndr.check_log({"before()", "render(test_rate1)", "render(test_rate2)", "after()"}));
+    }
+
+    TEST(Registry, render_parallel_calculation)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        Registry subject([&dummy_clock]{return dummy_clock;});
+        subject.parallel_calculation(1, 4);
+
+        std::vector<UintHandle> targets;
+        std::vector<SumOfUintHandle> sums;
+        std::vector<RateOfSumOfUintHandle> rates;
+        for (std::size_t index=0;index<100;++index)
+        {
+            auto suffix = std::to_string(index);
+            targets.push_back(subject.create_metric(UINT::KIND, "target" + suffix, "test_unit", "test_description", 0, std::chrono::milliseconds(0)));
+            sums.push_back(subject.create_metric(SUM::KIND, UINT::KIND, "sum" + suffix, "test_unit", "test_description", {targets.back()}, std::chrono::milliseconds(0)));
+            rates.push_back(subject.create_metric(RATE::KIND, SUM::KIND, UINT::KIND, sums.back(), "rate" + suffix, "test_unit", "test_description", std::chrono::milliseconds(0)));
+        }
+
+        dummy_clock += std::chrono::seconds(1);
+        for (std::size_t index=0;index<targets.size();++index)
+        {
+            (*targets[index]) = index;
+        }
+
+        StubRenderer rndr;
+        subject.render(rndr);
+        EXPECT_EQ(rndr.render_count(), 300);
+
+        for (std::size_t index=0;index<targets.size();++index)
+        {
+            EXPECT_EQ(std::uint64_t(*sums[index]), index);
+            EXPECT_FLOAT_EQ(float(*rates[index]), float(index));
+        }
+    }
+
     TEST(Registry, schedule_render)
     {
         std::chrono::steady_clock::time_point dummy_clock;
@@ -472,6 +1210,26 @@ namespace measuro
         EXPECT_EQ(rndr.render_count(), 0);
     }
 
+    TEST(Registry, cancel_schedule_during_render)
+    {
+        Registry subject;
+        auto metric = subject.create_metric(UINT::KIND, "test_name", "test_unit", "test_description", 100, std::chrono::milliseconds(2000));
+
+        // With no interval, the schedule renders continuously, so it's likely to be rendering when replaced or cancelled
+        StubRenderer rndr;
+        auto done = std::async(std::launch::async, [&subject, &rndr]
+        {
+            for (std::size_t attempt=0;attempt<100;++attempt)
+            {
+                subject.render_schedule(rndr, std::chrono::seconds(0));
+                subject.render_schedule(rndr, std::chrono::seconds(0));
+                subject.cancel_render_schedule();
+            }
+        });
+
+        EXPECT_EQ(done.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    }
+
     TEST(Registry, create_uint_throttle)
     {
         std::chrono::steady_clock::time_point dummy_clock;
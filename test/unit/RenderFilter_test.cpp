@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "measuro.hpp"
+
+namespace measuro
+{
+
+    TEST(RenderFilter, construction)
+    {
+        RenderFilter everything;
+        EXPECT_EQ(everything.include(), std::vector<std::string>({""}));
+        EXPECT_TRUE(everything.exclude().empty());
+        EXPECT_TRUE(everything.matches("test_name"));
+        EXPECT_TRUE(everything.matches(""));
+
+        // Prefixes are sorted, and those covered by a shorter prefix are dropped
+        RenderFilter subject({"net.eth0", "disk", "net", "net.eth1.rx", "diskette"}, {"net.lo.", "net.lo", "disk.sda"});
+        EXPECT_EQ(subject.include(), std::vector<std::string>({"disk", "net"}));
+        EXPECT_EQ(subject.exclude(), std::vector<std::string>({"disk.sda", "net.lo"}));
+
+        RenderFilter excluding({}, {"test_"});
+        EXPECT_EQ(excluding.include(), std::vector<std::string>({""}));
+        EXPECT_FALSE(excluding.matches("test_name"));
+        EXPECT_TRUE(excluding.matches("other_name"));
+    }
+
+    TEST(RenderFilter, matches)
+    {
+        RenderFilter subject({"disk.", "net."}, {"net.lo", "disk.sda."});
+
+        EXPECT_TRUE(subject.matches("disk.sdb.reads"));
+        EXPECT_TRUE(subject.matches("disk.sda"));
+        EXPECT_TRUE(subject.matches("net.eth0.rx_bytes"));
+        EXPECT_FALSE(subject.matches("disk.sda.reads"));
+        EXPECT_FALSE(subject.matches("net.lo.rx_bytes"));
+        EXPECT_FALSE(subject.matches("net"));
+        EXPECT_FALSE(subject.matches("cpu.user"));
+        EXPECT_FALSE(subject.matches("memory"));
+
+        EXPECT_EQ(*subject.excluded_by("net.lo.rx_bytes"), "net.lo");
+        EXPECT_EQ(subject.excluded_by("net.eth0.rx_bytes"), nullptr);
+    }
+
+    TEST(RenderFilter, intersect)
+    {
+        RenderFilter subject({"disk.", "net."}, {"net.lo"});
+
+        auto narrowed = subject.intersect(RenderFilter({"net.eth", "cpu."}, {"net.eth1"}));
+        EXPECT_EQ(narrowed.include(), std::vector<std::string>({"net.eth"}));
+        EXPECT_EQ(narrowed.exclude(), std::vector<std::string>({"net.eth1", "net.lo"}));
+        EXPECT_TRUE(narrowed.matches("net.eth0.rx_bytes"));
+        EXPECT_FALSE(narrowed.matches("net.eth1.rx_bytes"));
+        EXPECT_FALSE(narrowed.matches("disk.sda.reads"));
+
+        EXPECT_EQ(subject.intersect(RenderFilter()).include(), subject.include());
+        EXPECT_EQ(RenderFilter().intersect(subject).include(), subject.include());
+
+        // Disjoint filters match nothing
+        auto disjoint = subject.intersect(RenderFilter({"cpu."}));
+        EXPECT_TRUE(disjoint.include().empty());
+        EXPECT_FALSE(disjoint.matches("cpu.user"));
+        EXPECT_FALSE(disjoint.matches("net.eth0.rx_bytes"));
+    }
+}
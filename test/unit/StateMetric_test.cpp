@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "measuro.hpp"
+#include "stubs.hpp"
+
+namespace measuro
+{
+
+    enum class LinkState { UP = 0, DEGRADED = 1, DOWN = 2 };
+
+    TEST(StateMetric, transition)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        StateMetric subject("test_name", "", "test desc", [&dummy_clock]{return dummy_clock;}, {"up", "degraded", "down"});
+        EXPECT_EQ(subject.kind(), Metric::Kind::STATE);
+        EXPECT_EQ(subject.states().size(), 3);
+        EXPECT_EQ(std::string(subject), "up");
+        EXPECT_EQ(std::uint64_t(subject), 0);
+
+        subject.transition(LinkState::DEGRADED);
+        EXPECT_EQ(std::string(subject), "degraded");
+        EXPECT_EQ(std::uint64_t(subject), 1);
+        EXPECT_DOUBLE_EQ(subject.numeric_value(), 1.0);
+
+        subject.transition(subject.index("down"));
+        subject.transition(2);
+        EXPECT_EQ(std::string(subject), "down");
+
+        // Transitions from a state to itself aren't counted
+        EXPECT_EQ(subject.transitions(0), 0);
+        EXPECT_EQ(subject.transitions(1), 1);
+        EXPECT_EQ(subject.transitions(2), 1);
+    }
+
+    TEST(StateMetric, time_in_state)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        StateMetric subject("test_name", "", "test desc", [&dummy_clock]{return dummy_clock;}, {"up", "degraded"});
+
+        dummy_clock += std::chrono::milliseconds(300);
+        subject.transition(1);
+        dummy_clock += std::chrono::milliseconds(100);
+        subject.transition(0);
+        dummy_clock += std::chrono::milliseconds(50);
+
+        EXPECT_EQ(subject.time_in(0), std::chrono::milliseconds(350));
+        EXPECT_EQ(subject.time_in(1), std::chrono::milliseconds(100));
+    }
+
+    TEST(StateMetric, concurrent_transition)
+    {
+        const std::chrono::steady_clock::time_point start;
+        std::atomic<std::uint64_t> elapsed(0);
+
+        // Yields a varying number of times after reading the time, so that transitions overtake one another
+        StateMetric subject("test_name", "", "test desc", [&start, &elapsed]
+        {
+            auto ticks = elapsed.fetch_add(1);
+            for (auto i = ticks % 3; i > 0; --i)
+            {
+                std::this_thread::yield();
+            }
+
+            return start + std::chrono::milliseconds(ticks);
+        }, {"up", "degraded", "down"});
+
+        // The time in each state never exceeds the time that has passed
+        std::atomic<bool> exceeded(false);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&subject, &elapsed, &exceeded, t]
+            {
+                for (std::size_t i = 0; i < 2000; ++i)
+                {
+                    subject.transition((t + i) % 3);
+                    if (std::uint64_t(subject.time_in(t % 3).count()) > elapsed.load())
+                    {
+                        exceeded = true;
+                    }
+                }
+            });
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        EXPECT_FALSE(exceeded.load());
+
+        std::uint64_t total = 0;
+        for (std::size_t state = 0; state < 3; ++state)
+        {
+            auto time = std::uint64_t(subject.time_in(state).count());
+            EXPECT_LE(time, elapsed.load());
+            total += time;
+        }
+
+        EXPECT_LE(total, elapsed.load());
+    }
+
+    TEST(StateMetric, interval)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        StateMetric subject("test_name", "", "test desc", [&dummy_clock]{return dummy_clock;}, {"up", "degraded"});
+        EXPECT_DOUBLE_EQ(subject.interval_percent(0), 0.0);
+
+        dummy_clock += std::chrono::milliseconds(750);
+        subject.transition(1);
+        dummy_clock += std::chrono::milliseconds(250);
+        subject.calculate();
+
+        EXPECT_DOUBLE_EQ(subject.interval_percent(0), 75.0);
+        EXPECT_DOUBLE_EQ(subject.interval_percent(1), 25.0);
+        EXPECT_EQ(subject.interval_transitions(0), 0);
+        EXPECT_EQ(subject.interval_transitions(1), 1);
+
+        // Still degraded for the whole of the next interval
+        dummy_clock += std::chrono::milliseconds(500);
+        subject.calculate();
+
+        EXPECT_DOUBLE_EQ(subject.interval_percent(0), 0.0);
+        EXPECT_DOUBLE_EQ(subject.interval_percent(1), 100.0);
+        EXPECT_EQ(subject.interval_transitions(1), 0);
+
+        auto result = subject.series();
+        ASSERT_EQ(result.size(), 4);
+        EXPECT_EQ(result[0], std::make_pair(std::string("up.percent"), std::string("0.00")));
+        EXPECT_EQ(result[1], std::make_pair(std::string("up.transitions"), std::string("0")));
+        EXPECT_EQ(result[2], std::make_pair(std::string("degraded.percent"), std::string("100.00")));
+        EXPECT_EQ(result[3], std::make_pair(std::string("degraded.transitions"), std::string("0")));
+    }
+
+    TEST(StateMetric, bad_state)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        StateMetric subject("test_name", "", "test desc", [&dummy_clock]{return dummy_clock;}, {"up", "down"});
+
+        EXPECT_THROW(subject.transition(2), CategoryError);
+        EXPECT_THROW(subject.time_in(2), CategoryError);
+        EXPECT_THROW(subject.transitions(2), CategoryError);
+        EXPECT_THROW(subject.interval_percent(2), CategoryError);
+        EXPECT_THROW(subject.index("degraded"), CategoryError);
+
+        EXPECT_THROW(StateMetric("test_name", "", "test desc", [&dummy_clock]{return dummy_clock;}, {}), MetricConfigError);
+        EXPECT_THROW(StateMetric("test_name", "", "test desc", [&dummy_clock]{return dummy_clock;}, {"up", "down", "up"}), MetricConfigError);
+    }
+
+    TEST(StateMetric, hook)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        StateMetric subject("test_name", "", "test desc", [&dummy_clock]{return dummy_clock;}, {"up", "down"});
+
+        std::string seen;
+        subject.register_hook([&seen](const Metric & metric){seen = std::string(metric);});
+        subject.transition(1);
+        EXPECT_EQ(seen, "down");
+    }
+
+}
@@ -76,6 +76,39 @@ namespace measuro
         EXPECT_EQ(std::uint64_t(subject), 145);
     }
 
+
+    TEST(SumMetric, dependencies)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        auto target1 = std::make_shared<NumberMetric<Metric::Kind::UINT, std::uint64_t> >("test_tgt", "tst", "test desc 2", [&dummy_clock]{return dummy_clock;}, 10);
+        auto target2 = std::make_shared<NumberMetric<Metric::Kind::UINT, std::uint64_t> >("test_tgt", "tst", "test desc 2", [&dummy_clock]{return dummy_clock;}, 35);
+        SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > subject({target1}, "test_name", "tst", "test desc 1", [&dummy_clock]{return dummy_clock;});
+        subject.add_target(target2);
+
+        auto result = subject.dependencies();
+        ASSERT_EQ(result.size(), 2);
+        EXPECT_EQ(result[0], target1);
+        EXPECT_EQ(result[1], target2);
+    }
+
+
+    TEST(SumMetric, delta)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        auto target = std::make_shared<NumberMetric<Metric::Kind::UINT, std::uint64_t> >("test_tgt", "tst", "test desc 2", [&dummy_clock]{return dummy_clock;}, 10);
+        SumMetric<NumberMetric<Metric::Kind::UINT, std::uint64_t> > subject({target}, "test_name", "tst", "test desc 1", [&dummy_clock]{return dummy_clock;});
+
+        std::uint64_t checkpoint = 0;
+        std::string result;
+        EXPECT_TRUE(subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "10");
+
+        (*target) = 25;
+        subject.calculate();
+        EXPECT_TRUE(subject.delta(checkpoint, result));
+        EXPECT_EQ(result, "15");
+    }
+
     TEST(SumMetric, sum_of_rate)
     {
         StubTimeFunction time_f({0, 0, 2500, 5000, 1600, 1500});
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "measuro.hpp"
+#include "stubs.hpp"
+
+namespace measuro
+{
+
+    TEST(WindowedMetric, windows)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        WindowedMetric subject("test_name", "req", "test desc", [&dummy_clock]{return dummy_clock;},
+                {std::chrono::seconds(2), std::chrono::seconds(4)}, std::chrono::seconds(1));
+        EXPECT_EQ(subject.kind(), Metric::Kind::WINDOWED);
+        EXPECT_EQ(std::string(subject), "0");
+
+        subject.add(3);            // epoch 0
+        dummy_clock += std::chrono::seconds(1);
+        subject.add();             // epoch 1
+        subject.add(4);
+        dummy_clock += std::chrono::seconds(1);
+        subject.add(2);            // epoch 2, still in progress
+
+        subject.calculate();
+        EXPECT_EQ(std::uint64_t(subject), 8);
+        EXPECT_EQ(std::string(subject), "8");
+
+        auto result = subject.windows();
+        ASSERT_EQ(result.size(), 2);
+        EXPECT_EQ(result[0].length, std::chrono::seconds(2));
+        EXPECT_EQ(result[0].sum, 8);
+        EXPECT_EQ(result[0].max, 5);
+        EXPECT_EQ(result[0].min, 3);
+        EXPECT_EQ(result[1].sum, 8);
+        EXPECT_EQ(result[1].max, 5);
+        EXPECT_EQ(result[1].min, 0);
+
+        // Epochs 0 and 1 drop out of the short window
+        dummy_clock += std::chrono::seconds(2);
+        subject.calculate();
+        result = subject.windows();
+        EXPECT_EQ(result[0].sum, 2);
+        EXPECT_EQ(result[1].sum, 10);
+    }
+
+    TEST(WindowedMetric, rotation)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        WindowedMetric subject("test_name", "req", "test desc", [&dummy_clock]{return dummy_clock;},
+                {std::chrono::seconds(2)}, std::chrono::seconds(1));
+
+        subject.add(100);          // epoch 0
+
+        // Bucket reused by epoch 3: the old count must not survive
+        dummy_clock += std::chrono::seconds(3);
+        subject.add(1);
+        dummy_clock += std::chrono::seconds(1);
+        subject.calculate();
+        EXPECT_EQ(std::uint64_t(subject), 1);
+
+        // Idle for longer than the window
+        dummy_clock += std::chrono::minutes(10);
+        subject.calculate();
+        EXPECT_EQ(std::uint64_t(subject), 0);
+    }
+
+    TEST(WindowedMetric, series)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        WindowedMetric subject("test_name", "req", "test desc", [&dummy_clock]{return dummy_clock;});
+
+        subject.add(6);
+        dummy_clock += std::chrono::seconds(5);
+        subject.calculate();
+
+        auto result = subject.series();
+        ASSERT_EQ(result.size(), 9);
+        EXPECT_EQ(result[0], std::make_pair(std::string("1m"), std::string("6")));
+        EXPECT_EQ(result[1], std::make_pair(std::string("1m.max"), std::string("6")));
+        EXPECT_EQ(result[2], std::make_pair(std::string("1m.min"), std::string("0")));
+        EXPECT_EQ(result[3].first, "5m");
+        EXPECT_EQ(result[6].first, "15m");
+    }
+
+    TEST(WindowedMetric, bad_config)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        EXPECT_THROW(WindowedMetric("test_name", "req", "test desc", [&dummy_clock]{return dummy_clock;},
+                std::vector<std::chrono::milliseconds>(), std::chrono::seconds(1)), MetricConfigError);
+        EXPECT_THROW(WindowedMetric("test_name", "req", "test desc", [&dummy_clock]{return dummy_clock;},
+                {std::chrono::milliseconds(1500)}, std::chrono::seconds(1)), MetricConfigError);
+        EXPECT_THROW(WindowedMetric("test_name", "req", "test desc", [&dummy_clock]{return dummy_clock;},
+                {std::chrono::seconds(1)}, std::chrono::milliseconds::zero()), MetricConfigError);
+    }
+
+    TEST(WindowedMetric, concurrent_add)
+    {
+        std::chrono::steady_clock::time_point dummy_clock;
+        WindowedMetric subject("test_name", "req", "test desc", [&dummy_clock]{return dummy_clock;},
+                {std::chrono::seconds(1)}, std::chrono::seconds(1));
+
+        std::vector<std::thread> threads;
+        for (int thread=0;thread<4;++thread)
+        {
+            threads.push_back(std::thread([&subject]
+            {
+                for (int index=0;index<10000;++index)
+                {
+                    subject.add();
+                }
+            }));
+        }
+
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        dummy_clock += std::chrono::seconds(1);
+        subject.calculate();
+        EXPECT_EQ(std::uint64_t(subject), 40000);
+    }
+
+}